@@ -543,7 +543,19 @@ enum ErrorCode {
   /** Unable to update finalized features due to server error */
   ERR_FEATURE_UPDATE_FAILED = 96,
   /** Request principal deserialization failed during forwarding */
-  ERR_PRINCIPAL_DESERIALIZATION_FAILURE = 97
+  ERR_PRINCIPAL_DESERIALIZATION_FAILURE = 97,
+  /** Unknown Topic Id */
+  ERR_UNKNOWN_TOPIC_ID = 100,
+  /** The member epoch is fenced by the group coordinator */
+  ERR_FENCED_MEMBER_EPOCH = 110,
+  /** The instance ID is still used by another member in the
+   *  consumer group */
+  ERR_UNRELEASED_INSTANCE_ID = 111,
+  /** The assignor or its version range is not supported by the consumer
+   *  group */
+  ERR_UNSUPPORTED_ASSIGNOR = 112,
+  /** The member epoch is stale */
+  ERR_STALE_MEMBER_EPOCH = 113
 };
 
 
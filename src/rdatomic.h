@@ -133,6 +133,35 @@ static RD_INLINE int32_t RD_UNUSED rd_atomic32_set(rd_atomic32_t *ra,
 }
 
 
+/**
+ * @brief Atomically sets \p ra to \p desired if its current value
+ *        is \p expected.
+ *
+ * @returns the value of \p ra prior to the operation, the swap was
+ *          performed if the returned value equals \p expected.
+ */
+static RD_INLINE int32_t RD_UNUSED rd_atomic32_cas(rd_atomic32_t *ra,
+                                                   int32_t expected,
+                                                   int32_t desired) {
+#ifdef __SUNPRO_C
+        return (int32_t)atomic_cas_32((volatile uint32_t *)&ra->val,
+                                      (uint32_t)expected, (uint32_t)desired);
+#elif defined(_WIN32)
+        return InterlockedCompareExchange((LONG *)&ra->val, desired, expected);
+#elif !HAVE_ATOMICS_32
+        int32_t r;
+        mtx_lock(&ra->lock);
+        r = ra->val;
+        if (r == expected)
+                ra->val = desired;
+        mtx_unlock(&ra->lock);
+        return r;
+#else
+        return __sync_val_compare_and_swap(&ra->val, expected, desired);
+#endif
+}
+
+
 
 static RD_INLINE RD_UNUSED void rd_atomic64_init(rd_atomic64_t *ra, int64_t v) {
         ra->val = v;
@@ -223,4 +252,33 @@ static RD_INLINE int64_t RD_UNUSED rd_atomic64_set(rd_atomic64_t *ra,
 #endif
 }
 
+
+/**
+ * @brief Atomically sets \p ra to \p desired if its current value
+ *        is \p expected.
+ *
+ * @returns the value of \p ra prior to the operation, the swap was
+ *          performed if the returned value equals \p expected.
+ */
+static RD_INLINE int64_t RD_UNUSED rd_atomic64_cas(rd_atomic64_t *ra,
+                                                   int64_t expected,
+                                                   int64_t desired) {
+#ifdef __SUNPRO_C
+        return (int64_t)atomic_cas_64((volatile uint64_t *)&ra->val,
+                                      (uint64_t)expected, (uint64_t)desired);
+#elif defined(_WIN32)
+        return InterlockedCompareExchange64(&ra->val, desired, expected);
+#elif !HAVE_ATOMICS_64
+        int64_t r;
+        mtx_lock(&ra->lock);
+        r = ra->val;
+        if (r == expected)
+                ra->val = desired;
+        mtx_unlock(&ra->lock);
+        return r;
+#else
+        return __sync_val_compare_and_swap(&ra->val, expected, desired);
+#endif
+}
+
 #endif /* _RDATOMIC_H_ */
@@ -191,6 +191,30 @@ void rd_buf_write_ensure_contig(rd_buf_t *rbuf, size_t size) {
         rbuf->rbuf_wpos = rd_buf_alloc_segment(rbuf, size, size);
 }
 
+/**
+ * @brief Same as rd_buf_write_ensure_contig() but uses the caller-provided
+ *        memory \p mem of \p size bytes for the new segment, which will be
+ *        freed with \p free_cb when the segment is destroyed.
+ *
+ *        The new segment is always appended, any remaining space in the
+ *        current write segment is left unused.
+ */
+void rd_buf_write_ensure_contig_mem(rd_buf_t *rbuf,
+                                    void *mem,
+                                    size_t size,
+                                    void (*free_cb)(void *)) {
+        rd_segment_t *seg;
+
+        seg           = rd_buf_alloc_segment0(rbuf, 0);
+        seg->seg_p    = mem;
+        seg->seg_size = size;
+        seg->seg_free = free_cb;
+
+        rd_buf_append_segment(rbuf, seg);
+
+        rbuf->rbuf_wpos = seg;
+}
+
 /**
  * @brief Ensures that at least \p size bytes will be available for
  *        a future write.
@@ -334,6 +358,28 @@ void rd_buf_destroy(rd_buf_t *rbuf) {
 }
 
 
+/**
+ * @brief Destroy all segments and reset the buffer to the state of a
+ *        newly initialized buffer, retaining the pre-allocated extra memory
+ *        (see rd_buf_init()) for reuse.
+ */
+void rd_buf_reset(rd_buf_t *rbuf) {
+        rd_segment_t *seg, *tmp;
+        char *extra       = rbuf->rbuf_extra;
+        size_t extra_size = rbuf->rbuf_extra_size;
+
+        TAILQ_FOREACH_SAFE(seg, &rbuf->rbuf_segments, seg_link, tmp) {
+                rd_segment_destroy(seg);
+        }
+
+        memset(rbuf, 0, sizeof(*rbuf));
+        TAILQ_INIT(&rbuf->rbuf_segments);
+
+        rbuf->rbuf_extra      = extra;
+        rbuf->rbuf_extra_size = extra_size;
+}
+
+
 /**
  * @brief Same as rd_buf_destroy() but also frees the \p rbuf itself.
  */
@@ -767,6 +813,39 @@ size_t rd_buf_get_write_iov(const rd_buf_t *rbuf,
 
 
 
+/**
+ * @returns the amount of memory owned by the buffer: the extra memory,
+ *          segment headers and segment backing memory allocated by or
+ *          handed over to the buffer.
+ *
+ * Memory pushed to the buffer without a free callback is owned by
+ * someone else (e.g., message payloads) and is not included.
+ *
+ * @remark The unused tail of a segment that was split by rd_buf_push()
+ *         is not included.
+ */
+size_t rd_buf_mem_size(const rd_buf_t *rbuf) {
+        const rd_segment_t *seg;
+        const char *extra_end = rbuf->rbuf_extra + rbuf->rbuf_extra_size;
+        size_t size           = rbuf->rbuf_extra_size;
+
+        TAILQ_FOREACH(seg, &rbuf->rbuf_segments, seg_link) {
+                if (seg->seg_p >= rbuf->rbuf_extra && seg->seg_p < extra_end)
+                        continue; /* Header and memory both in extra */
+
+                if (!((const char *)seg >= rbuf->rbuf_extra &&
+                      (const char *)seg < extra_end))
+                        size += sizeof(*seg);
+
+                if (seg->seg_free || seg->seg_p == (const char *)(seg + 1))
+                        size += seg->seg_size;
+        }
+
+        return size;
+}
+
+
+
 /**
  * @name Slice reader interface
  *
@@ -1676,6 +1755,54 @@ static int do_unittest_write_iov(void) {
         RD_UT_PASS();
 }
 
+/**
+ * @brief Verify that owned memory is accounted for, but not pushed
+ *        memory without a free callback.
+ */
+static int do_unittest_mem_size(void) {
+        rd_buf_t b;
+        static char foreign[1000];
+        size_t base, size;
+
+        rd_buf_init(&b, 1, 1000);
+        base = rd_buf_mem_size(&b);
+        RD_UT_ASSERT(base >= 1000, "expected >= 1000 bytes, not %" PRIusz,
+                     base);
+
+        /* Fits in the fixed segment in the extra memory */
+        rd_buf_write(&b, foreign, 50);
+        size = rd_buf_mem_size(&b);
+        RD_UT_ASSERT(size == base, "expected %" PRIusz ", not %" PRIusz, base,
+                     size);
+
+        /* Foreign memory is not owned by the buffer */
+        rd_buf_push(&b, foreign, sizeof(foreign), NULL);
+        size = rd_buf_mem_size(&b);
+        RD_UT_ASSERT(size < base + sizeof(foreign),
+                     "pushed foreign memory should not be accounted for: "
+                     "%" PRIusz " >= %" PRIusz,
+                     size, base + sizeof(foreign));
+
+        /* Memory handed over with a free callback is owned. */
+        rd_buf_push(&b, rd_malloc(2000), 2000, rd_free);
+        size = rd_buf_mem_size(&b);
+        RD_UT_ASSERT(size >= base + 2000,
+                     "expected >= %" PRIusz ", not %" PRIusz, base + 2000,
+                     size);
+
+        /* Growing the buffer allocates new segments */
+        base = size;
+        rd_buf_write(&b, foreign, sizeof(foreign));
+        size = rd_buf_mem_size(&b);
+        RD_UT_ASSERT(size >= base + sizeof(foreign),
+                     "expected >= %" PRIusz ", not %" PRIusz,
+                     base + sizeof(foreign), size);
+
+        rd_buf_destroy(&b);
+
+        RD_UT_PASS();
+}
+
 /**
  * @brief Verify that erasing parts of the buffer works.
  */
@@ -1874,6 +2001,7 @@ int unittest_rdbuf(void) {
         fails += do_unittest_write_split_seek();
         fails += do_unittest_write_read_payload_correctness();
         fails += do_unittest_write_iov();
+        fails += do_unittest_mem_size();
         fails += do_unittest_erase();
 
         return fails;
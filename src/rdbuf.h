@@ -209,6 +209,11 @@ size_t rd_buf_get_writable(rd_buf_t *rbuf, void **p);
 
 void rd_buf_write_ensure_contig(rd_buf_t *rbuf, size_t size);
 
+void rd_buf_write_ensure_contig_mem(rd_buf_t *rbuf,
+                                    void *mem,
+                                    size_t size,
+                                    void (*free_cb)(void *));
+
 void rd_buf_write_ensure(rd_buf_t *rbuf, size_t min_size, size_t max_size);
 
 size_t rd_buf_get_write_iov(const rd_buf_t *rbuf,
@@ -222,6 +227,9 @@ rd_buf_t *rd_buf_new(size_t fixed_seg_cnt, size_t buf_size);
 
 void rd_buf_destroy(rd_buf_t *rbuf);
 void rd_buf_destroy_free(rd_buf_t *rbuf);
+void rd_buf_reset(rd_buf_t *rbuf);
+
+size_t rd_buf_mem_size(const rd_buf_t *rbuf);
 
 void rd_buf_dump(const rd_buf_t *rbuf, int do_hexdump);
 
@@ -45,6 +45,7 @@
 #include "rdkafka_topic.h"
 #include "rdkafka_partition.h"
 #include "rdkafka_offset.h"
+#include "rdkafka_fetcher.h"
 #include "rdkafka_transport.h"
 #include "rdkafka_cgrp.h"
 #include "rdkafka_assignor.h"
@@ -699,6 +700,17 @@ static const struct rd_kafka_err_desc rd_kafka_err_descs[] = {
     _ERR_DESC(RD_KAFKA_RESP_ERR_PRINCIPAL_DESERIALIZATION_FAILURE,
               "Broker: Request principal deserialization failed during "
               "forwarding"),
+    _ERR_DESC(RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_ID, "Broker: Unknown topic id"),
+    _ERR_DESC(RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH,
+              "Broker: The member epoch is fenced by the group coordinator"),
+    _ERR_DESC(RD_KAFKA_RESP_ERR_UNRELEASED_INSTANCE_ID,
+              "Broker: The instance ID is still used by another member in the "
+              "consumer group"),
+    _ERR_DESC(RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR,
+              "Broker: The assignor or its version range is not supported by "
+              "the consumer group"),
+    _ERR_DESC(RD_KAFKA_RESP_ERR_STALE_MEMBER_EPOCH,
+              "Broker: The member epoch is stale"),
 
     _ERR_DESC(RD_KAFKA_RESP_ERR__END, NULL)};
 
@@ -1035,7 +1047,7 @@ static void rd_kafka_destroy_app(rd_kafka_t *rk, int flags) {
                 unsigned int tot_cnt;
                 size_t tot_size;
 
-                rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size);
+                rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size, NULL);
 
                 if (tot_cnt > 0)
                         rd_kafka_log(rk, LOG_WARNING, "TERMINATE",
@@ -1276,6 +1288,10 @@ static void rd_kafka_destroy_internal(rd_kafka_t *rk) {
 
         rd_list_destroy(&wait_thrds);
 
+        /* Join decode threads, after the broker threads since they are
+         * the only ones to hand them jobs. */
+        rd_kafka_fetch_decode_pool_term(rk);
+
         /* Destroy mock cluster */
         if (rk->rk_mock.cluster)
                 rd_kafka_mock_cluster_destroy(rk->rk_mock.cluster);
@@ -1395,10 +1411,13 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
         int64_t consumer_lag        = -1;
         int64_t consumer_lag_stored = -1;
         struct offset_stats offs;
+        rd_kafka_fetch_pos_t stored_pos;
         int32_t broker_id = -1;
 
         rd_kafka_toppar_lock(rktp);
 
+        stored_pos = rd_kafka_toppar_stored_pos(rktp);
+
         if (rktp->rktp_broker) {
                 rd_kafka_broker_lock(rktp->rktp_broker);
                 broker_id = rktp->rktp_broker->rkb_nodeid;
@@ -1421,10 +1440,8 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
          * offsets are not (yet) committed.
          */
         if (end_offset != RD_KAFKA_OFFSET_INVALID) {
-                if (rktp->rktp_stored_pos.offset >= 0 &&
-                    rktp->rktp_stored_pos.offset <= end_offset)
-                        consumer_lag_stored =
-                            end_offset - rktp->rktp_stored_pos.offset;
+                if (stored_pos.offset >= 0 && stored_pos.offset <= end_offset)
+                        consumer_lag_stored = end_offset - stored_pos.offset;
                 if (rktp->rktp_committed_pos.offset >= 0 &&
                     rktp->rktp_committed_pos.offset <= end_offset)
                         consumer_lag =
@@ -1451,6 +1468,8 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
             "\"fetchq_cnt\":%i, "
             "\"fetchq_size\":%" PRIu64
             ", "
+            "\"prefetch_size\":%" PRId64
+            ", "
             "\"fetch_state\":\"%s\", "
             "\"query_offset\":%" PRId64
             ", "
@@ -1494,6 +1513,12 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
             ", "
             "\"rx_ver_drops\": %" PRIu64
             ", "
+            "\"rx_aborted_msgs\": %" PRIu64
+            ", "
+            "\"rx_aborted_bytes\": %" PRIu64
+            ", "
+            "\"rx_filtered_msgs\": %" PRIu64
+            ", "
             "\"msgs_inflight\": %" PRId32
             ", "
             "\"next_ack_seq\": %" PRId32
@@ -1510,10 +1535,11 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
             /* FIXME: xmit_msgq is local to the broker thread. */
             0, (size_t)0, rd_kafka_q_len(rktp->rktp_fetchq),
             rd_kafka_q_size(rktp->rktp_fetchq),
+            rd_atomic64_get(&rktp->rktp_prefetch_bytes),
             rd_kafka_fetch_states[rktp->rktp_fetch_state],
             rktp->rktp_query_pos.offset, offs.fetch_pos.offset,
-            rktp->rktp_app_pos.offset, rktp->rktp_stored_pos.offset,
-            rktp->rktp_stored_pos.leader_epoch,
+            rktp->rktp_app_pos.offset, stored_pos.offset,
+            stored_pos.leader_epoch,
             rktp->rktp_committed_pos.offset, /* FIXME: issue #80 */
             rktp->rktp_committed_pos.offset,
             rktp->rktp_committed_pos.leader_epoch, offs.eof_offset,
@@ -1528,6 +1554,9 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
                 : rd_atomic64_get(
                       &rktp->rktp_c.rx_msgs), /* legacy, same as rx_msgs */
             rd_atomic64_get(&rktp->rktp_c.rx_ver_drops),
+            rd_atomic64_get(&rktp->rktp_c.rx_aborted_msgs),
+            rd_atomic64_get(&rktp->rktp_c.rx_aborted_bytes),
+            rd_atomic64_get(&rktp->rktp_c.rx_filtered_msgs),
             rd_atomic32_get(&rktp->rktp_msgs_inflight),
             rktp->rktp_eos.next_ack_seq, rktp->rktp_eos.next_err_seq,
             rktp->rktp_eos.acked_msgid);
@@ -1544,6 +1573,54 @@ static RD_INLINE void rd_kafka_stats_emit_toppar(struct _stats_emit *st,
         rd_kafka_toppar_unlock(rktp);
 }
 
+/**
+ * @brief Emit buffer pool stats
+ */
+static void rd_kafka_stats_emit_buf_pool(struct _stats_emit *st,
+                                         const char *name,
+                                         rd_kafka_buf_pool_t *rkbp) {
+        mtx_lock(&rkbp->rkbp_lock);
+        _st_printf("\"%s\": { "
+                   "\"cnt\":%d, "
+                   "\"size\":%" PRIusz
+                   ", "
+                   "\"max_size\":%" PRIusz
+                   ", "
+                   "\"hits\":%" PRIu64
+                   ", "
+                   "\"misses\":%" PRIu64
+                   ", "
+                   "\"discards\":%" PRIu64 " }, ",
+                   name, rkbp->rkbp_cnt, rkbp->rkbp_size, rkbp->rkbp_max_size,
+                   rkbp->rkbp_c.hits, rkbp->rkbp_c.misses,
+                   rkbp->rkbp_c.discards);
+        mtx_unlock(&rkbp->rkbp_lock);
+}
+
+/**
+ * @brief Emit receive buffer pool stats for \p rkrp.
+ */
+static void rd_kafka_stats_emit_rxbuf_pool(struct _stats_emit *st,
+                                           const char *name,
+                                           rd_kafka_rxbuf_pool_t *rkrp) {
+        mtx_lock(&rkrp->rkrp_lock);
+        _st_printf("\"%s\": { "
+                   "\"cnt\":%d, "
+                   "\"size\":%" PRIusz
+                   ", "
+                   "\"max_size\":%" PRIusz
+                   ", "
+                   "\"hits\":%" PRIu64
+                   ", "
+                   "\"misses\":%" PRIu64
+                   ", "
+                   "\"discards\":%" PRIu64 " }, ",
+                   name, rkrp->rkrp_cnt, rkrp->rkrp_size, rkrp->rkrp_max_size,
+                   rkrp->rkrp_c.hits, rkrp->rkrp_c.misses,
+                   rkrp->rkrp_c.discards);
+        mtx_unlock(&rkrp->rkrp_lock);
+}
+
 /**
  * @brief Emit broker request type stats
  */
@@ -1557,7 +1634,9 @@ static void rd_kafka_stats_emit_broker_reqs(struct _stats_emit *st,
                                    [RD_KAFKAP_JoinGroup]    = rd_true,
                                    [RD_KAFKAP_Heartbeat]    = rd_true,
                                    [RD_KAFKAP_LeaveGroup]   = rd_true,
-                                   [RD_KAFKAP_SyncGroup]    = rd_true},
+                                   [RD_KAFKAP_SyncGroup]    = rd_true,
+                                   [RD_KAFKAP_ConsumerGroupHeartbeat] =
+                                       rd_true},
             [RD_KAFKA_CONSUMER] =
                 {
                     [RD_KAFKAP_Produce]        = rd_true,
@@ -1625,6 +1704,8 @@ static void rd_kafka_stats_emit_broker_reqs(struct _stats_emit *st,
                 [RD_KAFKAP_AlterClientQuotas]            = rd_true,
                 [RD_KAFKAP_DescribeUserScramCredentials] = rd_true,
                 [RD_KAFKAP_AlterUserScramCredentials]    = rd_true,
+                /* Only used by the consumer group protocol */
+                [RD_KAFKAP_ConsumerGroupHeartbeat] = rd_true,
             }};
         int i;
         int cnt = 0;
@@ -1658,7 +1739,7 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
         rd_ts_t now;
         rd_kafka_op_t *rko;
         unsigned int tot_cnt;
-        size_t tot_size;
+        size_t tot_size, tot_mem;
         rd_kafka_resp_err_t err;
         struct _stats_emit stx    = {.size = 1024 * 10};
         struct _stats_emit *st    = &stx;
@@ -1667,7 +1748,7 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
         st->buf = rd_malloc(st->size);
 
 
-        rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size);
+        rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size, &tot_mem);
         rd_kafka_rdlock(rk);
 
         now = rd_clock();
@@ -1688,6 +1769,14 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
             "\"msg_max\":%u, "
             "\"msg_size_max\":%" PRIusz
             ", "
+            "\"msg_mem\":%" PRIusz
+            ", "
+            "\"msg_mem_max\":%" PRIusz
+            ", "
+            "\"prefetch_size\":%" PRId64
+            ", "
+            "\"prefetch_size_max\":%" PRId64
+            ", "
             "\"simple_cnt\":%i, "
             "\"metadata_cache_cnt\":%i, "
             "\"brokers\":{ " /*open brokers*/,
@@ -1695,6 +1784,9 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
             rd_kafka_type2str(rk->rk_type), now, (signed long long)time(NULL),
             now - rk->rk_ts_created, rd_kafka_q_len(rk->rk_rep), tot_cnt,
             tot_size, rk->rk_curr_msgs.max_cnt, rk->rk_curr_msgs.max_size,
+            tot_mem, rk->rk_curr_msgs.max_mem,
+            rd_atomic64_get(&rk->rk_consumer.prefetch.bytes),
+            rk->rk_conf.queued_max_total_bytes,
             rd_atomic32_get(&rk->rk_simple_cnt),
             rk->rk_metadata_cache.rkmc_cnt);
 
@@ -1807,6 +1899,11 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
 
                 rd_kafka_stats_emit_broker_reqs(st, rkb);
 
+                rd_kafka_stats_emit_buf_pool(st, "buf_pool",
+                                             &rkb->rkb_buf_pool);
+                rd_kafka_stats_emit_rxbuf_pool(st, "rxbuf_pool",
+                                               &rkb->rkb_rxbuf_pool);
+
                 _st_printf("\"toppars\":{ " /*open toppars*/);
 
                 TAILQ_FOREACH(rktp, &rkb->rkb_toppars, rktp_rkblink) {
@@ -1890,8 +1987,7 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
                     "\"rebalance_age\": %" PRId64
                     ", "
                     "\"rebalance_cnt\": %d, "
-                    "\"rebalance_reason\": \"%s\", "
-                    "\"assignment_size\": %d }",
+                    "\"rebalance_reason\": \"%s\", ",
                     rd_kafka_cgrp_state_names[rkcg->rkcg_state],
                     rkcg->rkcg_ts_statechange
                         ? (now - rkcg->rkcg_ts_statechange) / 1000
@@ -1900,8 +1996,11 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
                     rkcg->rkcg_c.ts_rebalance
                         ? (now - rkcg->rkcg_c.ts_rebalance) / 1000
                         : 0,
-                    rkcg->rkcg_c.rebalance_cnt, rkcg->rkcg_c.rebalance_reason,
-                    rkcg->rkcg_c.assignment_size);
+                    rkcg->rkcg_c.rebalance_cnt, rkcg->rkcg_c.rebalance_reason);
+                rd_kafka_stats_emit_avg(st, "rebalance_latency",
+                                        &rkcg->rkcg_rebalance_latency.latency);
+                _st_printf("\"assignment_size\": %d }",
+                           rkcg->rkcg_c.assignment_size);
         }
 
         if (rd_kafka_is_idempotent(rk)) {
@@ -1917,8 +2016,7 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
                     "\"producer_id\": %" PRId64
                     ", "
                     "\"producer_epoch\": %hd, "
-                    "\"epoch_cnt\": %d "
-                    "}",
+                    "\"epoch_cnt\": %d",
                     rd_kafka_idemp_state2str(rk->rk_eos.idemp_state),
                     (now - rk->rk_eos.ts_idemp_state) / 1000,
                     rd_kafka_txn_state2str(rk->rk_eos.txn_state),
@@ -1926,6 +2024,39 @@ static void rd_kafka_stats_emit_all(rd_kafka_t *rk) {
                     rd_atomic32_get(&rk->rk_eos.txn_may_enq) ? "true" : "false",
                     rk->rk_eos.pid.id, rk->rk_eos.pid.epoch,
                     rk->rk_eos.epoch_cnt);
+
+                if (rd_kafka_is_transactional(rk)) {
+                        rd_kafka_txn_state_t state;
+
+                        _st_printf(
+                            ", \"txn_addparts_cnt\": %" PRId64
+                            ", "
+                            "\"txn_addparts_rtt_avg\": %" PRId64
+                            ", "
+                            "\"txn_state_time\": { ",
+                            rk->rk_eos.txn_addparts_cnt,
+                            rk->rk_eos.txn_addparts_cnt
+                                ? rk->rk_eos.txn_addparts_rtt /
+                                      rk->rk_eos.txn_addparts_cnt
+                                : 0);
+
+                        for (state = 0; state < RD_KAFKA_TXN_STATE__CNT;
+                             state++) {
+                                rd_ts_t t = rk->rk_eos.txn_state_time[state];
+
+                                if (state == rk->rk_eos.txn_state)
+                                        t += now - rk->rk_eos.ts_txn_state;
+
+                                _st_printf("%s\"%s\": %" PRId64,
+                                           state > 0 ? ", " : "",
+                                           rd_kafka_txn_state2str(state),
+                                           t / 1000);
+                        }
+
+                        _st_printf(" }");
+                }
+
+                _st_printf(" }");
         }
 
         if ((err = rd_atomic32_get(&rk->rk_fatal.err)))
@@ -2072,6 +2203,7 @@ static int rd_kafka_thread_main(void *arg) {
         rd_kafka_timer_t tmr_1s               = RD_ZERO_INIT;
         rd_kafka_timer_t tmr_stats_emit       = RD_ZERO_INIT;
         rd_kafka_timer_t tmr_metadata_refresh = RD_ZERO_INIT;
+        rd_kafka_timer_t tmr_consumer_lag     = RD_ZERO_INIT;
 
         rd_kafka_set_thread_name("main");
         rd_kafka_set_thread_sysname("rdk:main");
@@ -2098,6 +2230,22 @@ static int rd_kafka_thread_main(void *arg) {
                                          1000ll,
                                      rd_kafka_metadata_refresh_cb, NULL);
 
+        /* Consumer: If statistics is available we query the log start offset
+         * of all partitions.
+         * Since the oldest offset only moves on log retention, we cap this
+         * value on the low end to a reasonable value to avoid flooding
+         * the brokers with OffsetRequests when our statistics interval is low.
+         * FIXME: This timer is superfulous for FETCH >= v5 because the log
+         *        start offset is included in fetch responses.
+         * */
+        if (rk->rk_conf.stats_interval_ms > 0 &&
+            rk->rk_type == RD_KAFKA_CONSUMER)
+                rd_kafka_timer_start(
+                    &rk->rk_timers, &tmr_consumer_lag,
+                    RD_MAX(rk->rk_conf.stats_interval_ms, 10 * 1000 /*10s*/) *
+                        1000ll,
+                    rd_kafka_consumer_lag_tmr_cb, NULL);
+
         if (rk->rk_cgrp)
                 rd_kafka_q_fwd_set(rk->rk_cgrp->rkcg_ops, rk->rk_ops);
 
@@ -2134,6 +2282,7 @@ static int rd_kafka_thread_main(void *arg) {
         if (rk->rk_conf.stats_interval_ms)
                 rd_kafka_timer_stop(&rk->rk_timers, &tmr_stats_emit, 1);
         rd_kafka_timer_stop(&rk->rk_timers, &tmr_metadata_refresh, 1);
+        rd_kafka_timer_stop(&rk->rk_timers, &tmr_consumer_lag, 1);
 
         /* Synchronise state */
         rd_kafka_wrlock(rk);
@@ -2325,6 +2474,10 @@ rd_kafka_t *rd_kafka_new(rd_kafka_type_t type,
         /* Config fixups */
         rk->rk_conf.queued_max_msg_bytes =
             (int64_t)rk->rk_conf.queued_max_msg_kbytes * 1000ll;
+        rk->rk_conf.queued_max_total_bytes =
+            (int64_t)rk->rk_conf.queued_max_total_kbytes * 1024ll;
+        rd_atomic64_init(&rk->rk_consumer.prefetch.bytes, 0);
+        rd_atomic32_init(&rk->rk_consumer.prefetch.toppar_cnt, 0);
 
         /* Enable api.version.request=true if fallback.broker.version
          * indicates a supporting broker. */
@@ -2350,6 +2503,11 @@ rd_kafka_t *rd_kafka_new(rd_kafka_type_t type,
                             (size_t)rk->rk_conf.queue_buffering_max_kbytes *
                             1024;
                 }
+                rk->rk_curr_msgs.max_mem =
+                    (size_t)RD_MIN((unsigned long long)rk->rk_conf
+                                           .queue_buffering_max_memory_kbytes *
+                                       1024,
+                                   (unsigned long long)SIZE_MAX);
         }
 
         if (rd_kafka_assignors_init(rk, errstr, errstr_size) == -1) {
@@ -2515,6 +2673,9 @@ rd_kafka_t *rd_kafka_new(rd_kafka_type_t type,
          * @warning `goto fail` is prohibited past this point
          */
 
+        /* Start the fetch response decode worker pool, if configured */
+        rd_kafka_fetch_decode_pool_init(rk);
+
         mtx_lock(&rk->rk_internal_rkb_lock);
         rk->rk_internal_rkb =
             rd_kafka_broker_add(rk, RD_KAFKA_INTERNAL, RD_KAFKA_PROTO_PLAINTEXT,
@@ -3006,6 +3167,128 @@ ssize_t rd_kafka_consume_batch_queue(rd_kafka_queue_t *rkqu,
 }
 
 
+rd_kafka_message_columns_t *rd_kafka_message_columns_new(size_t size) {
+        rd_kafka_message_columns_t *cols;
+
+        cols            = rd_calloc(1, sizeof(*cols));
+        cols->size      = size;
+        cols->err       = rd_calloc(size, sizeof(*cols->err));
+        cols->rkt       = rd_calloc(size, sizeof(*cols->rkt));
+        cols->partition = rd_calloc(size, sizeof(*cols->partition));
+        cols->offset    = rd_calloc(size, sizeof(*cols->offset));
+        cols->timestamp = rd_calloc(size, sizeof(*cols->timestamp));
+        cols->key       = rd_calloc(size, sizeof(*cols->key));
+        cols->key_len   = rd_calloc(size, sizeof(*cols->key_len));
+        cols->payload   = rd_calloc(size, sizeof(*cols->payload));
+        cols->len       = rd_calloc(size, sizeof(*cols->len));
+        cols->rko       = rd_calloc(size, sizeof(*cols->rko));
+
+        return cols;
+}
+
+void rd_kafka_message_columns_clear(rd_kafka_message_columns_t *cols) {
+        size_t i;
+
+        for (i = 0; i < cols->cnt; i++) {
+                rd_kafka_op_destroy(cols->rko[i]);
+                cols->rko[i] = NULL;
+        }
+
+        cols->cnt = 0;
+}
+
+void rd_kafka_message_columns_destroy(rd_kafka_message_columns_t *cols) {
+        rd_kafka_message_columns_clear(cols);
+
+        rd_free(cols->err);
+        rd_free(cols->rkt);
+        rd_free(cols->partition);
+        rd_free(cols->offset);
+        rd_free(cols->timestamp);
+        rd_free(cols->key);
+        rd_free(cols->key_len);
+        rd_free(cols->payload);
+        rd_free(cols->len);
+        rd_free(cols->rko);
+        rd_free(cols);
+}
+
+size_t rd_kafka_message_columns_cnt(const rd_kafka_message_columns_t *cols) {
+        return cols->cnt;
+}
+
+const rd_kafka_resp_err_t *
+rd_kafka_message_columns_err(const rd_kafka_message_columns_t *cols) {
+        return cols->err;
+}
+
+rd_kafka_topic_t *const *
+rd_kafka_message_columns_topic(const rd_kafka_message_columns_t *cols) {
+        return cols->rkt;
+}
+
+const int32_t *
+rd_kafka_message_columns_partition(const rd_kafka_message_columns_t *cols) {
+        return cols->partition;
+}
+
+const int64_t *
+rd_kafka_message_columns_offset(const rd_kafka_message_columns_t *cols) {
+        return cols->offset;
+}
+
+const int64_t *
+rd_kafka_message_columns_timestamp(const rd_kafka_message_columns_t *cols) {
+        return cols->timestamp;
+}
+
+const void *const *
+rd_kafka_message_columns_key(const rd_kafka_message_columns_t *cols) {
+        return cols->key;
+}
+
+const size_t *
+rd_kafka_message_columns_key_len(const rd_kafka_message_columns_t *cols) {
+        return cols->key_len;
+}
+
+const void *const *
+rd_kafka_message_columns_payload(const rd_kafka_message_columns_t *cols) {
+        return cols->payload;
+}
+
+const size_t *
+rd_kafka_message_columns_len(const rd_kafka_message_columns_t *cols) {
+        return cols->len;
+}
+
+rd_kafka_resp_err_t
+rd_kafka_message_columns_headers(const rd_kafka_message_columns_t *cols,
+                                 size_t row,
+                                 rd_kafka_headers_t **hdrsp) {
+        rd_kafka_op_t *rko;
+
+        if (row >= cols->cnt)
+                return RD_KAFKA_RESP_ERR__INVALID_ARG;
+
+        rko = cols->rko[row];
+        if (rko->rko_type != RD_KAFKA_OP_FETCH || cols->err[row])
+                return RD_KAFKA_RESP_ERR__NOENT;
+
+        return rd_kafka_message_headers(&rko->rko_u.fetch.rkm.rkm_rkmessage,
+                                        hdrsp);
+}
+
+ssize_t rd_kafka_consume_columns_queue(rd_kafka_queue_t *rkqu,
+                                       int timeout_ms,
+                                       rd_kafka_message_columns_t *cols) {
+        /* Release the previous batch's messages */
+        rd_kafka_message_columns_clear(cols);
+
+        return rd_kafka_q_serve_columns(rkqu->rkqu_q, timeout_ms, cols);
+}
+
+
 struct consume_ctx {
         void (*consume_cb)(rd_kafka_message_t *rkmessage, void *opaque);
         void *opaque;
@@ -3619,6 +3902,37 @@ rd_kafka_resp_err_t rd_kafka_query_watermark_offsets(rd_kafka_t *rk,
 }
 
 
+/**
+ * @brief Look up a partition known to the client, either from metadata
+ *        or as a desired partition, without creating any local topic or
+ *        partition state.
+ *
+ * @returns a new reference to the partition, or NULL if it is unknown.
+ *
+ * @locks none
+ * @locality any
+ */
+static rd_kafka_toppar_t *rd_kafka_toppar_get_known(rd_kafka_t *rk,
+                                                    const char *topic,
+                                                    int32_t partition) {
+        rd_kafka_topic_t *rkt;
+        rd_kafka_toppar_t *rktp;
+
+        if (!(rkt = rd_kafka_topic_find(rk, topic, 1 /*lock*/)))
+                return NULL;
+
+        rd_kafka_topic_rdlock(rkt);
+        rktp = rd_kafka_toppar_get(rkt, partition, 0 /*no ua on miss*/);
+        if (!rktp)
+                rktp = rd_kafka_toppar_desired_get(rkt, partition);
+        rd_kafka_topic_rdunlock(rkt);
+
+        rd_kafka_topic_destroy0(rkt);
+
+        return rktp;
+}
+
+
 rd_kafka_resp_err_t rd_kafka_get_watermark_offsets(rd_kafka_t *rk,
                                                    const char *topic,
                                                    int32_t partition,
@@ -3641,6 +3955,28 @@ rd_kafka_resp_err_t rd_kafka_get_watermark_offsets(rd_kafka_t *rk,
 }
 
 
+rd_kafka_resp_err_t rd_kafka_fetch_priority_set(rd_kafka_t *rk,
+                                                const char *topic,
+                                                int32_t partition,
+                                                int priority) {
+        rd_kafka_toppar_t *rktp;
+
+        if (priority < 1 || priority > 1000)
+                return RD_KAFKA_RESP_ERR__INVALID_ARG;
+
+        rktp = rd_kafka_toppar_get_known(rk, topic, partition);
+        if (!rktp)
+                return RD_KAFKA_RESP_ERR__UNKNOWN_PARTITION;
+
+        /* Picked up by the broker thread on its next FetchRequest. */
+        rd_atomic32_set(&rktp->rktp_fetch_priority, priority);
+
+        rd_kafka_toppar_destroy(rktp);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
 /**
  * @brief get_offsets_for_times() state
  */
@@ -4133,9 +4469,9 @@ static void rd_kafka_dump0(FILE *fp, rd_kafka_t *rk, int locks) {
         rd_kafka_toppar_t *rktp;
         int i;
         unsigned int tot_cnt;
-        size_t tot_size;
+        size_t tot_size, tot_mem;
 
-        rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size);
+        rd_kafka_curr_msgs_get(rk, &tot_cnt, &tot_size, &tot_mem);
 
         if (locks)
                 rd_kafka_rdlock(rk);
@@ -4144,8 +4480,10 @@ static void rd_kafka_dump0(FILE *fp, rd_kafka_t *rk, int locks) {
 #endif
         fprintf(fp, "rd_kafka_t %p: %s\n", rk, rk->rk_name);
 
-        fprintf(fp, " producer.msg_cnt %u (%" PRIusz " bytes)\n", tot_cnt,
-                tot_size);
+        fprintf(fp,
+                " producer.msg_cnt %u (%" PRIusz " bytes, %" PRIusz
+                " bytes of memory)\n",
+                tot_cnt, tot_size, tot_mem);
         fprintf(fp, " rk_rep reply queue: %i ops\n",
                 rd_kafka_q_len(rk->rk_rep));
 
@@ -629,6 +629,18 @@ typedef enum {
         RD_KAFKA_RESP_ERR_FEATURE_UPDATE_FAILED = 96,
         /** Request principal deserialization failed during forwarding */
         RD_KAFKA_RESP_ERR_PRINCIPAL_DESERIALIZATION_FAILURE = 97,
+        /** Unknown Topic Id */
+        RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_ID = 100,
+        /** The member epoch is fenced by the group coordinator */
+        RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH = 110,
+        /** The instance ID is still used by another member in the
+         *  consumer group */
+        RD_KAFKA_RESP_ERR_UNRELEASED_INSTANCE_ID = 111,
+        /** The assignor or its version range is not supported by the consumer
+         *  group */
+        RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR = 112,
+        /** The member epoch is stale */
+        RD_KAFKA_RESP_ERR_STALE_MEMBER_EPOCH = 113,
 
         RD_KAFKA_RESP_ERR_END_ALL,
 } rd_kafka_resp_err_t;
@@ -1315,6 +1327,33 @@ RD_EXPORT void rd_kafka_headers_destroy(rd_kafka_headers_t *hdrs);
 RD_EXPORT rd_kafka_headers_t *
 rd_kafka_headers_copy(const rd_kafka_headers_t *src);
 
+/**
+ * @brief Create a new headers list from headers in the Kafka protocol
+ *        wire-format.
+ *
+ * \p buf of \p size bytes holds zero or more serialized headers as laid
+ * out in the MessageSet v2 (KIP-82) Headers array, without the leading
+ * HeaderCount, i.e., for each header:
+ * varint(KeyLength), Key, varint(ValueLength), Value,
+ * where the lengths are zig-zag encoded varints and a ValueLength of -1
+ * denotes a null value.
+ *
+ * This allows applications that propagate the same set of headers
+ * on many messages (e.g., tracing context) to encode them once.
+ * \p buf is only validated by this call: the individual headers are not
+ * parsed until they are first accessed or modified through the headers API.
+ * The serialized form is retained on the returned headers list and is
+ * written as-is by the producer, unless the list is subsequently modified.
+ *
+ * @remark \p buf is copied and may be freed after this call returns.
+ *
+ * @returns a new headers list which the application must either pass to
+ *          the producer or destroy with rd_kafka_headers_destroy(),
+ *          or NULL if \p buf could not be parsed.
+ */
+RD_EXPORT rd_kafka_headers_t *rd_kafka_headers_new_from_wire(const void *buf,
+                                                             size_t size);
+
 /**
  * @brief Add header with name \p name and value \p val (copied) of size
  *        \p size (not including null-terminator).
@@ -1561,6 +1600,74 @@ rd_kafka_message_detach_headers(rd_kafka_message_t *rkmessage,
                                 rd_kafka_headers_t **hdrsp);
 
 
+/**
+ * @brief Find the last header named \p name in message \p rkmessage
+ *        without parsing or copying the message's headers.
+ *
+ * Unlike rd_kafka_message_headers() this function does not allocate:
+ * for consumed messages the raw protocol headers are scanned in place and
+ * \p *valuep is set to point directly into the fetched message data.
+ * This makes it suitable for looking up a single header, e.g., a tracing
+ * header, on each consumed message.
+ *
+ * If the message's header list has already been created by
+ * rd_kafka_message_headers() or set with rd_kafka_message_set_headers(),
+ * that list is searched instead, as by rd_kafka_header_get_last().
+ *
+ * @param rkmessage Message to look up the header in.
+ * @param name      Header name to find (last match).
+ * @param valuep    (out) Set to a const pointer to the value, which is
+ *                  NULL for a null value.
+ * @param sizep     (out) Set to the value's size.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR if the header was found,
+ *          RD_KAFKA_RESP_ERR__NOENT if the message has no such header,
+ *          or RD_KAFKA_RESP_ERR__BAD_MSG if the headers are malformed.
+ *
+ * @remark The returned value is not null-terminated when read from the
+ *         raw protocol headers.
+ * @remark The returned pointer is only valid as long as the message is.
+ */
+RD_EXPORT rd_kafka_resp_err_t
+rd_kafka_message_header_peek(const rd_kafka_message_t *rkmessage,
+                             const char *name,
+                             const void **valuep,
+                             size_t *sizep);
+
+
+/**
+ * @brief Iterate over all headers of message \p rkmessage without parsing
+ *        or copying the message's headers.
+ *
+ * Same semantics as rd_kafka_message_header_peek().
+ *
+ * @param rkmessage  Message to iterate the headers of.
+ * @param iterp      Iterator state: set \c *iterp to 0 before the first call
+ *                   and pass it unmodified to subsequent calls for as long
+ *                   as RD_KAFKA_RESP_ERR_NO_ERROR is returned.
+ * @param namep      (out) Set to a const pointer to the header name,
+ *                   which is not null-terminated.
+ * @param name_sizep (out) Set to the header name's size.
+ * @param valuep     (out) Set to a const pointer to the value, which is
+ *                   NULL for a null value.
+ * @param sizep      (out) Set to the value's size.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR if a header was returned,
+ *          RD_KAFKA_RESP_ERR__NOENT when there are no more headers,
+ *          or RD_KAFKA_RESP_ERR__BAD_MSG if the headers are malformed.
+ *
+ * @remark The message's headers must not be modified, nor be created by
+ *         calling rd_kafka_message_headers(), while iterating.
+ */
+RD_EXPORT rd_kafka_resp_err_t
+rd_kafka_message_header_peek_all(const rd_kafka_message_t *rkmessage,
+                                 size_t *iterp,
+                                 const char **namep,
+                                 size_t *name_sizep,
+                                 const void **valuep,
+                                 size_t *sizep);
+
+
 /**
  * @brief Replace the message's current headers with a new list.
  *
@@ -1869,6 +1976,45 @@ void rd_kafka_conf_set_consume_cb(
     rd_kafka_conf_t *conf,
     void (*consume_cb)(rd_kafka_message_t *rkmessage, void *opaque));
 
+/**
+ * @brief \b Consumer: Set message filter callback, applied to fetched
+ *        messages before they are enqueued for the application.
+ *
+ * The \p consume_filter_cb is called for each fetched (non-control)
+ * message while the fetch response is being parsed, before any
+ * per-message memory is allocated. Return 1 to keep the message or
+ * 0 to drop it. Dropped messages are never returned to the application
+ * and don't count towards the consumer's queue thresholds.
+ *
+ * The \p rkmessage provides the topic, partition, offset, key and value.
+ * The timestamp is available through rd_kafka_message_timestamp() and the
+ * headers through rd_kafka_message_header_peek() and
+ * rd_kafka_message_header_peek_all().
+ * The \p rkmessage and the memory it points to are only valid for the
+ * duration of the callback.
+ *
+ * The consumer's position, and thus the offsets committed by the
+ * automatic offset store, advance past dropped messages as if they had
+ * been consumed.
+ *
+ * The \p consume_filter_cb \p opaque argument is the opaque set with
+ * rd_kafka_conf_set_opaque().
+ *
+ * @remark The callback is only applied to MsgVersion 2 messages
+ *         (Apache Kafka 0.11.0 and later).
+ *
+ * @warning The callback is called from internal librdkafka threads and
+ *          must be thread-safe and not block. It must not call
+ *          rd_kafka_message_headers(), rd_kafka_message_detach_headers()
+ *          or any other librdkafka API that modifies the message.
+ */
+RD_EXPORT
+void rd_kafka_conf_set_consume_filter_cb(
+    rd_kafka_conf_t *conf,
+    int (*consume_filter_cb)(rd_kafka_t *rk,
+                             const rd_kafka_message_t *rkmessage,
+                             void *opaque));
+
 /**
  * @brief \b Consumer: Set rebalance callback for use with
  *                     coordinated consumer group balancing.
@@ -3201,6 +3347,28 @@ rd_kafka_resume_partitions(rd_kafka_t *rk,
 
 
 
+/**
+ * @brief Set the fetch priority of a partition.
+ *
+ * With \c fetch.scheduling=priority the consumer divides \c fetch.max.bytes
+ * between the partitions fetched from the same broker in proportion to
+ * their priority, and with \c fetch.scheduling=lag in proportion to their
+ * priority multiplied by their consumer lag.
+ * The priority has no effect with the default \c round-robin scheduling.
+ *
+ * @param priority The priority, from 1 (the default) to 1000.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR on success,
+ *          RD_KAFKA_RESP_ERR__INVALID_ARG if \p priority is out of range or
+ *          RD_KAFKA_RESP_ERR__UNKNOWN_PARTITION if the partition is unknown.
+ */
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_fetch_priority_set(rd_kafka_t *rk,
+                                                          const char *topic,
+                                                          int32_t partition,
+                                                          int priority);
+
+
+
 /**
  * @brief Query broker for low (oldest/beginning) and high (newest/end) offsets
  *        for partition.
@@ -3903,6 +4071,170 @@ ssize_t rd_kafka_consume_batch_queue(rd_kafka_queue_t *rkqu,
                                      rd_kafka_message_t **rkmessages,
                                      size_t rkmessages_size);
 
+
+/**
+ * @brief Column-oriented (struct-of-arrays) view of a batch of consumed
+ *        messages, see rd_kafka_consume_columns_queue().
+ *
+ * Each column is an array accessed with one of the
+ * rd_kafka_message_columns_..() accessors, where element \c i holds the
+ * corresponding field of the \c i:th consumed message, for \c i in the
+ * range 0..rd_kafka_message_columns_cnt()-1.
+ *
+ * The returned arrays and the key and payload pointers they hold reference
+ * the fetched message data directly and remain valid until the next call to
+ * rd_kafka_consume_columns_queue(), rd_kafka_message_columns_clear()
+ * or rd_kafka_message_columns_destroy() for the same object.
+ *
+ * @sa rd_kafka_message_columns_new()
+ */
+typedef struct rd_kafka_message_columns_s rd_kafka_message_columns_t;
+
+
+/**
+ * @brief Create a column-oriented message batch that holds up to \p size
+ *        messages, for use with rd_kafka_consume_columns_queue().
+ *
+ * The object is meant to be created once and reused for each consume call,
+ * making the consume loop free of per-message allocations in the
+ * application.
+ *
+ * @returns a new columns object which must be destroyed with
+ *          rd_kafka_message_columns_destroy().
+ */
+RD_EXPORT
+rd_kafka_message_columns_t *rd_kafka_message_columns_new(size_t size);
+
+
+/**
+ * @brief Release the messages currently referenced by \p cols and
+ *        set its row count to 0.
+ *
+ * Call this when done processing a batch to release the fetched message
+ * memory without waiting for the next rd_kafka_consume_columns_queue() call.
+ */
+RD_EXPORT
+void rd_kafka_message_columns_clear(rd_kafka_message_columns_t *cols);
+
+
+/**
+ * @brief Release the messages referenced by \p cols and free the object.
+ */
+RD_EXPORT
+void rd_kafka_message_columns_destroy(rd_kafka_message_columns_t *cols);
+
+
+/**
+ * @returns the number of rows currently populated in \p cols.
+ */
+RD_EXPORT
+size_t rd_kafka_message_columns_cnt(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the message error code column.
+ *
+ * If non-zero the row is a consumer error or event and the payload column
+ * holds the error string, as for rd_kafka_message_t.err.
+ */
+RD_EXPORT const rd_kafka_resp_err_t *
+rd_kafka_message_columns_err(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the topic column.
+ */
+RD_EXPORT rd_kafka_topic_t *const *
+rd_kafka_message_columns_topic(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the partition column.
+ */
+RD_EXPORT const int32_t *
+rd_kafka_message_columns_partition(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the message offset column.
+ */
+RD_EXPORT const int64_t *
+rd_kafka_message_columns_offset(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the message timestamp column, where a value of -1 means
+ *          the timestamp is not available,
+ *          see rd_kafka_message_timestamp().
+ */
+RD_EXPORT const int64_t *
+rd_kafka_message_columns_timestamp(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the key pointer column, where pointers may be NULL.
+ */
+RD_EXPORT const void *const *
+rd_kafka_message_columns_key(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the key length column.
+ */
+RD_EXPORT const size_t *
+rd_kafka_message_columns_key_len(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the payload pointer column, where pointers may be NULL.
+ */
+RD_EXPORT const void *const *
+rd_kafka_message_columns_payload(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @returns the payload length column.
+ */
+RD_EXPORT const size_t *
+rd_kafka_message_columns_len(const rd_kafka_message_columns_t *cols);
+
+/**
+ * @brief Get the headers of the message at row \p row, as
+ *        rd_kafka_message_headers() does for a message object.
+ *
+ * The headers list is owned by \p cols and remains valid for as long as
+ * the row does.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR if the message has headers,
+ *          RD_KAFKA_RESP_ERR__NOENT if it has none or the row is an error,
+ *          RD_KAFKA_RESP_ERR__INVALID_ARG if \p row is out of range,
+ *          or another error code if the headers could not be parsed.
+ */
+RD_EXPORT rd_kafka_resp_err_t
+rd_kafka_message_columns_headers(const rd_kafka_message_columns_t *cols,
+                                 size_t row,
+                                 rd_kafka_headers_t **hdrsp);
+
+
+/**
+ * @brief Consume a batch of messages from queue \p rkqu into the
+ *        column arrays of \p cols.
+ *
+ * This is the column-oriented counterpart of rd_kafka_consume_batch_queue()
+ * and has the same semantics with regards to waiting, offset storing,
+ * interceptors and control messages.
+ * Rather than returning an array of message objects, the message fields are
+ * laid out in parallel arrays suitable for vectorized processing.
+ *
+ * Any messages from a previous call with the same \p cols are released
+ * first, see rd_kafka_message_columns_clear().
+ *
+ * @param rkqu Queue to consume from, e.g., the queue returned by
+ *             rd_kafka_queue_get_consumer() or rd_kafka_queue_get_partition().
+ * @param timeout_ms Maximum time to wait for the first message.
+ * @param cols Columns object created with rd_kafka_message_columns_new().
+ *
+ * @returns the number of rows populated, which is also available from
+ *          rd_kafka_message_columns_cnt().
+ *
+ * @sa rd_kafka_consume_batch_queue()
+ */
+RD_EXPORT
+ssize_t rd_kafka_consume_columns_queue(rd_kafka_queue_t *rkqu,
+                                       int timeout_ms,
+                                       rd_kafka_message_columns_t *cols);
+
 /**
  * @brief Consume multiple messages from queue with callback
  *
@@ -5116,6 +5448,190 @@ void rd_kafka_group_list_destroy(const struct rd_kafka_group_list *grplist);
 
 
 
+/**
+ * @name Custom partition assignors
+ * @{
+ *
+ * Applications may provide their own partition assignor, for use with the
+ * \c classic consumer group protocol, which is run on the group leader to
+ * assign the subscribed topics' partitions to the group members.
+ *
+ * The assignor is added to the configuration object with
+ * rd_kafka_conf_add_partition_assignor() and is enabled by listing its name
+ * in \c partition.assignment.strategy.
+ *
+ * The assign callback is provided an assignor context which gives read-only,
+ * indexed access to the group members, their subscriptions and the cluster
+ * metadata of the subscribed topics. The returned objects point directly
+ * into the consumer's internal state and are not copied: they must not be
+ * modified and are only valid for the duration of the assign callback.
+ */
+
+
+/**
+ * @brief Custom partition assignor context.
+ *
+ * Members are indexed from 0 to rd_kafka_assignor_ctx_member_cnt() - 1 and
+ * the topics eligible for assignment, i.e., existing topics subscribed to
+ * by at least one member, from 0 to rd_kafka_assignor_ctx_topic_cnt() - 1.
+ */
+typedef struct rd_kafka_assignor_ctx_s rd_kafka_assignor_ctx_t;
+
+
+/**
+ * @brief Add a custom partition assignor named \p name to \p conf.
+ *
+ * @param conf Configuration object.
+ * @param name Assignor (protocol) name, this name must be listed in
+ *             \c partition.assignment.strategy for the assignor to be used.
+ * @param rebalance_protocol The assignor's rebalance protocol, either
+ *                           "EAGER" or "COOPERATIVE",
+ *                           see rd_kafka_rebalance_protocol().
+ * @param assign_cb Assign callback, called on the group leader with an
+ *                  assignor context from which it assigns partitions to
+ *                  members with rd_kafka_assignor_ctx_assign().
+ *                  On failure the callback writes a human readable error
+ *                  string to \p errstr and returns an error code.
+ * @param opaque Application opaque passed to \p assign_cb.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR on success,
+ *          RD_KAFKA_RESP_ERR__INVALID_ARG if \p name is empty or
+ *          \p rebalance_protocol is unknown, or
+ *          RD_KAFKA_RESP_ERR__CONFLICT if an assignor with the same name
+ *          was already added.
+ *
+ * @remark rd_kafka_new() fails if \p name is the name of a builtin assignor.
+ *
+ * @remark The assign callback is called from an internal librdkafka thread.
+ */
+RD_EXPORT rd_kafka_resp_err_t rd_kafka_conf_add_partition_assignor(
+    rd_kafka_conf_t *conf,
+    const char *name,
+    const char *rebalance_protocol,
+    rd_kafka_resp_err_t (*assign_cb)(rd_kafka_t *rk,
+                                     rd_kafka_assignor_ctx_t *ctx,
+                                     char *errstr,
+                                     size_t errstr_size,
+                                     void *opaque),
+    void *opaque);
+
+
+/**
+ * @returns the number of members in the group.
+ */
+RD_EXPORT
+int rd_kafka_assignor_ctx_member_cnt(const rd_kafka_assignor_ctx_t *ctx);
+
+/**
+ * @returns the member id of member \p member_idx, or NULL if the index is
+ *          out of range.
+ */
+RD_EXPORT
+const char *rd_kafka_assignor_ctx_member_id(const rd_kafka_assignor_ctx_t *ctx,
+                                            int member_idx);
+
+/**
+ * @returns the rack (\c client.rack) of member \p member_idx, or NULL if
+ *          the member has no rack or the index is out of range.
+ */
+RD_EXPORT
+const char *
+rd_kafka_assignor_ctx_member_rack(const rd_kafka_assignor_ctx_t *ctx,
+                                  int member_idx);
+
+/**
+ * @returns the subscription of member \p member_idx, where only the topic
+ *          names are relevant, or NULL if the index is out of range.
+ */
+RD_EXPORT
+const rd_kafka_topic_partition_list_t *
+rd_kafka_assignor_ctx_member_subscription(const rd_kafka_assignor_ctx_t *ctx,
+                                          int member_idx);
+
+/**
+ * @returns the partitions owned by member \p member_idx going into the
+ *          rebalance, or NULL if none are known or the index is out of
+ *          range.
+ */
+RD_EXPORT
+const rd_kafka_topic_partition_list_t *
+rd_kafka_assignor_ctx_member_owned(const rd_kafka_assignor_ctx_t *ctx,
+                                   int member_idx);
+
+/**
+ * @returns the number of topics eligible for assignment.
+ */
+RD_EXPORT
+int rd_kafka_assignor_ctx_topic_cnt(const rd_kafka_assignor_ctx_t *ctx);
+
+/**
+ * @returns the cluster metadata of eligible topic \p topic_idx, including
+ *          its partitions' leaders and replicas, or NULL if the index is out
+ *          of range.
+ */
+RD_EXPORT
+const rd_kafka_metadata_topic_t *
+rd_kafka_assignor_ctx_topic(const rd_kafka_assignor_ctx_t *ctx,
+                            int topic_idx);
+
+/**
+ * @returns the number of members subscribed to eligible topic \p topic_idx.
+ */
+RD_EXPORT
+int rd_kafka_assignor_ctx_topic_member_cnt(const rd_kafka_assignor_ctx_t *ctx,
+                                           int topic_idx);
+
+/**
+ * @returns the member index of the \p i'th member subscribed to eligible
+ *          topic \p topic_idx, or -1 if an index is out of range.
+ */
+RD_EXPORT
+int rd_kafka_assignor_ctx_topic_member(const rd_kafka_assignor_ctx_t *ctx,
+                                       int topic_idx,
+                                       int i);
+
+/**
+ * @returns the number of distinct racks of the replicas of \p partition of
+ *          eligible topic \p topic_idx, which is 0 if the brokers' racks are
+ *          unknown.
+ */
+RD_EXPORT
+int rd_kafka_assignor_ctx_partition_rack_cnt(
+    const rd_kafka_assignor_ctx_t *ctx,
+    int topic_idx,
+    int32_t partition);
+
+/**
+ * @returns the \p i'th (in sorted order) distinct rack of the replicas of
+ *          \p partition of eligible topic \p topic_idx, or NULL if an index
+ *          is out of range.
+ */
+RD_EXPORT
+const char *
+rd_kafka_assignor_ctx_partition_rack(const rd_kafka_assignor_ctx_t *ctx,
+                                     int topic_idx,
+                                     int32_t partition,
+                                     int i);
+
+/**
+ * @brief Assign \p partition of eligible topic \p topic_idx to member
+ *        \p member_idx.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR on success or
+ *          RD_KAFKA_RESP_ERR__INVALID_ARG if an index or the partition is
+ *          out of range.
+ */
+RD_EXPORT
+rd_kafka_resp_err_t rd_kafka_assignor_ctx_assign(rd_kafka_assignor_ctx_t *ctx,
+                                                 int member_idx,
+                                                 int topic_idx,
+                                                 int32_t partition);
+
+
+/**@}*/
+
+
+
 /**
  * @name Miscellaneous APIs
  * @{
@@ -84,6 +84,37 @@
  *
  * This explanation is more verbose than the code involved.
  *
+ *
+ *
+ ******************************************************************************
+ * Starting at the cached committed offset (.unconfirmed list)
+ * -----------------------------------------------------------
+ *
+ * A partition that is assigned again, e.g., after being revoked by a
+ * rebalance, usually has a known committed offset from this consumer's own
+ * commits or from an earlier OffsetFetch response, see
+ * rd_kafka_toppar_committed_cache_get().
+ * Such a partition's fetcher is started at the cached offset right away
+ * rather than after the OffsetFetch round-trip, but the partition's fetch
+ * queue is not forwarded to the consumer queue until the OffsetFetch
+ * response confirms the cached offset, so that no messages are delivered
+ * from a stale offset (e.g., committed by another consumer in the meantime).
+ * If the committed offset differs the fetcher is seeked to it, which
+ * discards the messages fetched from the cached offset.
+ *
+ *
+ * Prefetching before assignment (.prefetched list)
+ * ------------------------------------------------
+ *
+ * The cgrp may start fetching partitions it expects to be assigned, e.g.,
+ * from a static group member's assignment snapshot, before the group
+ * assignment is received, see rd_kafka_assignment_prefetch().
+ * Their fetched messages are held back like above. When such a partition
+ * is assigned and its committed offset queried, the running fetcher is
+ * adopted as if it had been started at a cached committed offset.
+ * Prefetched partitions that are not part of the assignment are stopped
+ * when partitions are added to the assignment.
+ *
  ******************************************************************************
  *
  *
@@ -116,6 +147,183 @@ static void rd_kafka_assignment_dump(rd_kafka_t *rk) {
 
         rd_kafka_topic_partition_list_log(rk, "DUMP_REM", RD_KAFKA_DBG_CGRP,
                                           rk->rk_consumer.assignment.removed);
+
+        rd_kafka_topic_partition_list_log(
+            rk, "DUMP_UNC", RD_KAFKA_DBG_CGRP,
+            rk->rk_consumer.assignment.unconfirmed);
+
+        rd_kafka_topic_partition_list_log(
+            rk, "DUMP_PRE", RD_KAFKA_DBG_CGRP,
+            rk->rk_consumer.assignment.prefetched);
+}
+
+
+/**
+ * @brief Stop the fetcher of the prefetched partition at index \p i of
+ *        the .prefetched list, discard its held back messages, and remove
+ *        it from the list and, if not assigned, from the desired
+ *        partitions.
+ */
+static void rd_kafka_assignment_prefetch_stop(rd_kafka_t *rk, int i) {
+        rd_kafka_topic_partition_t *rktpar =
+            &rk->rk_consumer.assignment.prefetched->elems[i];
+        /* Borrow ref */
+        rd_kafka_toppar_t *rktp = rd_kafka_topic_partition_toppar(rk, rktpar);
+
+        rd_kafka_dbg(rk, CGRP, "PREFETCH",
+                     "Stopping prefetch of %s [%" PRId32 "] at offset %s",
+                     rktpar->topic, rktpar->partition,
+                     rd_kafka_offset2str(rktpar->offset));
+
+        /* The version barrier outdates any message fetched before the
+         * stop, purge the ones already held back. */
+        rd_kafka_toppar_op_fetch_stop(rktp, RD_KAFKA_NO_REPLYQ);
+        rd_kafka_q_purge(rktp->rktp_fetchq);
+
+        /* Prefetching marked the partition as desired: unless it has been
+         * assigned since, it no longer is. */
+        rd_kafka_toppar_lock(rktp);
+        if (!(rktp->rktp_flags & RD_KAFKA_TOPPAR_F_ASSIGNED))
+                rd_kafka_toppar_desired_del(rktp);
+        rd_kafka_toppar_unlock(rktp);
+
+        rd_kafka_topic_partition_list_del_by_idx(
+            rk->rk_consumer.assignment.prefetched, i);
+}
+
+
+/**
+ * @brief Start fetching \p rktp at its cached committed offset, if any,
+ *        while its committed offset is being queried.
+ *
+ * The fetched messages are held back on the partition's fetch queue until
+ * the committed offset is confirmed by rd_kafka_assignment_confirm_cached().
+ */
+static void
+rd_kafka_assignment_start_cached(rd_kafka_t *rk,
+                                 rd_kafka_toppar_t *rktp,
+                                 rd_kafka_topic_partition_t *rktpar) {
+        rd_kafka_fetch_pos_t pos;
+        rd_bool_t fwd_app;
+
+        int i;
+
+        if (rktp->rktp_started)
+                return; /* Already started at the cached offset */
+
+        /* The messages can't be held back if the application consumes
+         * the partition from its own queue. */
+        rd_kafka_q_lock(rktp->rktp_fetchq);
+        fwd_app = !!(rktp->rktp_fetchq->rkq_flags & RD_KAFKA_Q_F_FWD_APP);
+        rd_kafka_q_unlock(rktp->rktp_fetchq);
+
+        i = rd_kafka_topic_partition_list_find_idx(
+            rk->rk_consumer.assignment.prefetched, rktpar->topic,
+            rktpar->partition);
+        if (i != -1 && fwd_app) {
+                /* Forwarded to the application after it was prefetched:
+                 * outdate the messages that may have been delivered. */
+                rd_kafka_assignment_prefetch_stop(rk, i);
+                return;
+        } else if (i != -1) {
+                /* Adopt the fetcher started before the assignment. */
+                pos = rd_kafka_topic_partition_get_fetch_pos(
+                    &rk->rk_consumer.assignment.prefetched->elems[i]);
+                rd_kafka_topic_partition_list_del_by_idx(
+                    rk->rk_consumer.assignment.prefetched, i);
+
+                rd_kafka_dbg(rk, CGRP, "SRVPEND",
+                             "Adopting prefetch of pending assigned partition "
+                             "%s [%" PRId32
+                             "] at offset %s "
+                             "until its committed offset is known",
+                             rktpar->topic, rktpar->partition,
+                             rd_kafka_fetch_pos2str(pos));
+
+                rktp->rktp_started = rd_true;
+                rk->rk_consumer.assignment.started_cnt++;
+
+                rd_kafka_topic_partition_set_from_fetch_pos(
+                    rd_kafka_topic_partition_list_add(
+                        rk->rk_consumer.assignment.unconfirmed, rktpar->topic,
+                        rktpar->partition),
+                    pos);
+                return;
+        }
+
+        if (fwd_app)
+                return;
+
+        rd_kafka_toppar_lock(rktp);
+        pos = rd_kafka_toppar_committed_cache_get(rktp);
+        rd_kafka_toppar_unlock(rktp);
+
+        if (pos.offset == RD_KAFKA_OFFSET_INVALID)
+                return;
+
+        rd_kafka_dbg(rk, CGRP, "SRVPEND",
+                     "Starting pending assigned partition "
+                     "%s [%" PRId32
+                     "] at cached committed offset %s "
+                     "until its committed offset is known",
+                     rktpar->topic, rktpar->partition,
+                     rd_kafka_fetch_pos2str(pos));
+
+        rd_kafka_toppar_op_pause_resume(rktp, rd_false /*resume*/,
+                                        RD_KAFKA_TOPPAR_F_LIB_PAUSE,
+                                        RD_KAFKA_NO_REPLYQ);
+
+        rktp->rktp_started = rd_true;
+        rk->rk_consumer.assignment.started_cnt++;
+
+        /* No forward queue: hold back the fetched messages. */
+        rd_kafka_toppar_op_fetch_start(rktp, pos, NULL, RD_KAFKA_NO_REPLYQ);
+
+        rd_kafka_topic_partition_set_from_fetch_pos(
+            rd_kafka_topic_partition_list_add(
+                rk->rk_consumer.assignment.unconfirmed, rktpar->topic,
+                rktpar->partition),
+            pos);
+}
+
+
+/**
+ * @brief Confirm the cached committed offset \p cached_pos that \p rktp
+ *        was started at by rd_kafka_assignment_start_cached(), or seek to
+ *        the actual committed offset \p rktpar, and release the held back
+ *        messages to the consumer queue.
+ */
+static void
+rd_kafka_assignment_confirm_cached(rd_kafka_t *rk,
+                                   rd_kafka_toppar_t *rktp,
+                                   rd_kafka_fetch_pos_t cached_pos,
+                                   const rd_kafka_topic_partition_t *rktpar) {
+        rd_kafka_fetch_pos_t pos =
+            rd_kafka_topic_partition_get_fetch_pos(rktpar);
+
+        if (pos.offset != cached_pos.offset) {
+                rd_kafka_dbg(rk, CGRP, "OFFSETFETCH",
+                             "Cached committed offset %s of %s [%" PRId32
+                             "] is outdated: seeking to committed offset %s",
+                             rd_kafka_fetch_pos2str(cached_pos), rktpar->topic,
+                             rktpar->partition, rd_kafka_fetch_pos2str(pos));
+
+                /* The seek bumps the version barrier which discards the
+                 * messages fetched from the cached offset. */
+                rd_kafka_toppar_op_seek(rktp, pos, RD_KAFKA_NO_REPLYQ);
+        } else {
+                rd_kafka_dbg(rk, CGRP, "OFFSETFETCH",
+                             "Cached committed offset %s of %s [%" PRId32
+                             "] confirmed",
+                             rd_kafka_fetch_pos2str(cached_pos), rktpar->topic,
+                             rktpar->partition);
+        }
+
+        rd_kafka_q_lock(rktp->rktp_fetchq);
+        if (!(rktp->rktp_fetchq->rkq_flags & RD_KAFKA_Q_F_FWD_APP))
+                rd_kafka_q_fwd_set0(rktp->rktp_fetchq, rk->rk_consumer.q,
+                                    0 /* no do_lock */, 0 /* no fwd_app */);
+        rd_kafka_q_unlock(rktp->rktp_fetchq);
 }
 
 /**
@@ -138,6 +346,9 @@ rd_kafka_assignment_apply_offsets(rd_kafka_t *rk,
                 /* May be NULL, borrow ref. */
                 rd_kafka_toppar_t *rktp =
                     rd_kafka_topic_partition_toppar(rk, rktpar);
+                rd_kafka_topic_partition_t *cached;
+                rd_kafka_fetch_pos_t cached_pos =
+                    RD_KAFKA_FETCH_POS(RD_KAFKA_OFFSET_INVALID, -1);
 
                 if (!rd_kafka_topic_partition_list_del(
                         rk->rk_consumer.assignment.queried, rktpar->topic,
@@ -152,6 +363,14 @@ rd_kafka_assignment_apply_offsets(rd_kafka_t *rk,
                         continue;
                 }
 
+                /* Partition started at its cached committed offset */
+                if (rktp &&
+                    (cached = rd_kafka_topic_partition_list_find(
+                         rk->rk_consumer.assignment.unconfirmed, rktpar->topic,
+                         rktpar->partition)))
+                        cached_pos =
+                            rd_kafka_topic_partition_get_fetch_pos(cached);
+
                 if (err == RD_KAFKA_RESP_ERR_UNSTABLE_OFFSET_COMMIT ||
                     rktpar->err == RD_KAFKA_RESP_ERR_UNSTABLE_OFFSET_COMMIT) {
                         /* Ongoing transactions are blocking offset retrieval.
@@ -184,7 +403,27 @@ rd_kafka_assignment_apply_offsets(rd_kafka_t *rk,
 
                         /* The partition will not be added back to .pending
                          * and thus only reside on .all until the application
-                         * unassigns it and possible re-assigns it. */
+                         * unassigns it and possible re-assigns it.
+                         * If it was started at its cached offset the
+                         * fetcher is paused, its messages never released. */
+                        if (cached_pos.offset != RD_KAFKA_OFFSET_INVALID) {
+                                rd_kafka_topic_partition_list_del(
+                                    rk->rk_consumer.assignment.unconfirmed,
+                                    rktpar->topic, rktpar->partition);
+                                rd_kafka_toppar_op_pause_resume(
+                                    rktp, rd_true /*pause*/,
+                                    RD_KAFKA_TOPPAR_F_LIB_PAUSE,
+                                    RD_KAFKA_NO_REPLYQ);
+                        }
+
+                } else if (!err &&
+                           cached_pos.offset != RD_KAFKA_OFFSET_INVALID) {
+                        /* Already started: confirm the cached offset. */
+                        rd_kafka_topic_partition_list_del(
+                            rk->rk_consumer.assignment.unconfirmed,
+                            rktpar->topic, rktpar->partition);
+                        rd_kafka_assignment_confirm_cached(rk, rktp, cached_pos,
+                                                           rktpar);
 
                 } else if (!err) {
                         /* If rktpar->offset is RD_KAFKA_OFFSET_INVALID it means
@@ -307,7 +546,7 @@ static int rd_kafka_assignment_serve_removals(rd_kafka_t *rk) {
                 rd_kafka_toppar_t *rktp =
                     rd_kafka_topic_partition_ensure_toppar(
                         rk, rktpar, rd_true); /* Borrow ref */
-                int was_pending, was_queried;
+                int was_pending, was_queried, i;
 
                 /* Remove partition from pending and querying lists,
                  * if it happens to be there.
@@ -319,6 +558,16 @@ static int rd_kafka_assignment_serve_removals(rd_kafka_t *rk) {
                 was_queried = rd_kafka_topic_partition_list_del(
                     rk->rk_consumer.assignment.queried, rktpar->topic,
                     rktpar->partition);
+                rd_kafka_topic_partition_list_del(
+                    rk->rk_consumer.assignment.unconfirmed, rktpar->topic,
+                    rktpar->partition);
+
+                /* Removed before its prefetcher was adopted */
+                i = rd_kafka_topic_partition_list_find_idx(
+                    rk->rk_consumer.assignment.prefetched, rktpar->topic,
+                    rktpar->partition);
+                if (i != -1)
+                        rd_kafka_assignment_prefetch_stop(rk, i);
 
                 if (rktp->rktp_started) {
                         /* Partition was started, stop the fetcher. */
@@ -337,10 +586,16 @@ static int rd_kafka_assignment_serve_removals(rd_kafka_t *rk) {
 
                 rd_kafka_toppar_lock(rktp);
 
+                /* Close the lock-free store path so that no offset
+                 * can be stored after the stored offset is read below:
+                 * later stores take the locked path and fail once the
+                 * partition is no longer assigned. */
+                rd_kafka_offset_store_close(rktp);
+
                 /* Save the currently stored offset and epoch on .removed
                  * so it will be committed below. */
                 rd_kafka_topic_partition_set_from_fetch_pos(
-                    rktpar, rktp->rktp_stored_pos);
+                    rktpar, rd_kafka_toppar_stored_pos(rktp));
                 valid_offsets += !RD_KAFKA_OFFSET_IS_LOGICAL(rktpar->offset);
 
                 /* Reset the stored offset to invalid so that
@@ -432,13 +687,19 @@ static int rd_kafka_assignment_serve_pending(rd_kafka_t *rk) {
                 rd_kafka_toppar_t *rktp =
                     rd_kafka_topic_partition_ensure_toppar(rk, rktpar, rd_true);
 
-                rd_assert(!rktp->rktp_started);
-
-                if (!RD_KAFKA_OFFSET_IS_LOGICAL(rktpar->offset) ||
-                    rktpar->offset == RD_KAFKA_OFFSET_BEGINNING ||
-                    rktpar->offset == RD_KAFKA_OFFSET_END ||
-                    rktpar->offset == RD_KAFKA_OFFSET_INVALID ||
-                    rktpar->offset <= RD_KAFKA_OFFSET_TAIL_BASE) {
+                /* Only partitions started at their cached committed offset
+                 * may be started while pending. */
+                rd_assert(!rktp->rktp_started ||
+                          rd_kafka_topic_partition_list_find(
+                              rk->rk_consumer.assignment.unconfirmed,
+                              rktpar->topic, rktpar->partition));
+
+                if (!rktp->rktp_started &&
+                    (!RD_KAFKA_OFFSET_IS_LOGICAL(rktpar->offset) ||
+                     rktpar->offset == RD_KAFKA_OFFSET_BEGINNING ||
+                     rktpar->offset == RD_KAFKA_OFFSET_END ||
+                     rktpar->offset == RD_KAFKA_OFFSET_INVALID ||
+                     rktpar->offset <= RD_KAFKA_OFFSET_TAIL_BASE)) {
                         /* The partition fetcher can handle absolute
                          * as well as beginning/end/tail start offsets, so we're
                          * ready to start the fetcher now.
@@ -463,7 +724,11 @@ static int rd_kafka_assignment_serve_pending(rd_kafka_t *rk) {
                             rktp, rd_false /*resume*/,
                             RD_KAFKA_TOPPAR_F_LIB_PAUSE, RD_KAFKA_NO_REPLYQ);
 
-                        /* Start the fetcher */
+                        /* Start the fetcher, which replaces any
+                         * prefetcher and outdates its messages. */
+                        rd_kafka_topic_partition_list_del(
+                            rk->rk_consumer.assignment.prefetched,
+                            rktpar->topic, rktpar->partition);
                         rktp->rktp_started = rd_true;
                         rk->rk_consumer.assignment.started_cnt++;
 
@@ -478,7 +743,10 @@ static int rd_kafka_assignment_serve_pending(rd_kafka_t *rk) {
                          * We can't rely on any internal cached committed offset
                          * so we'll accumulate a list of partitions that need
                          * to be queried and then send FetchOffsetsRequest
-                         * to the group coordinator. */
+                         * to the group coordinator.
+                         * Fetching may however start at the cached offset
+                         * until the query confirms it. */
+                        rd_kafka_assignment_start_cached(rk, rktp, rktpar);
 
                         rd_dassert(!rd_kafka_topic_partition_list_find(
                             rk->rk_consumer.assignment.queried, rktpar->topic,
@@ -497,6 +765,8 @@ static int rd_kafka_assignment_serve_pending(rd_kafka_t *rk) {
 
 
                 } else {
+                        rd_kafka_assignment_start_cached(rk, rktp, rktpar);
+
                         rd_kafka_dbg(
                             rk, CGRP, "SRVPEND",
                             "Pending assignment partition "
@@ -615,6 +885,89 @@ void rd_kafka_assignment_serve(rd_kafka_t *rk) {
 }
 
 
+/**
+ * @brief Start fetching \p partitions at their offsets before they are
+ *        assigned, holding back the fetched messages until the partitions
+ *        are assigned and their committed offsets confirmed.
+ *
+ * Partitions without an absolute offset, or that are already assigned or
+ * prefetched, are ignored.
+ */
+void rd_kafka_assignment_prefetch(
+    rd_kafka_t *rk,
+    const rd_kafka_topic_partition_list_t *partitions) {
+        const rd_kafka_topic_partition_t *rktpar;
+
+        RD_KAFKA_TPLIST_FOREACH(rktpar, partitions) {
+                rd_kafka_toppar_t *rktp;
+                rd_bool_t fwd_app;
+
+                if (rktpar->offset < 0 ||
+                    rd_kafka_topic_partition_list_find(
+                        rk->rk_consumer.assignment.all, rktpar->topic,
+                        rktpar->partition) ||
+                    rd_kafka_topic_partition_list_find(
+                        rk->rk_consumer.assignment.prefetched, rktpar->topic,
+                        rktpar->partition))
+                        continue;
+
+                rktp = rd_kafka_toppar_get2(rk, rktpar->topic,
+                                            rktpar->partition,
+                                            0 /*no ua_on_miss*/,
+                                            1 /*create_on_miss*/);
+                if (!rktp)
+                        continue;
+
+                rd_kafka_q_lock(rktp->rktp_fetchq);
+                fwd_app =
+                    !!(rktp->rktp_fetchq->rkq_flags & RD_KAFKA_Q_F_FWD_APP);
+                rd_kafka_q_unlock(rktp->rktp_fetchq);
+
+                if (!fwd_app) {
+                        rd_kafka_dbg(rk, CGRP, "PREFETCH",
+                                     "Prefetching %s [%" PRId32
+                                     "] at offset %s before it is assigned",
+                                     rktpar->topic, rktpar->partition,
+                                     rd_kafka_offset2str(rktpar->offset));
+
+                        /* No forward queue: hold back the fetched
+                         * messages. */
+                        rd_kafka_toppar_op_fetch_start(
+                            rktp, RD_KAFKA_FETCH_POS(rktpar->offset, -1),
+                            NULL, RD_KAFKA_NO_REPLYQ);
+
+                        rd_kafka_topic_partition_list_add0(
+                            __FUNCTION__, __LINE__,
+                            rk->rk_consumer.assignment.prefetched,
+                            rktpar->topic, rktpar->partition, rktp, NULL)
+                            ->offset = rktpar->offset;
+                }
+
+                rd_kafka_toppar_destroy(rktp);
+        }
+}
+
+
+/**
+ * @brief Stop the prefetched partitions that are not in the current
+ *        assignment.
+ */
+void rd_kafka_assignment_prefetch_stop_unassigned(rd_kafka_t *rk) {
+        int i;
+
+        /* Scan the list backwards so removals are cheap */
+        for (i = rk->rk_consumer.assignment.prefetched->cnt - 1; i >= 0; i--) {
+                const rd_kafka_topic_partition_t *rktpar =
+                    &rk->rk_consumer.assignment.prefetched->elems[i];
+
+                if (!rd_kafka_topic_partition_list_find(
+                        rk->rk_consumer.assignment.all, rktpar->topic,
+                        rktpar->partition))
+                        rd_kafka_assignment_prefetch_stop(rk, i);
+        }
+}
+
+
 /**
  * @returns true if the current or previous assignment has operations in
  *          progress, such as waiting for partition fetchers to stop.
@@ -651,6 +1004,9 @@ int rd_kafka_assignment_clear(rd_kafka_t *rk) {
 
         rd_kafka_topic_partition_list_clear(rk->rk_consumer.assignment.pending);
         rd_kafka_topic_partition_list_clear(rk->rk_consumer.assignment.queried);
+        rd_kafka_topic_partition_list_clear(rk->rk_consumer.assignment.paused);
+        rd_kafka_topic_partition_list_clear(
+            rk->rk_consumer.assignment.unconfirmed);
 
         rd_kafka_topic_partition_list_add_list(
             rk->rk_consumer.assignment.removed, rk->rk_consumer.assignment.all);
@@ -776,6 +1132,10 @@ rd_kafka_assignment_add(rd_kafka_t *rk,
 
         rk->rk_consumer.assignment.version++;
 
+        /* The prefetched partitions not assigned now are not expected
+         * to be assigned. */
+        rd_kafka_assignment_prefetch_stop_unassigned(rk);
+
         return NULL;
 }
 
@@ -848,6 +1208,11 @@ rd_kafka_assignment_subtract(rd_kafka_t *rk,
                             rk->rk_consumer.assignment.pending, rktpar->topic,
                             rktpar->partition);
 
+                /* Removed partitions are resumed by serve_removals(). */
+                rd_kafka_topic_partition_list_del(
+                    rk->rk_consumer.assignment.paused, rktpar->topic,
+                    rktpar->partition);
+
                 /* Add to .removed list which will be served by
                  * serve_removals(). */
                 rd_kafka_topic_partition_list_add_copy(
@@ -905,35 +1270,82 @@ void rd_kafka_assignment_partition_stopped(rd_kafka_t *rk,
  * from either serve_removals() or serve_pending() above.
  */
 void rd_kafka_assignment_pause(rd_kafka_t *rk, const char *reason) {
+        rd_kafka_assignment_pause_partitions(rk, rk->rk_consumer.assignment.all,
+                                             reason);
+}
 
-        if (rk->rk_consumer.assignment.all->cnt == 0)
-                return;
+/**
+ * @brief Pause fetching of the assigned partitions in \p partitions,
+ *        leaving the other assigned partitions, and their fetched messages,
+ *        untouched.
+ *
+ * Pausing a partition bumps its version barrier which discards any
+ * messages already fetched for it, so only the partitions that need
+ * it should be paused.
+ */
+void rd_kafka_assignment_pause_partitions(
+    rd_kafka_t *rk,
+    const rd_kafka_topic_partition_list_t *partitions,
+    const char *reason) {
+        rd_kafka_topic_partition_list_t *topause;
+        int i;
 
-        rd_kafka_dbg(rk, CGRP, "PAUSE",
-                     "Pausing fetchers for %d assigned partition(s): %s",
-                     rk->rk_consumer.assignment.all->cnt, reason);
+        topause = rd_kafka_topic_partition_list_new(partitions->cnt);
+        for (i = 0; i < partitions->cnt; i++) {
+                const rd_kafka_topic_partition_t *rktpar =
+                    &partitions->elems[i];
 
-        rd_kafka_toppars_pause_resume(rk, rd_true /*pause*/, RD_ASYNC,
-                                      RD_KAFKA_TOPPAR_F_LIB_PAUSE,
-                                      rk->rk_consumer.assignment.all);
+                if ((partitions != rk->rk_consumer.assignment.all &&
+                     !rd_kafka_topic_partition_list_find(
+                         rk->rk_consumer.assignment.all, rktpar->topic,
+                         rktpar->partition)) ||
+                    (rk->rk_consumer.assignment.paused->cnt > 0 &&
+                     rd_kafka_topic_partition_list_find(
+                         rk->rk_consumer.assignment.paused, rktpar->topic,
+                         rktpar->partition)))
+                        continue;
+
+                rd_kafka_topic_partition_list_add_copy(topause, rktpar);
+        }
+
+        if (topause->cnt > 0) {
+                rd_kafka_dbg(rk, CGRP, "PAUSE",
+                             "Pausing fetchers for %d of %d assigned "
+                             "partition(s): %s",
+                             topause->cnt, rk->rk_consumer.assignment.all->cnt,
+                             reason);
+
+                rd_kafka_toppars_pause_resume(rk, rd_true /*pause*/, RD_ASYNC,
+                                              RD_KAFKA_TOPPAR_F_LIB_PAUSE,
+                                              topause);
+                rd_kafka_topic_partition_list_add_list(
+                    rk->rk_consumer.assignment.paused, topause);
+        }
+
+        rd_kafka_topic_partition_list_destroy(topause);
 }
 
 /**
  * @brief Resume fetching of the currently assigned partitions which have
- *        previously been paused by rd_kafka_assignment_pause().
+ *        previously been paused by rd_kafka_assignment_pause*().
+ *
+ * Assigned partitions that were not paused are left untouched to retain
+ * their fetched messages.
  */
 void rd_kafka_assignment_resume(rd_kafka_t *rk, const char *reason) {
 
-        if (rk->rk_consumer.assignment.all->cnt == 0)
+        if (rk->rk_consumer.assignment.paused->cnt == 0)
                 return;
 
         rd_kafka_dbg(rk, CGRP, "PAUSE",
-                     "Resuming fetchers for %d assigned partition(s): %s",
+                     "Resuming fetchers for %d of %d assigned partition(s): %s",
+                     rk->rk_consumer.assignment.paused->cnt,
                      rk->rk_consumer.assignment.all->cnt, reason);
 
         rd_kafka_toppars_pause_resume(rk, rd_false /*resume*/, RD_ASYNC,
                                       RD_KAFKA_TOPPAR_F_LIB_PAUSE,
-                                      rk->rk_consumer.assignment.all);
+                                      rk->rk_consumer.assignment.paused);
+        rd_kafka_topic_partition_list_clear(rk->rk_consumer.assignment.paused);
 }
 
 
@@ -951,6 +1363,12 @@ void rd_kafka_assignment_destroy(rd_kafka_t *rk) {
             rk->rk_consumer.assignment.queried);
         rd_kafka_topic_partition_list_destroy(
             rk->rk_consumer.assignment.removed);
+        rd_kafka_topic_partition_list_destroy(
+            rk->rk_consumer.assignment.paused);
+        rd_kafka_topic_partition_list_destroy(
+            rk->rk_consumer.assignment.unconfirmed);
+        rd_kafka_topic_partition_list_destroy(
+            rk->rk_consumer.assignment.prefetched);
 }
 
 
@@ -965,4 +1383,10 @@ void rd_kafka_assignment_init(rd_kafka_t *rk) {
             rd_kafka_topic_partition_list_new(100);
         rk->rk_consumer.assignment.removed =
             rd_kafka_topic_partition_list_new(100);
+        rk->rk_consumer.assignment.paused =
+            rd_kafka_topic_partition_list_new(100);
+        rk->rk_consumer.assignment.unconfirmed =
+            rd_kafka_topic_partition_list_new(100);
+        rk->rk_consumer.assignment.prefetched =
+            rd_kafka_topic_partition_list_new(0);
 }
@@ -41,6 +41,18 @@ typedef struct rd_kafka_assignment_s {
         /** Partitions that have been removed from the assignment
          * but not yet decommissioned. (not included in .all) */
         rd_kafka_topic_partition_list_t *removed;
+        /** Partitions paused by rd_kafka_assignment_pause*() and not yet
+         *  resumed by rd_kafka_assignment_resume() (subset of .all) */
+        rd_kafka_topic_partition_list_t *paused;
+        /** Partitions started at their cached committed offset, which
+         *  is yet to be confirmed by OffsetFetch, with the offset they
+         *  were started at (subset of .all) */
+        rd_kafka_topic_partition_list_t *unconfirmed;
+        /** Partitions whose fetcher was started by
+         *  rd_kafka_assignment_prefetch() before they were assigned,
+         *  with the offset they were started at (not included in .all,
+         *  until assigned and adopted by the assignment) */
+        rd_kafka_topic_partition_list_t *prefetched;
         /** Number of started partitions */
         int started_cnt;
         /** Number of partitions being stopped. */
@@ -64,8 +76,16 @@ rd_kafka_assignment_subtract(rd_kafka_t *rk,
 void rd_kafka_assignment_partition_stopped(rd_kafka_t *rk,
                                            rd_kafka_toppar_t *rktp);
 void rd_kafka_assignment_pause(rd_kafka_t *rk, const char *reason);
+void rd_kafka_assignment_pause_partitions(
+    rd_kafka_t *rk,
+    const rd_kafka_topic_partition_list_t *partitions,
+    const char *reason);
 void rd_kafka_assignment_resume(rd_kafka_t *rk, const char *reason);
 void rd_kafka_assignment_serve(rd_kafka_t *rk);
+void rd_kafka_assignment_prefetch(
+    rd_kafka_t *rk,
+    const rd_kafka_topic_partition_list_t *partitions);
+void rd_kafka_assignment_prefetch_stop_unassigned(rd_kafka_t *rk);
 rd_bool_t rd_kafka_assignment_in_progress(rd_kafka_t *rk);
 void rd_kafka_assignment_destroy(rd_kafka_t *rk);
 void rd_kafka_assignment_init(rd_kafka_t *rk);
@@ -59,6 +59,9 @@ void rd_kafka_group_member_clear(rd_kafka_group_member_t *rkgm) {
         if (rkgm->rkgm_member_metadata)
                 rd_kafkap_bytes_destroy(rkgm->rkgm_member_metadata);
 
+        if (rkgm->rkgm_rack_id)
+                rd_kafkap_str_destroy(rkgm->rkgm_rack_id);
+
         memset(rkgm, 0, sizeof(*rkgm));
 }
 
@@ -106,7 +109,9 @@ rd_kafkap_bytes_t *rd_kafka_consumer_protocol_member_metadata_new(
     const rd_list_t *topics,
     const void *userdata,
     size_t userdata_size,
-    const rd_kafka_topic_partition_list_t *owned_partitions) {
+    const rd_kafka_topic_partition_list_t *owned_partitions,
+    int generation,
+    const rd_kafkap_str_t *rack_id) {
 
         rd_kafka_buf_t *rkbuf;
         rd_kafkap_bytes_t *kbytes;
@@ -124,12 +129,14 @@ rd_kafkap_bytes_t *rd_kafka_consumer_protocol_member_metadata_new(
          *   OwnedPartitions => [Topic Partitions] // added in v1
          *     Topic => string
          *     Partitions => [int32]
+         *   GenerationId => int32 // added in v2
+         *   RackId => string // added in v3
          */
 
         rkbuf = rd_kafka_buf_new(1, 100 + (topic_cnt * 100) + userdata_size);
 
         /* Version */
-        rd_kafka_buf_write_i16(rkbuf, 1);
+        rd_kafka_buf_write_i16(rkbuf, 3);
         rd_kafka_buf_write_i32(rkbuf, topic_cnt);
         RD_LIST_FOREACH(tinfo, topics, i)
         rd_kafka_buf_write_str(rkbuf, tinfo->topic, -1);
@@ -154,6 +161,12 @@ rd_kafkap_bytes_t *rd_kafka_consumer_protocol_member_metadata_new(
                     rd_false /*any offset*/, fields);
         }
 
+        /* Following data is ignored by consumers with version < 2 */
+        rd_kafka_buf_write_i32(rkbuf, generation);
+
+        /* Following data is ignored by consumers with version < 3 */
+        rd_kafka_buf_write_kstr(rkbuf, rack_id);
+
         /* Get binary buffer and allocate a new Kafka Bytes with a copy. */
         rd_slice_init_full(&rkbuf->rkbuf_reader, &rkbuf->rkbuf_buf);
         len    = rd_slice_remains(&rkbuf->rkbuf_reader);
@@ -170,9 +183,10 @@ rd_kafkap_bytes_t *rd_kafka_assignor_get_metadata_with_empty_userdata(
     const rd_kafka_assignor_t *rkas,
     void *assignor_state,
     const rd_list_t *topics,
-    const rd_kafka_topic_partition_list_t *owned_partitions) {
-        return rd_kafka_consumer_protocol_member_metadata_new(topics, NULL, 0,
-                                                              owned_partitions);
+    const rd_kafka_topic_partition_list_t *owned_partitions,
+    const rd_kafkap_str_t *rack_id) {
+        return rd_kafka_consumer_protocol_member_metadata_new(
+            topics, NULL, 0, owned_partitions, -1 /* generation */, rack_id);
 }
 
 
@@ -218,9 +232,150 @@ static int rd_kafka_member_subscription_match(
 
 static void rd_kafka_assignor_topic_destroy(rd_kafka_assignor_topic_t *at) {
         rd_list_destroy(&at->members);
+        if (at->partition_racks) {
+                int i;
+                for (i = 0; i < at->metadata->partition_cnt; i++)
+                        if (at->partition_racks[i])
+                                rd_list_destroy(at->partition_racks[i]);
+                rd_free(at->partition_racks);
+        }
         rd_free(at);
 }
 
+
+/**
+ * @brief Set up the replica racks of each partition of \p eligible_topic
+ *        from its metadata and \p broker_racks (KIP-881).
+ *
+ * @param broker_racks The rack of each of the \p metadata brokers, in the
+ *                     same order, or NULL if no broker rack is known.
+ */
+static void rd_kafka_assignor_topic_set_partition_racks(
+    rd_kafka_assignor_topic_t *eligible_topic,
+    const rd_kafka_metadata_t *metadata,
+    const char **broker_racks) {
+        const rd_kafka_metadata_topic_t *mdt = eligible_topic->metadata;
+        int i;
+
+        if (!broker_racks || !mdt->partitions)
+                return;
+
+        for (i = 0; i < mdt->partition_cnt; i++) {
+                const rd_kafka_metadata_partition_t *mdp = &mdt->partitions[i];
+                int j;
+
+                if (mdp->id < 0 || mdp->id >= mdt->partition_cnt)
+                        continue;
+
+                for (j = 0; j < mdp->replica_cnt; j++) {
+                        const char *rack = NULL;
+                        rd_list_t *racks;
+                        int k;
+
+                        for (k = 0; k < metadata->broker_cnt; k++) {
+                                if (metadata->brokers[k].id ==
+                                    mdp->replicas[j]) {
+                                        rack = broker_racks[k];
+                                        break;
+                                }
+                        }
+
+                        if (!rack || !*rack)
+                                continue;
+
+                        if (!eligible_topic->partition_racks)
+                                eligible_topic->partition_racks = rd_calloc(
+                                    mdt->partition_cnt,
+                                    sizeof(*eligible_topic->partition_racks));
+
+                        if (!(racks =
+                                  eligible_topic->partition_racks[mdp->id]))
+                                racks = eligible_topic
+                                            ->partition_racks[mdp->id] =
+                                    rd_list_new(mdp->replica_cnt, NULL);
+
+                        if (!rd_list_find(racks, rack, rd_list_cmp_str))
+                                rd_list_add(racks, (void *)rack);
+                }
+
+                if (eligible_topic->partition_racks &&
+                    eligible_topic->partition_racks[mdp->id])
+                        rd_list_sort(eligible_topic->partition_racks[mdp->id],
+                                     rd_list_cmp_str);
+        }
+}
+
+
+/**
+ * @returns true if \p rack is one of the replica racks of \p partition
+ *          of \p eligible_topic.
+ */
+rd_bool_t rd_kafka_assignor_topic_partition_has_rack(
+    const rd_kafka_assignor_topic_t *eligible_topic,
+    int32_t partition,
+    const char *rack) {
+        const rd_list_t *racks;
+
+        if (!rack || !eligible_topic->partition_racks || partition < 0 ||
+            partition >= eligible_topic->metadata->partition_cnt ||
+            !(racks = eligible_topic->partition_racks[partition]))
+                return rd_false;
+
+        return rd_list_find(racks, rack, rd_list_cmp_str) != NULL;
+}
+
+
+/**
+ * @returns true if rack-aware assignment (KIP-881) should be used for
+ *          \p eligible_topic: at least one of its members is in one of its
+ *          partitions' replica racks, and not all partitions are replicated
+ *          to the same set of racks, in which case rack-awareness would make
+ *          no difference.
+ */
+rd_bool_t rd_kafka_assignor_topic_use_rack_aware(
+    const rd_kafka_assignor_topic_t *eligible_topic) {
+        const rd_kafka_metadata_topic_t *mdt = eligible_topic->metadata;
+        const rd_list_t *first_racks         = NULL;
+        const rd_kafka_group_member_t *rkgm;
+        rd_bool_t member_rack_match = rd_false;
+        rd_bool_t racks_differ      = rd_false;
+        int i;
+
+        if (!eligible_topic->partition_racks)
+                return rd_false;
+
+        for (i = 0; i < mdt->partition_cnt; i++) {
+                const rd_list_t *racks = eligible_topic->partition_racks[i];
+
+                if (i == 0)
+                        first_racks = racks;
+                else if (!racks != !first_racks ||
+                         (racks &&
+                          rd_list_cmp(racks, first_racks, rd_list_cmp_str)))
+                        racks_differ = rd_true;
+        }
+
+        if (!racks_differ)
+                return rd_false;
+
+        RD_LIST_FOREACH(rkgm, &eligible_topic->members, i) {
+                int j;
+
+                if (!rkgm->rkgm_rack_id)
+                        continue;
+
+                for (j = 0; j < mdt->partition_cnt && !member_rack_match; j++)
+                        member_rack_match =
+                            rd_kafka_assignor_topic_partition_has_rack(
+                                eligible_topic, j, rkgm->rkgm_rack_id->str);
+
+                if (member_rack_match)
+                        break;
+        }
+
+        return member_rack_match;
+}
+
 int rd_kafka_assignor_topic_cmp(const void *_a, const void *_b) {
         const rd_kafka_assignor_topic_t *a =
             *(const rd_kafka_assignor_topic_t *const *)_a;
@@ -240,6 +395,7 @@ static void
 rd_kafka_member_subscriptions_map(rd_kafka_cgrp_t *rkcg,
                                   rd_list_t *eligible_topics,
                                   const rd_kafka_metadata_t *metadata,
+                                  const char **broker_racks,
                                   rd_kafka_group_member_t *members,
                                   int member_cnt) {
         int ti;
@@ -286,6 +442,8 @@ rd_kafka_member_subscriptions_map(rd_kafka_cgrp_t *rkcg,
                 }
 
                 eligible_topic->metadata = &metadata->topics[ti];
+                rd_kafka_assignor_topic_set_partition_racks(
+                    eligible_topic, metadata, broker_racks);
                 rd_list_add(eligible_topics, eligible_topic);
                 eligible_topic = NULL;
         }
@@ -295,6 +453,14 @@ rd_kafka_member_subscriptions_map(rd_kafka_cgrp_t *rkcg,
 }
 
 
+/**
+ * @brief Run the assignor \p rkas for \p members.
+ *
+ * The partitions' replica racks, used for rack-aware assignment, are
+ * looked up from the known brokers' racks.
+ *
+ * @locality rdkafka main thread
+ */
 rd_kafka_resp_err_t rd_kafka_assignor_run(rd_kafka_cgrp_t *rkcg,
                                           const rd_kafka_assignor_t *rkas,
                                           rd_kafka_metadata_t *metadata,
@@ -303,6 +469,60 @@ rd_kafka_resp_err_t rd_kafka_assignor_run(rd_kafka_cgrp_t *rkcg,
                                           char *errstr,
                                           size_t errstr_size) {
         rd_kafka_resp_err_t err;
+        const char **broker_racks = NULL;
+        int i;
+
+        rd_kafka_rdlock(rkcg->rkcg_rk);
+        for (i = 0; i < metadata->broker_cnt; i++) {
+                rd_kafka_broker_t *rkb;
+
+                if (!(rkb = rd_kafka_broker_find_by_nodeid(
+                          rkcg->rkcg_rk, metadata->brokers[i].id)))
+                        continue;
+
+                rd_kafka_broker_lock(rkb);
+                if (rkb->rkb_rack) {
+                        if (!broker_racks)
+                                broker_racks = rd_calloc(metadata->broker_cnt,
+                                                         sizeof(*broker_racks));
+                        broker_racks[i] = rd_strdup(rkb->rkb_rack);
+                }
+                rd_kafka_broker_unlock(rkb);
+                rd_kafka_broker_destroy(rkb);
+        }
+        rd_kafka_rdunlock(rkcg->rkcg_rk);
+
+        err = rd_kafka_assignor_run_with_racks(rkcg, rkas, metadata,
+                                               broker_racks, members,
+                                               member_cnt, errstr, errstr_size);
+
+        if (broker_racks) {
+                for (i = 0; i < metadata->broker_cnt; i++)
+                        if (broker_racks[i])
+                                rd_free((char *)broker_racks[i]);
+                rd_free(broker_racks);
+        }
+
+        return err;
+}
+
+
+/**
+ * @brief Run the assignor \p rkas for \p members.
+ *
+ * @param broker_racks The rack of each of the \p metadata brokers, in the
+ *                     same order, or NULL if unknown.
+ */
+rd_kafka_resp_err_t
+rd_kafka_assignor_run_with_racks(rd_kafka_cgrp_t *rkcg,
+                                 const rd_kafka_assignor_t *rkas,
+                                 rd_kafka_metadata_t *metadata,
+                                 const char **broker_racks,
+                                 rd_kafka_group_member_t *members,
+                                 int member_cnt,
+                                 char *errstr,
+                                 size_t errstr_size) {
+        rd_kafka_resp_err_t err;
         rd_ts_t ts_start = rd_clock();
         int i;
         rd_list_t eligible_topics;
@@ -311,7 +531,7 @@ rd_kafka_resp_err_t rd_kafka_assignor_run(rd_kafka_cgrp_t *rkcg,
         /* Construct eligible_topics, a map of:
          *    topic -> set of members that are subscribed to it. */
         rd_kafka_member_subscriptions_map(rkcg, &eligible_topics, metadata,
-                                          members, member_cnt);
+                                          broker_racks, members, member_cnt);
 
 
         if (rkcg->rkcg_rk->rk_conf.debug &
@@ -330,7 +550,7 @@ rd_kafka_resp_err_t rd_kafka_assignor_run(rd_kafka_cgrp_t *rkcg,
                         rd_kafka_dbg(
                             rkcg->rkcg_rk, CGRP | RD_KAFKA_DBG_ASSIGNOR,
                             "ASSIGN",
-                            " Member \"%.*s\"%s with "
+                            " Member \"%.*s\"%s%s%s with "
                             "%d owned partition(s) and "
                             "%d subscribed topic(s):",
                             RD_KAFKAP_STR_PR(member->rkgm_member_id),
@@ -338,6 +558,9 @@ rd_kafka_resp_err_t rd_kafka_assignor_run(rd_kafka_cgrp_t *rkcg,
                                                rkcg->rkcg_member_id)
                                 ? " (me)"
                                 : "",
+                            member->rkgm_rack_id ? " in rack " : "",
+                            member->rkgm_rack_id ? member->rkgm_rack_id->str
+                                                 : "",
                             member->rkgm_owned ? member->rkgm_owned->cnt : 0,
                             member->rkgm_subscription->cnt);
                         for (j = 0; j < member->rkgm_subscription->cnt; j++) {
@@ -485,7 +708,8 @@ rd_kafka_resp_err_t rd_kafka_assignor_add(
         const struct rd_kafka_assignor_s *rkas,
         void *assignor_state,
         const rd_list_t *topics,
-        const rd_kafka_topic_partition_list_t *owned_partitions),
+        const rd_kafka_topic_partition_list_t *owned_partitions,
+        const rd_kafkap_str_t *rack_id),
     void (*on_assignment_cb)(const struct rd_kafka_assignor_s *rkas,
                              void **assignor_state,
                              const rd_kafka_topic_partition_list_t *assignment,
@@ -527,6 +751,259 @@ rd_kafka_resp_err_t rd_kafka_assignor_add(
 }
 
 
+/**
+ * @name Custom assignors
+ * @{
+ *
+ * Application assignors are run through the same assignor interface as the
+ * builtin ones, with an assignor context that wraps the internal member and
+ * eligible topic arrays without copying them.
+ */
+
+struct rd_kafka_assignor_ctx_s {
+        rd_kafka_group_member_t *members;
+        int member_cnt;
+        rd_kafka_assignor_topic_t **eligible_topics;
+        int eligible_topic_cnt;
+};
+
+
+static void rd_kafka_custom_assignor_destroy(void *ptr) {
+        rd_kafka_custom_assignor_t *custom = ptr;
+        rd_free(custom->name);
+        rd_free(custom);
+}
+
+static void *rd_kafka_custom_assignor_copy(const void *ptr, void *opaque) {
+        const rd_kafka_custom_assignor_t *src = ptr;
+        rd_kafka_custom_assignor_t *custom    = rd_malloc(sizeof(*custom));
+
+        *custom      = *src;
+        custom->name = rd_strdup(src->name);
+
+        return custom;
+}
+
+void rd_kafka_conf_custom_assignors_ctor(int scope, void *pconf) {
+        rd_kafka_conf_t *conf = pconf;
+        rd_list_init(&conf->custom_assignors, 0,
+                     rd_kafka_custom_assignor_destroy);
+}
+
+void rd_kafka_conf_custom_assignors_dtor(int scope, void *pconf) {
+        rd_kafka_conf_t *conf = pconf;
+        rd_list_destroy(&conf->custom_assignors);
+}
+
+void rd_kafka_conf_custom_assignors_copy(int scope,
+                                         void *pdst,
+                                         const void *psrc,
+                                         void *dstptr,
+                                         const void *srcptr,
+                                         size_t filter_cnt,
+                                         const char **filter) {
+        rd_kafka_conf_t *dconf       = pdst;
+        const rd_kafka_conf_t *sconf = psrc;
+
+        rd_list_copy_to(&dconf->custom_assignors, &sconf->custom_assignors,
+                        rd_kafka_custom_assignor_copy, NULL);
+}
+
+
+rd_kafka_resp_err_t rd_kafka_conf_add_partition_assignor(
+    rd_kafka_conf_t *conf,
+    const char *name,
+    const char *rebalance_protocol,
+    rd_kafka_resp_err_t (*assign_cb)(rd_kafka_t *rk,
+                                     rd_kafka_assignor_ctx_t *ctx,
+                                     char *errstr,
+                                     size_t errstr_size,
+                                     void *opaque),
+    void *opaque) {
+        rd_kafka_custom_assignor_t *custom;
+        rd_kafka_rebalance_protocol_t protocol;
+        int i;
+
+        if (!name || !*name || !assign_cb || !rebalance_protocol)
+                return RD_KAFKA_RESP_ERR__INVALID_ARG;
+
+        if (!rd_strcasecmp(rebalance_protocol, "EAGER"))
+                protocol = RD_KAFKA_REBALANCE_PROTOCOL_EAGER;
+        else if (!rd_strcasecmp(rebalance_protocol, "COOPERATIVE"))
+                protocol = RD_KAFKA_REBALANCE_PROTOCOL_COOPERATIVE;
+        else
+                return RD_KAFKA_RESP_ERR__INVALID_ARG;
+
+        RD_LIST_FOREACH(custom, &conf->custom_assignors, i) {
+                if (!strcmp(custom->name, name))
+                        return RD_KAFKA_RESP_ERR__CONFLICT;
+        }
+
+        custom            = rd_calloc(1, sizeof(*custom));
+        custom->name      = rd_strdup(name);
+        custom->protocol  = protocol;
+        custom->assign_cb = assign_cb;
+        custom->opaque    = opaque;
+        rd_list_add(&conf->custom_assignors, custom);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
+/**
+ * @brief Assign callback of custom assignors: calls the application's
+ *        assign callback with an assignor context for the group.
+ */
+static rd_kafka_resp_err_t
+rd_kafka_custom_assignor_assign_cb(rd_kafka_t *rk,
+                                   const rd_kafka_assignor_t *rkas,
+                                   const char *member_id,
+                                   const rd_kafka_metadata_t *metadata,
+                                   rd_kafka_group_member_t *members,
+                                   size_t member_cnt,
+                                   rd_kafka_assignor_topic_t **eligible_topics,
+                                   size_t eligible_topic_cnt,
+                                   char *errstr,
+                                   size_t errstr_size,
+                                   void *opaque) {
+        const rd_kafka_custom_assignor_t *custom = opaque;
+        rd_kafka_assignor_ctx_t ctx              = {
+            members, (int)member_cnt, eligible_topics, (int)eligible_topic_cnt};
+
+        return custom->assign_cb(rk, &ctx, errstr, errstr_size,
+                                 custom->opaque);
+}
+
+
+int rd_kafka_assignor_ctx_member_cnt(const rd_kafka_assignor_ctx_t *ctx) {
+        return ctx->member_cnt;
+}
+
+const char *rd_kafka_assignor_ctx_member_id(const rd_kafka_assignor_ctx_t *ctx,
+                                            int member_idx) {
+        if (member_idx < 0 || member_idx >= ctx->member_cnt)
+                return NULL;
+        return ctx->members[member_idx].rkgm_member_id->str;
+}
+
+const char *
+rd_kafka_assignor_ctx_member_rack(const rd_kafka_assignor_ctx_t *ctx,
+                                  int member_idx) {
+        if (member_idx < 0 || member_idx >= ctx->member_cnt ||
+            !ctx->members[member_idx].rkgm_rack_id)
+                return NULL;
+        return ctx->members[member_idx].rkgm_rack_id->str;
+}
+
+const rd_kafka_topic_partition_list_t *
+rd_kafka_assignor_ctx_member_subscription(const rd_kafka_assignor_ctx_t *ctx,
+                                          int member_idx) {
+        if (member_idx < 0 || member_idx >= ctx->member_cnt)
+                return NULL;
+        return ctx->members[member_idx].rkgm_subscription;
+}
+
+const rd_kafka_topic_partition_list_t *
+rd_kafka_assignor_ctx_member_owned(const rd_kafka_assignor_ctx_t *ctx,
+                                   int member_idx) {
+        if (member_idx < 0 || member_idx >= ctx->member_cnt)
+                return NULL;
+        return ctx->members[member_idx].rkgm_owned;
+}
+
+int rd_kafka_assignor_ctx_topic_cnt(const rd_kafka_assignor_ctx_t *ctx) {
+        return ctx->eligible_topic_cnt;
+}
+
+const rd_kafka_metadata_topic_t *
+rd_kafka_assignor_ctx_topic(const rd_kafka_assignor_ctx_t *ctx,
+                            int topic_idx) {
+        if (topic_idx < 0 || topic_idx >= ctx->eligible_topic_cnt)
+                return NULL;
+        return ctx->eligible_topics[topic_idx]->metadata;
+}
+
+int rd_kafka_assignor_ctx_topic_member_cnt(const rd_kafka_assignor_ctx_t *ctx,
+                                           int topic_idx) {
+        if (topic_idx < 0 || topic_idx >= ctx->eligible_topic_cnt)
+                return 0;
+        return rd_list_cnt(&ctx->eligible_topics[topic_idx]->members);
+}
+
+int rd_kafka_assignor_ctx_topic_member(const rd_kafka_assignor_ctx_t *ctx,
+                                       int topic_idx,
+                                       int i) {
+        const rd_kafka_group_member_t *rkgm;
+
+        if (topic_idx < 0 || topic_idx >= ctx->eligible_topic_cnt ||
+            !(rkgm = rd_list_elem(&ctx->eligible_topics[topic_idx]->members,
+                                  i)))
+                return -1;
+
+        /* The eligible topic's members point into the members array. */
+        return (int)(rkgm - ctx->members);
+}
+
+/**
+ * @returns the replica racks of \p partition of eligible topic \p topic_idx,
+ *          or NULL if unknown.
+ */
+static const rd_list_t *
+rd_kafka_assignor_ctx_partition_racks(const rd_kafka_assignor_ctx_t *ctx,
+                                      int topic_idx,
+                                      int32_t partition) {
+        const rd_kafka_assignor_topic_t *eligible_topic;
+
+        if (topic_idx < 0 || topic_idx >= ctx->eligible_topic_cnt)
+                return NULL;
+
+        eligible_topic = ctx->eligible_topics[topic_idx];
+        if (!eligible_topic->partition_racks || partition < 0 ||
+            partition >= eligible_topic->metadata->partition_cnt)
+                return NULL;
+
+        return eligible_topic->partition_racks[partition];
+}
+
+int rd_kafka_assignor_ctx_partition_rack_cnt(
+    const rd_kafka_assignor_ctx_t *ctx,
+    int topic_idx,
+    int32_t partition) {
+        const rd_list_t *racks =
+            rd_kafka_assignor_ctx_partition_racks(ctx, topic_idx, partition);
+        return racks ? rd_list_cnt(racks) : 0;
+}
+
+const char *
+rd_kafka_assignor_ctx_partition_rack(const rd_kafka_assignor_ctx_t *ctx,
+                                     int topic_idx,
+                                     int32_t partition,
+                                     int i) {
+        const rd_list_t *racks =
+            rd_kafka_assignor_ctx_partition_racks(ctx, topic_idx, partition);
+        return racks ? rd_list_elem(racks, i) : NULL;
+}
+
+rd_kafka_resp_err_t rd_kafka_assignor_ctx_assign(rd_kafka_assignor_ctx_t *ctx,
+                                                 int member_idx,
+                                                 int topic_idx,
+                                                 int32_t partition) {
+        const rd_kafka_metadata_topic_t *mdt;
+
+        if (member_idx < 0 || member_idx >= ctx->member_cnt ||
+            !(mdt = rd_kafka_assignor_ctx_topic(ctx, topic_idx)) ||
+            partition < 0 || partition >= mdt->partition_cnt)
+                return RD_KAFKA_RESP_ERR__INVALID_ARG;
+
+        rd_kafka_topic_partition_list_add(
+            ctx->members[member_idx].rkgm_assignment, mdt->topic, partition);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+/**@}*/
+
+
 /* Right trim string of whitespaces */
 static void rtrim(char *s) {
         char *e = s + strlen(s);
@@ -552,9 +1029,11 @@ static int rd_kafka_assignor_cmp_idx(const void *ptr1, const void *ptr2) {
  * Initialize assignor list based on configuration.
  */
 int rd_kafka_assignors_init(rd_kafka_t *rk, char *errstr, size_t errstr_size) {
+        rd_kafka_custom_assignor_t *custom;
         char *wanted;
         char *s;
         int idx = 0;
+        int i;
 
         rd_list_init(&rk->rk_conf.partition_assignors, 3,
                      (void *)rd_kafka_assignor_destroy);
@@ -564,6 +1043,22 @@ int rd_kafka_assignors_init(rd_kafka_t *rk, char *errstr, size_t errstr_size) {
         rd_kafka_roundrobin_assignor_init(rk);
         rd_kafka_sticky_assignor_init(rk);
 
+        /* Initialize the application's custom assignors */
+        RD_LIST_FOREACH(custom, &rk->rk_conf.custom_assignors, i) {
+                rd_kafka_resp_err_t err = rd_kafka_assignor_add(
+                    rk, "consumer", custom->name, custom->protocol,
+                    rd_kafka_custom_assignor_assign_cb,
+                    rd_kafka_assignor_get_metadata_with_empty_userdata,
+                    NULL, NULL, NULL, custom);
+                if (err) {
+                        rd_snprintf(errstr, errstr_size,
+                                    "Failed to add custom partition "
+                                    "assignor \"%s\": %s",
+                                    custom->name, rd_kafka_err2str(err));
+                        return -1;
+                }
+        }
+
         rd_strdupa(&wanted, rk->rk_conf.partition_assignment_strategy);
 
         s = wanted;
@@ -885,6 +1380,7 @@ static int ut_assignors(void) {
                 rd_kafka_group_member_t *members;
 
                 /* Create topic metadata */
+                memset(&metadata, 0, sizeof(metadata));
                 metadata.topic_cnt = tests[i].topic_cnt;
                 metadata.topics =
                     rd_alloca(sizeof(*metadata.topics) * metadata.topic_cnt);
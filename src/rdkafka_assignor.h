@@ -69,6 +69,8 @@ typedef struct rd_kafka_group_member_s {
         rd_kafkap_bytes_t *rkgm_member_metadata;
         /** Group generation id. */
         int rkgm_generation;
+        /** Member rack id (client.rack), or NULL if not set (KIP-881). */
+        rd_kafkap_str_t *rkgm_rack_id;
 } rd_kafka_group_member_t;
 
 
@@ -86,11 +88,24 @@ int rd_kafka_group_member_find_subscription(rd_kafka_t *rk,
 typedef struct rd_kafka_assignor_topic_s {
         const rd_kafka_metadata_topic_t *metadata;
         rd_list_t members; /* rd_kafka_group_member_t * */
+        /** Replica racks of each partition, indexed by partition id:
+         *  a sorted list of distinct rack names (const char *), or NULL
+         *  if no replica rack is known for the partition.
+         *  The array is NULL if no rack is known for any partition. */
+        rd_list_t **partition_racks;
 } rd_kafka_assignor_topic_t;
 
 
 int rd_kafka_assignor_topic_cmp(const void *_a, const void *_b);
 
+rd_bool_t rd_kafka_assignor_topic_partition_has_rack(
+    const rd_kafka_assignor_topic_t *eligible_topic,
+    int32_t partition,
+    const char *rack);
+
+rd_bool_t rd_kafka_assignor_topic_use_rack_aware(
+    const rd_kafka_assignor_topic_t *eligible_topic);
+
 
 typedef struct rd_kafka_assignor_s {
         rd_kafkap_str_t *rkas_protocol_type;
@@ -120,7 +135,8 @@ typedef struct rd_kafka_assignor_s {
             const struct rd_kafka_assignor_s *rkas,
             void *assignor_state,
             const rd_list_t *topics,
-            const rd_kafka_topic_partition_list_t *owned_partitions);
+            const rd_kafka_topic_partition_list_t *owned_partitions,
+            const rd_kafkap_str_t *rack_id);
 
         void (*rkas_on_assignment_cb)(
             const struct rd_kafka_assignor_s *rkas,
@@ -137,6 +153,32 @@ typedef struct rd_kafka_assignor_s {
 } rd_kafka_assignor_t;
 
 
+/**
+ * @brief Custom assignor added by the application with
+ *        rd_kafka_conf_add_partition_assignor().
+ */
+typedef struct rd_kafka_custom_assignor_s {
+        char *name;
+        rd_kafka_rebalance_protocol_t protocol;
+        rd_kafka_resp_err_t (*assign_cb)(rd_kafka_t *rk,
+                                         rd_kafka_assignor_ctx_t *ctx,
+                                         char *errstr,
+                                         size_t errstr_size,
+                                         void *opaque);
+        void *opaque;
+} rd_kafka_custom_assignor_t;
+
+void rd_kafka_conf_custom_assignors_ctor(int scope, void *pconf);
+void rd_kafka_conf_custom_assignors_dtor(int scope, void *pconf);
+void rd_kafka_conf_custom_assignors_copy(int scope,
+                                         void *pdst,
+                                         const void *psrc,
+                                         void *dstptr,
+                                         const void *srcptr,
+                                         size_t filter_cnt,
+                                         const char **filter);
+
+
 rd_kafka_resp_err_t rd_kafka_assignor_add(
     rd_kafka_t *rk,
     const char *protocol_type,
@@ -158,7 +200,8 @@ rd_kafka_resp_err_t rd_kafka_assignor_add(
         const struct rd_kafka_assignor_s *rkas,
         void *assignor_state,
         const rd_list_t *topics,
-        const rd_kafka_topic_partition_list_t *owned_partitions),
+        const rd_kafka_topic_partition_list_t *owned_partitions,
+        const rd_kafkap_str_t *rack_id),
     void (*on_assignment_cb)(const struct rd_kafka_assignor_s *rkas,
                              void **assignor_state,
                              const rd_kafka_topic_partition_list_t *assignment,
@@ -172,13 +215,16 @@ rd_kafkap_bytes_t *rd_kafka_consumer_protocol_member_metadata_new(
     const rd_list_t *topics,
     const void *userdata,
     size_t userdata_size,
-    const rd_kafka_topic_partition_list_t *owned_partitions);
+    const rd_kafka_topic_partition_list_t *owned_partitions,
+    int generation,
+    const rd_kafkap_str_t *rack_id);
 
 rd_kafkap_bytes_t *rd_kafka_assignor_get_metadata_with_empty_userdata(
     const rd_kafka_assignor_t *rkas,
     void *assignor_state,
     const rd_list_t *topics,
-    const rd_kafka_topic_partition_list_t *owned_partitions);
+    const rd_kafka_topic_partition_list_t *owned_partitions,
+    const rd_kafkap_str_t *rack_id);
 
 
 void rd_kafka_assignor_update_subscription(
@@ -194,6 +240,16 @@ rd_kafka_resp_err_t rd_kafka_assignor_run(struct rd_kafka_cgrp_s *rkcg,
                                           char *errstr,
                                           size_t errstr_size);
 
+rd_kafka_resp_err_t
+rd_kafka_assignor_run_with_racks(struct rd_kafka_cgrp_s *rkcg,
+                                 const rd_kafka_assignor_t *rkas,
+                                 rd_kafka_metadata_t *metadata,
+                                 const char **broker_racks,
+                                 rd_kafka_group_member_t *members,
+                                 int member_cnt,
+                                 char *errstr,
+                                 size_t errstr_size);
+
 rd_kafka_assignor_t *rd_kafka_assignor_find(rd_kafka_t *rk,
                                             const char *protocol);
 
@@ -629,6 +629,10 @@ void rd_kafka_broker_fail(rd_kafka_broker_t *rkb,
          */
         rd_kafka_bufq_connection_reset(rkb, &rkb->rkb_outbufs);
 
+        /* The outcome of an in-flight FetchRequest is unknown,
+         * start over with a new fetch session. */
+        rd_kafka_broker_fetch_session_reset(rkb, rd_false, "broker down");
+
         /* Extra debugging for tracking termination-hang issues:
          * show what is keeping this broker from decommissioning. */
         if (rd_kafka_terminating(rkb->rkb_rk) &&
@@ -1922,7 +1926,9 @@ int rd_kafka_recv(rd_kafka_broker_t *rkb) {
         if (!(rkbuf = rkb->rkb_recv_buf)) {
                 /* No receive in progress: create new buffer */
 
-                rkbuf = rd_kafka_buf_new(2, RD_KAFKAP_RESHDR_SIZE);
+                if (!(rkbuf = rd_kafka_buf_pool_get(&rkb->rkb_buf_pool, 2,
+                                                    RD_KAFKAP_RESHDR_SIZE)))
+                        rkbuf = rd_kafka_buf_new(2, RD_KAFKAP_RESHDR_SIZE);
 
                 rkb->rkb_recv_buf = rkbuf;
 
@@ -1993,12 +1999,25 @@ int rd_kafka_recv(rd_kafka_broker_t *rkb) {
                 rkbuf->rkbuf_totlen -= 4; /*CorrId*/
 
                 if (rkbuf->rkbuf_totlen > 0) {
+                        void *mem;
+
                         /* Allocate another buffer that fits all data (short of
                          * the common response header). We want all
-                         * data to be in contigious memory. */
-
-                        rd_buf_write_ensure_contig(&rkbuf->rkbuf_buf,
-                                                   rkbuf->rkbuf_totlen);
+                         * data to be in contigious memory.
+                         * Larger responses (typically Fetch) use a
+                         * recycled block from the receive buffer pool,
+                         * which is returned to the pool when the last
+                         * reference to the response (and thus any
+                         * consumed messages pointing into it) is gone. */
+                        if ((mem = rd_kafka_rxbuf_pool_get(
+                                 &rkb->rkb_rxbuf_pool, rkbuf->rkbuf_totlen)))
+                                rd_buf_write_ensure_contig_mem(
+                                    &rkbuf->rkbuf_buf, mem,
+                                    rkbuf->rkbuf_totlen,
+                                    rd_kafka_rxbuf_pool_release);
+                        else
+                                rd_buf_write_ensure_contig(
+                                    &rkbuf->rkbuf_buf, rkbuf->rkbuf_totlen);
                 }
         }
 
@@ -4204,9 +4223,11 @@ static void rd_kafka_broker_consumer_serve(rd_kafka_broker_t *rkb,
                 }
 
                 /* Send Fetch request message for all underflowed toppars
-                 * if the connection is up and there are no outstanding
-                 * fetch requests for this connection. */
-                if (!rkb->rkb_fetching &&
+                 * if the connection is up and the number of outstanding
+                 * fetch requests for this connection is below the
+                 * configured pipeline depth. */
+                if (rkb->rkb_fetching <
+                        rkb->rkb_rk->rk_conf.fetch_pipeline_depth &&
                     rkb->rkb_state == RD_KAFKA_BROKER_STATE_UP) {
                         if (min_backoff < now) {
                                 rd_kafka_broker_fetch_toppars(rkb, now);
@@ -4657,6 +4678,8 @@ void rd_kafka_broker_destroy_final(rd_kafka_broker_t *rkb) {
         if (rkb->rkb_ApiVersions)
                 rd_free(rkb->rkb_ApiVersions);
         rd_free(rkb->rkb_origname);
+        if (rkb->rkb_rack)
+                rd_free(rkb->rkb_rack);
 
         rd_kafka_q_purge(rkb->rkb_ops);
         rd_kafka_q_destroy_owner(rkb->rkb_ops);
@@ -4676,6 +4699,11 @@ void rd_kafka_broker_destroy_final(rd_kafka_broker_t *rkb) {
 
         rd_refcnt_destroy(&rkb->rkb_refcnt);
 
+        rd_kafka_broker_fetch_session_destroy(rkb);
+
+        rd_kafka_buf_pool_destroy(&rkb->rkb_buf_pool);
+        rd_kafka_rxbuf_pool_destroy(&rkb->rkb_rxbuf_pool);
+
         rd_free(rkb);
 }
 
@@ -4743,6 +4771,7 @@ rd_kafka_broker_t *rd_kafka_broker_add(rd_kafka_t *rk,
         rkb->rkb_logname = rd_strdup(rkb->rkb_name);
         TAILQ_INIT(&rkb->rkb_toppars);
         CIRCLEQ_INIT(&rkb->rkb_active_toppars);
+        rd_kafka_broker_fetch_session_init(rkb);
         TAILQ_INIT(&rkb->rkb_monitors);
         rd_kafka_bufq_init(&rkb->rkb_outbufs);
         rd_kafka_bufq_init(&rkb->rkb_waitresps);
@@ -4759,11 +4788,20 @@ rd_kafka_broker_t *rd_kafka_broker_add(rd_kafka_t *rk,
         rd_refcnt_init(&rkb->rkb_refcnt, 0);
         rd_kafka_broker_keep(rkb); /* rk_broker's refcount */
 
+        rd_kafka_buf_pool_init(
+            &rkb->rkb_buf_pool,
+            (size_t)rk->rk_conf.broker_buf_pool_max_kbytes * 1024);
+        rd_kafka_rxbuf_pool_init(
+            &rkb->rkb_rxbuf_pool,
+            (size_t)rk->rk_conf.broker_rxbuf_pool_max_kbytes * 1024,
+            rk->rk_conf.broker_rxbuf_hugepages);
+
         rkb->rkb_reconnect_backoff_ms = rk->rk_conf.reconnect_backoff_ms;
         rd_atomic32_init(&rkb->rkb_persistconn.coord, 0);
 
         rd_atomic64_init(&rkb->rkb_c.ts_send, 0);
         rd_atomic64_init(&rkb->rkb_c.ts_recv, 0);
+        rd_atomic64_init(&rkb->rkb_c.fetch_rtt, 0);
 
         /* ApiVersion fallback interval */
         if (rkb->rkb_rk->rk_conf.api_version_request) {
@@ -5348,6 +5386,30 @@ void rd_kafka_broker_update(rd_kafka_t *rk,
 }
 
 
+/**
+ * @brief Update the broker's rack (broker.rack) as learned from Metadata.
+ *
+ * @param rack The rack, which is null or empty if the broker has no rack.
+ *
+ * @locks none
+ * @locks_acquired rkb_lock
+ * @locality any
+ */
+void rd_kafka_broker_set_rack(rd_kafka_broker_t *rkb,
+                              const rd_kafkap_str_t *rack) {
+        rd_bool_t has_rack = RD_KAFKAP_STR_LEN(rack) > 0;
+
+        rd_kafka_broker_lock(rkb);
+        if (!rkb->rkb_rack != !has_rack ||
+            (has_rack && rd_kafkap_str_cmp_str(rack, rkb->rkb_rack))) {
+                if (rkb->rkb_rack)
+                        rd_free(rkb->rkb_rack);
+                rkb->rkb_rack = has_rack ? RD_KAFKAP_STR_DUP(rack) : NULL;
+        }
+        rd_kafka_broker_unlock(rkb);
+}
+
+
 /**
  * @returns the broker id, or RD_KAFKA_NODEID_UA if \p rkb is NULL.
  *
@@ -5682,9 +5744,18 @@ void rd_kafka_broker_active_toppar_del(rd_kafka_broker_t *rkb,
         rd_kafka_assert(NULL, rkb->rkb_active_toppar_cnt > 0);
         rkb->rkb_active_toppar_cnt--;
 
-        if (is_consumer)
+        if (is_consumer) {
                 rktp->rktp_fetch = 0;
 
+                /* No FetchRequest will be sent until a partition is
+                 * added again: don't keep references to partitions
+                 * no longer fetched in the fetch session. */
+                if (rkb->rkb_active_toppar_cnt == 0 &&
+                    rd_list_cnt(&rkb->rkb_fetch_session.toppars) > 0)
+                        rd_kafka_broker_fetch_session_reset(
+                            rkb, rd_false, "no partitions to fetch");
+        }
+
         if (rkb->rkb_active_toppar_next == rktp) {
                 /* Update next pointer */
                 rd_kafka_broker_active_toppar_next(
@@ -125,7 +125,20 @@ struct rd_kafka_broker_s { /* rd_kafka_broker_t */
         rd_kafka_cgrp_t *rkb_cgrp;
 
         rd_ts_t rkb_ts_fetch_backoff;
-        int rkb_fetching;
+        int rkb_fetching; /**< Number of FetchRequests in flight,
+                           *   at most fetch.pipeline.depth. */
+
+        /**< Incremental fetch session (KIP-227).
+         *   @locality broker thread */
+        struct {
+                int32_t id;        /**< SessionId, 0 if no session. */
+                int32_t epoch;     /**< Epoch of the next FetchRequest,
+                                    *   0 for a full FetchRequest. */
+                rd_list_t toppars; /**< Partitions in the session with
+                                    *   their last sent fetch state
+                                    *   (rd_kafka_fetch_session_toppar_t *),
+                                    *   sorted by topic and partition. */
+        } rkb_fetch_session;
 
         rd_kafka_broker_state_t rkb_state; /**< Current broker state */
 
@@ -189,8 +202,20 @@ struct rd_kafka_broker_s { /* rd_kafka_broker_t */
 
                 rd_atomic64_t ts_send; /**< Timestamp of last send */
                 rd_atomic64_t ts_recv; /**< Timestamp of last receive */
+
+                rd_atomic64_t fetch_rtt; /**< Moving average of the
+                                          *   Fetch round-trip time (us)
+                                          *   for responses returned
+                                          *   before fetch.wait.max.ms,
+                                          *   used for client-side
+                                          *   replica selection. */
         } rkb_c;
 
+        rd_kafka_buf_pool_t rkb_buf_pool; /**< Pool of recycled request and
+                                           *   response buffers. */
+        rd_kafka_rxbuf_pool_t rkb_rxbuf_pool; /**< Pool of recycled response
+                                               *   receive buffers. */
+
         int rkb_req_timeouts; /* Current value */
 
         thrd_t rkb_thread;
@@ -222,6 +247,8 @@ struct rd_kafka_broker_s { /* rd_kafka_broker_t */
         uint16_t rkb_port;                         /* TCP port */
         char *rkb_origname;                        /* Original
                                                     * host name */
+        char *rkb_rack;                            /**< broker.rack from
+                                                    *   Metadata, or NULL. */
         int rkb_nodename_epoch;                    /**< Bumped each time
                                                     *   the nodename is changed.
                                                     *   Compared to
@@ -485,6 +512,8 @@ void rd_kafka_broker_update(rd_kafka_t *rk,
                             rd_kafka_secproto_t proto,
                             const struct rd_kafka_metadata_broker *mdb,
                             rd_kafka_broker_t **rkbp);
+void rd_kafka_broker_set_rack(rd_kafka_broker_t *rkb,
+                              const rd_kafkap_str_t *rack);
 rd_kafka_broker_t *rd_kafka_broker_add(rd_kafka_t *rk,
                                        rd_kafka_confsource_t source,
                                        rd_kafka_secproto_t proto,
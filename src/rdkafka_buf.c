@@ -30,8 +30,14 @@
 #include "rdkafka_buf.h"
 #include "rdkafka_broker.h"
 #include "rdkafka_interceptor.h"
+#include "rdunittest.h"
+
+static rd_bool_t rd_kafka_buf_pool_put(rd_kafka_buf_pool_t *rkbp,
+                                       rd_kafka_buf_t *rkbuf);
+
 
 void rd_kafka_buf_destroy_final(rd_kafka_buf_t *rkbuf) {
+        rd_kafka_broker_t *rkb = rkbuf->rkbuf_rkb;
 
         switch (rkbuf->rkbuf_reqhdr.ApiKey) {
         case RD_KAFKAP_Metadata:
@@ -53,6 +59,10 @@ void rd_kafka_buf_destroy_final(rd_kafka_buf_t *rkbuf) {
                 break;
 
         case RD_KAFKAP_Produce:
+                if (rkbuf->rkbuf_u.Produce.mem_size > 0)
+                        rd_kafka_curr_msgs_sub(
+                            rkbuf->rkbuf_batch.rktp->rktp_rkt->rkt_rk, 0, 0,
+                            rkbuf->rkbuf_u.Produce.mem_size);
                 rd_kafka_msgbatch_destroy(&rkbuf->rkbuf_batch);
                 break;
         }
@@ -66,17 +76,189 @@ void rd_kafka_buf_destroy_final(rd_kafka_buf_t *rkbuf) {
         rd_kafka_replyq_destroy(&rkbuf->rkbuf_replyq);
         rd_kafka_replyq_destroy(&rkbuf->rkbuf_orig_replyq);
 
-        rd_buf_destroy(&rkbuf->rkbuf_buf);
-
         if (rkbuf->rkbuf_rktp_vers)
                 rd_list_destroy(rkbuf->rkbuf_rktp_vers);
 
-        if (rkbuf->rkbuf_rkb)
-                rd_kafka_broker_destroy(rkbuf->rkbuf_rkb);
-
         rd_refcnt_destroy(&rkbuf->rkbuf_refcnt);
 
-        rd_free(rkbuf);
+        /* Return pooled buffers to the broker's pool, if there's room. */
+        if (!(rkbuf->rkbuf_flags & RD_KAFKA_OP_F_POOLED) || !rkb ||
+            !rd_kafka_buf_pool_put(&rkb->rkb_buf_pool, rkbuf)) {
+                rd_buf_destroy(&rkbuf->rkbuf_buf);
+                rd_free(rkbuf);
+        }
+
+        /* The broker (and thus its pool) must outlive the buffer. */
+        if (rkb)
+                rd_kafka_broker_destroy(rkb);
+}
+
+
+
+/**
+ * @returns the buffer pool size class for \p extra_size bytes of
+ *          backing memory, or -1 if too large to be pooled.
+ */
+static int rd_kafka_buf_pool_class(size_t extra_size) {
+        size_t class_size = RD_KAFKA_BUF_POOL_CLASS_MIN_SIZE;
+        int i;
+
+        for (i = 0; i < RD_KAFKA_BUF_POOL_CLASS_CNT; i++, class_size <<= 2)
+                if (extra_size <= class_size)
+                        return i;
+
+        return -1;
+}
+
+#define rd_kafka_buf_pool_class_size(class)                                    \
+        ((size_t)RD_KAFKA_BUF_POOL_CLASS_MIN_SIZE << (2 * (class)))
+
+
+/**
+ * @brief Initialize buffer pool \p rkbp which will retain at most
+ *        \p max_size bytes of buffer backing memory.
+ *        A \p max_size of 0 disables the pool.
+ */
+void rd_kafka_buf_pool_init(rd_kafka_buf_pool_t *rkbp, size_t max_size) {
+        int i;
+
+        memset(rkbp, 0, sizeof(*rkbp));
+        mtx_init(&rkbp->rkbp_lock, mtx_plain);
+        for (i = 0; i < RD_KAFKA_BUF_POOL_CLASS_CNT; i++)
+                TAILQ_INIT(&rkbp->rkbp_bufs[i]);
+        rkbp->rkbp_max_size = max_size;
+}
+
+
+/**
+ * @brief Free all pooled buffers and destroy the pool.
+ *
+ * @remark All buffers allocated from the pool must have been destroyed.
+ */
+void rd_kafka_buf_pool_destroy(rd_kafka_buf_pool_t *rkbp) {
+        int i;
+
+        for (i = 0; i < RD_KAFKA_BUF_POOL_CLASS_CNT; i++) {
+                rd_kafka_buf_t *rkbuf, *tmp;
+
+                TAILQ_FOREACH_SAFE(rkbuf, &rkbp->rkbp_bufs[i], rkbuf_link,
+                                   tmp) {
+                        rd_buf_destroy(&rkbuf->rkbuf_buf);
+                        rd_free(rkbuf);
+                }
+        }
+
+        mtx_destroy(&rkbp->rkbp_lock);
+}
+
+
+/**
+ * @brief Get a buffer from the pool with at least \p segcnt initial segments
+ *        and \p size bytes of initial backing memory, or allocate a new
+ *        pool-sized buffer if there is none available in the pool.
+ *
+ * @returns the new buffer (with refcnt 1), or NULL if the pool is disabled
+ *          or the requested size is too large to be pooled, in which case
+ *          the caller should fall back on rd_kafka_buf_new0().
+ *
+ * @locality any
+ * @locks none
+ */
+rd_kafka_buf_t *rd_kafka_buf_pool_get(rd_kafka_buf_pool_t *rkbp,
+                                      int segcnt,
+                                      size_t size) {
+        rd_kafka_buf_t *rkbuf;
+        size_t extra_size, class_size;
+        int class;
+
+        rd_dassert(segcnt > 0);
+
+        if (!rkbp->rkbp_max_size)
+                return NULL;
+
+        /* Same calculation as rd_buf_init() */
+        extra_size = (RD_ROUNDUP(sizeof(rd_segment_t), 8) * segcnt) + size;
+        class      = rd_kafka_buf_pool_class(extra_size);
+
+        mtx_lock(&rkbp->rkbp_lock);
+        if (unlikely(class == -1)) {
+                rkbp->rkbp_c.misses++;
+                mtx_unlock(&rkbp->rkbp_lock);
+                return NULL;
+        }
+
+        class_size = rd_kafka_buf_pool_class_size(class);
+
+        if ((rkbuf = TAILQ_FIRST(&rkbp->rkbp_bufs[class]))) {
+                TAILQ_REMOVE(&rkbp->rkbp_bufs[class], rkbuf, rkbuf_link);
+                rkbp->rkbp_cnt--;
+                rkbp->rkbp_size -= class_size;
+                rkbp->rkbp_c.hits++;
+        } else {
+                rkbp->rkbp_c.misses++;
+        }
+        mtx_unlock(&rkbp->rkbp_lock);
+
+        if (rkbuf) {
+                /* The buffer was reset by pool_put(), keep its backing
+                 * memory but clear everything else. */
+                rd_buf_t rbuf = rkbuf->rkbuf_buf;
+
+                memset(rkbuf, 0, sizeof(*rkbuf));
+                rkbuf->rkbuf_buf = rbuf;
+                TAILQ_INIT(&rkbuf->rkbuf_buf.rbuf_segments);
+
+        } else {
+                rkbuf = rd_calloc(1, sizeof(*rkbuf));
+                /* Round up the backing memory to the class size. */
+                rd_buf_init(&rkbuf->rkbuf_buf, segcnt,
+                            size + (class_size - extra_size));
+        }
+
+        rkbuf->rkbuf_flags = RD_KAFKA_OP_F_POOLED;
+        rd_refcnt_init(&rkbuf->rkbuf_refcnt, 1);
+
+        return rkbuf;
+}
+
+
+/**
+ * @brief Return \p rkbuf, which must have been allocated with
+ *        rd_kafka_buf_pool_get() and must have been cleaned up with
+ *        only its rkbuf_buf remaining, to the pool.
+ *
+ * @returns rd_true if the buffer was added to the pool, or rd_false if
+ *          the pool is full in which case the caller must free the buffer.
+ *
+ * @locality any
+ * @locks none
+ */
+static rd_bool_t rd_kafka_buf_pool_put(rd_kafka_buf_pool_t *rkbp,
+                                       rd_kafka_buf_t *rkbuf) {
+        size_t class_size = rkbuf->rkbuf_buf.rbuf_extra_size;
+        int class         = rd_kafka_buf_pool_class(class_size);
+
+        rd_dassert(class != -1 &&
+                   class_size == rd_kafka_buf_pool_class_size(class));
+
+        /* Free any segments not in the pre-allocated backing memory. */
+        rd_buf_reset(&rkbuf->rkbuf_buf);
+
+        mtx_lock(&rkbp->rkbp_lock);
+        if (rkbp->rkbp_size + class_size > rkbp->rkbp_max_size) {
+                rkbp->rkbp_c.discards++;
+                mtx_unlock(&rkbp->rkbp_lock);
+                return rd_false;
+        }
+
+        /* LIFO to reuse the most recently used, and thus most likely
+         * cache-warm, memory. */
+        TAILQ_INSERT_HEAD(&rkbp->rkbp_bufs[class], rkbuf, rkbuf_link);
+        rkbp->rkbp_cnt++;
+        rkbp->rkbp_size += class_size;
+        mtx_unlock(&rkbp->rkbp_lock);
+
+        return rd_true;
 }
 
 
@@ -141,7 +323,8 @@ rd_kafka_buf_t *rd_kafka_buf_new_request0(rd_kafka_broker_t *rkb,
                 (is_flexver ? 1 + 1 : 0);
         segcnt += 1; /* headers */
 
-        rkbuf = rd_kafka_buf_new0(segcnt, size, 0);
+        if (!(rkbuf = rd_kafka_buf_pool_get(&rkb->rkb_buf_pool, segcnt, size)))
+                rkbuf = rd_kafka_buf_new0(segcnt, size, 0);
 
         rkbuf->rkbuf_rkb = rkb;
         rd_kafka_broker_keep(rkb);
@@ -528,3 +711,380 @@ void rd_kafka_buf_set_maker(rd_kafka_buf_t *rkbuf,
 
         rkbuf->rkbuf_flags |= RD_KAFKA_OP_F_NEED_MAKE;
 }
+
+
+
+/**
+ * @brief Receive buffer pool block header, preceding the block's memory.
+ */
+typedef struct rd_kafka_rxbuf_s {
+        TAILQ_ENTRY(rd_kafka_rxbuf_s) rkrb_link;
+        rd_kafka_rxbuf_pool_t *rkrb_pool; /**< Pool the block belongs to */
+        int rkrb_class;                   /**< Size class */
+        size_t rkrb_mmap_size; /**< Size of mmap():ed region, or 0 if
+                                *   allocated with rd_malloc(). */
+} rd_kafka_rxbuf_t;
+
+/** Block header size, keeping the block memory cache-line aligned. */
+#define RD_KAFKA_RXBUF_HDR_SIZE RD_ROUNDUP(sizeof(rd_kafka_rxbuf_t), 64)
+
+#define rd_kafka_rxbuf_pool_class_size(class)                                  \
+        ((size_t)RD_KAFKA_RXBUF_POOL_CLASS_MIN_SIZE << (class))
+
+/** Huge page size, blocks of at least this size will be backed by
+ *  huge pages if enabled. */
+#define RD_KAFKA_RXBUF_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+
+/**
+ * @brief Initialize receive buffer pool \p rkrp which will retain at most
+ *        \p max_size bytes of blocks. A \p max_size of 0 disables the pool.
+ */
+void rd_kafka_rxbuf_pool_init(rd_kafka_rxbuf_pool_t *rkrp,
+                              size_t max_size,
+                              rd_bool_t hugepages) {
+        int i;
+
+        memset(rkrp, 0, sizeof(*rkrp));
+        mtx_init(&rkrp->rkrp_lock, mtx_plain);
+        for (i = 0; i < RD_KAFKA_RXBUF_POOL_CLASS_CNT; i++)
+                TAILQ_INIT(&rkrp->rkrp_blocks[i]);
+        rkrp->rkrp_max_size  = max_size;
+        rkrp->rkrp_hugepages = hugepages;
+}
+
+
+/**
+ * @brief Allocate a new block of size class \p class.
+ */
+static rd_kafka_rxbuf_t *rd_kafka_rxbuf_new(rd_kafka_rxbuf_pool_t *rkrp,
+                                            int class) {
+        rd_kafka_rxbuf_t *rkrb = NULL;
+        size_t size =
+            RD_KAFKA_RXBUF_HDR_SIZE + rd_kafka_rxbuf_pool_class_size(class);
+
+#ifdef MADV_HUGEPAGE
+        if (rkrp->rkrp_hugepages &&
+            rd_kafka_rxbuf_pool_class_size(class) >=
+                RD_KAFKA_RXBUF_HUGEPAGE_SIZE) {
+                size_t mmap_size = RD_ROUNDUP(size, 4096);
+                void *p = mmap(NULL, mmap_size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+                if (p != MAP_FAILED) {
+                        /* Failure is not fatal: the kernel may not
+                         * support transparent huge pages. */
+                        madvise(p, mmap_size, MADV_HUGEPAGE);
+                        rkrb                 = p;
+                        rkrb->rkrb_mmap_size = mmap_size;
+                }
+        }
+#endif
+
+        if (!rkrb) {
+                rkrb                 = rd_malloc(size);
+                rkrb->rkrb_mmap_size = 0;
+        }
+
+        rkrb->rkrb_pool  = rkrp;
+        rkrb->rkrb_class = class;
+
+        return rkrb;
+}
+
+
+/**
+ * @brief Free block \p rkrb.
+ */
+static void rd_kafka_rxbuf_free(rd_kafka_rxbuf_t *rkrb) {
+#ifdef MADV_HUGEPAGE
+        if (rkrb->rkrb_mmap_size > 0) {
+                munmap(rkrb, rkrb->rkrb_mmap_size);
+                return;
+        }
+#endif
+        rd_free(rkrb);
+}
+
+
+/**
+ * @brief Free all pooled blocks and destroy the pool.
+ *
+ * @remark All blocks allocated from the pool must have been released.
+ */
+void rd_kafka_rxbuf_pool_destroy(rd_kafka_rxbuf_pool_t *rkrp) {
+        int i;
+
+        for (i = 0; i < RD_KAFKA_RXBUF_POOL_CLASS_CNT; i++) {
+                rd_kafka_rxbuf_t *rkrb, *tmp;
+
+                TAILQ_FOREACH_SAFE(rkrb, &rkrp->rkrp_blocks[i], rkrb_link,
+                                   tmp) {
+                        rd_kafka_rxbuf_free(rkrb);
+                }
+        }
+
+        mtx_destroy(&rkrp->rkrp_lock);
+}
+
+
+/**
+ * @brief Get a block of at least \p size bytes from the pool, or allocate
+ *        a new one if there is none available in the pool.
+ *
+ * @returns a pointer to the block's memory, which must be released with
+ *          rd_kafka_rxbuf_pool_release(), or NULL if the pool is disabled or
+ *          \p size is too small or too large to be pooled, in which case
+ *          the caller should allocate the memory by other means.
+ *
+ * @locality any
+ * @locks none
+ */
+void *rd_kafka_rxbuf_pool_get(rd_kafka_rxbuf_pool_t *rkrp, size_t size) {
+        rd_kafka_rxbuf_t *rkrb;
+        int class;
+
+        if (!rkrp->rkrp_max_size || size < RD_KAFKA_RXBUF_POOL_CLASS_MIN_SIZE)
+                return NULL;
+
+        for (class = 0; class < RD_KAFKA_RXBUF_POOL_CLASS_CNT; class++)
+                if (size <= rd_kafka_rxbuf_pool_class_size(class))
+                        break;
+
+        mtx_lock(&rkrp->rkrp_lock);
+        if (unlikely(class == RD_KAFKA_RXBUF_POOL_CLASS_CNT)) {
+                rkrp->rkrp_c.misses++;
+                mtx_unlock(&rkrp->rkrp_lock);
+                return NULL;
+        }
+
+        if ((rkrb = TAILQ_FIRST(&rkrp->rkrp_blocks[class]))) {
+                TAILQ_REMOVE(&rkrp->rkrp_blocks[class], rkrb, rkrb_link);
+                rkrp->rkrp_cnt--;
+                rkrp->rkrp_size -= rd_kafka_rxbuf_pool_class_size(class);
+                rkrp->rkrp_c.hits++;
+        } else {
+                rkrp->rkrp_c.misses++;
+        }
+        mtx_unlock(&rkrp->rkrp_lock);
+
+        if (!rkrb)
+                rkrb = rd_kafka_rxbuf_new(rkrp, class);
+
+        return (char *)rkrb + RD_KAFKA_RXBUF_HDR_SIZE;
+}
+
+
+/**
+ * @brief Release block memory \p mem, as returned by
+ *        rd_kafka_rxbuf_pool_get(), back to its pool, or free it if the
+ *        pool is full.
+ *
+ * Suitable as an rd_buf_t segment free callback.
+ *
+ * @locality any
+ * @locks none
+ */
+void rd_kafka_rxbuf_pool_release(void *mem) {
+        rd_kafka_rxbuf_t *rkrb =
+            (rd_kafka_rxbuf_t *)((char *)mem - RD_KAFKA_RXBUF_HDR_SIZE);
+        rd_kafka_rxbuf_pool_t *rkrp = rkrb->rkrb_pool;
+        size_t class_size = rd_kafka_rxbuf_pool_class_size(rkrb->rkrb_class);
+
+        mtx_lock(&rkrp->rkrp_lock);
+        if (rkrp->rkrp_size + class_size > rkrp->rkrp_max_size) {
+                rkrp->rkrp_c.discards++;
+                mtx_unlock(&rkrp->rkrp_lock);
+                rd_kafka_rxbuf_free(rkrb);
+                return;
+        }
+
+        TAILQ_INSERT_HEAD(&rkrp->rkrp_blocks[rkrb->rkrb_class], rkrb,
+                          rkrb_link);
+        rkrp->rkrp_cnt++;
+        rkrp->rkrp_size += class_size;
+        mtx_unlock(&rkrp->rkrp_lock);
+}
+
+
+/**
+ * @name Unit tests
+ * @{
+ */
+
+/**
+ * @brief Simulate rd_kafka_buf_destroy_final() of a pooled buffer.
+ */
+static rd_bool_t ut_buf_pool_release(rd_kafka_buf_pool_t *rkbp,
+                                     rd_kafka_buf_t *rkbuf) {
+        rd_refcnt_destroy(&rkbuf->rkbuf_refcnt);
+        if (rd_kafka_buf_pool_put(rkbp, rkbuf))
+                return rd_true;
+        rd_buf_destroy(&rkbuf->rkbuf_buf);
+        rd_free(rkbuf);
+        return rd_false;
+}
+
+static int unittest_buf_pool(void) {
+        rd_kafka_buf_pool_t rkbp;
+        rd_kafka_buf_t *rkbuf, *rkbuf2, *bufs[3];
+        static const char data[5000];
+        int i;
+
+        rd_kafka_buf_pool_init(&rkbp, 8 * 1024);
+
+        rkbuf = rd_kafka_buf_pool_get(&rkbp, 2, 100);
+        RD_UT_ASSERT(rkbuf && (rkbuf->rkbuf_flags & RD_KAFKA_OP_F_POOLED),
+                     "expected pooled buffer");
+        RD_UT_ASSERT(rkbuf->rkbuf_buf.rbuf_extra_size == 1024,
+                     "expected 1024 bytes size class, not %" PRIusz,
+                     rkbuf->rkbuf_buf.rbuf_extra_size);
+
+        /* Grow beyond the pre-allocated memory */
+        rd_kafka_buf_write(rkbuf, data, sizeof(data));
+        RD_UT_ASSERT(ut_buf_pool_release(&rkbp, rkbuf),
+                     "expected buffer to be pooled");
+        RD_UT_ASSERT(rkbp.rkbp_cnt == 1 && rkbp.rkbp_size == 1024,
+                     "expected 1 buffer of 1024 bytes in pool, not %d (%" PRIusz
+                     " bytes)",
+                     rkbp.rkbp_cnt, rkbp.rkbp_size);
+
+        /* The pooled buffer is reused and reset */
+        rkbuf2 = rd_kafka_buf_pool_get(&rkbp, 1, 10);
+        RD_UT_ASSERT(rkbuf2 == rkbuf, "expected pooled buffer to be reused");
+        RD_UT_ASSERT(rd_buf_len(&rkbuf2->rkbuf_buf) == 0 &&
+                         rd_buf_mem_size(&rkbuf2->rkbuf_buf) == 1024,
+                     "expected reused buffer to be reset");
+        RD_UT_ASSERT(rkbp.rkbp_c.hits == 1 && rkbp.rkbp_c.misses == 1,
+                     "expected 1 hit and 1 miss, not %" PRIu64 " and %" PRIu64,
+                     rkbp.rkbp_c.hits, rkbp.rkbp_c.misses);
+        rd_kafka_buf_write(rkbuf2, data, 10);
+        RD_UT_ASSERT(rd_buf_len(&rkbuf2->rkbuf_buf) == 10,
+                     "expected 10 bytes written, not %" PRIusz,
+                     rd_buf_len(&rkbuf2->rkbuf_buf));
+
+        /* Too large to be pooled */
+        RD_UT_ASSERT(!rd_kafka_buf_pool_get(&rkbp, 1, 2 * 1024 * 1024),
+                     "expected too large buffer to not be pooled");
+
+        /* Pool max size is honoured */
+        for (i = 0; i < 3; i++) {
+                bufs[i] = rd_kafka_buf_pool_get(&rkbp, 1, 2000);
+                RD_UT_ASSERT(bufs[i]->rkbuf_buf.rbuf_extra_size == 4096,
+                             "expected 4096 bytes size class, not %" PRIusz,
+                             bufs[i]->rkbuf_buf.rbuf_extra_size);
+        }
+
+        RD_UT_ASSERT(ut_buf_pool_release(&rkbp, bufs[0]),
+                     "expected buffer to be pooled");
+        RD_UT_ASSERT(ut_buf_pool_release(&rkbp, bufs[1]),
+                     "expected buffer to be pooled");
+        RD_UT_ASSERT(!ut_buf_pool_release(&rkbp, bufs[2]),
+                     "expected buffer to be discarded");
+        RD_UT_ASSERT(!ut_buf_pool_release(&rkbp, rkbuf2),
+                     "expected buffer to be discarded");
+        RD_UT_ASSERT(rkbp.rkbp_c.discards == 2,
+                     "expected 2 discards, not %" PRIu64,
+                     rkbp.rkbp_c.discards);
+
+        rd_kafka_buf_pool_destroy(&rkbp);
+
+        /* Disabled pool */
+        rd_kafka_buf_pool_init(&rkbp, 0);
+        RD_UT_ASSERT(!rd_kafka_buf_pool_get(&rkbp, 1, 10),
+                     "expected disabled pool to not return buffers");
+        rd_kafka_buf_pool_destroy(&rkbp);
+
+        RD_UT_PASS();
+}
+
+
+static int unittest_rxbuf_pool(void) {
+        rd_kafka_rxbuf_pool_t rkrp;
+        rd_buf_t b;
+        void *mem, *mem2, *blocks[3];
+        static const char data[1000];
+        int i;
+
+        rd_kafka_rxbuf_pool_init(&rkrp, 256 * 1024, rd_false);
+
+        /* Too small to be pooled */
+        RD_UT_ASSERT(!rd_kafka_rxbuf_pool_get(&rkrp, 1000),
+                     "expected small block to not be pooled");
+
+        /* Use a block as receive buffer memory and release it with
+         * the buffer. */
+        mem = rd_kafka_rxbuf_pool_get(&rkrp, 100000);
+        RD_UT_ASSERT(mem, "expected pooled block");
+        rd_buf_init(&b, 1, 8);
+        rd_buf_write_ensure_contig_mem(&b, mem, 100000,
+                                       rd_kafka_rxbuf_pool_release);
+        RD_UT_ASSERT(rd_buf_write_remains(&b) == 100000,
+                     "expected 100000 writable bytes, not %" PRIusz,
+                     rd_buf_write_remains(&b));
+        rd_buf_write(&b, data, sizeof(data));
+        RD_UT_ASSERT(rd_buf_len(&b) == sizeof(data),
+                     "expected %" PRIusz " bytes written, not %" PRIusz,
+                     sizeof(data), rd_buf_len(&b));
+        rd_buf_destroy(&b);
+
+        RD_UT_ASSERT(rkrp.rkrp_cnt == 1 && rkrp.rkrp_size == 128 * 1024,
+                     "expected 1 block of 128K in pool, not %d (%" PRIusz
+                     " bytes)",
+                     rkrp.rkrp_cnt, rkrp.rkrp_size);
+
+        /* The pooled block is reused for any size in its size class */
+        mem2 = rd_kafka_rxbuf_pool_get(&rkrp, 70000);
+        RD_UT_ASSERT(mem2 == mem, "expected pooled block to be reused");
+        RD_UT_ASSERT(rkrp.rkrp_c.hits == 1 && rkrp.rkrp_c.misses == 1,
+                     "expected 1 hit and 1 miss, not %" PRIu64 " and %" PRIu64,
+                     rkrp.rkrp_c.hits, rkrp.rkrp_c.misses);
+        rd_kafka_rxbuf_pool_release(mem2);
+
+        /* Too large to be pooled */
+        RD_UT_ASSERT(!rd_kafka_rxbuf_pool_get(&rkrp, 128 * 1024 * 1024),
+                     "expected too large block to not be pooled");
+
+        /* Pool max size is honoured */
+        for (i = 0; i < 3; i++)
+                blocks[i] = rd_kafka_rxbuf_pool_get(&rkrp, 128 * 1024);
+        for (i = 0; i < 3; i++)
+                rd_kafka_rxbuf_pool_release(blocks[i]);
+        RD_UT_ASSERT(rkrp.rkrp_cnt == 2 && rkrp.rkrp_c.discards == 1,
+                     "expected 2 pooled blocks and 1 discard, not %d and "
+                     "%" PRIu64,
+                     rkrp.rkrp_cnt, rkrp.rkrp_c.discards);
+
+        rd_kafka_rxbuf_pool_destroy(&rkrp);
+
+        /* Huge page backed blocks, where supported */
+        rd_kafka_rxbuf_pool_init(&rkrp, 4 * 1024 * 1024, rd_true);
+        mem = rd_kafka_rxbuf_pool_get(&rkrp, 3 * 1024 * 1024);
+        RD_UT_ASSERT(mem, "expected pooled block");
+        memset(mem, 0xa5, 3 * 1024 * 1024);
+        rd_kafka_rxbuf_pool_release(mem);
+        RD_UT_ASSERT(rd_kafka_rxbuf_pool_get(&rkrp, 3 * 1024 * 1024) == mem,
+                     "expected pooled block to be reused");
+        rd_kafka_rxbuf_pool_release(mem);
+        rd_kafka_rxbuf_pool_destroy(&rkrp);
+
+        /* Disabled pool */
+        rd_kafka_rxbuf_pool_init(&rkrp, 0, rd_false);
+        RD_UT_ASSERT(!rd_kafka_rxbuf_pool_get(&rkrp, 100000),
+                     "expected disabled pool to not return blocks");
+        rd_kafka_rxbuf_pool_destroy(&rkrp);
+
+        RD_UT_PASS();
+}
+
+
+int unittest_buf(void) {
+        int fails = 0;
+
+        fails += unittest_buf_pool();
+        fails += unittest_rxbuf_pool();
+
+        return fails;
+}
+
+/**@}*/
@@ -378,11 +378,22 @@ struct rd_kafka_buf_s { /* rd_kafka_buf_t */
                 } Metadata;
                 struct {
                         rd_kafka_msgbatch_t batch; /**< MessageSet/batch */
+                        size_t mem_size; /**< Buffer memory accounted for
+                                          *   in rk_curr_msgs.mem */
                 } Produce;
                 struct {
                         rd_bool_t commit; /**< true = txn commit,
                                            *   false = txn abort */
                 } EndTxn;
+                struct {
+                        int32_t SessionEpoch; /**< Fetch session epoch
+                                               *   (KIP-227), or -1 if
+                                               *   not using a session. */
+                        rd_bool_t pipelined;  /**< Request is part of a
+                                               *   fetch pipeline and
+                                               *   holds the partitions'
+                                               *   rktp_fetch_inflight. */
+                } Fetch;
         } rkbuf_u;
 
 #define rkbuf_batch rkbuf_u.Produce.batch
@@ -546,6 +557,18 @@ struct rd_kafka_buf_s { /* rd_kafka_buf_t */
                 *_vp = be64toh(_v);                                            \
         } while (0)
 
+/**
+ * @brief Read a Uuid (e.g., topic id) and store it in \p dstptr
+ */
+#define rd_kafka_buf_read_uuid(rkbuf, dstptr)                                  \
+        do {                                                                   \
+                rd_kafka_Uuid_t *_uuidp = dstptr;                              \
+                rd_kafka_buf_read_i64(rkbuf,                                   \
+                                      &_uuidp->most_significant_bits);         \
+                rd_kafka_buf_read_i64(rkbuf,                                   \
+                                      &_uuidp->least_significant_bits);        \
+        } while (0)
+
 #define rd_kafka_buf_peek_i64(rkbuf, of, dstptr)                               \
         do {                                                                   \
                 int64_t _v;                                                    \
@@ -837,6 +860,103 @@ typedef struct rd_kafka_bufq_s {
 
 #define rd_kafka_bufq_cnt(rkbq) rd_atomic32_get(&(rkbq)->rkbq_cnt)
 
+
+/**
+ * @name Buffer pool
+ *
+ * Per-broker pool of recycled rd_kafka_buf_t objects along with their
+ * pre-allocated rd_buf_t backing memory (rbuf_extra), to avoid allocating
+ * and freeing a new buffer for each request and response.
+ *
+ * Buffers are allocated in a fixed set of size classes
+ * (RD_KAFKA_BUF_POOL_CLASS_MIN_SIZE << (2 * class)) and returned to the
+ * pool of the buffer's broker in rd_kafka_buf_destroy_final(),
+ * as long as the pool's total size stays within
+ * `broker.buffer.pool.max.kbytes`.
+ *
+ * Buffers may be destroyed from any thread (e.g., when the application
+ * destroys the last message referencing a FetchResponse buffer), so the
+ * pool is protected by a mutex.
+ *
+ * @{
+ */
+
+#define RD_KAFKA_BUF_POOL_CLASS_CNT      6    /**< 1K, 4K, .. 1M */
+#define RD_KAFKA_BUF_POOL_CLASS_MIN_SIZE 1024
+
+typedef struct rd_kafka_buf_pool_s {
+        mtx_t rkbp_lock;
+        /** Free buffers per size class */
+        TAILQ_HEAD(, rd_kafka_buf_s) rkbp_bufs[RD_KAFKA_BUF_POOL_CLASS_CNT];
+        int rkbp_cnt;         /**< Number of buffers in pool */
+        size_t rkbp_size;     /**< Total backing memory of pooled buffers */
+        size_t rkbp_max_size; /**< Max total backing memory, 0 = disabled */
+        struct {
+                uint64_t hits;     /**< Allocations served from the pool */
+                uint64_t misses;   /**< Allocations not served from pool */
+                uint64_t discards; /**< Buffers freed rather than pooled
+                                    *   since the pool was full. */
+        } rkbp_c;
+} rd_kafka_buf_pool_t;
+
+void rd_kafka_buf_pool_init(rd_kafka_buf_pool_t *rkbp, size_t max_size);
+void rd_kafka_buf_pool_destroy(rd_kafka_buf_pool_t *rkbp);
+rd_kafka_buf_t *rd_kafka_buf_pool_get(rd_kafka_buf_pool_t *rkbp,
+                                      int segcnt,
+                                      size_t size);
+
+/**@}*/
+
+
+/**
+ * @name Receive buffer pool
+ *
+ * Per-broker pool of recycled memory blocks used as the contiguous
+ * backing memory of received responses, such as large FetchResponses,
+ * to avoid a new multi-megabyte allocation for each response.
+ *
+ * Blocks are allocated in power-of-two size classes from
+ * RD_KAFKA_RXBUF_POOL_CLASS_MIN_SIZE and are returned to the pool when
+ * the response buffer is destroyed, i.e., when the response has been
+ * handled and, for FetchResponses, the application has destroyed all
+ * messages referencing the response, as long as the pool's total size
+ * stays within `broker.receive.buffer.pool.max.kbytes`.
+ *
+ * Blocks of 2 MB or larger may optionally be backed by transparent huge
+ * pages (`broker.receive.buffer.hugepages`).
+ *
+ * @{
+ */
+
+#define RD_KAFKA_RXBUF_POOL_CLASS_CNT      11 /**< 64K, 128K, .. 64M */
+#define RD_KAFKA_RXBUF_POOL_CLASS_MIN_SIZE (64 * 1024)
+
+typedef struct rd_kafka_rxbuf_pool_s {
+        mtx_t rkrp_lock;
+        /** Free blocks per size class */
+        TAILQ_HEAD(, rd_kafka_rxbuf_s)
+        rkrp_blocks[RD_KAFKA_RXBUF_POOL_CLASS_CNT];
+        int rkrp_cnt;             /**< Number of blocks in pool */
+        size_t rkrp_size;         /**< Total size of blocks in pool */
+        size_t rkrp_max_size;     /**< Max total size, 0 = disabled */
+        rd_bool_t rkrp_hugepages; /**< Back large blocks by huge pages */
+        struct {
+                uint64_t hits;     /**< Blocks served from the pool */
+                uint64_t misses;   /**< Blocks not served from the pool */
+                uint64_t discards; /**< Blocks freed rather than pooled
+                                    *   since the pool was full. */
+        } rkrp_c;
+} rd_kafka_rxbuf_pool_t;
+
+void rd_kafka_rxbuf_pool_init(rd_kafka_rxbuf_pool_t *rkrp,
+                              size_t max_size,
+                              rd_bool_t hugepages);
+void rd_kafka_rxbuf_pool_destroy(rd_kafka_rxbuf_pool_t *rkrp);
+void *rd_kafka_rxbuf_pool_get(rd_kafka_rxbuf_pool_t *rkrp, size_t size);
+void rd_kafka_rxbuf_pool_release(void *mem);
+
+/**@}*/
+
 /**
  * @brief Set buffer's request timeout to relative \p timeout_ms measured
  *        from the time the buffer is sent on the underlying socket.
@@ -1181,6 +1301,16 @@ static RD_INLINE size_t rd_kafka_buf_write_i64(rd_kafka_buf_t *rkbuf,
         return rd_kafka_buf_write(rkbuf, &v, sizeof(v));
 }
 
+/**
+ * @brief Write Uuid (e.g., topic id) to buffer.
+ */
+static RD_INLINE size_t rd_kafka_buf_write_uuid(rd_kafka_buf_t *rkbuf,
+                                                rd_kafka_Uuid_t uuid) {
+        size_t of = rd_kafka_buf_write_i64(rkbuf, uuid.most_significant_bits);
+        rd_kafka_buf_write_i64(rkbuf, uuid.least_significant_bits);
+        return of;
+}
+
 /**
  * Update int64_t in buffer at address 'ptr'.
  * 'of' should have been previously returned by `.._buf_write_i64()`.
@@ -67,6 +67,11 @@ static void rd_kafka_cgrp_group_leader_reset(rd_kafka_cgrp_t *rkcg,
 
 static RD_INLINE int rd_kafka_cgrp_try_terminate(rd_kafka_cgrp_t *rkcg);
 
+static void rd_kafka_cgrp_offsets_commit(rd_kafka_cgrp_t *rkcg,
+                                         rd_kafka_op_t *rko,
+                                         rd_bool_t set_offsets,
+                                         const char *reason);
+
 static void rd_kafka_cgrp_revoke_all_rejoin(rd_kafka_cgrp_t *rkcg,
                                             rd_bool_t assignment_lost,
                                             rd_bool_t initiating,
@@ -97,6 +102,12 @@ static void
 rd_kafka_cgrp_handle_assignment(rd_kafka_cgrp_t *rkcg,
                                 rd_kafka_topic_partition_list_t *assignment);
 
+static void rd_kafka_cgrp_consumer_join(rd_kafka_cgrp_t *rkcg);
+static void rd_kafka_cgrp_consumer_heartbeat(rd_kafka_cgrp_t *rkcg);
+static void rd_kafka_cgrp_consumer_leave(rd_kafka_cgrp_t *rkcg,
+                                         const char *member_id);
+static void rd_kafka_cgrp_consumer_reconcile(rd_kafka_cgrp_t *rkcg);
+
 
 /**
  * @returns true if the current assignment is lost.
@@ -170,6 +181,9 @@ rd_kafka_cgrp_assignment_clear_lost(rd_kafka_cgrp_t *rkcg, char *fmt, ...) {
  */
 rd_kafka_rebalance_protocol_t
 rd_kafka_cgrp_rebalance_protocol(rd_kafka_cgrp_t *rkcg) {
+        /* The consumer group protocol (KIP-848) is always incremental. */
+        if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg))
+                return RD_KAFKA_REBALANCE_PROTOCOL_COOPERATIVE;
         if (!rkcg->rkcg_assignor)
                 return RD_KAFKA_REBALANCE_PROTOCOL_NONE;
         return rkcg->rkcg_assignor->rkas_protocol;
@@ -354,7 +368,337 @@ void rd_kafka_cgrp_set_join_state(rd_kafka_cgrp_t *rkcg, int join_state) {
 }
 
 
+/**
+ * @brief rkcg_commit_dirty list element destructor.
+ */
+static void rd_kafka_cgrp_commit_dirty_toppar_destroy(void *ptr) {
+        rd_kafka_toppar_t *rktp = ptr;
+        rd_kafka_toppar_destroy(rktp);
+}
+
+
+/**
+ * @name Static group membership assignment snapshot
+ * @{
+ *
+ * With `group.assignment.snapshot.path` a static group member writes its
+ * assignment, with each partition's committed offset, to a local file when
+ * the consumer is closed. The next run of the consumer reads the file
+ * when it is created and prefetches the partitions at their committed
+ * offsets while it rejoins the group, see rd_kafka_assignment_prefetch().
+ * Messages are only delivered once a partition is assigned and its
+ * committed offset is confirmed by the group coordinator, so an outdated
+ * snapshot only costs the prefetched messages.
+ *
+ * The file is a text file: a format line, the group.id and
+ * group.instance.id lines, a partition count line, and one
+ * "<topic> <partition> <offset>" line per partition. The file is written
+ * to a temporary file that is renamed over the previous snapshot once
+ * complete, and a file with fewer partition lines than its count is
+ * ignored, so a crash while writing never leaves a truncated snapshot to
+ * be used.
+ */
+
+#define RD_KAFKA_CGRP_SNAPSHOT_FORMAT "librdkafka-assignment-snapshot 1"
+
+
+/**
+ * @brief Open the snapshot file \p path with \p flags.
+ *
+ * @returns the opened file, or NULL on error (errno is set).
+ */
+static FILE *
+rd_kafka_cgrp_snapshot_open(rd_kafka_t *rk, const char *path, int flags) {
+        int fd;
+#ifndef _WIN32
+        mode_t mode = 0644;
+#else
+        mode_t mode = _S_IREAD | _S_IWRITE;
+#endif
+
+        fd = rk->rk_conf.open_cb(path, flags, mode, rk->rk_conf.opaque);
+        if (fd == -1)
+                return NULL;
+
+#ifndef _WIN32
+        return fdopen(fd, (flags & O_WRONLY) ? "w" : "r");
+#else
+        return _fdopen(fd, (flags & O_WRONLY) ? "w" : "r");
+#endif
+}
+
+
+/**
+ * @brief Read the next line of \p fp into \p buf, without the newline.
+ *
+ * @returns false on end of file or if the line does not fit \p buf.
+ */
+static rd_bool_t
+rd_kafka_cgrp_snapshot_read_line(FILE *fp, char *buf, size_t size) {
+        size_t len;
+
+        if (!fgets(buf, (int)size, fp))
+                return rd_false;
+
+        len = strlen(buf);
+        if (len == 0 || buf[len - 1] != '\n')
+                return rd_false;
+
+        buf[len - 1] = '\0';
+        return rd_true;
+}
+
+
+/**
+ * @brief Read the assignment snapshot written by a previous run of this
+ *        static group member.
+ *
+ * @returns the snapshot's partitions with their committed offsets, or NULL
+ *          if there is no usable snapshot.
+ */
+static rd_kafka_topic_partition_list_t *
+rd_kafka_cgrp_snapshot_read(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_t *rk = rkcg->rkcg_rk;
+        const char *path = rk->rk_conf.group_assignment_snapshot_path;
+        rd_kafka_topic_partition_list_t *partitions;
+        char line[512], *end;
+        long cnt;
+        FILE *fp;
+
+        if (!(fp = rd_kafka_cgrp_snapshot_open(rk, path, O_RDONLY))) {
+                rd_kafka_dbg(rk, CGRP, "SNAPSHOT",
+                             "No assignment snapshot to read from %s: %s",
+                             path, rd_strerror(errno));
+                return NULL;
+        }
+
+        /* The snapshot must have been written by this group member. */
+        if (!rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line)) ||
+            strcmp(line, RD_KAFKA_CGRP_SNAPSHOT_FORMAT) ||
+            !rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line)) ||
+            strcmp(line, rk->rk_conf.group_id_str) ||
+            !rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line)) ||
+            strcmp(line, rk->rk_conf.group_instance_id) ||
+            !rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line)) ||
+            (cnt = strtol(line, &end, 10)) < 0 || end == line || *end) {
+                rd_kafka_log(rk, LOG_WARNING, "SNAPSHOT",
+                             "Ignoring assignment snapshot %s: "
+                             "unknown format or written by another "
+                             "group member",
+                             path);
+                fclose(fp);
+                return NULL;
+        }
+
+        partitions = rd_kafka_topic_partition_list_new(0);
+
+        while (partitions->cnt < cnt &&
+               rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line))) {
+                char *topic = line, *s;
+                long partition;
+                int64_t offset;
+
+                /* Topic names can't contain spaces. */
+                if (!(s = strchr(line, ' ')))
+                        break;
+                *s = '\0';
+
+                partition = strtol(s + 1, &end, 10);
+                if (end == s + 1 || *end != ' ' || partition < 0)
+                        break;
+
+                s      = end + 1;
+                offset = strtoll(s, &end, 10);
+                if (end == s || *end)
+                        break;
+
+                rd_kafka_topic_partition_list_add(partitions, topic,
+                                                  (int32_t)partition)
+                    ->offset = offset;
+        }
+
+        /* A truncated snapshot has fewer partitions than its count. */
+        if (partitions->cnt < cnt ||
+            rd_kafka_cgrp_snapshot_read_line(fp, line, sizeof(line)) ||
+            !feof(fp)) {
+                rd_kafka_log(rk, LOG_WARNING, "SNAPSHOT",
+                             "Ignoring assignment snapshot %s: "
+                             "truncated or invalid partition line \"%s\"",
+                             path, line);
+                rd_kafka_topic_partition_list_destroy(partitions);
+                partitions = NULL;
+        } else {
+                rd_kafka_dbg(rk, CGRP, "SNAPSHOT",
+                             "Read assignment snapshot of %d partition(s) "
+                             "from %s",
+                             partitions->cnt, path);
+        }
+
+        fclose(fp);
+
+        return partitions;
+}
+
+
+/**
+ * @brief Replace the file \p path with \p tmppath.
+ *
+ * @returns 0 on success or -1 on error (errno is set).
+ */
+static int rd_kafka_cgrp_snapshot_rename(const char *tmppath,
+                                         const char *path) {
+#ifndef _WIN32
+        return rename(tmppath, path);
+#else
+        if (!MoveFileExA(tmppath, path, MOVEFILE_REPLACE_EXISTING)) {
+                errno = EIO;
+                return -1;
+        }
+        return 0;
+#endif
+}
+
+
+/**
+ * @brief Write the assignment snapshot \p partitions with their current
+ *        committed offsets, for the next run of this static group member.
+ *
+ * Partitions without a known committed offset are left out.
+ */
+static void rd_kafka_cgrp_snapshot_write(
+    rd_kafka_cgrp_t *rkcg,
+    const rd_kafka_topic_partition_list_t *partitions) {
+        rd_kafka_t *rk   = rkcg->rkcg_rk;
+        const char *path = rk->rk_conf.group_assignment_snapshot_path;
+        rd_kafka_topic_partition_list_t *snapshot;
+        const rd_kafka_topic_partition_t *rktpar;
+        char tmppath[1024];
+        int cnt;
+        int r;
+        FILE *fp;
+
+        if (rd_snprintf(tmppath, sizeof(tmppath), "%s.tmp", path) >=
+            (int)sizeof(tmppath)) {
+                rd_kafka_log(rk, LOG_WARNING, "SNAPSHOT",
+                             "Failed to write assignment snapshot %s: "
+                             "path too long",
+                             path);
+                return;
+        }
+
+        snapshot = rd_kafka_topic_partition_list_new(partitions->cnt);
+        RD_KAFKA_TPLIST_FOREACH(rktpar, partitions) {
+                /* Borrow ref */
+                rd_kafka_toppar_t *rktp =
+                    rd_kafka_topic_partition_toppar(rk, rktpar);
+                int64_t offset;
+
+                if (!rktp)
+                        continue;
+
+                rd_kafka_toppar_lock(rktp);
+                offset = rktp->rktp_committed_cache.pos.offset;
+                rd_kafka_toppar_unlock(rktp);
+
+                if (offset < 0)
+                        continue;
+
+                rd_kafka_topic_partition_list_add(snapshot, rktpar->topic,
+                                                  rktpar->partition)
+                    ->offset = offset;
+        }
+        cnt = snapshot->cnt;
+
+        if (!(fp = rd_kafka_cgrp_snapshot_open(rk, tmppath,
+                                               O_CREAT | O_WRONLY |
+                                                   O_TRUNC))) {
+                rd_kafka_log(rk, LOG_WARNING, "SNAPSHOT",
+                             "Failed to open assignment snapshot %s "
+                             "for writing: %s",
+                             tmppath, rd_strerror(errno));
+                rd_kafka_topic_partition_list_destroy(snapshot);
+                return;
+        }
+
+        fprintf(fp, "%s\n%s\n%s\n%d\n", RD_KAFKA_CGRP_SNAPSHOT_FORMAT,
+                rk->rk_conf.group_id_str, rk->rk_conf.group_instance_id, cnt);
+
+        RD_KAFKA_TPLIST_FOREACH(rktpar, snapshot) {
+                fprintf(fp, "%s %" PRId32 " %" PRId64 "\n", rktpar->topic,
+                        rktpar->partition, rktpar->offset);
+        }
+
+        rd_kafka_topic_partition_list_destroy(snapshot);
+
+        /* Make sure the snapshot is on disk before it replaces the
+         * previous one. */
+        r = fflush(fp);
+#ifndef _WIN32
+        if (r != EOF)
+                r = fsync(fileno(fp));
+#else
+        if (r != EOF)
+                r = _commit(_fileno(fp));
+#endif
+        if (fclose(fp) == EOF)
+                r = -1;
+
+        if (r || rd_kafka_cgrp_snapshot_rename(tmppath, path) == -1) {
+                rd_kafka_log(rk, LOG_WARNING, "SNAPSHOT",
+                             "Failed to write assignment snapshot %s: %s",
+                             path, rd_strerror(errno));
+                remove(tmppath);
+                return;
+        }
+
+        rd_kafka_dbg(rk, CGRP, "SNAPSHOT",
+                     "Wrote assignment snapshot of %d partition(s) to %s", cnt,
+                     path);
+}
+
+
+/**
+ * @brief Prefetch the partitions of the read assignment snapshot that
+ *        belong to topics in the new \p subscription, and forget the
+ *        snapshot.
+ *
+ * @remark Topics subscribed to by regex are not prefetched.
+ */
+static void rd_kafka_cgrp_snapshot_prefetch(
+    rd_kafka_cgrp_t *rkcg,
+    const rd_kafka_topic_partition_list_t *subscription) {
+        rd_kafka_topic_partition_list_t *partitions;
+        const rd_kafka_topic_partition_t *rktpar;
+
+        partitions =
+            rd_kafka_topic_partition_list_new(rkcg->rkcg_snapshot->cnt);
+        RD_KAFKA_TPLIST_FOREACH(rktpar, rkcg->rkcg_snapshot) {
+                if (rd_kafka_topic_partition_list_find_topic(subscription,
+                                                             rktpar->topic))
+                        rd_kafka_topic_partition_list_add_copy(partitions,
+                                                               rktpar);
+        }
+
+        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "SNAPSHOT",
+                     "Group \"%.*s\": prefetching %d of %d partition(s) "
+                     "in assignment snapshot while joining",
+                     RD_KAFKAP_STR_PR(rkcg->rkcg_group_id), partitions->cnt,
+                     rkcg->rkcg_snapshot->cnt);
+
+        rd_kafka_assignment_prefetch(rkcg->rkcg_rk, partitions);
+
+        rd_kafka_topic_partition_list_destroy(partitions);
+        rd_kafka_topic_partition_list_destroy(rkcg->rkcg_snapshot);
+        rkcg->rkcg_snapshot = NULL;
+}
+
+/**@}*/
+
+
 void rd_kafka_cgrp_destroy_final(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_op_t *rko;
+        int i;
+
         rd_kafka_assert(rkcg->rkcg_rk, !rkcg->rkcg_subscription);
         rd_kafka_assert(rkcg->rkcg_rk, !rkcg->rkcg_group_leader.members);
         rd_kafka_cgrp_set_member_id(rkcg, NULL);
@@ -369,6 +713,17 @@ void rd_kafka_cgrp_destroy_final(rd_kafka_cgrp_t *rkcg) {
         rd_list_destroy(&rkcg->rkcg_toppars);
         rd_list_destroy(rkcg->rkcg_subscribed_topics);
         rd_kafka_topic_partition_list_destroy(rkcg->rkcg_errored_topics);
+        if (rkcg->rkcg_consumer.target)
+                rd_list_destroy(rkcg->rkcg_consumer.target);
+        rd_list_destroy(&rkcg->rkcg_consumer.topic_ids);
+        RD_LIST_FOREACH(rko, &rkcg->rkcg_commit.pending, i)
+        rd_kafka_op_destroy(rko);
+        rd_list_destroy(&rkcg->rkcg_commit.pending);
+        rd_list_destroy(&rkcg->rkcg_commit_dirty.list);
+        mtx_destroy(&rkcg->rkcg_commit_dirty.lock);
+        rd_avg_destroy(&rkcg->rkcg_rebalance_latency.latency);
+        if (rkcg->rkcg_snapshot)
+                rd_kafka_topic_partition_list_destroy(rkcg->rkcg_snapshot);
         if (rkcg->rkcg_assignor && rkcg->rkcg_assignor->rkas_destroy_state_cb)
                 rkcg->rkcg_assignor->rkas_destroy_state_cb(
                     rkcg->rkcg_assignor_state);
@@ -433,6 +788,23 @@ rd_kafka_cgrp_t *rd_kafka_cgrp_new(rd_kafka_t *rk,
 
         rkcg->rkcg_errored_topics = rd_kafka_topic_partition_list_new(0);
 
+        if (rk->rk_conf.group_assignment_snapshot_path)
+                rkcg->rkcg_snapshot = rd_kafka_cgrp_snapshot_read(rkcg);
+
+        rd_list_init(&rkcg->rkcg_consumer.topic_ids, 0,
+                     rd_kafka_topic_id_partitions_destroy);
+
+        rd_list_init(&rkcg->rkcg_commit.pending, 0, NULL);
+        mtx_init(&rkcg->rkcg_commit_dirty.lock, mtx_plain);
+        rd_list_init(&rkcg->rkcg_commit_dirty.list, 0,
+                     rd_kafka_cgrp_commit_dirty_toppar_destroy);
+
+        rd_atomic64_init(&rkcg->rkcg_rebalance_latency.ts_start, 0);
+        rd_atomic32_init(&rkcg->rkcg_rebalance_latency.epoch, 0);
+        rd_avg_init(&rkcg->rkcg_rebalance_latency.latency, RD_AVG_GAUGE, 0,
+                    600 * 1000 * 1000ll /* 10 minutes */, 2,
+                    rk->rk_conf.stats_interval_ms ? 1 : 0);
+
         /* Create a logical group coordinator broker to provide
          * a dedicated connection for group coordination.
          * This is needed since JoinGroup may block for up to
@@ -876,6 +1248,10 @@ static void rd_kafka_cgrp_leave(rd_kafka_cgrp_t *rkcg) {
         if (rkcg->rkcg_state == RD_KAFKA_CGRP_STATE_UP) {
                 rd_rkb_dbg(rkcg->rkcg_curr_coord, CONSUMER, "LEAVE",
                            "Leaving group");
+                if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg)) {
+                        rd_kafka_cgrp_consumer_leave(rkcg, member_id);
+                        return;
+                }
                 rd_kafka_LeaveGroupRequest(
                     rkcg->rkcg_coord, rkcg->rkcg_group_id->str, member_id,
                     RD_KAFKA_REPLYQ(rkcg->rkcg_ops, 0),
@@ -916,6 +1292,135 @@ static rd_bool_t rd_kafka_cgrp_leave_maybe(rd_kafka_cgrp_t *rkcg) {
 }
 
 
+/**
+ * @brief Start measuring the rebalance latency, unless the latency of
+ *        a previous rebalance is still being measured, in which case
+ *        this rebalance is considered part of it.
+ *
+ *        The measurement is started when the group leaves the steady
+ *        state to rejoin, or at the latest when the rebalance callback is
+ *        triggered, e.g., on the initial join.
+ *
+ * @locality rdkafka main thread
+ */
+static void rd_kafka_cgrp_rebalance_latency_start(rd_kafka_cgrp_t *rkcg) {
+        /* Nothing will be assigned without a subscription. */
+        if (!rkcg->rkcg_subscription && !rkcg->rkcg_next_subscription)
+                return;
+
+        if (rd_atomic64_get(&rkcg->rkcg_rebalance_latency.ts_start))
+                return;
+
+        /* Bump the epoch before publishing the start time so that no
+         * partition marked by a previous measurement can end this one. */
+        rd_atomic32_add(&rkcg->rkcg_rebalance_latency.epoch, 1);
+        rd_atomic64_set(&rkcg->rkcg_rebalance_latency.ts_start, rd_clock());
+}
+
+
+/**
+ * @brief Abandon the current rebalance latency measurement, if any,
+ *        without recording it.
+ *
+ * @locality rdkafka main thread
+ */
+static void rd_kafka_cgrp_rebalance_latency_cancel(rd_kafka_cgrp_t *rkcg) {
+        rd_atomic64_set(&rkcg->rkcg_rebalance_latency.ts_start, 0);
+}
+
+
+/**
+ * @brief Marks the partitions in \p partitions that are part of the
+ *        assignment with the current rebalance latency measurement.
+ *
+ * @returns the number of partitions marked.
+ *
+ * @locality rdkafka main thread
+ */
+static int rd_kafka_cgrp_rebalance_latency_mark(
+    rd_kafka_cgrp_t *rkcg,
+    rd_kafka_topic_partition_list_t *partitions) {
+        int32_t epoch = rd_atomic32_get(&rkcg->rkcg_rebalance_latency.epoch);
+        int i, cnt = 0;
+
+        if (!partitions)
+                return 0;
+
+        for (i = 0; i < partitions->cnt; i++) {
+                rd_kafka_toppar_t *rktp;
+
+                rktp = rd_kafka_topic_partition_ensure_toppar(
+                    rkcg->rkcg_rk, &partitions->elems[i], rd_false);
+
+                if (!rktp)
+                        continue;
+
+                rd_atomic32_set(&rktp->rktp_rebalance_epoch, epoch);
+                cnt++;
+        }
+
+        return cnt;
+}
+
+
+/**
+ * @brief Called when the rebalance hands out its assignment, prior to
+ *        resuming the paused partitions: marks the partitions that
+ *        were added (\p added) or are about to be resumed so that the
+ *        first message from one of them ends the measurement.
+ *
+ *        If the rebalance neither added nor resumed any partition, e.g.,
+ *        it only revoked partitions, there is no message to wait for and
+ *        the measurement is abandoned.
+ *
+ * @locality rdkafka main thread
+ */
+static void rd_kafka_cgrp_rebalance_latency_assigned(
+    rd_kafka_cgrp_t *rkcg,
+    rd_kafka_topic_partition_list_t *added) {
+        int cnt;
+
+        if (!rd_atomic64_get(&rkcg->rkcg_rebalance_latency.ts_start))
+                return;
+
+        cnt = rd_kafka_cgrp_rebalance_latency_mark(rkcg, added);
+        cnt += rd_kafka_cgrp_rebalance_latency_mark(
+            rkcg, rkcg->rkcg_rk->rk_consumer.assignment.paused);
+
+        if (cnt == 0)
+                rd_kafka_cgrp_rebalance_latency_cancel(rkcg);
+}
+
+
+/**
+ * @brief Called when a message from \p rktp is delivered to the application
+ *        while the rebalance latency is being measured: records the latency
+ *        if \p rktp was added or resumed by the rebalance.
+ *
+ * @locality application thread
+ */
+void rd_kafka_cgrp_rebalance_latency_end(rd_kafka_cgrp_t *rkcg,
+                                         rd_kafka_toppar_t *rktp) {
+        rd_ts_t ts_start =
+            rd_atomic64_get(&rkcg->rkcg_rebalance_latency.ts_start);
+
+        /* Messages from partitions the rebalance did not add or resume,
+         * e.g. retained partitions that kept fetching, do not end it. */
+        if (ts_start == 0 ||
+            rd_atomic32_get(&rktp->rktp_rebalance_epoch) !=
+                rd_atomic32_get(&rkcg->rkcg_rebalance_latency.epoch))
+                return;
+
+        /* Only the first message after the rebalance is accounted for. */
+        if (rd_atomic64_cas(&rkcg->rkcg_rebalance_latency.ts_start, ts_start,
+                            0) != ts_start)
+                return;
+
+        rd_avg_add(&rkcg->rkcg_rebalance_latency.latency,
+                   rd_clock() - ts_start);
+}
+
+
 /**
  * @brief Enqueues a rebalance op, delegating responsibility of calling
  *        incremental_assign / incremental_unassign to the application.
@@ -945,6 +1450,8 @@ void rd_kafka_rebalance_op_incr(rd_kafka_cgrp_t *rkcg,
         rkcg->rkcg_c.rebalance_cnt++;
         rd_kafka_wrunlock(rkcg->rkcg_rk);
 
+        rd_kafka_cgrp_rebalance_latency_start(rkcg);
+
         if (rd_kafka_destroy_flags_no_consumer_close(rkcg->rkcg_rk) ||
             rd_kafka_fatal_error_code(rkcg->rkcg_rk)) {
                 /* Total unconditional unassign in these cases */
@@ -974,19 +1481,26 @@ void rd_kafka_rebalance_op_incr(rd_kafka_cgrp_t *rkcg,
                              partitions->cnt,
                              rd_kafka_q_dest_name(rkcg->rkcg_q), reason);
 
-                /* Pause currently assigned partitions while waiting for
-                 * rebalance callback to get called to make sure the
-                 * application will not receive any more messages that
-                 * might block it from serving the rebalance callback
-                 * and to not process messages for partitions it
-                 * might have lost in the rebalance. */
-                rd_kafka_assignment_pause(rkcg->rkcg_rk,
-                                          "incremental rebalance");
+                /* Pause the partitions being revoked while waiting for
+                 * the rebalance callback to get called so that the
+                 * application will not process any more messages for
+                 * partitions it is losing in the rebalance.
+                 * The partitions retained across the rebalance keep
+                 * fetching and keep their already fetched messages,
+                 * which would otherwise be discarded by the pause
+                 * and fetched again. */
+                if (err == RD_KAFKA_RESP_ERR__REVOKE_PARTITIONS)
+                        rd_kafka_assignment_pause_partitions(
+                            rkcg->rkcg_rk, partitions, "incremental revoke");
 
                 rko          = rd_kafka_op_new(RD_KAFKA_OP_REBALANCE);
                 rko->rko_err = err;
                 rko->rko_u.rebalance.partitions =
                     rd_kafka_topic_partition_list_copy(partitions);
+                /* Serve the rebalance event before the retained
+                 * partitions' queued messages, it would otherwise be
+                 * delayed by them. */
+                rko->rko_prio = RD_KAFKA_PRIO_HIGH;
 
                 if (rd_kafka_q_enq(rkcg->rkcg_q, rko))
                         goto done; /* Rebalance op successfully enqueued */
@@ -1063,6 +1577,8 @@ static void rd_kafka_rebalance_op(rd_kafka_cgrp_t *rkcg,
         rkcg->rkcg_c.rebalance_cnt++;
         rd_kafka_wrunlock(rkcg->rkcg_rk);
 
+        rd_kafka_cgrp_rebalance_latency_start(rkcg);
+
         if (rd_kafka_destroy_flags_no_consumer_close(rkcg->rkcg_rk) ||
             rd_kafka_fatal_error_code(rkcg->rkcg_rk)) {
                 /* Unassign */
@@ -1189,6 +1705,10 @@ static void rd_kafka_cgrp_rejoin(rd_kafka_cgrp_t *rkcg, const char *fmt, ...) {
                 rd_snprintf(astr, sizeof(astr), " without an assignment");
 
         if (rkcg->rkcg_subscription || rkcg->rkcg_next_subscription) {
+                /* Leaving the steady state starts a rebalance. */
+                if (rkcg->rkcg_join_state == RD_KAFKA_CGRP_JOIN_STATE_STEADY)
+                        rd_kafka_cgrp_rebalance_latency_start(rkcg);
+
                 rd_kafka_dbg(
                     rkcg->rkcg_rk, CONSUMER | RD_KAFKA_DBG_CGRP, "REJOIN",
                     "Group \"%s\": %s group%s: %s", rkcg->rkcg_group_id->str,
@@ -1810,6 +2330,19 @@ static int rd_kafka_group_MemberMetadata_consumer_read(
                   rd_kafka_buf_read_topic_partitions(rkbuf, 0, fields)))
                 goto err;
 
+        if (Version >= 2) {
+                int32_t GenerationId;
+                rd_kafka_buf_read_i32(rkbuf, &GenerationId);
+                rkgm->rkgm_generation = GenerationId;
+        }
+
+        if (Version >= 3) {
+                rd_kafkap_str_t RackId;
+                rd_kafka_buf_read_str(rkbuf, &RackId);
+                if (RD_KAFKAP_STR_LEN(&RackId) > 0)
+                        rkgm->rkgm_rack_id = rd_kafkap_str_copy(&RackId);
+        }
+
         rd_kafka_buf_destroy(rkbuf);
 
         return 0;
@@ -1826,6 +2359,10 @@ err:
                 rd_kafka_topic_partition_list_destroy(rkgm->rkgm_subscription);
                 rkgm->rkgm_subscription = NULL;
         }
+        if (rkgm->rkgm_rack_id) {
+                rd_kafkap_str_destroy(rkgm->rkgm_rack_id);
+                rkgm->rkgm_rack_id = NULL;
+        }
 
         rd_kafka_buf_destroy(rkbuf);
         return -1;
@@ -2317,6 +2854,11 @@ static void rd_kafka_cgrp_join(rd_kafka_cgrp_t *rkcg) {
             rkcg->rkcg_member_id ? rkcg->rkcg_member_id->str : "");
 
 
+        if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg)) {
+                rd_kafka_cgrp_consumer_join(rkcg);
+                return;
+        }
+
         rd_kafka_cgrp_set_join_state(rkcg, RD_KAFKA_CGRP_JOIN_STATE_WAIT_JOIN);
 
         rd_kafka_cgrp_set_wait_resp(rkcg, RD_KAFKAP_JoinGroup);
@@ -2568,6 +3110,11 @@ static void rd_kafka_cgrp_heartbeat(rd_kafka_cgrp_t *rkcg) {
         if (rkcg->rkcg_flags & RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT)
                 return;
 
+        if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg)) {
+                rd_kafka_cgrp_consumer_heartbeat(rkcg);
+                return;
+        }
+
         rkcg->rkcg_flags |= RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT;
         rd_kafka_HeartbeatRequest(
             rkcg->rkcg_coord, rkcg->rkcg_group_id, rkcg->rkcg_generation_id,
@@ -2576,6 +3123,77 @@ static void rd_kafka_cgrp_heartbeat(rd_kafka_cgrp_t *rkcg) {
             NULL);
 }
 
+/**
+ * @brief rd_kafka_q_apply() callback moving the offset commit ops of
+ *        rkcg_wait_coord_q to the \p opaque list.
+ */
+static int rd_kafka_cgrp_wait_coord_q_commits_deq(rd_kafka_q_t *rkq,
+                                                  rd_kafka_op_t *rko,
+                                                  void *opaque) {
+        rd_list_t *commits = opaque;
+
+        if (rko->rko_type != RD_KAFKA_OP_OFFSET_COMMIT)
+                return 0;
+
+        rd_kafka_q_deq0(rkq, rko);
+        rd_list_add(commits, rko);
+        return 1;
+}
+
+
+/**
+ * @brief Reply to the waiting offset commit \p rko with ERR__DESTROY.
+ */
+static void rd_kafka_cgrp_commit_reply_destroy(rd_kafka_cgrp_t *rkcg,
+                                               rd_kafka_op_t *rko) {
+        rd_kafka_assert(NULL, rkcg->rkcg_rk->rk_consumer.wait_commit_cnt > 0);
+        rkcg->rkcg_rk->rk_consumer.wait_commit_cnt--;
+
+        rd_kafka_op_reply(rko, RD_KAFKA_RESP_ERR__DESTROY);
+}
+
+
+/**
+ * @brief Purge the wait-for-coordinator queue.
+ *
+ * The deferred offset commits will never be sent: they are replied to
+ * with ERR__DESTROY. If the in-flight commit of the assignment is one
+ * of them so are the commits coalesced with it or queued after it.
+ */
+static void rd_kafka_cgrp_wait_coord_q_purge(rd_kafka_cgrp_t *rkcg) {
+        rd_list_t commits;
+        rd_kafka_op_t *rko, *rko_waiting;
+        int i;
+
+        rd_list_init(&commits, 0, NULL);
+        rd_kafka_q_apply(rkcg->rkcg_wait_coord_q,
+                         rd_kafka_cgrp_wait_coord_q_commits_deq, &commits);
+        rd_kafka_q_purge(rkcg->rkcg_wait_coord_q);
+
+        RD_LIST_FOREACH(rko, &commits, i) {
+                if (rko == rkcg->rkcg_commit.inflight) {
+                        rkcg->rkcg_commit.inflight = NULL;
+
+                        if (rko->rko_u.offset_commit.coalesced)
+                                while ((rko_waiting = rd_list_pop(
+                                            rko->rko_u.offset_commit
+                                                .coalesced)))
+                                        rd_kafka_cgrp_commit_reply_destroy(
+                                            rkcg, rko_waiting);
+
+                        while ((rko_waiting =
+                                    rd_list_pop(&rkcg->rkcg_commit.pending)))
+                                rd_kafka_cgrp_commit_reply_destroy(
+                                    rkcg, rko_waiting);
+                }
+
+                rd_kafka_cgrp_commit_reply_destroy(rkcg, rko);
+        }
+
+        rd_list_destroy(&commits);
+}
+
+
 /**
  * Cgrp is now terminated: decommission it and signal back to application.
  */
@@ -2594,7 +3212,13 @@ static void rd_kafka_cgrp_terminated(rd_kafka_cgrp_t *rkcg) {
         rd_kafka_timer_stop(&rkcg->rkcg_rk->rk_timers,
                             &rkcg->rkcg_offset_commit_tmr, 1 /*lock*/);
 
-        rd_kafka_q_purge(rkcg->rkcg_wait_coord_q);
+        /* Release the dirty partitions' references, there will be
+         * no more commits. */
+        mtx_lock(&rkcg->rkcg_commit_dirty.lock);
+        rd_list_clear(&rkcg->rkcg_commit_dirty.list);
+        mtx_unlock(&rkcg->rkcg_commit_dirty.lock);
+
+        rd_kafka_cgrp_wait_coord_q_purge(rkcg);
 
         /* Disable and empty ops queue since there will be no
          * (broker) thread serving it anymore after the unassign_broker
@@ -2657,7 +3281,7 @@ static RD_INLINE int rd_kafka_cgrp_try_terminate(rd_kafka_cgrp_t *rkcg) {
                 if (rd_kafka_q_concat(rkcg->rkcg_ops,
                                       rkcg->rkcg_wait_coord_q) == -1) {
                         /* ops queue shut down, purge coord queue */
-                        rd_kafka_q_purge(rkcg->rkcg_wait_coord_q);
+                        rd_kafka_cgrp_wait_coord_q_purge(rkcg);
                 }
         }
 
@@ -2674,6 +3298,16 @@ static RD_INLINE int rd_kafka_cgrp_try_terminate(rd_kafka_cgrp_t *rkcg) {
                  * at its own discretion. */
                 rd_kafka_cgrp_set_state(rkcg, RD_KAFKA_CGRP_STATE_TERM);
 
+                /* All final commits are done: write the snapshot of the
+                 * assignment held when terminating, if any. */
+                if (rkcg->rkcg_snapshot) {
+                        rd_kafka_cgrp_snapshot_write(rkcg,
+                                                     rkcg->rkcg_snapshot);
+                        rd_kafka_topic_partition_list_destroy(
+                            rkcg->rkcg_snapshot);
+                        rkcg->rkcg_snapshot = NULL;
+                }
+
                 return 1;
         } else {
                 rd_kafka_dbg(
@@ -2859,6 +3493,7 @@ static int rd_kafka_cgrp_update_committed_offsets(
         for (i = 0; offsets && i < offsets->cnt; i++) {
                 rd_kafka_topic_partition_t *rktpar = &offsets->elems[i];
                 rd_kafka_toppar_t *rktp;
+                rd_kafka_fetch_pos_t stored_pos;
 
                 /* Ignore logical offsets since they were never
                  * sent to the broker. */
@@ -2894,6 +3529,15 @@ static int rd_kafka_cgrp_update_committed_offsets(
                 rd_kafka_toppar_lock(rktp);
                 rktp->rktp_committed_pos =
                     rd_kafka_topic_partition_get_fetch_pos(rktpar);
+                rd_kafka_toppar_committed_cache_set(rktp,
+                                                    rktp->rktp_committed_pos);
+                /* An explicitly committed offset may be behind the
+                 * stored offset, which then needs to be committed
+                 * by the next commit of the assignment. */
+                stored_pos = rd_kafka_toppar_stored_pos(rktp);
+                if (rd_kafka_fetch_pos_cmp(&stored_pos,
+                                           &rktp->rktp_committed_pos) > 0)
+                        rd_kafka_cgrp_commit_dirty_add(rkcg, rktp);
                 rd_kafka_toppar_unlock(rktp);
 
                 rd_kafka_toppar_destroy(rktp); /* from get_toppar() */
@@ -2904,13 +3548,183 @@ static int rd_kafka_cgrp_update_committed_offsets(
 
 
 /**
- * @brief Propagate OffsetCommit results.
+ * @brief Add \p rktp to the set of partitions whose stored offset changed
+ *        since they were last considered for a commit of the assignment,
+ *        unless it is already on it.
  *
- * @param rko_orig The original rko that triggered the commit, this is used
- *                 to propagate the result.
- * @param err Is the aggregated request-level error, or ERR_NO_ERROR.
- * @param errcnt Are the number of partitions in \p offsets that failed
- *               offset commit.
+ * @locks none
+ * @locality any
+ */
+void rd_kafka_cgrp_commit_dirty_add(rd_kafka_cgrp_t *rkcg,
+                                    rd_kafka_toppar_t *rktp) {
+        if (rd_atomic32_cas(&rktp->rktp_commit_dirty, 0, 1) != 0)
+                return;
+
+        mtx_lock(&rkcg->rkcg_commit_dirty.lock);
+        rd_list_add(&rkcg->rkcg_commit_dirty.list, rd_kafka_toppar_keep(rktp));
+        mtx_unlock(&rkcg->rkcg_commit_dirty.lock);
+}
+
+
+/**
+ * @returns a new list of the assigned partitions whose stored offset changed
+ *          since the last commit of the assignment, with the partitions'
+ *          toppars set, and empties the dirty set.
+ *
+ * @locality rdkafka main thread
+ */
+static rd_kafka_topic_partition_list_t *
+rd_kafka_cgrp_commit_dirty_collect(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_topic_partition_list_t *offsets;
+        rd_list_t dirty;
+        rd_kafka_toppar_t *rktp;
+        int i;
+
+        mtx_lock(&rkcg->rkcg_commit_dirty.lock);
+        rd_list_move(&dirty, &rkcg->rkcg_commit_dirty.list);
+        mtx_unlock(&rkcg->rkcg_commit_dirty.lock);
+
+        offsets = rd_kafka_topic_partition_list_new(rd_list_cnt(&dirty));
+
+        RD_LIST_FOREACH(rktp, &dirty, i) {
+                rd_bool_t assigned;
+
+                /* Clear the flag before the stored offset is read by
+                 * set_offsets() so that a concurrent store re-adds
+                 * the partition rather than being lost. */
+                rd_atomic32_set(&rktp->rktp_commit_dirty, 0);
+                rd_kafka_toppar_lock(rktp);
+                assigned = !!(rktp->rktp_flags & RD_KAFKA_TOPPAR_F_ASSIGNED);
+                rd_kafka_toppar_unlock(rktp);
+
+                if (assigned)
+                        rd_kafka_topic_partition_list_add0(
+                            __FUNCTION__, __LINE__, offsets,
+                            rktp->rktp_rkt->rkt_topic->str,
+                            rktp->rktp_partition, rktp, NULL);
+        }
+
+        rd_list_destroy(&dirty);
+
+        return offsets;
+}
+
+
+/**
+ * @brief Mark the partitions in \p offsets that failed to commit as dirty
+ *        again so that they are retried by the next commit of the
+ *        assignment.
+ */
+static void
+rd_kafka_cgrp_commit_dirty_readd(rd_kafka_cgrp_t *rkcg,
+                                 rd_kafka_resp_err_t err,
+                                 rd_kafka_topic_partition_list_t *offsets) {
+        int i;
+
+        for (i = 0; i < offsets->cnt; i++) {
+                rd_kafka_topic_partition_t *rktpar = &offsets->elems[i];
+                rd_kafka_toppar_t *rktp;
+
+                if (rktpar->offset < 0 || (!err && !rktpar->err))
+                        continue;
+
+                rktp = rd_kafka_topic_partition_get_toppar(rkcg->rkcg_rk,
+                                                           rktpar, rd_false);
+                if (!rktp)
+                        continue;
+
+                rd_kafka_cgrp_commit_dirty_add(rkcg, rktp);
+
+                rd_kafka_toppar_destroy(rktp); /* from get_toppar() */
+        }
+}
+
+
+/**
+ * @brief Coalesce a commit of the current assignment (\p rko without
+ *        partitions) with the in-flight one, if any.
+ *
+ * If nothing has been stored since the in-flight commit was created
+ * its result is also \p rko's result, else \p rko is queued and sent
+ * together with other queued commits when the in-flight commit is done.
+ *
+ * @returns rd_true if \p rko is to be sent now, else rd_false.
+ */
+static rd_bool_t rd_kafka_cgrp_commit_coalesce(rd_kafka_cgrp_t *rkcg,
+                                               rd_kafka_op_t *rko) {
+        rd_kafka_op_t *rko_inflight = rkcg->rkcg_commit.inflight;
+        rd_bool_t dirty;
+
+        if (!rko_inflight) {
+                rkcg->rkcg_commit.inflight = rko;
+                return rd_true;
+        }
+
+        mtx_lock(&rkcg->rkcg_commit_dirty.lock);
+        dirty = !rd_list_empty(&rkcg->rkcg_commit_dirty.list);
+        mtx_unlock(&rkcg->rkcg_commit_dirty.lock);
+
+        if (!dirty && rd_list_empty(&rkcg->rkcg_commit.pending)) {
+                if (!rko_inflight->rko_u.offset_commit.coalesced)
+                        rko_inflight->rko_u.offset_commit.coalesced =
+                            rd_list_new(1, (void *)rd_kafka_op_destroy);
+                rd_list_add(rko_inflight->rko_u.offset_commit.coalesced, rko);
+        } else {
+                rd_list_add(&rkcg->rkcg_commit.pending, rko);
+        }
+
+        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "COMMIT",
+                     "Group \"%s\": coalescing \"%s\" offset commit with "
+                     "%s commit",
+                     rkcg->rkcg_group_id->str, rko->rko_u.offset_commit.reason,
+                     dirty ? "next" : "in-flight");
+
+        return rd_false;
+}
+
+
+/**
+ * @brief Send the commits queued while the previous commit of the
+ *        assignment was in-flight as a single commit.
+ */
+static void rd_kafka_cgrp_commit_pending_serve(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_op_t *rko, *rko_next;
+        int i;
+
+        if (rd_list_empty(&rkcg->rkcg_commit.pending))
+                return;
+
+        rko = rd_list_elem(&rkcg->rkcg_commit.pending, 0);
+        RD_LIST_FOREACH(rko_next, &rkcg->rkcg_commit.pending, i) {
+                if (rko_next == rko)
+                        continue;
+                if (!rko->rko_u.offset_commit.coalesced)
+                        rko->rko_u.offset_commit.coalesced = rd_list_new(
+                            rd_list_cnt(&rkcg->rkcg_commit.pending) - 1,
+                            (void *)rd_kafka_op_destroy);
+                rd_list_add(rko->rko_u.offset_commit.coalesced, rko_next);
+        }
+
+        /* The ops are now owned by rko */
+        rd_list_clear(&rkcg->rkcg_commit.pending);
+
+        /* wait_commit_cnt was increased when rko was first queued,
+         * offsets_commit() will increase it again. */
+        rkcg->rkcg_rk->rk_consumer.wait_commit_cnt--;
+
+        rd_kafka_cgrp_offsets_commit(rkcg, rko, rd_true /*set offsets*/,
+                                     rko->rko_u.offset_commit.reason);
+}
+
+
+/**
+ * @brief Propagate OffsetCommit results.
+ *
+ * @param rko_orig The original rko that triggered the commit, this is used
+ *                 to propagate the result.
+ * @param err Is the aggregated request-level error, or ERR_NO_ERROR.
+ * @param errcnt Are the number of partitions in \p offsets that failed
+ *               offset commit.
  */
 static void rd_kafka_cgrp_propagate_commit_result(
     rd_kafka_cgrp_t *rkcg,
@@ -2950,6 +3764,7 @@ static void rd_kafka_cgrp_propagate_commit_result(
 
                 /* Copy offset & partitions & callbacks to reply op */
                 rko_reply->rko_u.offset_commit = rko_orig->rko_u.offset_commit;
+                rko_reply->rko_u.offset_commit.coalesced = NULL;
                 if (offsets)
                         rko_reply->rko_u.offset_commit.partitions =
                             rd_kafka_topic_partition_list_copy(offsets);
@@ -3112,7 +3927,40 @@ static void rd_kafka_cgrp_op_handle_OffsetCommit(rd_kafka_t *rk,
                                                       errcnt, offsets);
         }
 
-        rd_kafka_op_destroy(rko_orig);
+        /* Commits coalesced into this one share its result. */
+        if (rko_orig->rko_u.offset_commit.coalesced) {
+                rd_kafka_op_t *rko;
+                int i;
+
+                RD_LIST_FOREACH(rko, rko_orig->rko_u.offset_commit.coalesced,
+                                i) {
+                        rd_kafka_assert(NULL,
+                                        rk->rk_consumer.wait_commit_cnt > 0);
+                        rk->rk_consumer.wait_commit_cnt--;
+
+                        if ((rko->rko_replyq.q ||
+                             rk->rk_conf.offset_commit_cb) &&
+                            !(err == RD_KAFKA_RESP_ERR__NO_OFFSET &&
+                              rko->rko_u.offset_commit.silent_empty))
+                                rd_kafka_cgrp_propagate_commit_result(
+                                    rkcg, rko, err, errcnt, offsets);
+                }
+        }
+
+        if (rko_orig == rkcg->rkcg_commit.inflight) {
+                rkcg->rkcg_commit.inflight = NULL;
+
+                if (offsets && err != RD_KAFKA_RESP_ERR__NO_OFFSET &&
+                    (err || errcnt > 0))
+                        rd_kafka_cgrp_commit_dirty_readd(rkcg, err, offsets);
+
+                rd_kafka_op_destroy(rko_orig);
+
+                /* Send commits that were requested meanwhile. */
+                rd_kafka_cgrp_commit_pending_serve(rkcg);
+        } else {
+                rd_kafka_op_destroy(rko_orig);
+        }
 
         /* If the current state was waiting for commits to finish we'll try to
          * transition to the next state. */
@@ -3161,8 +4009,15 @@ static void rd_kafka_cgrp_offsets_commit(rd_kafka_cgrp_t *rkcg,
                 rkcg->rkcg_rk->rk_consumer.wait_commit_cnt++;
         }
 
+        /* Only one commit of the current assignment is in-flight at
+         * any time, others are coalesced. */
+        if (!rko->rko_u.offset_commit.partitions &&
+            !rd_kafka_cgrp_commit_coalesce(rkcg, rko))
+                return;
+
         /* If offsets is NULL we shall use the current assignment
-         * (not the group assignment). */
+         * (not the group assignment), limited to the partitions
+         * whose stored offset changed since the last commit. */
         if (!rko->rko_u.offset_commit.partitions &&
             rkcg->rkcg_rk->rk_consumer.assignment.all->cnt > 0) {
                 if (rd_kafka_cgrp_assignment_is_lost(rkcg)) {
@@ -3172,8 +4027,7 @@ static void rd_kafka_cgrp_offsets_commit(rd_kafka_cgrp_t *rkcg,
                 }
 
                 rko->rko_u.offset_commit.partitions =
-                    rd_kafka_topic_partition_list_copy(
-                        rkcg->rkcg_rk->rk_consumer.assignment.all);
+                    rd_kafka_cgrp_commit_dirty_collect(rkcg);
         }
 
         offsets = rko->rko_u.offset_commit.partitions;
@@ -3220,6 +4074,22 @@ static void rd_kafka_cgrp_offsets_commit(rd_kafka_cgrp_t *rkcg,
                 goto err;
         }
 
+        if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg) &&
+            rd_kafka_broker_ApiVersion_supported(rkcg->rkcg_coord,
+                                                 RD_KAFKAP_OffsetCommit, 9, 9,
+                                                 NULL) == -1) {
+                /* OffsetCommit v9 is needed to commit with the
+                 * member epoch instead of a generation id. */
+                rd_kafka_log(rkcg->rkcg_rk, LOG_WARNING, "COMMIT",
+                             "Unable to commit offsets for %d partition(s): "
+                             "group coordinator does not support "
+                             "OffsetCommit v9 required by "
+                             "group.protocol=consumer",
+                             valid_offsets);
+                err = RD_KAFKA_RESP_ERR__UNSUPPORTED_FEATURE;
+                goto err;
+        }
+
 
         rd_rkb_dbg(rkcg->rkcg_coord, CONSUMER | RD_KAFKA_DBG_CGRP, "COMMIT",
                    "Committing offsets for %d partition(s) with "
@@ -3373,6 +4243,7 @@ rd_kafka_cgrp_incremental_assign(rd_kafka_cgrp_t *rkcg,
 
         if (rkcg->rkcg_join_state ==
             RD_KAFKA_CGRP_JOIN_STATE_WAIT_ASSIGN_CALL) {
+                rd_kafka_cgrp_rebalance_latency_assigned(rkcg, partitions);
                 rd_kafka_assignment_resume(rkcg->rkcg_rk,
                                            "incremental assign called");
                 rd_kafka_cgrp_set_join_state(rkcg,
@@ -3450,7 +4321,15 @@ static void rd_kafka_cgrp_incr_unassign_done(rd_kafka_cgrp_t *rkcg) {
                              "Group \"%s\" is terminating, initiating full "
                              "unassign",
                              rkcg->rkcg_group_id->str);
+
+                /* Leave the group, if desired, from unassign_done() once the
+                 * removals, including the final offset commit, are done. */
+                rd_kafka_cgrp_set_join_state(
+                    rkcg, RD_KAFKA_CGRP_JOIN_STATE_WAIT_UNASSIGN_TO_COMPLETE);
                 rd_kafka_cgrp_unassign(rkcg);
+
+                /* Now serve the assignment to make updates */
+                rd_kafka_assignment_serve(rkcg->rkcg_rk);
                 return;
         }
 
@@ -3640,6 +4519,7 @@ rd_kafka_cgrp_assign(rd_kafka_cgrp_t *rkcg,
 
         if (rkcg->rkcg_join_state ==
             RD_KAFKA_CGRP_JOIN_STATE_WAIT_ASSIGN_CALL) {
+                rd_kafka_cgrp_rebalance_latency_assigned(rkcg, assignment);
                 rd_kafka_assignment_resume(rkcg->rkcg_rk, "assign called");
                 rd_kafka_cgrp_set_join_state(rkcg,
                                              RD_KAFKA_CGRP_JOIN_STATE_STEADY);
@@ -3780,6 +4660,682 @@ static void rd_kafka_cgrp_handle_assignment_cooperative(
         RD_MAP_DESTROY_AND_FREE(new_assignment_set);
 }
 
+/**
+ * @name Consumer group protocol (KIP-848)
+ * @{
+ *
+ * With `group.protocol=consumer` the assignment is computed by the group
+ * coordinator and handed out to each member in the ConsumerGroupHeartbeat
+ * response. There are no group-wide JoinGroup/SyncGroup barriers:
+ * each member reconciles towards its own target assignment with
+ * incremental revokes and assigns and acknowledges the partitions it owns
+ * in the following heartbeat.
+ *
+ * The existing join-state machine is reused:
+ *  - INIT -> WAIT_JOIN: a ConsumerGroupHeartbeat is sent with the current
+ *    member epoch (0 when joining).
+ *  - WAIT_JOIN -> STEADY: on a successful response.
+ *  - STEADY: periodic heartbeats. A new target assignment is reconciled
+ *    through rd_kafka_rebalance_op_incr() with rejoin set, which brings
+ *    the member back through INIT to immediately acknowledge the
+ *    reconciled assignment.
+ */
+
+
+/**
+ * @brief Reset the member id and epoch after the member was fenced or
+ *        timed out, and drop any pending target assignment.
+ */
+static void rd_kafka_cgrp_consumer_reset(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_cgrp_set_member_id(rkcg, "");
+        rkcg->rkcg_consumer.member_epoch = 0;
+        rkcg->rkcg_generation_id         = -1;
+        if (rkcg->rkcg_consumer.target) {
+                rd_list_destroy(rkcg->rkcg_consumer.target);
+                rkcg->rkcg_consumer.target = NULL;
+        }
+}
+
+
+/**
+ * @returns the topic id of \p topic from the known mappings or the
+ *          metadata cache, or a zero id if not known.
+ */
+static rd_kafka_Uuid_t rd_kafka_cgrp_consumer_topic_id(rd_kafka_cgrp_t *rkcg,
+                                                       const char *topic) {
+        const rd_kafka_topic_id_partitions_t *tidp;
+        const struct rd_kafka_metadata_cache_entry *rkmce;
+        rd_kafka_Uuid_t topic_id = RD_KAFKA_UUID_ZERO;
+        int i;
+
+        RD_LIST_FOREACH(tidp, &rkcg->rkcg_consumer.topic_ids, i) {
+                if (!strcmp(tidp->topic, topic))
+                        return tidp->topic_id;
+        }
+
+        rd_kafka_rdlock(rkcg->rkcg_rk);
+        if ((rkmce = rd_kafka_metadata_cache_find(rkcg->rkcg_rk, topic,
+                                                  1 /*valid*/)))
+                topic_id = rkmce->rkmce_topic_id;
+        rd_kafka_rdunlock(rkcg->rkcg_rk);
+
+        if (!RD_KAFKA_UUID_IS_ZERO(topic_id))
+                rd_list_add(&rkcg->rkcg_consumer.topic_ids,
+                            rd_kafka_topic_id_partitions_new(topic_id, topic,
+                                                             0));
+
+        return topic_id;
+}
+
+
+/**
+ * @returns the topic name of \p topic_id from the known mappings or the
+ *          metadata cache, or NULL if not (yet) known.
+ */
+static const char *rd_kafka_cgrp_consumer_topic_name(rd_kafka_cgrp_t *rkcg,
+                                                     rd_kafka_Uuid_t topic_id) {
+        rd_kafka_topic_id_partitions_t *tidp;
+        const struct rd_kafka_metadata_cache_entry *rkmce;
+        int i;
+
+        RD_LIST_FOREACH(tidp, &rkcg->rkcg_consumer.topic_ids, i) {
+                if (!rd_kafka_Uuid_cmp(tidp->topic_id, topic_id))
+                        return tidp->topic;
+        }
+
+        tidp = NULL;
+        rd_kafka_rdlock(rkcg->rkcg_rk);
+        if ((rkmce = rd_kafka_metadata_cache_find_by_id(rkcg->rkcg_rk, topic_id,
+                                                        1 /*valid*/)))
+                tidp = rd_kafka_topic_id_partitions_new(
+                    topic_id, rkmce->rkmce_mtopic.topic, 0);
+        rd_kafka_rdunlock(rkcg->rkcg_rk);
+
+        if (!tidp)
+                return NULL;
+
+        rd_list_add(&rkcg->rkcg_consumer.topic_ids, tidp);
+        return tidp->topic;
+}
+
+
+/**
+ * @returns a new list of the currently owned partitions by topic id,
+ *          as reported in the ConsumerGroupHeartbeat.
+ *          (rd_kafka_topic_id_partitions_t *)
+ */
+static rd_list_t *rd_kafka_cgrp_consumer_owned(rd_kafka_cgrp_t *rkcg) {
+        const rd_kafka_topic_partition_list_t *assignment =
+            rkcg->rkcg_group_assignment;
+        rd_list_t *owned;
+        int i = 0;
+
+        owned = rd_list_new(0, rd_kafka_topic_id_partitions_destroy);
+
+        if (!assignment)
+                return owned;
+
+        /* The group assignment is sorted by topic. */
+        while (i < assignment->cnt) {
+                const char *topic = assignment->elems[i].topic;
+                rd_kafka_topic_id_partitions_t *tidp;
+                rd_kafka_Uuid_t topic_id;
+                int j, cnt = 0;
+
+                while (i + cnt < assignment->cnt &&
+                       !strcmp(assignment->elems[i + cnt].topic, topic))
+                        cnt++;
+
+                topic_id = rd_kafka_cgrp_consumer_topic_id(rkcg, topic);
+                if (RD_KAFKA_UUID_IS_ZERO(topic_id)) {
+                        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "HEARTBEAT",
+                                     "Group \"%s\": not reporting %d owned "
+                                     "partition(s) of topic %s: "
+                                     "topic id not known",
+                                     rkcg->rkcg_group_id->str, cnt, topic);
+                } else {
+                        tidp =
+                            rd_kafka_topic_id_partitions_new(topic_id, topic,
+                                                             cnt);
+                        for (j = 0; j < cnt; j++)
+                                tidp->partitions[j] =
+                                    assignment->elems[i + j].partition;
+                        rd_list_add(owned, tidp);
+                }
+
+                i += cnt;
+        }
+
+        return owned;
+}
+
+
+/**
+ * @brief Send a ConsumerGroupHeartbeat with the current member state.
+ */
+static rd_kafka_resp_err_t
+rd_kafka_cgrp_consumer_heartbeat_send(rd_kafka_cgrp_t *rkcg,
+                                      rd_kafka_resp_cb_t *resp_cb) {
+        rd_kafka_t *rk = rkcg->rkcg_rk;
+        rd_list_t *owned;
+        rd_kafka_resp_err_t err;
+
+        owned = rd_kafka_cgrp_consumer_owned(rkcg);
+
+        err = rd_kafka_ConsumerGroupHeartbeatRequest(
+            rkcg->rkcg_coord, rkcg->rkcg_group_id, rkcg->rkcg_member_id,
+            rkcg->rkcg_consumer.member_epoch, rkcg->rkcg_group_instance_id,
+            rk->rk_conf.client_rack, rk->rk_conf.max_poll_interval_ms,
+            rkcg->rkcg_subscribed_topics, rk->rk_conf.group_remote_assignor,
+            owned, RD_KAFKA_REPLYQ(rkcg->rkcg_ops, 0), resp_cb, rkcg);
+
+        rd_list_destroy(owned);
+
+        return err;
+}
+
+
+/**
+ * @brief Reconcile the pending target assignment, if any, with the current
+ *        group assignment by revoking and assigning the difference.
+ *
+ * Reconciliation is postponed until all target topic ids can be
+ * resolved to topic names through the metadata cache.
+ */
+static void rd_kafka_cgrp_consumer_reconcile(rd_kafka_cgrp_t *rkcg) {
+        const rd_kafka_topic_id_partitions_t *tidp;
+        rd_kafka_topic_partition_list_t *assignment;
+        map_toppar_member_info_t *new_assignment_set;
+        map_toppar_member_info_t *old_assignment_set;
+        map_toppar_member_info_t *newly_added_set;
+        map_toppar_member_info_t *revoked_set;
+        rd_kafka_topic_partition_list_t *newly_added;
+        rd_kafka_topic_partition_list_t *revoked;
+        int unresolved = 0;
+        int i, j;
+
+        if (!rkcg->rkcg_consumer.target ||
+            rkcg->rkcg_join_state != RD_KAFKA_CGRP_JOIN_STATE_STEADY)
+                return;
+
+        assignment = rd_kafka_topic_partition_list_new(0);
+
+        RD_LIST_FOREACH(tidp, rkcg->rkcg_consumer.target, i) {
+                const char *topic =
+                    rd_kafka_cgrp_consumer_topic_name(rkcg, tidp->topic_id);
+
+                if (!topic) {
+                        unresolved++;
+                        continue;
+                }
+
+                for (j = 0; j < tidp->partition_cnt; j++)
+                        rd_kafka_topic_partition_list_add(
+                            assignment, topic, tidp->partitions[j]);
+        }
+
+        if (unresolved > 0) {
+                rd_list_t topics;
+                const rd_kafka_topic_info_t *tinfo;
+
+                rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "RECONCILE",
+                             "Group \"%s\": postponing reconciliation of "
+                             "target assignment: %d topic id(s) not yet "
+                             "known: refreshing metadata",
+                             rkcg->rkcg_group_id->str, unresolved);
+
+                rd_list_init(&topics, rd_list_cnt(rkcg->rkcg_subscribed_topics),
+                             NULL);
+                RD_LIST_FOREACH(tinfo, rkcg->rkcg_subscribed_topics, i)
+                rd_list_add(&topics, (void *)tinfo->topic);
+                rd_kafka_metadata_refresh_topics(
+                    rkcg->rkcg_rk, NULL, &topics, rd_false /*!force*/,
+                    rd_false /*!allow_auto_create*/, rd_false /*!cgrp_update*/,
+                    "resolve target assignment topic ids");
+                rd_list_destroy(&topics);
+
+                rd_kafka_topic_partition_list_destroy(assignment);
+                return;
+        }
+
+        rd_list_destroy(rkcg->rkcg_consumer.target);
+        rkcg->rkcg_consumer.target = NULL;
+
+        new_assignment_set =
+            rd_kafka_toppar_list_to_toppar_member_info_map(assignment);
+        old_assignment_set = rd_kafka_toppar_list_to_toppar_member_info_map(
+            rkcg->rkcg_group_assignment);
+
+        newly_added_set = rd_kafka_member_partitions_subtract(
+            new_assignment_set, old_assignment_set);
+        revoked_set = rd_kafka_member_partitions_subtract(old_assignment_set,
+                                                          new_assignment_set);
+
+        newly_added = rd_kafka_toppar_member_info_map_to_list(newly_added_set);
+        revoked     = rd_kafka_toppar_member_info_map_to_list(revoked_set);
+
+        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "RECONCILE",
+                     "Group \"%s\": reconciling target assignment of %d "
+                     "partition(s) at member epoch %" PRId32
+                     ": %d newly added, %d revoked partition(s)",
+                     rkcg->rkcg_group_id->str, assignment->cnt,
+                     rkcg->rkcg_consumer.member_epoch, newly_added->cnt,
+                     revoked->cnt);
+
+        if (revoked->cnt > 0) {
+                /* Revoke first, the follow-on incremental assign will
+                 * rejoin to acknowledge the new assignment. */
+                rkcg->rkcg_rebalance_incr_assignment = newly_added;
+                newly_added                          = NULL;
+
+                rd_kafka_rebalance_op_incr(
+                    rkcg, RD_KAFKA_RESP_ERR__REVOKE_PARTITIONS, revoked,
+                    rd_false /*no rejoin following unassign*/,
+                    "consumer group heartbeat revoke");
+
+        } else if (newly_added->cnt > 0) {
+                rd_kafka_rebalance_op_incr(
+                    rkcg, RD_KAFKA_RESP_ERR__ASSIGN_PARTITIONS, newly_added,
+                    rd_true /*rejoin to acknowledge assignment*/,
+                    "consumer group heartbeat assign");
+        }
+
+        if (newly_added)
+                rd_kafka_topic_partition_list_destroy(newly_added);
+        rd_kafka_topic_partition_list_destroy(revoked);
+        rd_kafka_topic_partition_list_destroy(assignment);
+        RD_MAP_DESTROY_AND_FREE(revoked_set);
+        RD_MAP_DESTROY_AND_FREE(newly_added_set);
+        RD_MAP_DESTROY_AND_FREE(old_assignment_set);
+        RD_MAP_DESTROY_AND_FREE(new_assignment_set);
+}
+
+
+/**
+ * @brief Common ConsumerGroupHeartbeat response handling.
+ *
+ * @param joining true if this is the response to the heartbeat sent
+ *        from WAIT_JOIN, else a periodic heartbeat.
+ */
+static void
+rd_kafka_cgrp_handle_ConsumerGroupHeartbeat0(rd_kafka_cgrp_t *rkcg,
+                                             rd_kafka_broker_t *rkb,
+                                             rd_kafka_resp_err_t err,
+                                             rd_kafka_buf_t *rkbuf,
+                                             rd_kafka_buf_t *request,
+                                             rd_bool_t joining) {
+        const int log_decode_errors  = LOG_ERR;
+        int16_t ErrorCode            = 0;
+        rd_kafkap_str_t ErrorMessage = RD_KAFKAP_STR_INITIALIZER;
+        rd_kafkap_str_t MemberId     = RD_KAFKAP_STR_INITIALIZER;
+        int32_t MemberEpoch, HeartbeatIntervalMs;
+        int8_t AssignmentPresent;
+        rd_list_t *target = NULL;
+        int actions       = 0;
+
+        if (err)
+                goto err;
+
+        rd_kafka_buf_read_throttle_time(rkbuf);
+        rd_kafka_buf_read_i16(rkbuf, &ErrorCode);
+        rd_kafka_buf_read_str(rkbuf, &ErrorMessage);
+        if (ErrorCode) {
+                err = ErrorCode;
+                goto err;
+        }
+
+        rd_kafka_buf_read_str(rkbuf, &MemberId);
+        rd_kafka_buf_read_i32(rkbuf, &MemberEpoch);
+        rd_kafka_buf_read_i32(rkbuf, &HeartbeatIntervalMs);
+
+        /* Assignment: nullable struct */
+        rd_kafka_buf_read_i8(rkbuf, &AssignmentPresent);
+        if (AssignmentPresent != -1) {
+                int32_t TopicCnt;
+                int i;
+
+                rd_kafka_buf_read_arraycnt(rkbuf, &TopicCnt,
+                                           RD_KAFKAP_TOPICS_MAX);
+                target = rd_list_new(RD_MAX(TopicCnt, 0),
+                                     rd_kafka_topic_id_partitions_destroy);
+
+                for (i = 0; i < TopicCnt; i++) {
+                        rd_kafka_Uuid_t TopicId;
+                        int32_t PartitionCnt;
+                        rd_kafka_topic_id_partitions_t *tidp;
+                        int j;
+
+                        rd_kafka_buf_read_uuid(rkbuf, &TopicId);
+                        rd_kafka_buf_read_arraycnt(rkbuf, &PartitionCnt,
+                                                   RD_KAFKAP_PARTITIONS_MAX);
+
+                        tidp = rd_kafka_topic_id_partitions_new(
+                            TopicId, NULL, RD_MAX(PartitionCnt, 0));
+                        rd_list_add(target, tidp);
+
+                        for (j = 0; j < tidp->partition_cnt; j++)
+                                rd_kafka_buf_read_i32(rkbuf,
+                                                      &tidp->partitions[j]);
+
+                        rd_kafka_buf_skip_tags(rkbuf);
+                }
+
+                rd_kafka_buf_skip_tags(rkbuf);
+        }
+
+        rd_kafka_buf_skip_tags(rkbuf);
+
+        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "HEARTBEAT",
+                     "Group \"%s\": ConsumerGroupHeartbeat response: "
+                     "member id \"%.*s\", member epoch %" PRId32
+                     ", heartbeat interval %" PRId32 "ms%s",
+                     rkcg->rkcg_group_id->str, RD_KAFKAP_STR_PR(&MemberId),
+                     MemberEpoch, HeartbeatIntervalMs,
+                     target ? ", with target assignment" : "");
+
+        if (!RD_KAFKAP_STR_IS_NULL(&MemberId) &&
+            rd_kafkap_str_cmp(&MemberId, rkcg->rkcg_member_id)) {
+                char *member_id;
+                RD_KAFKAP_STR_DUPA(&member_id, &MemberId);
+                rd_kafka_cgrp_set_member_id(rkcg, member_id);
+        }
+
+        rkcg->rkcg_consumer.member_epoch = MemberEpoch;
+        /* The member epoch is used as generation for offset commits. */
+        rkcg->rkcg_generation_id = MemberEpoch;
+        if (HeartbeatIntervalMs > 0)
+                rkcg->rkcg_consumer.heartbeat_intvl_ms = HeartbeatIntervalMs;
+
+        rkcg->rkcg_last_heartbeat_err = RD_KAFKA_RESP_ERR_NO_ERROR;
+        rkcg->rkcg_last_err           = RD_KAFKA_RESP_ERR_NO_ERROR;
+        rd_kafka_cgrp_update_session_timeout(rkcg, joining /*reset on join*/);
+
+        if (target) {
+                if (rkcg->rkcg_consumer.target)
+                        rd_list_destroy(rkcg->rkcg_consumer.target);
+                rkcg->rkcg_consumer.target = target;
+        }
+
+        if (joining)
+                rd_kafka_cgrp_set_join_state(rkcg,
+                                             RD_KAFKA_CGRP_JOIN_STATE_STEADY);
+
+        rd_kafka_cgrp_consumer_reconcile(rkcg);
+        return;
+
+err_parse:
+        err = rkbuf->rkbuf_err;
+        if (target)
+                rd_list_destroy(target);
+err:
+        rkcg->rkcg_last_heartbeat_err = err;
+
+        rd_kafka_dbg(rkcg->rkcg_rk, CGRP, "HEARTBEAT",
+                     "Group \"%s\": ConsumerGroupHeartbeat failed in "
+                     "join-state %s with %d partition(s) assigned: %s%s%.*s",
+                     rkcg->rkcg_group_id->str,
+                     rd_kafka_cgrp_join_state_names[rkcg->rkcg_join_state],
+                     rkcg->rkcg_group_assignment
+                         ? rkcg->rkcg_group_assignment->cnt
+                         : 0,
+                     rd_kafka_err2str(err),
+                     RD_KAFKAP_STR_LEN(&ErrorMessage) > 0 ? ": " : "",
+                     RD_KAFKAP_STR_PR(&ErrorMessage));
+
+        switch (err) {
+        case RD_KAFKA_RESP_ERR__DESTROY:
+                return;
+
+        case RD_KAFKA_RESP_ERR_NOT_COORDINATOR_FOR_GROUP:
+        case RD_KAFKA_RESP_ERR_GROUP_COORDINATOR_NOT_AVAILABLE:
+        case RD_KAFKA_RESP_ERR__TRANSPORT:
+                actions = RD_KAFKA_ERR_ACTION_REFRESH;
+                break;
+
+        case RD_KAFKA_RESP_ERR_UNKNOWN_MEMBER_ID:
+        case RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH:
+                rd_kafka_cgrp_consumer_reset(rkcg);
+                rd_kafka_cgrp_revoke_all_rejoin_maybe(
+                    rkcg, rd_true /*lost*/, rd_true /*initiating*/,
+                    "member fenced by the group coordinator");
+                return;
+
+        case RD_KAFKA_RESP_ERR_FENCED_INSTANCE_ID:
+                rd_kafka_set_fatal_error(rkcg->rkcg_rk, err,
+                                         "Fatal consumer error: %s",
+                                         rd_kafka_err2str(err));
+                rd_kafka_cgrp_revoke_all_rejoin_maybe(
+                    rkcg, rd_true, /*assignment lost*/
+                    rd_true,       /*initiating*/
+                    "consumer fenced by newer instance");
+                return;
+
+        case RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR:
+        case RD_KAFKA_RESP_ERR_UNRELEASED_INSTANCE_ID:
+        case RD_KAFKA_RESP_ERR_GROUP_AUTHORIZATION_FAILED:
+        case RD_KAFKA_RESP_ERR_INVALID_REQUEST:
+                actions = RD_KAFKA_ERR_ACTION_PERMANENT;
+                break;
+
+        default:
+                actions = rd_kafka_err_action(rkb, err, request,
+                                              RD_KAFKA_ERR_ACTION_END);
+                break;
+        }
+
+        if (actions & RD_KAFKA_ERR_ACTION_REFRESH)
+                rd_kafka_cgrp_coord_query(rkcg, rd_kafka_err2str(err));
+
+        if ((actions & RD_KAFKA_ERR_ACTION_PERMANENT) &&
+            rkcg->rkcg_last_err != err) {
+                /* Propagate permanent errors to the application */
+                rd_kafka_consumer_err(
+                    rkcg->rkcg_q, rd_kafka_broker_id(rkb), err, 0, NULL, NULL,
+                    RD_KAFKA_OFFSET_INVALID,
+                    "ConsumerGroupHeartbeat failed: %s%s%.*s",
+                    rd_kafka_err2str(err),
+                    RD_KAFKAP_STR_LEN(&ErrorMessage) > 0 ? ": " : "",
+                    RD_KAFKAP_STR_PR(&ErrorMessage));
+
+                /* Suppress repeated errors */
+                rkcg->rkcg_last_err = err;
+        }
+
+        if (joining) {
+                /* No need for retries here since the join is intervalled,
+                 * see rkcg_join_intvl */
+                rd_interval_backoff(&rkcg->rkcg_join_intvl, 1000 * 1000);
+                rd_kafka_cgrp_rejoin(rkcg, "ConsumerGroupHeartbeat error: %s",
+                                     rd_kafka_err2str(err));
+
+        } else if (actions & RD_KAFKA_ERR_ACTION_RETRY &&
+                   rd_kafka_buf_retry(rkb, request)) {
+                /* Retry */
+                rkcg->rkcg_flags |= RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT;
+        }
+}
+
+
+/**
+ * @brief Handle the ConsumerGroupHeartbeat response to the heartbeat sent
+ *        when (re)joining the group.
+ */
+static void
+rd_kafka_cgrp_handle_ConsumerGroupHeartbeat_join(rd_kafka_t *rk,
+                                                 rd_kafka_broker_t *rkb,
+                                                 rd_kafka_resp_err_t err,
+                                                 rd_kafka_buf_t *rkbuf,
+                                                 rd_kafka_buf_t *request,
+                                                 void *opaque) {
+        rd_kafka_cgrp_t *rkcg = opaque;
+
+        rd_kafka_cgrp_clear_wait_resp(rkcg, RD_KAFKAP_ConsumerGroupHeartbeat);
+
+        if (err == RD_KAFKA_RESP_ERR__DESTROY ||
+            rkcg->rkcg_flags & RD_KAFKA_CGRP_F_TERMINATE)
+                return; /* Terminating */
+
+        if (rkcg->rkcg_join_state != RD_KAFKA_CGRP_JOIN_STATE_WAIT_JOIN) {
+                rd_kafka_dbg(
+                    rk, CGRP, "HEARTBEAT",
+                    "ConsumerGroupHeartbeat response: discarding outdated "
+                    "join request (now in join-state %s)",
+                    rd_kafka_cgrp_join_state_names[rkcg->rkcg_join_state]);
+                return;
+        }
+
+        rd_kafka_cgrp_handle_ConsumerGroupHeartbeat0(rkcg, rkb, err, rkbuf,
+                                                     request, rd_true);
+}
+
+
+/**
+ * @brief Handle the ConsumerGroupHeartbeat response to a periodic heartbeat.
+ */
+static void
+rd_kafka_cgrp_handle_ConsumerGroupHeartbeat(rd_kafka_t *rk,
+                                            rd_kafka_broker_t *rkb,
+                                            rd_kafka_resp_err_t err,
+                                            rd_kafka_buf_t *rkbuf,
+                                            rd_kafka_buf_t *request,
+                                            void *opaque) {
+        rd_kafka_cgrp_t *rkcg = opaque;
+
+        if (err == RD_KAFKA_RESP_ERR__DESTROY)
+                return;
+
+        rd_dassert(rkcg->rkcg_flags & RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT);
+        rkcg->rkcg_flags &= ~RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT;
+
+        if (rkcg->rkcg_join_state <= RD_KAFKA_CGRP_JOIN_STATE_WAIT_SYNC) {
+                rd_kafka_dbg(
+                    rk, CGRP, "HEARTBEAT",
+                    "ConsumerGroupHeartbeat response: discarding outdated "
+                    "request (now in join-state %s)",
+                    rd_kafka_cgrp_join_state_names[rkcg->rkcg_join_state]);
+                return;
+        }
+
+        rd_kafka_cgrp_handle_ConsumerGroupHeartbeat0(rkcg, rkb, err, rkbuf,
+                                                     request, rd_false);
+}
+
+
+/**
+ * @brief Handle the ConsumerGroupHeartbeat response to a leave request.
+ */
+static void
+rd_kafka_cgrp_handle_ConsumerGroupHeartbeat_leave(rd_kafka_t *rk,
+                                                  rd_kafka_broker_t *rkb,
+                                                  rd_kafka_resp_err_t err,
+                                                  rd_kafka_buf_t *rkbuf,
+                                                  rd_kafka_buf_t *request,
+                                                  void *opaque) {
+        rd_kafka_cgrp_t *rkcg       = opaque;
+        const int log_decode_errors = LOG_ERR;
+        int16_t ErrorCode           = 0;
+
+        if (err) {
+                ErrorCode = err;
+                goto err;
+        }
+
+        rd_kafka_buf_read_throttle_time(rkbuf);
+        rd_kafka_buf_read_i16(rkbuf, &ErrorCode);
+
+err:
+        rd_kafka_dbg(rk, CGRP, "LEAVEGROUP",
+                     "Leave group response received in state %s: %s",
+                     rd_kafka_cgrp_state_names[rkcg->rkcg_state],
+                     ErrorCode ? rd_kafka_err2str(ErrorCode) : "(no error)");
+
+        if (ErrorCode != RD_KAFKA_RESP_ERR__DESTROY) {
+                rd_assert(thrd_is_current(rk->rk_thread));
+                rkcg->rkcg_flags &= ~RD_KAFKA_CGRP_F_WAIT_LEAVE;
+                rd_kafka_cgrp_try_terminate(rkcg);
+        }
+
+        return;
+
+err_parse:
+        ErrorCode = rkbuf->rkbuf_err;
+        goto err;
+}
+
+
+/**
+ * @brief Join the group, or acknowledge a reconciled assignment,
+ *        with a ConsumerGroupHeartbeat.
+ */
+static void rd_kafka_cgrp_consumer_join(rd_kafka_cgrp_t *rkcg) {
+        rd_kafka_resp_err_t err;
+
+        rd_kafka_cgrp_set_join_state(rkcg, RD_KAFKA_CGRP_JOIN_STATE_WAIT_JOIN);
+
+        rd_kafka_cgrp_set_wait_resp(rkcg, RD_KAFKAP_ConsumerGroupHeartbeat);
+
+        err = rd_kafka_cgrp_consumer_heartbeat_send(
+            rkcg, rd_kafka_cgrp_handle_ConsumerGroupHeartbeat_join);
+        if (likely(!err))
+                return;
+
+        rd_kafka_cgrp_clear_wait_resp(rkcg, RD_KAFKAP_ConsumerGroupHeartbeat);
+        rd_kafka_cgrp_set_join_state(rkcg, RD_KAFKA_CGRP_JOIN_STATE_INIT);
+
+        if (rkcg->rkcg_last_err != err) {
+                rd_kafka_consumer_err(
+                    rkcg->rkcg_q, rd_kafka_broker_id(rkcg->rkcg_coord), err, 0,
+                    NULL, NULL, RD_KAFKA_OFFSET_INVALID,
+                    "Group \"%s\": group.protocol=consumer requires the "
+                    "ConsumerGroupHeartbeat API which is not supported "
+                    "by the group coordinator",
+                    rkcg->rkcg_group_id->str);
+                /* Suppress repeated errors */
+                rkcg->rkcg_last_err = err;
+        }
+}
+
+
+/**
+ * @brief Send a periodic ConsumerGroupHeartbeat.
+ */
+static void rd_kafka_cgrp_consumer_heartbeat(rd_kafka_cgrp_t *rkcg) {
+        rkcg->rkcg_flags |= RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT;
+
+        if (rd_kafka_cgrp_consumer_heartbeat_send(
+                rkcg, rd_kafka_cgrp_handle_ConsumerGroupHeartbeat))
+                rkcg->rkcg_flags &= ~RD_KAFKA_CGRP_F_HEARTBEAT_IN_TRANSIT;
+}
+
+
+/**
+ * @brief Leave the group with a ConsumerGroupHeartbeat with a negative
+ *        member epoch: -2 for static members to retain their assignment
+ *        for the session timeout, else -1.
+ */
+static void rd_kafka_cgrp_consumer_leave(rd_kafka_cgrp_t *rkcg,
+                                         const char *member_id) {
+        rd_kafkap_str_t *kmember_id = rd_kafkap_str_new(member_id, -1);
+        rd_kafka_resp_err_t err;
+
+        rd_kafka_cgrp_consumer_reset(rkcg);
+
+        err = rd_kafka_ConsumerGroupHeartbeatRequest(
+            rkcg->rkcg_coord, rkcg->rkcg_group_id, kmember_id,
+            RD_KAFKA_CGRP_IS_STATIC_MEMBER(rkcg) ? -2 : -1,
+            rkcg->rkcg_group_instance_id, NULL, -1, NULL, NULL, NULL,
+            RD_KAFKA_REPLYQ(rkcg->rkcg_ops, 0),
+            rd_kafka_cgrp_handle_ConsumerGroupHeartbeat_leave, rkcg);
+
+        rd_kafkap_str_destroy(kmember_id);
+
+        if (err)
+                rd_kafka_cgrp_handle_ConsumerGroupHeartbeat_leave(
+                    rkcg->rkcg_rk, rkcg->rkcg_coord, err, NULL, NULL, rkcg);
+}
+
+/**@}*/
+
 
 /**
  * @brief Sets or clears the group's partition assignment for our consumer.
@@ -4523,6 +6079,12 @@ static rd_kafka_resp_err_t rd_kafka_cgrp_unsubscribe(rd_kafka_cgrp_t *rkcg,
 
         rd_kafka_cgrp_update_subscribed_topics(rkcg, NULL);
 
+        /* No rebalance will complete without a subscription. */
+        rd_kafka_cgrp_rebalance_latency_cancel(rkcg);
+
+        /* Prefetched partitions will not be assigned anymore. */
+        rd_kafka_assignment_prefetch_stop_unassigned(rkcg->rkcg_rk);
+
         /*
          * Clean-up group leader duties, if any.
          */
@@ -4618,6 +6180,10 @@ rd_kafka_cgrp_subscribe(rd_kafka_cgrp_t *rkcg,
 
         rkcg->rkcg_subscription = rktparlist;
 
+        /* Start fetching the previous run's assignment while joining. */
+        if (rkcg->rkcg_snapshot)
+                rd_kafka_cgrp_snapshot_prefetch(rkcg, rktparlist);
+
         rd_kafka_cgrp_join(rkcg);
 
         return RD_KAFKA_RESP_ERR_NO_ERROR;
@@ -4670,6 +6236,20 @@ void rd_kafka_cgrp_terminate0(rd_kafka_cgrp_t *rkcg, rd_kafka_op_t *rko) {
         rkcg->rkcg_ts_terminate = rd_clock();
         rkcg->rkcg_reply_rko    = rko;
 
+        /* Replace any unused snapshot read on creation with the current
+         * assignment, to be written when terminated, if this is a
+         * controlled shutdown. */
+        if (rkcg->rkcg_snapshot) {
+                rd_kafka_topic_partition_list_destroy(rkcg->rkcg_snapshot);
+                rkcg->rkcg_snapshot = NULL;
+        }
+        if (rkcg->rkcg_rk->rk_conf.group_assignment_snapshot_path &&
+            (rkcg->rkcg_flags & RD_KAFKA_CGRP_F_SUBSCRIPTION) &&
+            !rd_kafka_destroy_flags_no_consumer_close(rkcg->rkcg_rk) &&
+            !rd_kafka_fatal_error_code(rkcg->rkcg_rk))
+                rkcg->rkcg_snapshot = rd_kafka_topic_partition_list_copy(
+                    rkcg->rkcg_rk->rk_consumer.assignment.all);
+
         if (rkcg->rkcg_flags & RD_KAFKA_CGRP_F_SUBSCRIPTION)
                 rd_kafka_cgrp_unsubscribe(
                     rkcg,
@@ -5087,7 +6667,10 @@ static rd_bool_t rd_kafka_cgrp_session_timeout_check(rd_kafka_cgrp_t *rkcg,
 
         /* Timing out invalidates the member id, reset it
          * now to avoid an ERR_UNKNOWN_MEMBER_ID on the next join. */
-        rd_kafka_cgrp_set_member_id(rkcg, "");
+        if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg))
+                rd_kafka_cgrp_consumer_reset(rkcg);
+        else
+                rd_kafka_cgrp_set_member_id(rkcg, "");
 
         /* Revoke and rebalance */
         rd_kafka_cgrp_revoke_all_rejoin_maybe(rkcg, rd_true /*lost*/,
@@ -5128,6 +6711,8 @@ static void rd_kafka_cgrp_apply_next_subscribe(rd_kafka_cgrp_t *rkcg) {
  */
 static void rd_kafka_cgrp_join_state_serve(rd_kafka_cgrp_t *rkcg) {
         rd_ts_t now = rd_clock();
+        int heartbeat_intvl_ms =
+            rkcg->rkcg_rk->rk_conf.group_heartbeat_intvl_ms;
 
         if (unlikely(rd_kafka_fatal_error_code(rkcg->rkcg_rk)))
                 return;
@@ -5161,11 +6746,22 @@ static void rd_kafka_cgrp_join_state_serve(rd_kafka_cgrp_t *rkcg) {
         case RD_KAFKA_CGRP_JOIN_STATE_STEADY:
         case RD_KAFKA_CGRP_JOIN_STATE_WAIT_ASSIGN_CALL:
         case RD_KAFKA_CGRP_JOIN_STATE_WAIT_UNASSIGN_CALL:
+                if (RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg)) {
+                        /* Reconcile a target assignment that was
+                         * received while rebalancing, or that
+                         * is waiting for topic ids to be resolved. */
+                        rd_kafka_cgrp_consumer_reconcile(rkcg);
+
+                        /* The heartbeat interval is dictated by the
+                         * group coordinator. */
+                        if (rkcg->rkcg_consumer.heartbeat_intvl_ms > 0)
+                                heartbeat_intvl_ms =
+                                    rkcg->rkcg_consumer.heartbeat_intvl_ms;
+                }
+
                 if (rkcg->rkcg_flags & RD_KAFKA_CGRP_F_SUBSCRIPTION &&
-                    rd_interval(
-                        &rkcg->rkcg_heartbeat_intvl,
-                        rkcg->rkcg_rk->rk_conf.group_heartbeat_intvl_ms * 1000,
-                        now) > 0)
+                    rd_interval(&rkcg->rkcg_heartbeat_intvl,
+                                heartbeat_intvl_ms * 1000, now) > 0)
                         rd_kafka_cgrp_heartbeat(rkcg);
                 break;
         }
@@ -251,6 +251,12 @@ typedef struct rd_kafka_cgrp_s {
          */
         rd_kafka_topic_partition_list_t *rkcg_group_assignment;
 
+        /** Static group membership assignment snapshot: read from
+         *  `group.assignment.snapshot.path` when the cgrp is created and
+         *  prefetched on the first subscribe, or the assignment to write
+         *  to the file when the cgrp is terminated. NULL if none. */
+        rd_kafka_topic_partition_list_t *rkcg_snapshot;
+
         /** The partitions to incrementally assign following a
          *  currently in-progress incremental unassign. */
         rd_kafka_topic_partition_list_t *rkcg_rebalance_incr_assignment;
@@ -259,11 +265,65 @@ typedef struct rd_kafka_cgrp_s {
          *  incremental unassign. */
         rd_bool_t rkcg_rebalance_rejoin;
 
+        /** Next-generation consumer group protocol (KIP-848) state,
+         *  only used with `group.protocol=consumer`. */
+        struct {
+                /** Current member epoch, 0 when not (yet) a member. */
+                int32_t member_epoch;
+                /** Heartbeat interval dictated by the coordinator. */
+                int heartbeat_intvl_ms;
+                /** Latest target assignment received from the coordinator
+                 *  that has not yet been reconciled, or NULL.
+                 *  (rd_kafka_topic_id_partitions_t *) */
+                rd_list_t *target;
+                /** Topic ids resolved to topic names, used to map the
+                 *  owned partitions back to topic ids.
+                 *  (rd_kafka_topic_id_partitions_t *) without partitions. */
+                rd_list_t topic_ids;
+        } rkcg_consumer;
+
         rd_kafka_resp_err_t rkcg_last_err; /* Last error propagated to
                                             * application.
                                             * This is for silencing
                                             * same errors. */
 
+        /** Offset commit coalescing: commits of the current assignment's
+         *  stored offsets are sent one at a time per group coordinator.
+         *  Such commits requested while another one is in-flight are
+         *  either attached to the in-flight commit (nothing new to
+         *  commit) or queued on .pending and sent as a single
+         *  OffsetCommitRequest once the in-flight commit is done. */
+        struct {
+                rd_kafka_op_t *inflight; /**< Current assignment commit
+                                          *   in-flight, or NULL. */
+                rd_list_t pending;       /**< (rd_kafka_op_t *) */
+        } rkcg_commit;
+
+        /** Partitions whose stored offset was updated since they were
+         *  last included in a commit of the current assignment
+         *  (rktp_commit_dirty), so that commits only need to consider
+         *  partitions that changed.
+         *  @locality any */
+        struct {
+                mtx_t lock;     /**< Protects list */
+                rd_list_t list; /**< (rd_kafka_toppar_t *) with refcount */
+        } rkcg_commit_dirty;
+
+        /** Rebalance latency: the time from the start of a rebalance
+         *  (leaving the steady state) to the first message delivered to
+         *  the application from a partition the rebalance added or
+         *  resumed.
+         *  @locality any */
+        struct {
+                rd_atomic64_t ts_start; /**< Start of the rebalance being
+                                         *   measured, or 0. */
+                rd_atomic32_t epoch;    /**< Measurement the partitions
+                                         *   added or resumed by the
+                                         *   rebalance are marked with,
+                                         *   see rktp_rebalance_epoch. */
+                rd_avg_t latency;       /**< Latency (microseconds) */
+        } rkcg_rebalance_latency;
+
         rd_kafka_timer_t rkcg_offset_commit_tmr;     /* Offset commit timer */
         rd_kafka_timer_t rkcg_max_poll_interval_tmr; /**< Enforce the max
                                                       *   poll interval. */
@@ -302,6 +362,14 @@ typedef struct rd_kafka_cgrp_s {
         ((rkcg)->rkcg_coord_id != -1 &&                                        \
          (rkcg)->rkcg_coord_id == (rkb)->rkb_nodeid)
 
+/**
+ * @returns true if cgrp is using the next-generation consumer group
+ *          protocol (KIP-848).
+ */
+#define RD_KAFKA_CGRP_IS_CONSUMER_PROTOCOL(rkcg)                               \
+        ((rkcg)->rkcg_rk->rk_conf.group_protocol ==                            \
+         RD_KAFKA_GROUP_PROTOCOL_CONSUMER)
+
 /**
  * @returns true if cgrp is using static group membership
  */
@@ -347,6 +415,12 @@ void rd_kafka_cgrp_metadata_update_check(rd_kafka_cgrp_t *rkcg,
 #define rd_kafka_cgrp_get(rk) ((rk)->rk_cgrp)
 
 
+void rd_kafka_cgrp_rebalance_latency_end(rd_kafka_cgrp_t *rkcg,
+                                         rd_kafka_toppar_t *rktp);
+
+void rd_kafka_cgrp_commit_dirty_add(rd_kafka_cgrp_t *rkcg,
+                                    rd_kafka_toppar_t *rktp);
+
 void rd_kafka_cgrp_assigned_offsets_commit(
     rd_kafka_cgrp_t *rkcg,
     const rd_kafka_topic_partition_list_t *offsets,
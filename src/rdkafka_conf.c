@@ -197,6 +197,13 @@ struct rd_kafka_property {
             "available at build time"
 #endif
 
+#ifdef MADV_HUGEPAGE
+#define _UNSUPPORTED_HUGEPAGES .unsupported = NULL
+#else
+#define _UNSUPPORTED_HUGEPAGES                                                 \
+        .unsupported = "transparent huge pages not supported on this platform"
+#endif
+
 #ifdef _WIN32
 #define _UNSUPPORTED_WIN32_GSSAPI                                              \
         .unsupported =                                                         \
@@ -432,7 +439,8 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "This is a generic property applied to all broker communication, "
      "however it is primarily relevant to produce requests. "
      "In particular, note that other mechanisms limit the number "
-     "of outstanding consumer fetch request per broker to one.",
+     "of outstanding consumer fetch request per broker to "
+     "`fetch.pipeline.depth` (one by default).",
      1, 1000000, 1000000},
     {_RK_GLOBAL, "max.in.flight", _RK_C_ALIAS,
      .sdef = "max.in.flight.requests.per.connection"},
@@ -562,6 +570,36 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
              {AF_INET, "v4"},
              {AF_INET6, "v6"},
          }},
+    {_RK_GLOBAL, "broker.buffer.pool.max.kbytes", _RK_C_INT,
+     _RK(broker_buf_pool_max_kbytes),
+     "Maximum total size of protocol request and response buffers to "
+     "retain, per broker, for reuse by subsequent requests and responses "
+     "rather than freeing and allocating a new buffer for each. "
+     "Buffers are pooled in size classes of 1, 4, 16, 64, 256 and "
+     "1024 kilobytes, larger buffers are not pooled. "
+     "Disable with 0.",
+     0, 1000000, 1024},
+    {_RK_GLOBAL, "broker.receive.buffer.pool.max.kbytes", _RK_C_INT,
+     _RK(broker_rxbuf_pool_max_kbytes),
+     "Maximum total size of receive buffers to retain, per broker, for "
+     "reuse by subsequent responses rather than allocating new memory "
+     "for each large response, such as FetchResponses. "
+     "A receive buffer is returned to the pool when the response has been "
+     "handled and all consumed messages referencing it have been "
+     "destroyed. "
+     "Buffers are pooled in power-of-two size classes from 64 kilobytes "
+     "to 64 megabytes, smaller and larger responses are not pooled. "
+     "Since pooled memory is retained per broker and each block is rounded "
+     "up to its size class, the pool is disabled (0) by default; enable it "
+     "for high-throughput consumers where allocating large responses is "
+     "a measurable cost.",
+     0, 1000000, 0},
+    {_RK_GLOBAL, "broker.receive.buffer.hugepages", _RK_C_BOOL,
+     _RK(broker_rxbuf_hugepages),
+     "Back pooled receive buffers of 2 megabytes or larger by transparent "
+     "huge pages, reducing TLB pressure when parsing large responses. "
+     "Requires `broker.receive.buffer.pool.max.kbytes` to be enabled.",
+     0, 1, 0, _UNSUPPORTED_HUGEPAGES},
     {_RK_GLOBAL | _RK_MED, "socket.connection.setup.timeout.ms", _RK_C_INT,
      _RK(socket_connection_setup_timeout_ms),
      "Maximum time allowed for broker connection setup "
@@ -1097,6 +1135,15 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "`session.timeout.ms` to avoid group rebalances caused by transient "
      "unavailability (e.g. process restarts). "
      "Requires broker version >= 2.3.0."},
+    {_RK_GLOBAL | _RK_CGRP, "group.assignment.snapshot.path",
+     _RK_C_STR, _RK(group_assignment_snapshot_path),
+     "Path to a local file where a static group member writes its "
+     "current assignment and committed offsets when the consumer is "
+     "closed. When the consumer is started again it starts fetching the "
+     "partitions in the file while it rejoins the group, and delivers "
+     "their messages once the partitions are assigned and their committed "
+     "offsets are confirmed by the group coordinator. "
+     "Requires `group.instance.id`."},
     {_RK_GLOBAL | _RK_CGRP | _RK_MED, "partition.assignment.strategy",
      _RK_C_STR, _RK(partition_assignment_strategy),
      "The name of one or more partition assignment strategies. The "
@@ -1107,8 +1154,17 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "list have higher priority). "
      "Cooperative and non-cooperative (eager) strategies must not be "
      "mixed. "
-     "Available strategies: range, roundrobin, cooperative-sticky.",
+     "Available strategies: range, roundrobin, cooperative-sticky, "
+     "and any custom assignors added with "
+     "rd_kafka_conf_add_partition_assignor().",
      .sdef = "range,roundrobin"},
+    {_RK_GLOBAL | _RK_CGRP, "custom_assignors", _RK_C_INTERNAL,
+     _RK(custom_assignors),
+     "Custom partition assignors added through "
+     "rd_kafka_conf_add_partition_assignor().",
+     .ctor = rd_kafka_conf_custom_assignors_ctor,
+     .dtor = rd_kafka_conf_custom_assignors_dtor,
+     .copy = rd_kafka_conf_custom_assignors_copy},
     {_RK_GLOBAL | _RK_CGRP | _RK_HIGH, "session.timeout.ms", _RK_C_INT,
      _RK(group_session_timeout_ms),
      "Client group session and failure detection timeout. "
@@ -1130,6 +1186,25 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "Group protocol type. NOTE: Currently, the only supported group "
      "protocol type is `consumer`.",
      .sdef = "consumer"},
+    {_RK_GLOBAL | _RK_CGRP | _RK_HIGH, "group.protocol", _RK_C_S2I,
+     _RK(group_protocol),
+     "Group protocol to use. `classic` is the JoinGroup/SyncGroup based "
+     "protocol where the group leader performs the partition assignment. "
+     "`consumer` is the next-generation ConsumerGroupHeartbeat based "
+     "protocol (KIP-848) where the group coordinator performs the "
+     "partition assignment and members reconcile incrementally, "
+     "without group-wide synchronization barriers. "
+     "With the `consumer` protocol `partition.assignment.strategy` "
+     "is ignored, see `group.remote.assignor`.",
+     .vdef = RD_KAFKA_GROUP_PROTOCOL_CLASSIC,
+     .s2i  = {{RD_KAFKA_GROUP_PROTOCOL_CLASSIC, "classic"},
+             {RD_KAFKA_GROUP_PROTOCOL_CONSUMER, "consumer"}}},
+    {_RK_GLOBAL | _RK_CGRP | _RK_MED, "group.remote.assignor", _RK_C_STR,
+     _RK(group_remote_assignor),
+     "Server-side assignor to use with `group.protocol=consumer`. "
+     "Keep it unset to let the group coordinator select the assignor, "
+     "else specify the name of an assignor supported by the group "
+     "coordinator, e.g., `uniform` or `range`."},
     {_RK_GLOBAL | _RK_CGRP, "coordinator.query.interval.ms", _RK_C_INT,
      _RK(coord_query_intvl_ms),
      "How often to query for the current client group coordinator. "
@@ -1192,6 +1267,19 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "This value may be overshot by fetch.message.max.bytes. "
      "This property has higher priority than queued.min.messages.",
      1, INT_MAX / 1024, 0x10000 /*64MB*/},
+    {_RK_GLOBAL | _RK_CONSUMER | _RK_MED, "queued.max.messages.total.kbytes",
+     _RK_C_INT, _RK(queued_max_total_kbytes),
+     "Maximum number of kilobytes of pre-fetched messages, across all "
+     "partitions, that have not yet been destroyed by the application. "
+     "Each partition being fetched is limited to an equal share of this "
+     "budget, and its per-partition fetch size is reduced accordingly, "
+     "so that memory usage is bounded regardless of the number of "
+     "assigned partitions and of how partition queues are used. "
+     "This value may be overshot by one message batch per partition "
+     "since the broker always returns at least one batch. "
+     "A value of 0 disables the global budget, leaving only "
+     "queued.max.messages.kbytes in effect.",
+     0, INT_MAX / 1024, 0},
     {_RK_GLOBAL | _RK_CONSUMER, "fetch.wait.max.ms", _RK_C_INT,
      _RK(fetch_wait_max_ms),
      "Maximum time the broker may wait to fill the Fetch response "
@@ -1231,6 +1319,77 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "How long to postpone the next fetch request for a "
      "topic+partition in case of a fetch error.",
      0, 300 * 1000, 500},
+    {_RK_GLOBAL | _RK_CONSUMER, "enable.fetch.sessions", _RK_C_BOOL,
+     _RK(enable_fetch_sessions),
+     "Use incremental fetch sessions (KIP-227) with brokers that support "
+     "them (Apache Kafka 1.1.0 and later): after the initial full "
+     "FetchRequest only partitions whose fetch state has changed are sent "
+     "to the broker, and the broker only returns partitions with new data "
+     "or changed metadata, reducing request size and broker CPU usage for "
+     "consumers with many partitions per broker.",
+     0, 1, 1},
+    {_RK_GLOBAL | _RK_CONSUMER | _RK_MED, "fetch.pipeline.depth", _RK_C_INT,
+     _RK(fetch_pipeline_depth),
+     "Maximum number of FetchRequests to have in flight to a single broker. "
+     "With a value above 1 the partitions fetched from the broker are "
+     "spread over up to this many concurrent FetchRequests, each covering "
+     "a disjoint set of partitions, so that new data can be requested for "
+     "some partitions while the response for others is still in transit. "
+     "This increases throughput on high-latency links, but only when "
+     "several partitions are fetched from the same broker. "
+     "Incremental fetch sessions (`enable.fetch.sessions`) are not used "
+     "when this is above 1.",
+     1, 16, 1},
+    {_RK_GLOBAL | _RK_CONSUMER | _RK_MED, "fetch.decode.threads", _RK_C_INT,
+     _RK(fetch_decode_threads),
+     "Number of worker threads used to decompress and parse the "
+     "MessageSets of a FetchResponse. "
+     "With a value above 0 the MessageSets of the different partitions "
+     "in a single FetchResponse are decoded in parallel, by these threads "
+     "and the broker thread that received the response, "
+     "while per-partition message order is retained. "
+     "Small MessageSets are always decoded by the broker thread. "
+     "This is useful when a single broker's fetch throughput is limited by "
+     "decompression, e.g., with many partitions and compressed topics. "
+     "A value of 0 decodes all MessageSets on the broker thread.",
+     0, 64, 0},
+    {_RK_GLOBAL | _RK_CONSUMER | _RK_MED, "fetch.replica.selection",
+     _RK_C_S2I, _RK(fetch_replica_selection),
+     "How the replica to fetch a partition from is selected. "
+     "`broker` - fetch from the partition leader, or from the preferred "
+     "read replica the leader designates (KIP-392, requires "
+     "`replica.selector.class` to be configured on the broker). "
+     "`client` - the consumer selects the replica itself among the "
+     "partition's in-sync replicas, preferring replicas in the same rack "
+     "as the client (`client.rack`) and then the replica with the lowest "
+     "measured fetch latency and fetch load from this client. "
+     "The consumer reverts to the leader when the selected replica "
+     "falls out of sync or fails, and re-evaluates its selection when "
+     "the replica lease expires. "
+     "Fetching from a follower requires Apache Kafka 2.4.0 or later.",
+     .vdef = RD_KAFKA_FETCH_REPLICA_SELECTION_BROKER,
+     .s2i  = {{RD_KAFKA_FETCH_REPLICA_SELECTION_BROKER, "broker"},
+             {RD_KAFKA_FETCH_REPLICA_SELECTION_CLIENT, "client"}}},
+    {_RK_GLOBAL | _RK_CONSUMER | _RK_MED, "fetch.scheduling", _RK_C_S2I,
+     _RK(fetch_scheduling),
+     "How `fetch.max.bytes` is divided between the partitions fetched "
+     "from the same broker. "
+     "`round-robin` - each partition is asked for at most "
+     "`max.partition.fetch.bytes`, and the partition the FetchRequest "
+     "starts with is rotated. "
+     "`priority` - `fetch.max.bytes` is divided in proportion to the "
+     "partitions' fetch priority, see `rd_kafka_fetch_priority_set()`. "
+     "`lag` - `fetch.max.bytes` is divided in proportion to the "
+     "partitions' consumer lag multiplied by their fetch priority, "
+     "so that backlogged partitions catch up faster. "
+     "With `priority` and `lag` a partition is never asked for less than "
+     "`max.partition.fetch.bytes`, and the FetchRequest starts with the "
+     "partition with the highest weight since the broker fills the "
+     "response in request order.",
+     .vdef = RD_KAFKA_FETCH_SCHEDULING_ROUND_ROBIN,
+     .s2i  = {{RD_KAFKA_FETCH_SCHEDULING_ROUND_ROBIN, "round-robin"},
+             {RD_KAFKA_FETCH_SCHEDULING_PRIORITY, "priority"},
+             {RD_KAFKA_FETCH_SCHEDULING_LAG, "lag"}}},
     {_RK_GLOBAL | _RK_CONSUMER | _RK_DEPRECATED, "offset.store.method",
      _RK_C_S2I, _RK(offset_store_method),
      "Offset commit store method: "
@@ -1252,6 +1411,11 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
              {RD_KAFKA_READ_COMMITTED, "read_committed"}}},
     {_RK_GLOBAL | _RK_CONSUMER, "consume_cb", _RK_C_PTR, _RK(consume_cb),
      "Message consume callback (set with rd_kafka_conf_set_consume_cb())"},
+    {_RK_GLOBAL | _RK_CONSUMER, "consume_filter_cb", _RK_C_PTR,
+     _RK(consume_filter_cb),
+     "Message filter callback, called for each fetched message before "
+     "it is enqueued for the application "
+     "(set with rd_kafka_conf_set_consume_filter_cb())"},
     {_RK_GLOBAL | _RK_CONSUMER, "rebalance_cb", _RK_C_PTR, _RK(rebalance_cb),
      "Called after consumer group has been rebalanced "
      "(set with rd_kafka_conf_set_rebalance_cb())"},
@@ -1341,6 +1505,17 @@ static const struct rd_kafka_property rd_kafka_properties[] = {
      "This queue is shared by all topics and partitions. "
      "This property has higher priority than queue.buffering.max.messages.",
      1, INT_MAX, 0x100000 /*1GB*/},
+    {_RK_GLOBAL | _RK_PRODUCER | _RK_MED, "queue.buffering.max.memory.kbytes",
+     _RK_C_INT, _RK(queue_buffering_max_memory_kbytes),
+     "Maximum total memory allowed to be used by messages in the producer, "
+     "including the per-message overhead (message struct, key, headers, "
+     "payload) and the buffers of in-flight ProduceRequests. "
+     "Unlike queue.buffering.max.kbytes, which only accounts for "
+     "the message payload size, this is a hard limit on the memory "
+     "held by the producer for messages: when it is reached produce() "
+     "will fail with ERR__QUEUE_FULL (or block if RD_KAFKA_MSG_F_BLOCK "
+     "is used). A value of 0 disables this limit.",
+     0, INT_MAX, 0},
     {_RK_GLOBAL | _RK_PRODUCER | _RK_HIGH, "queue.buffering.max.ms", _RK_C_DBL,
      _RK(buffering_max_ms_dbl),
      "Delay in milliseconds to wait for messages in the producer queue "
@@ -2675,6 +2850,15 @@ void rd_kafka_conf_set_consume_cb(
                                       consume_cb);
 }
 
+void rd_kafka_conf_set_consume_filter_cb(
+    rd_kafka_conf_t *conf,
+    int (*consume_filter_cb)(rd_kafka_t *rk,
+                             const rd_kafka_message_t *rkmessage,
+                             void *opaque)) {
+        rd_kafka_anyconf_set_internal(_RK_GLOBAL, conf, "consume_filter_cb",
+                                      consume_filter_cb);
+}
+
 void rd_kafka_conf_set_rebalance_cb(
     rd_kafka_conf_t *conf,
     void (*rebalance_cb)(rd_kafka_t *rk,
@@ -3801,6 +3985,11 @@ const char *rd_kafka_conf_finalize(rd_kafka_type_t cltype,
                         return "`max.poll.interval.ms`must be >= "
                                "`session.timeout.ms`";
 
+                if (conf->group_assignment_snapshot_path &&
+                    !conf->group_instance_id)
+                        return "`group.assignment.snapshot.path` requires "
+                               "`group.instance.id`";
+
                 /* Simplifies rd_kafka_is_idempotent() which is producer-only */
                 conf->eos.idempotence = 0;
 
@@ -148,6 +148,23 @@ typedef enum {
         RD_KAFKA_OFFSET_METHOD_BROKER
 } rd_kafka_offset_method_t;
 
+typedef enum {
+        RD_KAFKA_FETCH_REPLICA_SELECTION_BROKER,
+        RD_KAFKA_FETCH_REPLICA_SELECTION_CLIENT
+} rd_kafka_fetch_replica_selection_t;
+
+typedef enum {
+        RD_KAFKA_FETCH_SCHEDULING_ROUND_ROBIN,
+        RD_KAFKA_FETCH_SCHEDULING_PRIORITY,
+        RD_KAFKA_FETCH_SCHEDULING_LAG
+} rd_kafka_fetch_scheduling_t;
+
+typedef enum {
+        RD_KAFKA_GROUP_PROTOCOL_CLASSIC, /**< JoinGroup/SyncGroup */
+        RD_KAFKA_GROUP_PROTOCOL_CONSUMER /**< ConsumerGroupHeartbeat
+                                          *   (KIP-848) */
+} rd_kafka_group_protocol_t;
+
 typedef enum {
         RD_KAFKA_SASL_OAUTHBEARER_METHOD_DEFAULT,
         RD_KAFKA_SASL_OAUTHBEARER_METHOD_OIDC
@@ -160,7 +177,7 @@ typedef enum {
 
 /* Increase in steps of 64 as needed.
  * This must be larger than sizeof(rd_kafka_[topic_]conf_t) */
-#define RD_KAFKA_CONF_PROPS_IDX_MAX (64 * 33)
+#define RD_KAFKA_CONF_PROPS_IDX_MAX (64 * 34)
 
 /**
  * @struct rd_kafka_anyconf_t
@@ -201,6 +218,9 @@ struct rd_kafka_conf_s {
         int debug;
         int broker_addr_ttl;
         int broker_addr_family;
+        int broker_buf_pool_max_kbytes;
+        int broker_rxbuf_pool_max_kbytes;
+        int broker_rxbuf_hugepages;
         int socket_timeout_ms;
         int socket_blocking_max_ms;
         int socket_sndbuf_size;
@@ -350,14 +370,22 @@ struct rd_kafka_conf_s {
         int check_crcs;
         int queued_min_msgs;
         int queued_max_msg_kbytes;
+        int queued_max_total_kbytes;
+        int64_t queued_max_total_bytes;
         int64_t queued_max_msg_bytes;
         int fetch_wait_max_ms;
         int fetch_msg_max_bytes;
         int fetch_max_bytes;
         int fetch_min_bytes;
         int fetch_error_backoff_ms;
+        int enable_fetch_sessions;
+        int fetch_pipeline_depth;
+        int fetch_decode_threads;
+        rd_kafka_fetch_replica_selection_t fetch_replica_selection;
+        rd_kafka_fetch_scheduling_t fetch_scheduling;
         char *group_id_str;
         char *group_instance_id;
+        char *group_assignment_snapshot_path;
         int allow_auto_create_topics;
 
         rd_kafka_pattern_list_t *topic_blacklist;
@@ -370,8 +398,14 @@ struct rd_kafka_conf_s {
         int group_session_timeout_ms;
         int group_heartbeat_intvl_ms;
         rd_kafkap_str_t *group_protocol_type;
+        rd_kafka_group_protocol_t group_protocol;
+        char *group_remote_assignor;
         char *partition_assignment_strategy;
         rd_list_t partition_assignors;
+        /** Application assignors added with
+         *  rd_kafka_conf_add_partition_assignor()
+         *  (rd_kafka_custom_assignor_t *) */
+        rd_list_t custom_assignors;
         int enabled_assignor_cnt;
 
         void (*rebalance_cb)(rd_kafka_t *rk,
@@ -411,6 +445,7 @@ struct rd_kafka_conf_s {
         } eos;
         int queue_buffering_max_msgs;
         int queue_buffering_max_kbytes;
+        int queue_buffering_max_memory_kbytes;
         double buffering_max_ms_dbl; /**< This is the configured value */
         rd_ts_t buffering_max_us;    /**< This is the value used in the code */
         int queue_backpressure_thres;
@@ -453,6 +488,11 @@ struct rd_kafka_conf_s {
         /* Consume callback */
         void (*consume_cb)(rd_kafka_message_t *rkmessage, void *opaque);
 
+        /* Consume filter callback */
+        int (*consume_filter_cb)(rd_kafka_t *rk,
+                                 const rd_kafka_message_t *rkmessage,
+                                 void *opaque);
+
         /* Log callback */
         void (*log_cb)(const rd_kafka_t *rk,
                        int level,
@@ -36,6 +36,7 @@
 #include "rdkafka_offset.h"
 #include "rdkafka_msgset.h"
 #include "rdkafka_fetcher.h"
+#include "rdkafka_interceptor.h"
 
 
 /**
@@ -76,6 +77,124 @@ static void rd_kafka_toppar_fetch_backoff(rd_kafka_broker_t *rkb,
 }
 
 
+/**
+ * @brief Fetch session (KIP-227) partition state: the partition's fetch
+ *        parameters as last sent to the broker in the session.
+ */
+typedef struct rd_kafka_fetch_session_toppar_s {
+        rd_kafka_toppar_t *rktp;
+        int64_t FetchOffset;
+        int32_t CurrentLeaderEpoch;
+        int32_t MaxBytes;
+        rd_bool_t seen; /**< Partition is in the FetchRequest being built. */
+} rd_kafka_fetch_session_toppar_t;
+
+static void rd_kafka_fetch_session_toppar_destroy(void *ptr) {
+        rd_kafka_fetch_session_toppar_t *fstp = ptr;
+        rd_kafka_toppar_destroy(fstp->rktp);
+        rd_free(fstp);
+}
+
+/**
+ * @brief Fetch session partition comparator, by topic and partition.
+ */
+static int rd_kafka_fetch_session_toppar_cmp(const void *_a, const void *_b) {
+        const rd_kafka_fetch_session_toppar_t *a = _a, *b = _b;
+        const rd_kafka_toppar_t *rktp_a = a->rktp;
+        const rd_kafka_toppar_t *rktp_b = b->rktp;
+        int r;
+
+        if (rktp_a->rktp_rkt != rktp_b->rktp_rkt &&
+            (r = rd_kafkap_str_cmp(rktp_a->rktp_rkt->rkt_topic,
+                                   rktp_b->rktp_rkt->rkt_topic)))
+                return r;
+
+        return RD_CMP(rktp_a->rktp_partition, rktp_b->rktp_partition);
+}
+
+
+/**
+ * @brief Initialize the broker's fetch session state.
+ */
+void rd_kafka_broker_fetch_session_init(rd_kafka_broker_t *rkb) {
+        rkb->rkb_fetch_session.id    = 0;
+        rkb->rkb_fetch_session.epoch = 0;
+        rd_list_init(&rkb->rkb_fetch_session.toppars, 0,
+                     rd_kafka_fetch_session_toppar_destroy);
+}
+
+/**
+ * @brief Destroy the broker's fetch session state.
+ */
+void rd_kafka_broker_fetch_session_destroy(rd_kafka_broker_t *rkb) {
+        rd_list_destroy(&rkb->rkb_fetch_session.toppars);
+}
+
+
+/**
+ * @brief Reset the broker's fetch session so that the next FetchRequest
+ *        is a full FetchRequest, creating a new session.
+ *
+ * If \p forget_id is false the current SessionId is sent along with the
+ * full FetchRequest, which closes the existing session on the broker,
+ * else the session is assumed to no longer exist on the broker.
+ *
+ * @locality broker thread
+ */
+void rd_kafka_broker_fetch_session_reset(rd_kafka_broker_t *rkb,
+                                         rd_bool_t forget_id,
+                                         const char *reason) {
+        if (rkb->rkb_fetch_session.epoch > 0)
+                rd_rkb_dbg(rkb, FETCH, "FETCHSESS",
+                           "Resetting fetch session %" PRId32
+                           " at epoch %" PRId32 " with %d partition(s): %s",
+                           rkb->rkb_fetch_session.id,
+                           rkb->rkb_fetch_session.epoch,
+                           rd_list_cnt(&rkb->rkb_fetch_session.toppars),
+                           reason);
+
+        if (forget_id)
+                rkb->rkb_fetch_session.id = 0;
+        rkb->rkb_fetch_session.epoch = 0;
+        rd_list_clear(&rkb->rkb_fetch_session.toppars);
+}
+
+
+/**
+ * @brief Update the fetch session after a successful FetchResponse to
+ *        a FetchRequest sent at session epoch \p SessionEpoch.
+ *
+ * @locality broker thread
+ */
+static void rd_kafka_fetch_session_update(rd_kafka_broker_t *rkb,
+                                          int32_t SessionEpoch,
+                                          int32_t SessionId) {
+        if (unlikely(SessionEpoch != rkb->rkb_fetch_session.epoch))
+                return; /* Session was reset while request was in flight */
+
+        if (SessionEpoch == 0) {
+                /* Full FetchRequest: the broker may or may not have
+                 * created a new session. */
+                if (SessionId != rkb->rkb_fetch_session.id)
+                        rd_rkb_dbg(rkb, FETCH, "FETCHSESS",
+                                   "Fetch session %" PRId32
+                                   " %s with %d partition(s)",
+                                   SessionId,
+                                   SessionId ? "created" : "not created",
+                                   rd_list_cnt(
+                                       &rkb->rkb_fetch_session.toppars));
+                rkb->rkb_fetch_session.id    = SessionId;
+                rkb->rkb_fetch_session.epoch = SessionId ? 1 : 0;
+        } else if (rkb->rkb_fetch_session.epoch == INT32_MAX) {
+                /* Epoch wraps around to 1 */
+                rkb->rkb_fetch_session.epoch = 1;
+        } else {
+                rkb->rkb_fetch_session.epoch++;
+        }
+}
+
+
+
 /**
  * @brief Handle preferred replica in fetch response.
  *
@@ -161,6 +280,192 @@ static void rd_kafka_fetch_preferred_replica_handle(rd_kafka_toppar_t *rktp,
 }
 
 
+/**
+ * @brief Update the broker's Fetch round-trip time moving average from
+ *        the \p request's RTT.
+ *
+ * Responses that took fetch.wait.max.ms or longer were most likely held
+ * back by the broker waiting for new messages and are not representative
+ * of the broker's latency: they are ignored.
+ *
+ * @locality broker thread
+ */
+static void rd_kafka_fetch_rtt_update(rd_kafka_broker_t *rkb,
+                                      const rd_kafka_buf_t *request) {
+        rd_ts_t rtt = request->rkbuf_ts_sent;
+        int64_t avg;
+
+        if (rtt <= 0 ||
+            rtt >= (rd_ts_t)rkb->rkb_rk->rk_conf.fetch_wait_max_ms * 1000)
+                return;
+
+        avg = rd_atomic64_get(&rkb->rkb_c.fetch_rtt);
+        rd_atomic64_set(&rkb->rkb_c.fetch_rtt,
+                        avg ? (avg * 7 + rtt) / 8 : rtt);
+}
+
+
+/**
+ * @brief Client-side replica selection (`fetch.replica.selection=client`):
+ *        select the broker to fetch \p rktp from among its in-sync
+ *        replicas.
+ *
+ * Replicas in the same rack as the client (`client.rack`) are preferred.
+ * Among those, the replica with the lowest cost is selected, where the
+ * cost is the broker's Fetch RTT scaled by the number of partitions this
+ * client currently fetches from it. The leader wins ties.
+ *
+ * @returns a reference to the selected broker, or NULL if the leader is to
+ *          be used.
+ *
+ * @locks rd_kafka_toppar_lock(rktp) and
+ *        rd_kafka_rdlock(rk) must NOT be held.
+ *
+ * @locality broker thread
+ */
+static rd_kafka_broker_t *
+rd_kafka_fetch_replica_select(rd_kafka_toppar_t *rktp) {
+        rd_kafka_t *rk               = rktp->rktp_rkt->rkt_rk;
+        const rd_kafkap_str_t *rack  = rk->rk_conf.client_rack;
+        rd_kafka_broker_t *best      = NULL;
+        rd_bool_t best_rack_match    = rd_false;
+        int64_t best_cost            = 0;
+        int64_t leader_rtt           = 0;
+        rd_kafka_broker_t **replicas = NULL;
+        int32_t *isrs                = NULL;
+        int32_t leader_id, broker_id;
+        int isr_cnt, replica_cnt = 0;
+        int i;
+
+        /* Copy the ISR under the toppar lock, but look up the brokers
+         * after releasing it to maintain the rk -> rktp lock order. */
+        rd_kafka_toppar_lock(rktp);
+        leader_id = rktp->rktp_leader_id;
+        broker_id = rktp->rktp_broker_id;
+        isr_cnt   = rktp->rktp_isr_cnt;
+        if (isr_cnt > 0) {
+                isrs = rd_alloca(sizeof(*isrs) * isr_cnt);
+                memcpy(isrs, rktp->rktp_isrs, sizeof(*isrs) * isr_cnt);
+        }
+        rd_kafka_toppar_unlock(rktp);
+
+        if (isr_cnt > 0) {
+                replicas = rd_alloca(sizeof(*replicas) * isr_cnt);
+                rd_kafka_rdlock(rk);
+                for (i = 0; i < isr_cnt; i++) {
+                        rd_kafka_broker_t *rkb =
+                            rd_kafka_broker_find_by_nodeid(rk, isrs[i]);
+                        if (rkb)
+                                replicas[replica_cnt++] = rkb;
+                }
+                rd_kafka_rdunlock(rk);
+        }
+
+        for (i = 0; i < replica_cnt; i++) {
+                if (replicas[i]->rkb_nodeid == leader_id)
+                        leader_rtt =
+                            rd_atomic64_get(&replicas[i]->rkb_c.fetch_rtt);
+        }
+
+        for (i = 0; i < replica_cnt; i++) {
+                rd_kafka_broker_t *rkb = replicas[i];
+                rd_bool_t rack_match;
+                int64_t rtt, cost;
+                int load;
+
+                rd_kafka_broker_lock(rkb);
+                rack_match = RD_KAFKAP_STR_LEN(rack) > 0 && rkb->rkb_rack &&
+                             !rd_kafkap_str_cmp_str(rack, rkb->rkb_rack);
+                load = rkb->rkb_toppar_cnt;
+                rd_kafka_broker_unlock(rkb);
+
+                /* Don't count this partition towards its current
+                 * broker's load. */
+                if (rkb->rkb_nodeid == broker_id && load > 0)
+                        load--;
+
+                /* Use the leader's RTT for replicas not yet fetched from */
+                rtt = rd_atomic64_get(&rkb->rkb_c.fetch_rtt);
+                if (!rtt)
+                        rtt = leader_rtt;
+
+                /* Add 1ms to the RTT so that the load is still
+                 * accounted for when the RTT is unknown. */
+                cost = (rtt + 1000) * (load + 1);
+
+                if (!best || (rack_match && !best_rack_match) ||
+                    (rack_match == best_rack_match &&
+                     (cost < best_cost ||
+                      (cost == best_cost && rkb->rkb_nodeid == leader_id)))) {
+                        best            = rkb;
+                        best_rack_match = rack_match;
+                        best_cost       = cost;
+                }
+        }
+
+        for (i = 0; i < replica_cnt; i++) {
+                if (replicas[i] != best)
+                        rd_kafka_broker_destroy(replicas[i]);
+        }
+
+        if (best && best->rkb_nodeid == leader_id) {
+                rd_kafka_broker_destroy(best);
+                best = NULL;
+        }
+
+        return best;
+}
+
+
+/**
+ * @brief Apply client-side replica selection to \p rktp, currently
+ *        fetched from \p rkb, and delegate it to the selected replica
+ *        if it differs from the current one.
+ *
+ * @returns rd_true if the partition was delegated to another broker.
+ *
+ * @locks rd_kafka_toppar_lock(rktp) and
+ *        rd_kafka_rdlock(rk) must NOT be held.
+ *
+ * @locality broker thread
+ */
+static rd_bool_t rd_kafka_fetch_replica_select_apply(rd_kafka_toppar_t *rktp,
+                                                     rd_kafka_broker_t *rkb) {
+        rd_kafka_broker_t *selected_rkb;
+        rd_bool_t changed = rd_false;
+
+        selected_rkb = rd_kafka_fetch_replica_select(rktp);
+
+        if (!selected_rkb) {
+                /* The leader was selected */
+                if (rktp->rktp_broker_id != rktp->rktp_leader_id)
+                        changed = rd_kafka_toppar_delegate_to_leader(rktp) != 0;
+                return changed;
+        }
+
+        rd_kafka_toppar_lock(rktp);
+        rd_interval_reset_to_now(&rktp->rktp_lease_intvl, 0);
+        if (selected_rkb != rkb) {
+                rd_rkb_dbg(rkb, FETCH, "FETCHREPLICA",
+                           "%.*s [%" PRId32
+                           "]: client-side replica selection: "
+                           "fetching from replica %" PRId32
+                           " (leader %" PRId32 ")",
+                           RD_KAFKAP_STR_PR(rktp->rktp_rkt->rkt_topic),
+                           rktp->rktp_partition, selected_rkb->rkb_nodeid,
+                           rktp->rktp_leader_id);
+                changed = rd_kafka_toppar_broker_update(
+                              rktp, selected_rkb->rkb_nodeid, selected_rkb,
+                              "client-side replica selection") != 0;
+        }
+        rd_kafka_toppar_unlock(rktp);
+
+        rd_kafka_broker_destroy(selected_rkb);
+
+        return changed;
+}
+
+
 /**
  * @brief Handle partition-specific Fetch error.
  */
@@ -326,9 +631,341 @@ static void rd_kafka_fetch_reply_handle_partition_error(
 
 
 
+/**
+ * @name Fetch response decode worker pool (fetch.decode.threads)
+ *
+ * The MessageSets of the partitions in a FetchResponse are independent
+ * of each other and may thus be decompressed and parsed in parallel.
+ *
+ * While parsing a FetchResponse the broker thread turns each sufficiently
+ * large MessageSet into a decode job which is handed to the worker pool.
+ * The job parses the MessageSet onto a job-local queue using a copy of
+ * the partition's fetch state, leaving the partition itself untouched.
+ * When the whole response has been parsed the broker thread helps out
+ * decoding its own remaining jobs, waits for the workers to finish the
+ * rest, and then applies each job's result to its partition in response
+ * order. Since a partition occurs at most once per FetchResponse and the
+ * next FetchRequest for it is not sent until this is done, per-partition
+ * message order is retained.
+ *
+ * @{
+ */
+
+/** MessageSets smaller than this are decoded directly by the broker
+ *  thread since the job overhead would outweigh the gains. */
+#define RD_KAFKA_FETCH_DECODE_MIN_SIZE (64 * 1024)
+
+/**
+ * @brief A MessageSet decode job.
+ */
+typedef struct rd_kafka_fetch_decode_job_s {
+        TAILQ_ENTRY(rd_kafka_fetch_decode_job_s) link; /**< rk_fetch_decode
+                                                        *   .jobs link */
+        int *remainingp;         /**< Owning batch's count of jobs not yet
+                                  *   decoded, protected by the pool lock. */
+        rd_kafka_buf_t *rkbuf;   /**< Shadow buffer of the MessageSet,
+                                  *   keeping the response buffer alive. */
+        rd_kafka_toppar_t *rktp; /**< Partition (refcounted) */
+        const struct rd_kafka_toppar_ver *tver; /**< Request's toppar version,
+                                                 *   owned by the request. */
+        rd_kafka_aborted_txns_t *aborted_txns;  /**< Aborted transactions,
+                                                 *   may be NULL. */
+        rd_kafka_q_t rkq;                       /**< Decoded messages and
+                                                 *   errors. */
+        rd_kafka_fetch_pos_t fetch_pos;         /**< Job's copy of the
+                                                 *   partition's fetch
+                                                 *   position. */
+        int32_t fetch_msg_max_bytes;            /**< Job's copy of
+                                                 *   rktp_fetch_msg_max_bytes */
+        rd_kafka_resp_err_t err;                /**< Decode result */
+} rd_kafka_fetch_decode_job_t;
+
+
+/**
+ * @brief The decode jobs of a single FetchResponse.
+ */
+typedef struct rd_kafka_fetch_decode_batch_s {
+        rd_list_t jobs; /**< rd_kafka_fetch_decode_job_t*, in
+                         *   response order. */
+        int remaining;  /**< Number of jobs not yet decoded,
+                         *   protected by the pool lock. */
+} rd_kafka_fetch_decode_batch_t;
+
+
+/**
+ * @brief Decode the job's MessageSet.
+ *
+ * @locality decode worker thread or the owning broker thread
+ * @locks none
+ */
+static void rd_kafka_fetch_decode_job_run(rd_kafka_fetch_decode_job_t *job) {
+        job->err = rd_kafka_msgset_parse0(
+            job->rkbuf, job->rktp, job->aborted_txns, job->tver, &job->rkq,
+            &job->fetch_pos, &job->fetch_msg_max_bytes);
+
+        if (job->aborted_txns) {
+                rd_kafka_aborted_txns_destroy(job->aborted_txns);
+                job->aborted_txns = NULL;
+        }
+
+        rd_kafka_buf_destroy(job->rkbuf);
+        job->rkbuf = NULL;
+}
+
+
+/**
+ * @brief Decode worker thread main loop.
+ *
+ * @locality decode worker thread
+ */
+static int rd_kafka_fetch_decode_thread_main(void *arg) {
+        rd_kafka_t *rk = arg;
+
+        rd_kafka_set_thread_name("decode");
+        rd_kafka_set_thread_sysname("rdk:decode");
+
+        /* Decode workers perform work on behalf of the broker threads
+         * and are thus reported as such to interceptors. */
+        rd_kafka_interceptors_on_thread_start(rk, RD_KAFKA_THREAD_BROKER);
+
+        mtx_lock(&rk->rk_fetch_decode.lock);
+        while (!rk->rk_fetch_decode.terminate) {
+                rd_kafka_fetch_decode_job_t *job;
+
+                if (!(job = TAILQ_FIRST(&rk->rk_fetch_decode.jobs))) {
+                        cnd_wait(&rk->rk_fetch_decode.cnd,
+                                 &rk->rk_fetch_decode.lock);
+                        continue;
+                }
+
+                TAILQ_REMOVE(&rk->rk_fetch_decode.jobs, job, link);
+                mtx_unlock(&rk->rk_fetch_decode.lock);
+
+                rd_kafka_fetch_decode_job_run(job);
+
+                mtx_lock(&rk->rk_fetch_decode.lock);
+                (*job->remainingp)--;
+                cnd_broadcast(&rk->rk_fetch_decode.done_cnd);
+        }
+        mtx_unlock(&rk->rk_fetch_decode.lock);
+
+        rd_kafka_interceptors_on_thread_exit(rk, RD_KAFKA_THREAD_BROKER);
+
+        return 0;
+}
+
+
+/**
+ * @brief Start the decode worker pool, if configured.
+ *
+ * Failure to create a worker thread is not fatal since the broker
+ * threads decode any jobs not picked up by a worker themselves.
+ *
+ * @locality application thread (rd_kafka_new())
+ */
+void rd_kafka_fetch_decode_pool_init(rd_kafka_t *rk) {
+        int i;
+
+        if (rk->rk_type != RD_KAFKA_CONSUMER ||
+            rk->rk_conf.fetch_decode_threads == 0)
+                return;
+
+        mtx_init(&rk->rk_fetch_decode.lock, mtx_plain);
+        cnd_init(&rk->rk_fetch_decode.cnd);
+        cnd_init(&rk->rk_fetch_decode.done_cnd);
+        TAILQ_INIT(&rk->rk_fetch_decode.jobs);
+
+        rk->rk_fetch_decode.thrds =
+            rd_calloc(rk->rk_conf.fetch_decode_threads,
+                      sizeof(*rk->rk_fetch_decode.thrds));
+
+        for (i = 0; i < rk->rk_conf.fetch_decode_threads; i++) {
+                if (thrd_create(&rk->rk_fetch_decode
+                                     .thrds[rk->rk_fetch_decode.thrd_cnt],
+                                rd_kafka_fetch_decode_thread_main,
+                                rk) != thrd_success) {
+                        rd_kafka_log(rk, LOG_WARNING, "DECODE",
+                                     "Failed to create decode thread: "
+                                     "%s (%i): "
+                                     "continuing with %d decode thread(s)",
+                                     rd_strerror(errno), errno,
+                                     rk->rk_fetch_decode.thrd_cnt);
+                        break;
+                }
+                rk->rk_fetch_decode.thrd_cnt++;
+        }
+}
+
+
+/**
+ * @brief Stop and join the decode worker pool.
+ *
+ * @locality rdkafka main thread, after all broker threads have
+ *           been joined.
+ */
+void rd_kafka_fetch_decode_pool_term(rd_kafka_t *rk) {
+        int i;
+
+        if (!rk->rk_fetch_decode.thrds)
+                return;
+
+        mtx_lock(&rk->rk_fetch_decode.lock);
+        rd_assert(TAILQ_EMPTY(&rk->rk_fetch_decode.jobs));
+        rk->rk_fetch_decode.terminate = rd_true;
+        cnd_broadcast(&rk->rk_fetch_decode.cnd);
+        mtx_unlock(&rk->rk_fetch_decode.lock);
+
+        rd_kafka_dbg(rk, GENERIC, "TERMINATE", "Join %d decode thread(s)",
+                     rk->rk_fetch_decode.thrd_cnt);
+
+        for (i = 0; i < rk->rk_fetch_decode.thrd_cnt; i++) {
+                int res;
+                thrd_join(rk->rk_fetch_decode.thrds[i], &res);
+        }
+
+        rd_free(rk->rk_fetch_decode.thrds);
+        rk->rk_fetch_decode.thrds    = NULL;
+        rk->rk_fetch_decode.thrd_cnt = 0;
+
+        cnd_destroy(&rk->rk_fetch_decode.done_cnd);
+        cnd_destroy(&rk->rk_fetch_decode.cnd);
+        mtx_destroy(&rk->rk_fetch_decode.lock);
+}
+
+
+/**
+ * @brief Create a decode job for the MessageSet of \p size bytes at \p ptr
+ *        in the response \p rkbuf and hand it to the worker pool.
+ *
+ * Ownership of \p aborted_txns is transferred to the job.
+ *
+ * @locality broker thread
+ */
+static void
+rd_kafka_fetch_decode_job_add(rd_kafka_broker_t *rkb,
+                              rd_kafka_fetch_decode_batch_t *batch,
+                              rd_kafka_buf_t *rkbuf,
+                              const void *ptr,
+                              size_t size,
+                              rd_kafka_toppar_t *rktp,
+                              const struct rd_kafka_toppar_ver *tver,
+                              rd_kafka_aborted_txns_t *aborted_txns) {
+        rd_kafka_t *rk = rkb->rkb_rk;
+        rd_kafka_fetch_decode_job_t *job;
+
+        job = rd_calloc(1, sizeof(*job));
+
+        /* The shadow buffer references the MessageSet memory in the
+         * response buffer, which is kept alive for as long as any
+         * of the decoded messages are. */
+        job->rkbuf = rd_kafka_buf_new_shadow(ptr, size, NULL);
+        job->rkbuf->rkbuf_rkb = rkb;
+        rd_kafka_broker_keep(rkb);
+        job->rkbuf->rkbuf_reqhdr   = rkbuf->rkbuf_reqhdr;
+        job->rkbuf->rkbuf_response = rkbuf;
+        rd_kafka_buf_keep(rkbuf);
+
+        job->rktp                = rd_kafka_toppar_keep(rktp);
+        job->tver                = tver;
+        job->aborted_txns        = aborted_txns;
+        job->fetch_pos           = rktp->rktp_offsets.fetch_pos;
+        job->fetch_msg_max_bytes = rktp->rktp_fetch_msg_max_bytes;
+        job->remainingp          = &batch->remaining;
+
+        /* Make sure enqueued ops get the correct serve/opaque reflecting
+         * the partition's fetch queue. */
+        rd_kafka_q_init(&job->rkq, rk);
+        job->rkq.rkq_serve  = rktp->rktp_fetchq->rkq_serve;
+        job->rkq.rkq_opaque = rktp->rktp_fetchq->rkq_opaque;
+
+        rd_list_add(&batch->jobs, job);
+
+        mtx_lock(&rk->rk_fetch_decode.lock);
+        batch->remaining++;
+        TAILQ_INSERT_TAIL(&rk->rk_fetch_decode.jobs, job, link);
+        cnd_signal(&rk->rk_fetch_decode.cnd);
+        mtx_unlock(&rk->rk_fetch_decode.lock);
+}
+
+
+/**
+ * @brief Wait for all of the batch's jobs to be decoded, decoding the
+ *        jobs not yet picked up by a worker on the current thread,
+ *        and then apply each job's result to its partition in order.
+ *
+ * @locality broker thread
+ */
+static void
+rd_kafka_fetch_decode_batch_complete(rd_kafka_broker_t *rkb,
+                                     rd_kafka_fetch_decode_batch_t *batch) {
+        rd_kafka_t *rk = rkb->rkb_rk;
+        rd_kafka_fetch_decode_job_t *job;
+        int i;
+
+        if (rd_list_empty(&batch->jobs))
+                return;
+
+        mtx_lock(&rk->rk_fetch_decode.lock);
+        while (batch->remaining > 0) {
+                /* Find one of our own jobs that is still pending */
+                TAILQ_FOREACH(job, &rk->rk_fetch_decode.jobs, link) {
+                        if (job->remainingp == &batch->remaining)
+                                break;
+                }
+
+                if (!job) {
+                        cnd_wait(&rk->rk_fetch_decode.done_cnd,
+                                 &rk->rk_fetch_decode.lock);
+                        continue;
+                }
+
+                TAILQ_REMOVE(&rk->rk_fetch_decode.jobs, job, link);
+                mtx_unlock(&rk->rk_fetch_decode.lock);
+
+                rd_kafka_fetch_decode_job_run(job);
+
+                mtx_lock(&rk->rk_fetch_decode.lock);
+                batch->remaining--;
+        }
+        mtx_unlock(&rk->rk_fetch_decode.lock);
+
+        rd_rkb_dbg(rkb, FETCH, "DECODE",
+                   "Decoded %d MessageSet(s) on decode worker pool",
+                   rd_list_cnt(&batch->jobs));
+
+        RD_LIST_FOREACH(job, &batch->jobs, i) {
+                rd_kafka_toppar_t *rktp = job->rktp;
+
+                /* Move the decoded messages to the partition's fetch queue
+                 * and update its fetch state, just as an inline parse
+                 * would have. */
+                if (rd_kafka_q_concat(rktp->rktp_fetchq, &job->rkq) != -1) {
+                        rktp->rktp_offsets.fetch_pos = job->fetch_pos;
+                        rktp->rktp_fetch_msg_max_bytes =
+                            job->fetch_msg_max_bytes;
+                }
+
+                rd_kafka_q_destroy_owner(&job->rkq);
+
+                /* On error: back off the fetcher for this partition */
+                if (unlikely(job->err))
+                        rd_kafka_toppar_fetch_backoff(rkb, rktp, job->err);
+
+                rd_kafka_toppar_destroy(rktp);
+        }
+
+}
+
+/**@}*/
+
+
 /**
  * @brief Per-partition FetchResponse parsing and handling.
  *
+ * If \p batch is non-NULL the MessageSet may be handed to the decode
+ * worker pool, in which case its messages are not enqueued until
+ * rd_kafka_fetch_decode_batch_complete() is called.
+ *
  * @returns an error on buffer parse failure, else RD_KAFKA_RESP_ERR_NO_ERROR.
  */
 static rd_kafka_resp_err_t
@@ -337,12 +974,14 @@ rd_kafka_fetch_reply_handle_partition(rd_kafka_broker_t *rkb,
                                       rd_kafka_topic_t *rkt /*possibly NULL*/,
                                       rd_kafka_buf_t *rkbuf,
                                       rd_kafka_buf_t *request,
-                                      int16_t ErrorCode) {
+                                      int16_t ErrorCode,
+                                      rd_kafka_fetch_decode_batch_t *batch) {
         const int log_decode_errors = LOG_ERR;
         struct rd_kafka_toppar_ver *tver, tver_skel;
         rd_kafka_toppar_t *rktp               = NULL;
         rd_kafka_aborted_txns_t *aborted_txns = NULL;
         rd_slice_t save_slice;
+        const void *msgset;
         int32_t fetch_version;
         struct {
                 int32_t Partition;
@@ -458,8 +1097,20 @@ rd_kafka_fetch_reply_handle_partition(rd_kafka_broker_t *rkb,
                 return RD_KAFKA_RESP_ERR_NO_ERROR;
         }
 
+        /* Look up the partition's fetch version and mark the partition
+         * as included in the response, see
+         * rd_kafka_fetch_reply_handle_omitted_partitions(). */
+        tver_skel.rktp = rktp;
+        tver           = rd_list_find(request->rkbuf_rktp_vers, &tver_skel,
+                            rd_kafka_toppar_ver_cmp);
+        if (tver)
+                tver->in_response = rd_true;
+
         rd_kafka_toppar_lock(rktp);
-        rktp->rktp_lo_offset = hdr.LogStartOffset;
+        /* Fetch < v5 does not return the log start offset, which is then
+         * kept up to date by consumer lag monitoring instead. */
+        if (hdr.LogStartOffset != RD_KAFKA_OFFSET_INVALID)
+                rktp->rktp_lo_offset = hdr.LogStartOffset;
         rktp->rktp_hi_offset = hdr.HighwaterMarkOffset;
         /* Let the LastStable offset be the effective
          * end_offset based on protocol version, that is:
@@ -516,9 +1167,6 @@ rd_kafka_fetch_reply_handle_partition(rd_kafka_broker_t *rkb,
          * created (due to partition count decreasing and
          * then increasing again, which can happen in
          * desynchronized clusters): if so ignore it. */
-        tver_skel.rktp = rktp;
-        tver           = rd_list_find(request->rkbuf_rktp_vers, &tver_skel,
-                            rd_kafka_toppar_ver_cmp);
         rd_kafka_assert(NULL, tver);
         if (tver->rktp != rktp || tver->version < fetch_version) {
                 rd_rkb_dbg(rkb, MSG, "DROP",
@@ -582,8 +1230,20 @@ rd_kafka_fetch_reply_handle_partition(rd_kafka_broker_t *rkb,
                                       (size_t)hdr.MessageSetSize))
                 rd_kafka_buf_check_len(rkbuf, hdr.MessageSetSize);
 
-        /* Parse messages */
-        err = rd_kafka_msgset_parse(rkbuf, request, rktp, aborted_txns, tver);
+        /* Parse messages, larger contiguous MessageSets are handed
+         * to the decode worker pool. */
+        if (batch && hdr.MessageSetSize >= RD_KAFKA_FETCH_DECODE_MIN_SIZE &&
+            (msgset = rd_slice_ensure_contig(&rkbuf->rkbuf_reader,
+                                             (size_t)hdr.MessageSetSize))) {
+                rd_kafka_fetch_decode_job_add(rkb, batch, rkbuf, msgset,
+                                              (size_t)hdr.MessageSetSize, rktp,
+                                              tver, aborted_txns);
+                aborted_txns = NULL; /* Owned by job */
+                err          = RD_KAFKA_RESP_ERR_NO_ERROR;
+        } else {
+                err = rd_kafka_msgset_parse(rkbuf, request, rktp, aborted_txns,
+                                            tver);
+        }
 
         if (aborted_txns)
                 rd_kafka_aborted_txns_destroy(aborted_txns);
@@ -607,6 +1267,57 @@ err_parse:
         return rkbuf->rkbuf_err;
 }
 
+/**
+ * @brief Handle the partitions of an incremental FetchRequest that were
+ *        omitted from the FetchResponse, meaning the partition has no new
+ *        data and its offsets are unchanged since its previous response.
+ *
+ * This emits the partition EOF event for partitions whose end was reached
+ * by the data in a previous response.
+ *
+ * @locality broker thread
+ */
+static void
+rd_kafka_fetch_reply_handle_omitted_partitions(rd_kafka_broker_t *rkb,
+                                               rd_kafka_buf_t *request) {
+        struct rd_kafka_toppar_ver *tver;
+        int i;
+
+        RD_LIST_FOREACH(tver, request->rkbuf_rktp_vers, i) {
+                rd_kafka_toppar_t *rktp = tver->rktp;
+                int32_t fetch_version;
+                int64_t end_offset, HighwaterMarkOffset;
+
+                if (tver->in_response)
+                        continue;
+
+                rd_kafka_toppar_lock(rktp);
+                if (unlikely(rktp->rktp_broker != rkb)) {
+                        rd_kafka_toppar_unlock(rktp);
+                        continue;
+                }
+                fetch_version       = rktp->rktp_fetch_version;
+                end_offset          = rktp->rktp_ls_offset;
+                HighwaterMarkOffset = rktp->rktp_hi_offset;
+                rd_kafka_toppar_unlock(rktp);
+
+                if (tver->version < fetch_version)
+                        continue; /* Outdated */
+
+                rktp->rktp_last_error = RD_KAFKA_RESP_ERR_NO_ERROR;
+
+                if (end_offset < 0 ||
+                    end_offset != rktp->rktp_offsets.fetch_pos.offset ||
+                    rktp->rktp_offsets.eof_offset == end_offset)
+                        continue;
+
+                rktp->rktp_offsets.eof_offset = end_offset;
+                rd_kafka_fetch_reply_handle_partition_error(
+                    rkb, rktp, tver, RD_KAFKA_RESP_ERR__PARTITION_EOF,
+                    HighwaterMarkOffset);
+        }
+}
+
 /**
  * Parses and handles a Fetch reply.
  * Returns 0 on success or an error code on failure.
@@ -620,6 +1331,8 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
         const int log_decode_errors = LOG_ERR;
         rd_kafka_topic_t *rkt       = NULL;
         int16_t ErrorCode           = RD_KAFKA_RESP_ERR_NO_ERROR;
+        rd_kafka_fetch_decode_batch_t batch_s,
+            *batch = NULL; /* Decode jobs, if pool is enabled */
 
         if (rd_kafka_buf_ApiVersion(request) >= 1) {
                 int32_t Throttle_Time;
@@ -633,6 +1346,25 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
                 int32_t SessionId;
                 rd_kafka_buf_read_i16(rkbuf, &ErrorCode);
                 rd_kafka_buf_read_i32(rkbuf, &SessionId);
+
+                if (request->rkbuf_u.Fetch.SessionEpoch != -1) {
+                        /* Fetch session errors are handled
+                         * by rd_kafka_broker_fetch_reply(). */
+                        if (ErrorCode ==
+                                RD_KAFKA_RESP_ERR_FETCH_SESSION_ID_NOT_FOUND ||
+                            ErrorCode ==
+                                RD_KAFKA_RESP_ERR_INVALID_FETCH_SESSION_EPOCH)
+                                return ErrorCode;
+
+                        if (ErrorCode)
+                                rd_kafka_broker_fetch_session_reset(
+                                    rkb, rd_false,
+                                    rd_kafka_err2str(ErrorCode));
+                        else
+                                rd_kafka_fetch_session_update(
+                                    rkb, request->rkbuf_u.Fetch.SessionEpoch,
+                                    SessionId);
+                }
         }
 
         rd_kafka_buf_read_i32(rkbuf, &TopicArrayCnt);
@@ -642,6 +1374,12 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
                                                 4 /*PartitionArrayCnt*/ + 4 +
                                                 2 + 8 + 4 /*inner header*/));
 
+        if (rkb->rkb_rk->rk_fetch_decode.thrd_cnt > 0) {
+                rd_list_init(&batch_s.jobs, 0, rd_free);
+                batch_s.remaining = 0;
+                batch             = &batch_s;
+        }
+
         for (i = 0; i < TopicArrayCnt; i++) {
                 rd_kafkap_str_t topic;
                 int32_t PartitionArrayCnt;
@@ -654,7 +1392,8 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
 
                 for (j = 0; j < PartitionArrayCnt; j++) {
                         if (rd_kafka_fetch_reply_handle_partition(
-                                rkb, &topic, rkt, rkbuf, request, ErrorCode))
+                                rkb, &topic, rkt, rkbuf, request, ErrorCode,
+                                batch))
                                 goto err_parse;
                 }
 
@@ -664,6 +1403,13 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
                 }
         }
 
+        if (batch) {
+                /* Enqueue the messages decoded by the worker pool */
+                rd_kafka_fetch_decode_batch_complete(rkb, batch);
+                rd_list_destroy(&batch->jobs);
+                batch = NULL;
+        }
+
         if (rd_kafka_buf_read_remain(rkbuf) != 0) {
                 rd_kafka_buf_parse_fail(rkbuf,
                                         "Remaining data after message set "
@@ -672,11 +1418,20 @@ rd_kafka_fetch_reply_handle(rd_kafka_broker_t *rkb,
                 RD_NOTREACHED();
         }
 
+        /* Partitions omitted from an incremental FetchResponse */
+        if (request->rkbuf_u.Fetch.SessionEpoch > 0 && !ErrorCode)
+                rd_kafka_fetch_reply_handle_omitted_partitions(rkb, request);
+
         return 0;
 
 err_parse:
         if (rkt)
                 rd_kafka_topic_destroy0(rkt);
+        if (batch) {
+                /* Partitions parsed prior to the error are still valid */
+                rd_kafka_fetch_decode_batch_complete(rkb, batch);
+                rd_list_destroy(&batch->jobs);
+        }
         rd_rkb_dbg(rkb, MSG, "BADMSG",
                    "Bad message (Fetch v%d): "
                    "is broker.version.fallback incorrectly set?",
@@ -698,21 +1453,43 @@ static void rd_kafka_broker_fetch_reply(rd_kafka_t *rk,
                                         rd_kafka_buf_t *request,
                                         void *opaque) {
 
+        if (request->rkbuf_u.Fetch.pipelined) {
+                /* Release the partitions for inclusion in
+                 * subsequent FetchRequests. */
+                struct rd_kafka_toppar_ver *tver;
+                int i;
+
+                RD_LIST_FOREACH(tver, request->rkbuf_rktp_vers, i) {
+                        rd_atomic32_sub(&tver->rktp->rktp_fetch_inflight, 1);
+                }
+        }
+
         if (err == RD_KAFKA_RESP_ERR__DESTROY)
                 return; /* Terminating */
 
         rd_kafka_assert(rkb->rkb_rk, rkb->rkb_fetching > 0);
-        rkb->rkb_fetching = 0;
+        rkb->rkb_fetching--;
 
         /* Parse and handle the messages (unless the request errored) */
-        if (!err && reply)
+        if (!err && reply) {
+                rd_kafka_fetch_rtt_update(rkb, request);
                 err = rd_kafka_fetch_reply_handle(rkb, reply, request);
+        }
 
         if (unlikely(err)) {
                 char tmp[128];
 
                 rd_rkb_dbg(rkb, MSG, "FETCH", "Fetch reply: %s",
                            rd_kafka_err2str(err));
+
+                /* The outcome of the request is unknown to the session,
+                 * start over with a full FetchRequest. */
+                if (request->rkbuf_u.Fetch.SessionEpoch != -1)
+                        rd_kafka_broker_fetch_session_reset(
+                            rkb,
+                            err == RD_KAFKA_RESP_ERR_FETCH_SESSION_ID_NOT_FOUND,
+                            rd_kafka_err2str(err));
+
                 switch (err) {
                 case RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART:
                 case RD_KAFKA_RESP_ERR_LEADER_NOT_AVAILABLE:
@@ -733,6 +1510,11 @@ static void rd_kafka_broker_fetch_reply(rd_kafka_t *rk,
                          * consumer_serve() so dont retry. */
                         break;
 
+                case RD_KAFKA_RESP_ERR_FETCH_SESSION_ID_NOT_FOUND:
+                case RD_KAFKA_RESP_ERR_INVALID_FETCH_SESSION_EPOCH:
+                        /* Retry immediately with a full FetchRequest. */
+                        return;
+
                 default:
                         break;
                 }
@@ -744,11 +1526,187 @@ static void rd_kafka_broker_fetch_reply(rd_kafka_t *rk,
 
 
 
+/**
+ * @brief Write the partitions that are no longer fetched from the broker to
+ *        the ForgottenTopics list of an incremental FetchRequest (if
+ *        \p rkbuf is non-NULL) and remove them from the fetch session.
+ *        Then add the \p new_toppars to the session.
+ *
+ * @locality broker thread
+ */
+static void rd_kafka_fetch_session_write_forgotten(rd_kafka_broker_t *rkb,
+                                                   rd_kafka_buf_t *rkbuf,
+                                                   rd_list_t *new_toppars) {
+        rd_list_t *toppars          = &rkb->rkb_fetch_session.toppars;
+        rd_kafka_topic_t *rkt_last  = NULL;
+        size_t of_TopicArrayCnt     = 0;
+        int TopicArrayCnt           = 0;
+        size_t of_PartitionArrayCnt = 0;
+        int PartitionArrayCnt       = 0;
+        rd_kafka_fetch_session_toppar_t *fstp;
+        int i;
+
+        if (rkbuf)
+                /* Write zero ForgottenTopicsCnt but store pointer for
+                 * later update */
+                of_TopicArrayCnt = rd_kafka_buf_write_i32(rkbuf, 0);
+
+        for (i = 0; i < rd_list_cnt(toppars); i++) {
+                fstp = rd_list_elem(toppars, i);
+
+                if (fstp->seen) {
+                        fstp->seen = rd_false;
+                        continue;
+                }
+
+                if (rkbuf) {
+                        if (rkt_last != fstp->rktp->rktp_rkt) {
+                                if (rkt_last != NULL)
+                                        rd_kafka_buf_update_i32(
+                                            rkbuf, of_PartitionArrayCnt,
+                                            PartitionArrayCnt);
+
+                                /* Topic name */
+                                rd_kafka_buf_write_kstr(
+                                    rkbuf, fstp->rktp->rktp_rkt->rkt_topic);
+                                TopicArrayCnt++;
+                                rkt_last = fstp->rktp->rktp_rkt;
+                                /* Partition count */
+                                of_PartitionArrayCnt =
+                                    rd_kafka_buf_write_i32(rkbuf, 0);
+                                PartitionArrayCnt = 0;
+                        }
+
+                        /* Partition */
+                        rd_kafka_buf_write_i32(rkbuf,
+                                               fstp->rktp->rktp_partition);
+                        PartitionArrayCnt++;
+
+                        rd_rkb_dbg(rkb, FETCH, "FETCHSESS",
+                                   "Removing %.*s [%" PRId32
+                                   "] from fetch session %" PRId32,
+                                   RD_KAFKAP_STR_PR(
+                                       fstp->rktp->rktp_rkt->rkt_topic),
+                                   fstp->rktp->rktp_partition,
+                                   rkb->rkb_fetch_session.id);
+                }
+
+                rd_list_remove_elem(toppars, i--);
+                rd_kafka_fetch_session_toppar_destroy(fstp);
+        }
+
+        if (rkbuf) {
+                if (rkt_last != NULL)
+                        rd_kafka_buf_update_i32(rkbuf, of_PartitionArrayCnt,
+                                                PartitionArrayCnt);
+                rd_kafka_buf_update_i32(rkbuf, of_TopicArrayCnt,
+                                        TopicArrayCnt);
+        }
+
+        /* Add new partitions to the session */
+        if (rd_list_cnt(new_toppars) > 0) {
+                RD_LIST_FOREACH(fstp, new_toppars, i) {
+                        fstp->seen = rd_false;
+                        rd_list_add(toppars, fstp);
+                }
+                rd_list_sort(toppars, rd_kafka_fetch_session_toppar_cmp);
+        }
+}
+
+
+/**
+ * @returns the fetch scheduling weight of the partition: its fetch
+ *          priority, multiplied by its consumer lag (in messages) with
+ *          fetch.scheduling=lag.
+ *
+ * @locality broker thread
+ */
+static double rd_kafka_toppar_fetch_weight(rd_kafka_toppar_t *rktp) {
+        rd_kafka_t *rk = rktp->rktp_rkt->rkt_rk;
+        double weight  = (double)rd_atomic32_get(&rktp->rktp_fetch_priority);
+        int64_t end_offset;
+
+        if (rk->rk_conf.fetch_scheduling != RD_KAFKA_FETCH_SCHEDULING_LAG)
+                return weight;
+
+        /* The end offsets are updated by the fetcher in this thread. */
+        end_offset = rk->rk_conf.isolation_level == RD_KAFKA_READ_COMMITTED
+                         ? rktp->rktp_ls_offset
+                         : rktp->rktp_hi_offset;
+
+        if (end_offset > rktp->rktp_offsets.fetch_pos.offset)
+                weight *= (double)(end_offset -
+                                   rktp->rktp_offsets.fetch_pos.offset + 1);
+
+        return weight;
+}
+
+
+/**
+ * @returns the MaxBytes to request for the partition: the configured
+ *          (or adapted) fetch.message.max.bytes, or with weighted
+ *          fetch.scheduling the partition's share of fetch.max.bytes
+ *          if that is larger, reduced to what is left of the partition's
+ *          share of the global prefetch budget.
+ *
+ * @param weight_sum The sum of the fetch weights of the broker's active
+ *                   partitions, or 0 for round-robin scheduling.
+ *
+ * The weighted share is rounded down to a power-of-two multiple of
+ * fetch.message.max.bytes, and the remaining prefetch share is rounded
+ * down to whole kilobytes, to avoid a slightly different MaxBytes on each
+ * request, which would defeat incremental fetch sessions.
+ *
+ * @locality broker thread
+ */
+static int32_t rd_kafka_toppar_fetch_max_bytes(rd_kafka_toppar_t *rktp,
+                                               double weight_sum) {
+        const rd_kafka_conf_t *conf = &rktp->rktp_rkt->rkt_rk->rk_conf;
+        int64_t max_bytes           = rktp->rktp_fetch_msg_max_bytes;
+        int64_t remaining;
+
+        if (weight_sum > 0.0) {
+                int64_t share = (int64_t)((double)conf->fetch_max_bytes *
+                                          rd_kafka_toppar_fetch_weight(rktp) /
+                                          weight_sum);
+
+                while (max_bytes * 2 <= share &&
+                       max_bytes * 2 <= conf->fetch_max_bytes)
+                        max_bytes *= 2;
+        }
+
+        if (likely(!conf->queued_max_total_bytes))
+                return (int32_t)max_bytes;
+
+        remaining = rd_kafka_toppar_prefetch_share(rktp) -
+                    rd_atomic64_get(&rktp->rktp_prefetch_bytes);
+        remaining = RD_MAX(remaining & ~(int64_t)1023, 1024);
+
+        return (int32_t)RD_MIN(remaining, max_bytes);
+}
+
+
 /**
  * @brief Build and send a Fetch request message for all underflowed toppars
  *        for a specific broker.
  *
- * @returns the number of partitions included in the FetchRequest, if any.
+ * If the broker supports incremental fetch sessions (KIP-227) only the
+ * partitions whose fetch state has changed since the previous request
+ * in the session are sent, along with the partitions removed from the
+ * session in the ForgottenTopics list.
+ *
+ * With fetch.pipeline.depth > 1 the request only includes partitions
+ * that are not already part of another in-flight FetchRequest, and at
+ * most a 1/depth share of the broker's active partitions so that the
+ * remaining partitions can be fetched by the next request in the
+ * pipeline.
+ *
+ * With fetch.scheduling=priority or lag, fetch.max.bytes is divided
+ * between the partitions in proportion to their fetch weight, and the
+ * request starts with the partition with the highest weight, unless it
+ * ties with the next partition in round-robin order.
+ *
+ * @returns the number of partitions fetched by the FetchRequest, if any.
  *
  * @locality broker thread
  */
@@ -762,6 +1720,12 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
         int PartitionArrayCnt       = 0;
         rd_kafka_topic_t *rkt_last  = NULL;
         int16_t ApiVersion          = 0;
+        int32_t SessionEpoch        = -1;
+        int PartitionSentCnt        = 0;
+        int pipeline_depth = rkb->rkb_rk->rk_conf.fetch_pipeline_depth;
+        int max_cnt        = INT_MAX;
+        double weight_sum  = 0.0;
+        rd_list_t new_toppars;
 
         /* Create buffer and segments:
          *   1 x ReplicaId MaxWaitTime MinBytes TopicArrayCnt
@@ -776,6 +1740,23 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
         if (unlikely(rkb->rkb_active_toppar_cnt == 0))
                 return 0;
 
+        if (pipeline_depth > 1 && rkb->rkb_fetching > 0) {
+                /* Don't build a FetchRequest unless at least one partition
+                 * is not already in an outstanding pipelined request. */
+                rd_bool_t fetchable = rd_false;
+
+                CIRCLEQ_FOREACH(rktp, &rkb->rkb_active_toppars,
+                                rktp_activelink) {
+                        if (rd_atomic32_get(&rktp->rktp_fetch_inflight) == 0) {
+                                fetchable = rd_true;
+                                break;
+                        }
+                }
+
+                if (!fetchable)
+                        return 0;
+        }
+
         rkbuf = rd_kafka_buf_new_request(
             rkb, RD_KAFKAP_Fetch, 1,
             /* ReplicaId+MaxWaitTime+MinBytes+MaxBytes+IsolationLevel+
@@ -802,6 +1783,18 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
                 rd_kafka_buf_ApiVersion_set(rkbuf, ApiVersion,
                                             RD_KAFKA_FEATURE_THROTTLETIME);
 
+        if (pipeline_depth > 1) {
+                /* Fetch sessions require each request to be based on
+                 * the outcome of the previous one, which is not the
+                 * case for pipelined requests. */
+                max_cnt = (rkb->rkb_active_toppar_cnt + pipeline_depth - 1) /
+                          pipeline_depth;
+                rkbuf->rkbuf_u.Fetch.pipelined = rd_true;
+
+        } else if (rd_kafka_buf_ApiVersion(rkbuf) >= 7 &&
+                   rkb->rkb_rk->rk_conf.enable_fetch_sessions)
+                SessionEpoch = rkb->rkb_fetch_session.epoch;
+        rkbuf->rkbuf_u.Fetch.SessionEpoch = SessionEpoch;
 
         /* FetchRequest header */
         /* ReplicaId */
@@ -811,10 +1804,23 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
         /* MinBytes */
         rd_kafka_buf_write_i32(rkbuf, rkb->rkb_rk->rk_conf.fetch_min_bytes);
 
-        if (rd_kafka_buf_ApiVersion(rkbuf) >= 3)
+        if (rd_kafka_buf_ApiVersion(rkbuf) >= 3) {
+                int32_t MaxBytes = rkb->rkb_rk->rk_conf.fetch_max_bytes;
+
+                if (rkb->rkb_rk->rk_conf.queued_max_total_bytes > 0) {
+                        /* Don't ask for more than what is left of the
+                         * global prefetch budget. */
+                        int64_t remaining =
+                            rkb->rkb_rk->rk_conf.queued_max_total_bytes -
+                            rd_atomic64_get(
+                                &rkb->rkb_rk->rk_consumer.prefetch.bytes);
+                        MaxBytes = (int32_t)RD_MAX(
+                            RD_MIN(remaining, (int64_t)MaxBytes), 1);
+                }
+
                 /* MaxBytes */
-                rd_kafka_buf_write_i32(rkbuf,
-                                       rkb->rkb_rk->rk_conf.fetch_max_bytes);
+                rd_kafka_buf_write_i32(rkbuf, MaxBytes);
+        }
 
         if (rd_kafka_buf_ApiVersion(rkbuf) >= 4)
                 /* IsolationLevel */
@@ -823,9 +1829,10 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
 
         if (rd_kafka_buf_ApiVersion(rkbuf) >= 7) {
                 /* SessionId */
-                rd_kafka_buf_write_i32(rkbuf, 0);
+                rd_kafka_buf_write_i32(
+                    rkbuf, SessionEpoch != -1 ? rkb->rkb_fetch_session.id : 0);
                 /* Epoch */
-                rd_kafka_buf_write_i32(rkbuf, -1);
+                rd_kafka_buf_write_i32(rkbuf, SessionEpoch);
         }
 
         /* Write zero TopicArrayCnt but store pointer for later update */
@@ -840,10 +1847,107 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
                                sizeof(struct rd_kafka_toppar_ver),
                                rkb->rkb_active_toppar_cnt, 0);
 
+        /* Partitions added to the fetch session by this request. */
+        rd_list_init(&new_toppars, 0, NULL);
+
+        if (rkb->rkb_rk->rk_conf.fetch_scheduling !=
+            RD_KAFKA_FETCH_SCHEDULING_ROUND_ROBIN) {
+                rd_kafka_toppar_t *heaviest = rkb->rkb_active_toppar_next;
+                double heaviest_weight = rd_kafka_toppar_fetch_weight(heaviest);
+
+                CIRCLEQ_FOREACH(rktp, &rkb->rkb_active_toppars,
+                                rktp_activelink) {
+                        double weight = rd_kafka_toppar_fetch_weight(rktp);
+
+                        weight_sum += weight;
+                        if (weight > heaviest_weight) {
+                                heaviest        = rktp;
+                                heaviest_weight = weight;
+                        }
+                }
+
+                /* The broker fills the response in request order
+                 * until fetch.max.bytes is reached. */
+                rd_kafka_broker_active_toppar_next(rkb, heaviest);
+        }
+
         /* Round-robin start of the list. */
         rktp = rkb->rkb_active_toppar_next;
         do {
                 struct rd_kafka_toppar_ver *tver;
+                int32_t CurrentLeaderEpoch = rktp->rktp_leader_epoch;
+                int32_t MaxBytes;
+
+                if (CurrentLeaderEpoch < 0 &&
+                    rd_kafka_has_reliable_leader_epochs(rkb)) {
+                        /* If current leader epoch is set to -1 and
+                         * the broker has reliable leader epochs,
+                         * send 0 instead, so that epoch is checked
+                         * and optionally metadata is refreshed.
+                         * This can happen if metadata is read initially
+                         * without an existing topic (see
+                         * rd_kafka_topic_metadata_update2).
+                         * TODO: have a private metadata struct that
+                         * stores leader epochs before topic creation.
+                         */
+                        CurrentLeaderEpoch = 0;
+                }
+
+                /* We must have a valid fetch offset when we get here */
+                rd_dassert(rktp->rktp_offsets.fetch_pos.offset >= 0);
+
+                if (rkbuf->rkbuf_u.Fetch.pipelined &&
+                    rd_atomic32_get(&rktp->rktp_fetch_inflight) > 0)
+                        continue; /* Already in an outstanding request */
+
+                /* Add toppar + op version mapping. */
+                tver          = rd_list_add(rkbuf->rkbuf_rktp_vers, NULL);
+                tver->rktp    = rd_kafka_toppar_keep(rktp);
+                tver->version = rktp->rktp_fetch_version;
+                tver->in_response = rd_false;
+
+                if (rkbuf->rkbuf_u.Fetch.pipelined)
+                        rd_atomic32_add(&rktp->rktp_fetch_inflight, 1);
+
+                cnt++;
+
+                MaxBytes = rd_kafka_toppar_fetch_max_bytes(rktp, weight_sum);
+
+                if (SessionEpoch != -1) {
+                        rd_kafka_fetch_session_toppar_t skel = {.rktp = rktp},
+                                                        *fstp;
+
+                        fstp = rd_list_find(&rkb->rkb_fetch_session.toppars,
+                                            &skel,
+                                            rd_kafka_fetch_session_toppar_cmp);
+                        if (!fstp) {
+                                fstp = rd_calloc(1, sizeof(*fstp));
+                                fstp->rktp = rd_kafka_toppar_keep(rktp);
+                                rd_list_add(&new_toppars, fstp);
+
+                        } else if (SessionEpoch > 0 && fstp->rktp == rktp &&
+                                   fstp->FetchOffset ==
+                                       rktp->rktp_offsets.fetch_pos.offset &&
+                                   fstp->CurrentLeaderEpoch ==
+                                       CurrentLeaderEpoch &&
+                                   fstp->MaxBytes == MaxBytes) {
+                                /* Unchanged since the last request in the
+                                 * session: don't send it. */
+                                fstp->seen = rd_true;
+                                continue;
+
+                        } else if (fstp->rktp != rktp) {
+                                /* Partition object was replaced */
+                                rd_kafka_toppar_destroy(fstp->rktp);
+                                fstp->rktp = rd_kafka_toppar_keep(rktp);
+                        }
+
+                        fstp->seen = rd_true;
+                        fstp->FetchOffset =
+                            rktp->rktp_offsets.fetch_pos.offset;
+                        fstp->CurrentLeaderEpoch = CurrentLeaderEpoch;
+                        fstp->MaxBytes           = MaxBytes;
+                }
 
                 if (rkt_last != rktp->rktp_rkt) {
                         if (rkt_last != NULL) {
@@ -864,30 +1968,14 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
                 }
 
                 PartitionArrayCnt++;
+                PartitionSentCnt++;
 
                 /* Partition */
                 rd_kafka_buf_write_i32(rkbuf, rktp->rktp_partition);
 
-                if (rd_kafka_buf_ApiVersion(rkbuf) >= 9) {
+                if (rd_kafka_buf_ApiVersion(rkbuf) >= 9)
                         /* CurrentLeaderEpoch */
-                        if (rktp->rktp_leader_epoch < 0 &&
-                            rd_kafka_has_reliable_leader_epochs(rkb)) {
-                                /* If current leader epoch is set to -1 and
-                                 * the broker has reliable leader epochs,
-                                 * send 0 instead, so that epoch is checked
-                                 * and optionally metadata is refreshed.
-                                 * This can happen if metadata is read initially
-                                 * without an existing topic (see
-                                 * rd_kafka_topic_metadata_update2).
-                                 * TODO: have a private metadata struct that
-                                 * stores leader epochs before topic creation.
-                                 */
-                                rd_kafka_buf_write_i32(rkbuf, 0);
-                        } else {
-                                rd_kafka_buf_write_i32(rkbuf,
-                                                       rktp->rktp_leader_epoch);
-                        }
-                }
+                        rd_kafka_buf_write_i32(rkbuf, CurrentLeaderEpoch);
 
                 /* FetchOffset */
                 rd_kafka_buf_write_i64(rkbuf,
@@ -898,27 +1986,24 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
                         rd_kafka_buf_write_i64(rkbuf, -1);
 
                 /* MaxBytes */
-                rd_kafka_buf_write_i32(rkbuf, rktp->rktp_fetch_msg_max_bytes);
+                rd_kafka_buf_write_i32(rkbuf, MaxBytes);
 
                 rd_rkb_dbg(rkb, FETCH, "FETCH",
                            "Fetch topic %.*s [%" PRId32 "] at offset %" PRId64
                            " (leader epoch %" PRId32
-                           ", current leader epoch %" PRId32 ", v%d)",
+                           ", current leader epoch %" PRId32
+                           ", v%d, MaxBytes %" PRId32 ")",
                            RD_KAFKAP_STR_PR(rktp->rktp_rkt->rkt_topic),
                            rktp->rktp_partition,
                            rktp->rktp_offsets.fetch_pos.offset,
                            rktp->rktp_offsets.fetch_pos.leader_epoch,
-                           rktp->rktp_leader_epoch, rktp->rktp_fetch_version);
-
-                /* We must have a valid fetch offset when we get here */
-                rd_dassert(rktp->rktp_offsets.fetch_pos.offset >= 0);
+                           rktp->rktp_leader_epoch, rktp->rktp_fetch_version,
+                           MaxBytes);
 
-                /* Add toppar + op version mapping. */
-                tver          = rd_list_add(rkbuf->rkbuf_rktp_vers, NULL);
-                tver->rktp    = rd_kafka_toppar_keep(rktp);
-                tver->version = rktp->rktp_fetch_version;
+                if (cnt == max_cnt)
+                        break; /* Leave the rest to the next pipelined
+                                * FetchRequest. */
 
-                cnt++;
         } while ((rktp = CIRCLEQ_LOOP_NEXT(&rkb->rkb_active_toppars, rktp,
                                            rktp_activelink)) !=
                  rkb->rkb_active_toppar_next);
@@ -929,9 +2014,12 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
                                           rktp_activelink)
                       : NULL);
 
-        rd_rkb_dbg(rkb, FETCH, "FETCH", "Fetch %i/%i/%i toppar(s)", cnt,
-                   rkb->rkb_active_toppar_cnt, rkb->rkb_toppar_cnt);
+        rd_rkb_dbg(rkb, FETCH, "FETCH",
+                   "Fetch %i/%i/%i toppar(s) (%d request(s) in flight)", cnt,
+                   rkb->rkb_active_toppar_cnt, rkb->rkb_toppar_cnt,
+                   rkb->rkb_fetching);
         if (!cnt) {
+                rd_list_destroy(&new_toppars);
                 rd_kafka_buf_destroy(rkbuf);
                 return cnt;
         }
@@ -946,11 +2034,30 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
         rd_kafka_buf_update_i32(rkbuf, of_TopicArrayCnt, TopicArrayCnt);
 
 
-        if (rd_kafka_buf_ApiVersion(rkbuf) >= 7)
-                /* Length of the ForgottenTopics list (KIP-227). Broker
-                 * use only - not used by the consumer. */
+        if (SessionEpoch != -1) {
+                int session_cnt = rd_list_cnt(&rkb->rkb_fetch_session.toppars);
+
+                /* ForgottenTopics list (KIP-227) for incremental requests,
+                 * a full request simply omits the partitions. */
+                if (SessionEpoch == 0)
+                        rd_kafka_buf_write_i32(rkbuf, 0);
+                rd_kafka_fetch_session_write_forgotten(
+                    rkb, SessionEpoch > 0 ? rkbuf : NULL, &new_toppars);
+
+                rd_rkb_dbg(rkb, FETCH, "FETCHSESS",
+                           "Fetch session %" PRId32 " epoch %" PRId32
+                           ": sending %d/%d partition(s), "
+                           "%d added, %d removed",
+                           rkb->rkb_fetch_session.id, SessionEpoch,
+                           PartitionSentCnt, cnt, rd_list_cnt(&new_toppars),
+                           session_cnt + rd_list_cnt(&new_toppars) - cnt);
+
+        } else if (rd_kafka_buf_ApiVersion(rkbuf) >= 7)
+                /* Length of the ForgottenTopics list (KIP-227). */
                 rd_kafka_buf_write_i32(rkbuf, 0);
 
+        rd_list_destroy(&new_toppars);
+
         if (rd_kafka_buf_ApiVersion(rkbuf) >= 11)
                 /* RackId */
                 rd_kafka_buf_write_kstr(rkbuf,
@@ -969,7 +2076,7 @@ int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now) {
         /* Sort toppar versions for quicker lookups in Fetch response. */
         rd_list_sort(rkbuf->rkbuf_rktp_vers, rd_kafka_toppar_ver_cmp);
 
-        rkb->rkb_fetching = 1;
+        rkb->rkb_fetching++;
         rd_kafka_broker_buf_enq1(rkb, rkbuf, rd_kafka_broker_fetch_reply, NULL);
 
         return cnt;
@@ -1025,12 +2132,41 @@ rd_ts_t rd_kafka_toppar_fetch_decide(rd_kafka_toppar_t *rktp,
         if (lease_expired) {
                 /* delete_to_leader() requires no locks to be held */
                 rd_kafka_toppar_unlock(rktp);
-                rd_kafka_toppar_delegate_to_leader(rktp);
+                if (rkb->rkb_rk->rk_conf.fetch_replica_selection ==
+                    RD_KAFKA_FETCH_REPLICA_SELECTION_CLIENT)
+                        should_fetch =
+                            !rd_kafka_fetch_replica_select_apply(rktp, rkb);
+                else {
+                        rd_kafka_toppar_delegate_to_leader(rktp);
+                        should_fetch = 0;
+                }
                 rd_kafka_toppar_lock(rktp);
 
-                reason       = "preferred replica lease expired";
-                should_fetch = 0;
-                goto done;
+                if (!should_fetch) {
+                        reason = "preferred replica lease expired";
+                        goto done;
+                }
+        }
+
+        /* Client-side replica selection for partitions fetched from
+         * the leader. */
+        if (rkb->rkb_rk->rk_conf.fetch_replica_selection ==
+                RD_KAFKA_FETCH_REPLICA_SELECTION_CLIENT &&
+            !force_remove && rktp->rktp_leader_id == rktp->rktp_broker_id &&
+            rktp->rktp_fetch_state == RD_KAFKA_TOPPAR_FETCH_ACTIVE &&
+            rd_interval(&rktp->rktp_replica_select_intvl,
+                        60 * 1000 * 1000 /*1 minute*/, 0) > 0) {
+                rd_bool_t changed;
+
+                rd_kafka_toppar_unlock(rktp);
+                changed = rd_kafka_fetch_replica_select_apply(rktp, rkb);
+                rd_kafka_toppar_lock(rktp);
+
+                if (changed) {
+                        reason       = "client-side replica selection";
+                        should_fetch = 0;
+                        goto done;
+                }
         }
 
         /* Forced removal from fetch list */
@@ -1112,6 +2248,16 @@ rd_ts_t rd_kafka_toppar_fetch_decide(rd_kafka_toppar_t *rktp,
                 reason       = "queued.max.messages.kbytes exceeded";
                 should_fetch = 0;
 
+        } else if (rkb->rkb_rk->rk_conf.queued_max_total_bytes > 0 &&
+                   rd_atomic64_get(&rktp->rktp_prefetch_bytes) >=
+                       rd_kafka_toppar_prefetch_share(rktp)) {
+                /* Each partition is limited to its share of the global
+                 * budget, rather than the budget as a whole, so that
+                 * partitions the application is not currently consuming
+                 * can't starve the others. */
+                reason = "share of queued.max.messages.total.kbytes exceeded";
+                should_fetch = 0;
+
         } else if (rktp->rktp_ts_fetch_backoff > rd_clock()) {
                 reason       = "fetch backed off";
                 ts_backoff   = rktp->rktp_ts_fetch_backoff;
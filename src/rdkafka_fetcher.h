@@ -31,6 +31,12 @@
 #define _RDKAFKA_FETCHER_H_
 
 
+void rd_kafka_broker_fetch_session_init(rd_kafka_broker_t *rkb);
+void rd_kafka_broker_fetch_session_destroy(rd_kafka_broker_t *rkb);
+void rd_kafka_broker_fetch_session_reset(rd_kafka_broker_t *rkb,
+                                         rd_bool_t forget_id,
+                                         const char *reason);
+
 int rd_kafka_broker_fetch_toppars(rd_kafka_broker_t *rkb, rd_ts_t now);
 
 rd_bool_t rd_kafka_toppar_fetch_decide_start_from_next_fetch_start(
@@ -40,5 +46,8 @@ rd_ts_t rd_kafka_toppar_fetch_decide(rd_kafka_toppar_t *rktp,
                                      rd_kafka_broker_t *rkb,
                                      int force_remove);
 
+void rd_kafka_fetch_decode_pool_init(rd_kafka_t *rk);
+void rd_kafka_fetch_decode_pool_term(rd_kafka_t *rk);
+
 
 #endif /* _RDKAFKA_FETCHER_H_ */
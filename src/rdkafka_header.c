@@ -28,6 +28,7 @@
 
 #include "rdkafka_int.h"
 #include "rdkafka_header.h"
+#include "rdunittest.h"
 
 
 
@@ -35,6 +36,8 @@
 
 void rd_kafka_headers_destroy(rd_kafka_headers_t *hdrs) {
         rd_list_destroy(&hdrs->rkhdrs_list);
+        if (hdrs->rkhdrs_ser_buf)
+                rd_free(hdrs->rkhdrs_ser_buf);
         rd_free(hdrs);
 }
 
@@ -44,7 +47,9 @@ rd_kafka_headers_t *rd_kafka_headers_new(size_t initial_count) {
         hdrs = rd_malloc(sizeof(*hdrs));
         rd_list_init(&hdrs->rkhdrs_list, (int)initial_count,
                      rd_kafka_header_destroy);
-        hdrs->rkhdrs_ser_size = 0;
+        hdrs->rkhdrs_ser_size     = 0;
+        hdrs->rkhdrs_ser_buf      = NULL;
+        hdrs->rkhdrs_unparsed_cnt = 0;
 
         return hdrs;
 }
@@ -61,10 +66,23 @@ static void *rd_kafka_header_copy(const void *_src, void *opaque) {
 rd_kafka_headers_t *rd_kafka_headers_copy(const rd_kafka_headers_t *src) {
         rd_kafka_headers_t *dst;
 
+        /* Unparsed headers are copied in their wire-format */
+        if (src->rkhdrs_unparsed_cnt > 0) {
+                dst = rd_kafka_headers_new(0);
+                dst->rkhdrs_ser_buf = rd_malloc(src->rkhdrs_ser_size);
+                memcpy(dst->rkhdrs_ser_buf, src->rkhdrs_ser_buf,
+                       src->rkhdrs_ser_size);
+                dst->rkhdrs_ser_size     = src->rkhdrs_ser_size;
+                dst->rkhdrs_unparsed_cnt = src->rkhdrs_unparsed_cnt;
+                return dst;
+        }
+
         dst = rd_malloc(sizeof(*dst));
         rd_list_init(&dst->rkhdrs_list, rd_list_cnt(&src->rkhdrs_list),
                      rd_kafka_header_destroy);
-        dst->rkhdrs_ser_size = 0; /* Updated by header_copy() */
+        dst->rkhdrs_ser_size     = 0; /* Updated by header_copy() */
+        dst->rkhdrs_ser_buf      = NULL;
+        dst->rkhdrs_unparsed_cnt = 0;
         rd_list_copy_to(&dst->rkhdrs_list, &src->rkhdrs_list,
                         rd_kafka_header_copy, dst);
 
@@ -73,6 +91,177 @@ rd_kafka_headers_t *rd_kafka_headers_copy(const rd_kafka_headers_t *src) {
 
 
 
+/**
+ * @brief Decode the wire-format header at \p *pp, not extending past \p end,
+ *        and advance \p *pp past it.
+ *
+ * \p *Valuep is set to NULL for null values.
+ *
+ * @returns false if the header is malformed.
+ */
+static rd_bool_t rd_kafka_header_wire_next(const char **pp,
+                                           const char *end,
+                                           const char **Keyp,
+                                           int64_t *KeyLenp,
+                                           const char **Valuep,
+                                           int64_t *ValueLenp) {
+        const char *p = *pp;
+        size_t r;
+
+        r = rd_varint_dec_i64(p, (size_t)(end - p), KeyLenp);
+        if (RD_UVARINT_DEC_FAILED(r) || *KeyLenp < 0 ||
+            *KeyLenp > (int64_t)(end - p - r))
+                return rd_false;
+        p += r;
+        *Keyp = p;
+        p += *KeyLenp;
+
+        r = rd_varint_dec_i64(p, (size_t)(end - p), ValueLenp);
+        if (RD_UVARINT_DEC_FAILED(r) || *ValueLenp < -1 ||
+            *ValueLenp > (int64_t)(end - p - r))
+                return rd_false;
+        p += r;
+        *Valuep = NULL;
+        if (*ValueLenp != -1) {
+                *Valuep = p;
+                p += *ValueLenp;
+        }
+
+        *pp = p;
+        return rd_true;
+}
+
+
+rd_kafka_headers_t *rd_kafka_headers_new_from_wire(const void *buf,
+                                                   size_t size) {
+        rd_kafka_headers_t *hdrs;
+        const char *p   = buf;
+        const char *end = p + size;
+        int cnt         = 0;
+
+        /* Only validate and count the headers here: they are parsed
+         * on first access, see rd_kafka_headers_parse(). */
+        while (p < end) {
+                const char *Key, *Value;
+                int64_t KeyLen, ValueLen;
+
+                if (!rd_kafka_header_wire_next(&p, end, &Key, &KeyLen, &Value,
+                                               &ValueLen))
+                        return NULL;
+                cnt++;
+        }
+
+        hdrs = rd_kafka_headers_new(0);
+
+        if (cnt > 0) {
+                hdrs->rkhdrs_ser_buf = rd_malloc(size);
+                memcpy(hdrs->rkhdrs_ser_buf, buf, size);
+                hdrs->rkhdrs_ser_size     = size;
+                hdrs->rkhdrs_unparsed_cnt = cnt;
+        }
+
+        return hdrs;
+}
+
+
+/**
+ * @brief Parse the headers of a list created with
+ *        rd_kafka_headers_new_from_wire() into the headers list.
+ *        Must be called before accessing the headers list.
+ *
+ * The wire-format is retained as the serialized cache, unless it uses
+ * non-minimal varint encodings, in which case the headers will be
+ * re-serialized when written.
+ */
+void rd_kafka_headers_parse(rd_kafka_headers_t *hdrs) {
+        char *buf   = hdrs->rkhdrs_ser_buf;
+        size_t size = hdrs->rkhdrs_ser_size;
+        const char *p, *end;
+
+        if (likely(hdrs->rkhdrs_unparsed_cnt == 0))
+                return;
+
+        hdrs->rkhdrs_unparsed_cnt = 0;
+        hdrs->rkhdrs_ser_buf      = NULL;
+        hdrs->rkhdrs_ser_size     = 0; /* Updated by header_add() */
+
+        for (p = buf, end = buf + size; p < end;) {
+                const char *Key, *Value;
+                int64_t KeyLen, ValueLen;
+                rd_bool_t ok;
+
+                /* Validated by rd_kafka_headers_new_from_wire() */
+                ok = rd_kafka_header_wire_next(&p, end, &Key, &KeyLen, &Value,
+                                               &ValueLen);
+                rd_assert(ok);
+
+                rd_kafka_header_add(hdrs, Key, (ssize_t)KeyLen, Value,
+                                    Value ? (ssize_t)ValueLen : 0);
+        }
+
+        if (hdrs->rkhdrs_ser_size == size)
+                hdrs->rkhdrs_ser_buf = buf;
+        else
+                rd_free(buf);
+}
+
+
+/**
+ * @brief Invalidate the serialized headers cache, must be called
+ *        whenever the headers list is modified.
+ */
+void rd_kafka_headers_invalidate(rd_kafka_headers_t *hdrs) {
+        /* The cache is the only copy of unparsed headers */
+        rd_kafka_headers_parse(hdrs);
+
+        if (hdrs->rkhdrs_ser_buf) {
+                rd_free(hdrs->rkhdrs_ser_buf);
+                hdrs->rkhdrs_ser_buf = NULL;
+        }
+}
+
+
+/**
+ * @brief Serialize the headers to their wire-format (the MsgVersion 2
+ *        Headers array, without the HeaderCount) and cache the result
+ *        on the headers list, so that the headers are only encoded once
+ *        regardless of how many times the message is written, e.g.,
+ *        when a message batch is rebuilt for a retry.
+ *
+ * @returns a pointer to the rkhdrs_ser_size bytes of serialized headers,
+ *          valid until the headers are modified or destroyed.
+ */
+const char *rd_kafka_headers_serialize(rd_kafka_headers_t *hdrs) {
+        const rd_kafka_header_t *hdr;
+        char *p;
+        int i;
+
+        if (hdrs->rkhdrs_ser_buf)
+                return hdrs->rkhdrs_ser_buf;
+
+        p = hdrs->rkhdrs_ser_buf =
+            rd_malloc(hdrs->rkhdrs_ser_size > 0 ? hdrs->rkhdrs_ser_size : 1);
+
+        RD_LIST_FOREACH(hdr, &hdrs->rkhdrs_list, i) {
+                p += rd_uvarint_enc_i64(p, RD_UVARINT_ENC_SIZEOF(int64_t),
+                                        (int64_t)hdr->rkhdr_name_size);
+                memcpy(p, hdr->rkhdr_name, hdr->rkhdr_name_size);
+                p += hdr->rkhdr_name_size;
+                p += rd_uvarint_enc_i64(
+                    p, RD_UVARINT_ENC_SIZEOF(int64_t),
+                    hdr->rkhdr_value ? (int64_t)hdr->rkhdr_value_size : -1);
+                if (hdr->rkhdr_value) {
+                        memcpy(p, hdr->rkhdr_value, hdr->rkhdr_value_size);
+                        p += hdr->rkhdr_value_size;
+                }
+        }
+
+        rd_assert((size_t)(p - hdrs->rkhdrs_ser_buf) == hdrs->rkhdrs_ser_size);
+
+        return hdrs->rkhdrs_ser_buf;
+}
+
+
 rd_kafka_resp_err_t rd_kafka_header_add(rd_kafka_headers_t *hdrs,
                                         const char *name,
                                         ssize_t name_size,
@@ -82,6 +271,8 @@ rd_kafka_resp_err_t rd_kafka_header_add(rd_kafka_headers_t *hdrs,
         char varint_NameLen[RD_UVARINT_ENC_SIZEOF(int32_t)];
         char varint_ValueLen[RD_UVARINT_ENC_SIZEOF(int32_t)];
 
+        rd_kafka_headers_invalidate(hdrs);
+
         if (name_size == -1)
                 name_size = strlen(name);
 
@@ -135,6 +326,8 @@ rd_kafka_resp_err_t rd_kafka_header_remove(rd_kafka_headers_t *hdrs,
         rd_kafka_header_t *hdr;
         int i;
 
+        rd_kafka_headers_parse(hdrs);
+
         RD_LIST_FOREACH_REVERSE(hdr, &hdrs->rkhdrs_list, i) {
                 if (rd_kafka_header_cmp_str(hdr, (void *)name))
                         continue;
@@ -147,6 +340,8 @@ rd_kafka_resp_err_t rd_kafka_header_remove(rd_kafka_headers_t *hdrs,
         if (ser_size == 0)
                 return RD_KAFKA_RESP_ERR__NOENT;
 
+        rd_kafka_headers_invalidate(hdrs);
+
         rd_dassert(hdrs->rkhdrs_ser_size >= ser_size);
         hdrs->rkhdrs_ser_size -= ser_size;
 
@@ -161,6 +356,10 @@ rd_kafka_resp_err_t rd_kafka_header_get_last(const rd_kafka_headers_t *hdrs,
         int i;
         size_t name_size = strlen(name);
 
+        /* Parsing unparsed headers on first access does not change
+         * the headers themselves. */
+        rd_kafka_headers_parse((rd_kafka_headers_t *)hdrs);
+
         RD_LIST_FOREACH_REVERSE(hdr, &hdrs->rkhdrs_list, i) {
                 if (hdr->rkhdr_name_size == name_size &&
                     !strcmp(hdr->rkhdr_name, name)) {
@@ -184,6 +383,8 @@ rd_kafka_resp_err_t rd_kafka_header_get(const rd_kafka_headers_t *hdrs,
         size_t mi        = 0; /* index for matching names */
         size_t name_size = strlen(name);
 
+        rd_kafka_headers_parse((rd_kafka_headers_t *)hdrs);
+
         RD_LIST_FOREACH(hdr, &hdrs->rkhdrs_list, i) {
                 if (hdr->rkhdr_name_size == name_size &&
                     !strcmp(hdr->rkhdr_name, name) && mi++ == idx) {
@@ -204,6 +405,8 @@ rd_kafka_resp_err_t rd_kafka_header_get_all(const rd_kafka_headers_t *hdrs,
                                             size_t *sizep) {
         const rd_kafka_header_t *hdr;
 
+        rd_kafka_headers_parse((rd_kafka_headers_t *)hdrs);
+
         hdr = rd_list_elem(&hdrs->rkhdrs_list, (int)idx);
         if (unlikely(!hdr))
                 return RD_KAFKA_RESP_ERR__NOENT;
@@ -216,5 +419,145 @@ rd_kafka_resp_err_t rd_kafka_header_get_all(const rd_kafka_headers_t *hdrs,
 
 
 size_t rd_kafka_header_cnt(const rd_kafka_headers_t *hdrs) {
-        return (size_t)rd_list_cnt(&hdrs->rkhdrs_list);
+        return (size_t)(rd_list_cnt(&hdrs->rkhdrs_list) +
+                        hdrs->rkhdrs_unparsed_cnt);
+}
+
+
+
+/**
+ * @name Unit tests
+ * @{
+ */
+
+/**
+ * @brief Verify that headers serialized to the wire-format can be parsed
+ *        back with rd_kafka_headers_new_from_wire() on first access, and
+ *        that the serialized cache is invalidated when the headers are
+ *        modified.
+ */
+static int unittest_headers_wire(void) {
+        rd_kafka_headers_t *hdrs, *hdrs2;
+        const char *ser;
+        char *ser_copy;
+        size_t ser_size;
+        const char *name;
+        const void *value;
+        size_t size;
+        /* Truncated: ValueLength 3 but only 2 bytes of value */
+        static const char bad[] = {2 /*KeyLen 1*/, 'a', 6 /*ValueLen 3*/,
+                                   'b', 'c'};
+        /* Non-minimal varint encoding of KeyLength 1 */
+        static const char nonmin[] = {(char)0x82, 0x00, 'a', 1 /*null*/};
+
+        hdrs = rd_kafka_headers_new(0);
+        rd_kafka_header_add(hdrs, "traceparent", -1,
+                            "00-0af7651916cd43dd8448eb211c80319c-"
+                            "b7ad6b7169203331-01",
+                            -1);
+        rd_kafka_header_add(hdrs, "null", -1, NULL, 0);
+        rd_kafka_header_add(hdrs, "empty", -1, "", 0);
+
+        ser = rd_kafka_headers_serialize(hdrs);
+        RD_UT_ASSERT(ser == hdrs->rkhdrs_ser_buf,
+                     "expected serialized headers to be cached");
+        RD_UT_ASSERT(rd_kafka_headers_serialize(hdrs) == ser,
+                     "expected cached serialized headers to be reused");
+
+        ser_size = hdrs->rkhdrs_ser_size;
+        ser_copy = rd_malloc(ser_size);
+        memcpy(ser_copy, ser, ser_size);
+
+        /* Parse the wire-format */
+        hdrs2 = rd_kafka_headers_new_from_wire(ser_copy, ser_size);
+        RD_UT_ASSERT(hdrs2, "failed to parse serialized headers");
+        RD_UT_ASSERT(rd_list_cnt(&hdrs2->rkhdrs_list) == 0 &&
+                         hdrs2->rkhdrs_unparsed_cnt == 3,
+                     "expected headers to be left unparsed");
+        RD_UT_ASSERT(rd_kafka_header_cnt(hdrs2) == 3,
+                     "expected 3 headers, not %" PRIusz,
+                     rd_kafka_header_cnt(hdrs2));
+        RD_UT_ASSERT(hdrs2->rkhdrs_ser_size == ser_size,
+                     "expected serialized size %" PRIusz ", not %" PRIusz,
+                     ser_size, hdrs2->rkhdrs_ser_size);
+        RD_UT_ASSERT(hdrs2->rkhdrs_ser_buf != NULL,
+                     "expected wire-format to be retained as cache");
+        RD_UT_ASSERT(!memcmp(rd_kafka_headers_serialize(hdrs2), ser_copy,
+                             ser_size),
+                     "serialized headers mismatch");
+
+        RD_UT_ASSERT(!rd_kafka_header_get_all(hdrs2, 1, &name, &value, &size),
+                     "expected header #1");
+        RD_UT_ASSERT(hdrs2->rkhdrs_unparsed_cnt == 0 &&
+                         rd_list_cnt(&hdrs2->rkhdrs_list) == 3,
+                     "expected headers to be parsed on access");
+        RD_UT_ASSERT(hdrs2->rkhdrs_ser_buf != NULL &&
+                         hdrs2->rkhdrs_ser_size == ser_size,
+                     "expected wire-format to be retained as cache "
+                     "after parsing");
+        RD_UT_ASSERT(!strcmp(name, "null") && !value && size == 0,
+                     "expected null value for header %s", name);
+        RD_UT_ASSERT(!rd_kafka_header_get_all(hdrs2, 2, &name, &value, &size),
+                     "expected header #2");
+        RD_UT_ASSERT(!strcmp(name, "empty") && value && size == 0,
+                     "expected empty value for header %s", name);
+
+        /* Modifications must invalidate the cache */
+        RD_UT_ASSERT(!rd_kafka_header_remove(hdrs, "null"),
+                     "expected header to be removed");
+        RD_UT_ASSERT(!hdrs->rkhdrs_ser_buf,
+                     "expected cache to be invalidated by remove");
+        rd_kafka_header_remove(hdrs2, "null");
+        RD_UT_ASSERT(!hdrs2->rkhdrs_ser_buf,
+                     "expected cache to be invalidated by remove");
+        RD_UT_ASSERT(hdrs->rkhdrs_ser_size == hdrs2->rkhdrs_ser_size &&
+                         !memcmp(rd_kafka_headers_serialize(hdrs),
+                                 rd_kafka_headers_serialize(hdrs2),
+                                 hdrs->rkhdrs_ser_size),
+                     "serialized headers mismatch after remove");
+
+        rd_kafka_header_add(hdrs, "added", -1, "value", -1);
+        RD_UT_ASSERT(!hdrs->rkhdrs_ser_buf,
+                     "expected cache to be invalidated by add");
+        ser = rd_kafka_headers_serialize(hdrs);
+        RD_UT_ASSERT(ser[hdrs->rkhdrs_ser_size - 6] == 10 /*ValueLen 5*/ &&
+                         !memcmp(&ser[hdrs->rkhdrs_ser_size - 5], "value", 5),
+                     "added header not serialized");
+
+        rd_kafka_headers_destroy(hdrs2);
+        rd_kafka_headers_destroy(hdrs);
+        rd_free(ser_copy);
+
+        /* Malformed wire-format */
+        hdrs = rd_kafka_headers_new_from_wire(bad, sizeof(bad));
+        RD_UT_ASSERT(!hdrs, "expected truncated headers to fail parsing");
+
+        /* Valid but non-minimal encoding is not retained as cache */
+        hdrs = rd_kafka_headers_new_from_wire(nonmin, sizeof(nonmin));
+        RD_UT_ASSERT(hdrs, "failed to parse non-minimal encoding");
+        RD_UT_ASSERT(!rd_kafka_header_get_last(hdrs, "a", &value, &size) &&
+                         !value,
+                     "expected null header \"a\"");
+        RD_UT_ASSERT(rd_kafka_header_cnt(hdrs) == 1 && !hdrs->rkhdrs_ser_buf,
+                     "expected 1 header and no cache");
+        rd_kafka_headers_destroy(hdrs);
+
+        /* Empty */
+        hdrs = rd_kafka_headers_new_from_wire(NULL, 0);
+        RD_UT_ASSERT(hdrs && rd_kafka_header_cnt(hdrs) == 0,
+                     "expected empty headers list");
+        rd_kafka_headers_destroy(hdrs);
+
+        RD_UT_PASS();
 }
+
+
+int unittest_headers(void) {
+        int fails = 0;
+
+        fails += unittest_headers_wire();
+
+        return fails;
+}
+
+/**@}*/
@@ -38,6 +38,15 @@
 struct rd_kafka_headers_s {
         rd_list_t rkhdrs_list;  /**< List of (rd_kafka_header_t *) */
         size_t rkhdrs_ser_size; /**< Total serialized size of headers */
+        char *rkhdrs_ser_buf;   /**< Cached serialized (wire-format) headers
+                                 *   of rkhdrs_ser_size bytes, or NULL if
+                                 *   not yet serialized.
+                                 *   Invalidated when the list is modified.
+                                 *   @sa rd_kafka_headers_serialize() */
+        int rkhdrs_unparsed_cnt; /**< Number of headers in rkhdrs_ser_buf
+                                  *   that are not yet parsed into
+                                  *   rkhdrs_list, else 0.
+                                  *   @sa rd_kafka_headers_parse() */
 };
 
 
@@ -73,4 +82,35 @@ rd_kafka_headers_serialized_size(const rd_kafka_headers_t *hdrs) {
         return hdrs->rkhdrs_ser_size;
 }
 
+
+/**
+ * @returns an upper bound of the memory currently used by the headers list,
+ *          including the list itself and the serialized headers cache,
+ *          if allocated.
+ *
+ * @remark The serialized size is used as an upper bound of the header name
+ *         and value allocations (including nul-terminators) since it
+ *         includes at least two bytes of length varints per header.
+ */
+static RD_INLINE RD_UNUSED size_t
+rd_kafka_headers_mem_size(const rd_kafka_headers_t *hdrs) {
+        size_t size = sizeof(*hdrs) +
+                      ((size_t)hdrs->rkhdrs_list.rl_size * sizeof(void *));
+
+        if (rd_list_cnt(&hdrs->rkhdrs_list) > 0)
+                size += ((size_t)rd_list_cnt(&hdrs->rkhdrs_list) *
+                         sizeof(rd_kafka_header_t)) +
+                        hdrs->rkhdrs_ser_size;
+
+        if (hdrs->rkhdrs_ser_buf)
+                size += hdrs->rkhdrs_ser_size;
+
+        return size;
+}
+
+
+void rd_kafka_headers_parse(rd_kafka_headers_t *hdrs);
+void rd_kafka_headers_invalidate(rd_kafka_headers_t *hdrs);
+const char *rd_kafka_headers_serialize(rd_kafka_headers_t *hdrs);
+
 #endif /* _RDKAFKA_HEADER_H */
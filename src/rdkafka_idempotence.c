@@ -774,6 +774,7 @@ void rd_kafka_idemp_init(rd_kafka_t *rk) {
 
         rd_atomic32_init(&rk->rk_eos.inflight_toppar_cnt, 0);
         rd_kafka_pid_reset(&rk->rk_eos.pid);
+        rk->rk_eos.ts_txn_state = rd_clock();
 
         /* The transactional producer acquires the PID
          * from init_transactions(), for non-transactional producers
@@ -206,7 +206,8 @@ typedef enum {
         /**< An abortable error has occurred. */
         RD_KAFKA_TXN_STATE_ABORTABLE_ERROR,
         /* A fatal error has occured. */
-        RD_KAFKA_TXN_STATE_FATAL_ERROR
+        RD_KAFKA_TXN_STATE_FATAL_ERROR,
+        RD_KAFKA_TXN_STATE__CNT /**< Number of states */
 } rd_kafka_txn_state_t;
 
 
@@ -473,6 +474,16 @@ struct rd_kafka_s {
                 /**< Timer to trigger registration of pending partitions */
                 rd_kafka_timer_t txn_register_parts_tmr;
 
+                /**< Accumulated time spent in each txn_state (microseconds).
+                 *   @locks rk_lock */
+                rd_ts_t txn_state_time[RD_KAFKA_TXN_STATE__CNT];
+
+                /**< Number of AddPartitionsToTxn responses received and
+                 *   their accumulated round-trip time (microseconds).
+                 *   @locality rdkafka main thread */
+                int64_t txn_addparts_cnt;
+                rd_ts_t txn_addparts_rtt;
+
                 /**< Lock for txn_pending_rktps and txn_waitresp_rktps */
                 mtx_t txn_pending_lock;
 
@@ -523,8 +534,35 @@ struct rd_kafka_s {
                 rd_kafka_assignment_t assignment;
                 /** Waiting for this number of commits to finish. */
                 int wait_commit_cnt;
+                /** Global prefetch budget
+                 *  (queued.max.messages.total.kbytes).
+                 *  @locality any */
+                struct {
+                        /** Payload bytes of fetched messages not yet
+                         *  destroyed, across all partitions. */
+                        rd_atomic64_t bytes;
+                        /** Number of partitions being consumed
+                         *  (fetch state started), used to compute each
+                         *  partition's fair share of the budget. */
+                        rd_atomic32_t toppar_cnt;
+                } prefetch;
         } rk_consumer;
 
+        /**< Fetch response decode worker pool (fetch.decode.threads),
+         *   see rdkafka_fetcher.c.
+         *   Only set up for consumers with fetch.decode.threads > 0. */
+        struct {
+                mtx_t lock;     /**< Protects jobs, terminate and
+                                 *   the jobs' remaining counts. */
+                cnd_t cnd;      /**< Signalled on new job or termination */
+                cnd_t done_cnd; /**< Signalled when a job is decoded */
+                TAILQ_HEAD(, rd_kafka_fetch_decode_job_s)
+                jobs;               /**< Jobs not yet picked up */
+                thrd_t *thrds;      /**< Worker threads */
+                int thrd_cnt;       /**< Number of running threads */
+                rd_bool_t terminate; /**< Workers should exit */
+        } rk_fetch_decode;
+
         /**<
          * Coordinator cache.
          *
@@ -545,6 +583,12 @@ struct rd_kafka_s {
                 size_t size;          /* Current message size sum */
                 unsigned int max_cnt; /* Max limit */
                 size_t max_size;      /* Max limit */
+                size_t mem;     /**< Current memory used by messages,
+                                 *   including overhead, and in-flight
+                                 *   ProduceRequest buffers. */
+                size_t max_mem; /**< Max memory limit
+                                 *   (queue.buffering.max.memory.kbytes),
+                                 *   or 0 if disabled. */
         } rk_curr_msgs;
 
         rd_kafka_timers_t rk_timers;
@@ -636,12 +680,37 @@ struct rd_kafka_s {
 #define rd_kafka_wrunlock(rk) rwlock_wrunlock(&(rk)->rk_lock)
 
 
+/**
+ * @returns true if adding \p cnt messages of total payload size \p size
+ *          and total memory footprint \p mem would exceed any of the
+ *          configured limits.
+ *
+ * @locks_required rk_curr_msgs.lock
+ */
+static RD_INLINE RD_UNUSED rd_bool_t
+rd_kafka_curr_msgs_exceeded(const rd_kafka_t *rk,
+                            unsigned int cnt,
+                            size_t size,
+                            size_t mem) {
+        return (rk->rk_curr_msgs.max_cnt > 0 &&
+                rk->rk_curr_msgs.cnt + cnt > rk->rk_curr_msgs.max_cnt) ||
+               (unsigned long long)(rk->rk_curr_msgs.size + size) >
+                   (unsigned long long)rk->rk_curr_msgs.max_size ||
+               (rk->rk_curr_msgs.max_mem > 0 &&
+                (unsigned long long)(rk->rk_curr_msgs.mem + mem) >
+                    (unsigned long long)rk->rk_curr_msgs.max_mem);
+}
+
+
 /**
  * @brief Add \p cnt messages and of total size \p size bytes to the
  *        internal bookkeeping of current message counts.
- *        If the total message count or size after add would exceed the
- *        configured limits \c queue.buffering.max.messages and
- *        \c queue.buffering.max.kbytes then depending on the value of
+ *        \p mem is the total memory footprint of the messages, including
+ *        the message struct, key and headers.
+ *        If the total message count, size or memory after add would exceed
+ *        the configured limits \c queue.buffering.max.messages,
+ *        \c queue.buffering.max.kbytes and
+ *        \c queue.buffering.max.memory.kbytes then depending on the value of
  *        \p block the function either blocks until enough space is available
  *        if \p block is 1, else immediately returns
  *        RD_KAFKA_RESP_ERR__QUEUE_FULL.
@@ -654,6 +723,7 @@ static RD_INLINE RD_UNUSED rd_kafka_resp_err_t
 rd_kafka_curr_msgs_add(rd_kafka_t *rk,
                        unsigned int cnt,
                        size_t size,
+                       size_t mem,
                        int block,
                        rwlock_t *rdlock) {
 
@@ -661,11 +731,7 @@ rd_kafka_curr_msgs_add(rd_kafka_t *rk,
                 return RD_KAFKA_RESP_ERR_NO_ERROR;
 
         mtx_lock(&rk->rk_curr_msgs.lock);
-        while (
-            unlikely((rk->rk_curr_msgs.max_cnt > 0 &&
-                      rk->rk_curr_msgs.cnt + cnt > rk->rk_curr_msgs.max_cnt) ||
-                     (unsigned long long)(rk->rk_curr_msgs.size + size) >
-                         (unsigned long long)rk->rk_curr_msgs.max_size)) {
+        while (unlikely(rd_kafka_curr_msgs_exceeded(rk, cnt, size, mem))) {
                 if (!block) {
                         mtx_unlock(&rk->rk_curr_msgs.lock);
                         return RD_KAFKA_RESP_ERR__QUEUE_FULL;
@@ -682,6 +748,7 @@ rd_kafka_curr_msgs_add(rd_kafka_t *rk,
 
         rk->rk_curr_msgs.cnt += cnt;
         rk->rk_curr_msgs.size += size;
+        rk->rk_curr_msgs.mem += mem;
         mtx_unlock(&rk->rk_curr_msgs.lock);
 
         return RD_KAFKA_RESP_ERR_NO_ERROR;
@@ -689,12 +756,14 @@ rd_kafka_curr_msgs_add(rd_kafka_t *rk,
 
 
 /**
- * @brief Subtract \p cnt messages of total size \p size from the
- *        current bookkeeping and broadcast a wakeup on the condvar
- *        for any waiting & blocking threads.
+ * @brief Subtract \p cnt messages of total size \p size and total
+ *        memory footprint \p mem from the current bookkeeping and
+ *        broadcast a wakeup on the condvar for any waiting & blocking threads.
  */
-static RD_INLINE RD_UNUSED void
-rd_kafka_curr_msgs_sub(rd_kafka_t *rk, unsigned int cnt, size_t size) {
+static RD_INLINE RD_UNUSED void rd_kafka_curr_msgs_sub(rd_kafka_t *rk,
+                                                       unsigned int cnt,
+                                                       size_t size,
+                                                       size_t mem) {
         int broadcast = 0;
 
         if (rk->rk_type != RD_KAFKA_PRODUCER)
@@ -702,7 +771,8 @@ rd_kafka_curr_msgs_sub(rd_kafka_t *rk, unsigned int cnt, size_t size) {
 
         mtx_lock(&rk->rk_curr_msgs.lock);
         rd_kafka_assert(NULL, rk->rk_curr_msgs.cnt >= cnt &&
-                                  rk->rk_curr_msgs.size >= size);
+                                  rk->rk_curr_msgs.size >= size &&
+                                  rk->rk_curr_msgs.mem >= mem);
 
         /* If the subtraction would pass one of the thresholds
          * broadcast a wake-up to any waiting listeners. */
@@ -710,11 +780,13 @@ rd_kafka_curr_msgs_sub(rd_kafka_t *rk, unsigned int cnt, size_t size) {
             (rk->rk_curr_msgs.cnt >= rk->rk_curr_msgs.max_cnt &&
              rk->rk_curr_msgs.cnt - cnt < rk->rk_curr_msgs.max_cnt) ||
             (rk->rk_curr_msgs.size >= rk->rk_curr_msgs.max_size &&
-             rk->rk_curr_msgs.size - size < rk->rk_curr_msgs.max_size))
+             rk->rk_curr_msgs.size - size < rk->rk_curr_msgs.max_size) ||
+            (rk->rk_curr_msgs.max_mem > 0 && mem > 0))
                 broadcast = 1;
 
         rk->rk_curr_msgs.cnt -= cnt;
         rk->rk_curr_msgs.size -= size;
+        rk->rk_curr_msgs.mem -= mem;
 
         if (unlikely(broadcast))
                 cnd_broadcast(&rk->rk_curr_msgs.cnd);
@@ -722,17 +794,42 @@ rd_kafka_curr_msgs_sub(rd_kafka_t *rk, unsigned int cnt, size_t size) {
         mtx_unlock(&rk->rk_curr_msgs.lock);
 }
 
-static RD_INLINE RD_UNUSED void
-rd_kafka_curr_msgs_get(rd_kafka_t *rk, unsigned int *cntp, size_t *sizep) {
+
+/**
+ * @brief Account for \p mem bytes of memory held on behalf of messages
+ *        that are not themselves messages, such as ProduceRequest buffers.
+ *
+ * This never blocks and is not subject to the memory limit, but counts
+ * towards it for subsequently produced messages.
+ * Release the memory with rd_kafka_curr_msgs_sub(rk, 0, 0, mem).
+ */
+static RD_INLINE RD_UNUSED void rd_kafka_curr_msgs_mem_add(rd_kafka_t *rk,
+                                                           size_t mem) {
+        if (rk->rk_type != RD_KAFKA_PRODUCER)
+                return;
+
+        mtx_lock(&rk->rk_curr_msgs.lock);
+        rk->rk_curr_msgs.mem += mem;
+        mtx_unlock(&rk->rk_curr_msgs.lock);
+}
+
+static RD_INLINE RD_UNUSED void rd_kafka_curr_msgs_get(rd_kafka_t *rk,
+                                                       unsigned int *cntp,
+                                                       size_t *sizep,
+                                                       size_t *memp) {
         if (rk->rk_type != RD_KAFKA_PRODUCER) {
                 *cntp  = 0;
                 *sizep = 0;
+                if (memp)
+                        *memp = 0;
                 return;
         }
 
         mtx_lock(&rk->rk_curr_msgs.lock);
         *cntp  = rk->rk_curr_msgs.cnt;
         *sizep = rk->rk_curr_msgs.size;
+        if (memp)
+                *memp = rk->rk_curr_msgs.mem;
         mtx_unlock(&rk->rk_curr_msgs.lock);
 }
 
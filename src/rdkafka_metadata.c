@@ -306,6 +306,8 @@ rd_kafka_resp_err_t rd_kafka_parse_Metadata(rd_kafka_broker_t *rkb,
         rd_kafka_resp_err_t err    = RD_KAFKA_RESP_ERR_NO_ERROR;
         int broker_changes         = 0;
         int cache_changes          = 0;
+        rd_kafkap_str_t *broker_racks = NULL;
+        rd_kafka_broker_t *mdrkb;
         /** This array is reused and resized as necessary to hold per-partition
          *  leader epochs (ApiVersion >= 7). */
         rd_kafka_partition_leader_epoch_t *leader_epochs = NULL;
@@ -358,16 +360,24 @@ rd_kafka_resp_err_t rd_kafka_parse_Metadata(rd_kafka_broker_t *rkb,
                                         "%d brokers: tmpabuf memory shortage",
                                         md->broker_cnt);
 
+        /* Broker racks, kept for client-side replica selection.
+         * The strings point into the response buffer. */
+        if (!(broker_racks = rd_tmpabuf_alloc(
+                  &tbuf, RD_MAX(md->broker_cnt, 1) * sizeof(*broker_racks))))
+                rd_kafka_buf_parse_fail(rkbuf,
+                                        "%d broker racks: "
+                                        "tmpabuf memory shortage",
+                                        md->broker_cnt);
+        memset(broker_racks, 0, md->broker_cnt * sizeof(*broker_racks));
+
         for (i = 0; i < md->broker_cnt; i++) {
                 rd_kafka_buf_read_i32a(rkbuf, md->brokers[i].id);
                 rd_kafka_buf_read_str_tmpabuf(rkbuf, &tbuf,
                                               md->brokers[i].host);
                 rd_kafka_buf_read_i32a(rkbuf, md->brokers[i].port);
 
-                if (ApiVersion >= 1) {
-                        rd_kafkap_str_t rack;
-                        rd_kafka_buf_read_str(rkbuf, &rack);
-                }
+                if (ApiVersion >= 1)
+                        rd_kafka_buf_read_str(rkbuf, &broker_racks[i]);
 
                 rd_kafka_buf_skip_tags(rkbuf);
         }
@@ -395,9 +405,13 @@ rd_kafka_resp_err_t rd_kafka_parse_Metadata(rd_kafka_broker_t *rkb,
                     rkbuf, "%d topics: tmpabuf memory shortage", md->topic_cnt);
 
         for (i = 0; i < md->topic_cnt; i++) {
+                rd_kafka_Uuid_t topic_id = RD_KAFKA_UUID_ZERO;
+
                 rd_kafka_buf_read_i16a(rkbuf, md->topics[i].err);
                 rd_kafka_buf_read_str_tmpabuf(rkbuf, &tbuf,
                                               md->topics[i].topic);
+                if (ApiVersion >= 10)
+                        rd_kafka_buf_read_uuid(rkbuf, &topic_id);
                 if (ApiVersion >= 1) {
                         int8_t is_internal;
                         rd_kafka_buf_read_i8(rkbuf, &is_internal);
@@ -576,7 +590,7 @@ rd_kafka_resp_err_t rd_kafka_parse_Metadata(rd_kafka_broker_t *rkb,
 
                                 rd_kafka_wrlock(rk);
                                 rd_kafka_metadata_cache_topic_update(
-                                    rk, &md->topics[i],
+                                    rk, &md->topics[i], topic_id,
                                     rd_false /*propagate later*/);
                                 cache_changes++;
                                 rd_kafka_wrunlock(rk);
@@ -609,7 +623,11 @@ rd_kafka_resp_err_t rd_kafka_parse_Metadata(rd_kafka_broker_t *rkb,
                            md->broker_cnt, md->brokers[i].host,
                            md->brokers[i].port, md->brokers[i].id);
                 rd_kafka_broker_update(rkb->rkb_rk, rkb->rkb_proto,
-                                       &md->brokers[i], NULL);
+                                       &md->brokers[i], &mdrkb);
+                if (mdrkb) {
+                        rd_kafka_broker_set_rack(mdrkb, &broker_racks[i]);
+                        rd_kafka_broker_destroy(mdrkb);
+                }
         }
 
         /* Requested topics not seen in metadata? Propogate to topic code. */
@@ -1367,25 +1385,38 @@ void rd_kafka_metadata_fast_leader_query(rd_kafka_t *rk) {
 
 
 /**
- * @brief Create mock Metadata (for testing) based on the provided topics.
+ * @brief Create mock Metadata (for testing) based on the provided topics,
+ *        with \p num_brokers brokers (with ids 0..num_brokers-1) and
+ *        \p replication_factor replicas for each partition.
+ *
+ * Partition \c p is replicated to brokers \c p, \c p+1, ..,
+ * \c p+replication_factor-1 (modulo \p num_brokers), the first being
+ * the leader.
  *
  * @param topics elements are checked for .topic and .partition_cnt
  * @param topic_cnt is the number of topic elements in \p topics.
+ * @param replication_factor must be <= \p num_brokers, and is ignored
+ *                           if \p num_brokers is 0.
  *
  * @returns a newly allocated metadata object that must be freed with
  *          rd_kafka_metadata_destroy().
- *
- * @sa rd_kafka_metadata_copy()
  */
-rd_kafka_metadata_t *
-rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
-                                 size_t topic_cnt) {
+rd_kafka_metadata_t *rd_kafka_metadata_new_topic_with_partition_replicas_mock(
+    const rd_kafka_metadata_topic_t *topics,
+    size_t topic_cnt,
+    int replication_factor,
+    int num_brokers) {
         rd_kafka_metadata_t *md;
         rd_tmpabuf_t tbuf;
         size_t topic_names_size = 0;
         int total_partition_cnt = 0;
         size_t i;
 
+        if (num_brokers == 0)
+                replication_factor = 0;
+
+        rd_assert(replication_factor <= num_brokers);
+
         /* Calculate total partition count and topic names size before
          * allocating memory. */
         for (i = 0; i < topic_cnt; i++) {
@@ -1400,12 +1431,25 @@ rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
             &tbuf,
             sizeof(*md) + (sizeof(*md->topics) * topic_cnt) + topic_names_size +
                 (64 /*topic name size..*/ * topic_cnt) +
-                (sizeof(*md->topics[0].partitions) * total_partition_cnt),
+                (sizeof(*md->topics[0].partitions) * total_partition_cnt) +
+                (sizeof(*md->topics[0].partitions[0].replicas) *
+                 replication_factor * total_partition_cnt) +
+                (sizeof(*md->brokers) * num_brokers) +
+                (8 /* alignment */ * (total_partition_cnt + 2)),
             1 /*assert on fail*/);
 
         md = rd_tmpabuf_alloc(&tbuf, sizeof(*md));
         memset(md, 0, sizeof(*md));
 
+        md->broker_cnt = num_brokers;
+        if (num_brokers > 0) {
+                md->brokers =
+                    rd_tmpabuf_alloc(&tbuf, num_brokers * sizeof(*md->brokers));
+                memset(md->brokers, 0, num_brokers * sizeof(*md->brokers));
+                for (i = 0; i < (size_t)num_brokers; i++)
+                        md->brokers[i].id = (int32_t)i;
+        }
+
         md->topic_cnt = (int)topic_cnt;
         md->topics =
             rd_tmpabuf_alloc(&tbuf, md->topic_cnt * sizeof(*md->topics));
@@ -1423,9 +1467,22 @@ rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
                                sizeof(*md->topics[i].partitions));
 
                 for (j = 0; j < md->topics[i].partition_cnt; j++) {
-                        memset(&md->topics[i].partitions[j], 0,
-                               sizeof(md->topics[i].partitions[j]));
-                        md->topics[i].partitions[j].id = j;
+                        rd_kafka_metadata_partition_t *mdp =
+                            &md->topics[i].partitions[j];
+                        int k;
+
+                        memset(mdp, 0, sizeof(*mdp));
+                        mdp->id = j;
+
+                        if (replication_factor == 0)
+                                continue;
+
+                        mdp->leader      = j % num_brokers;
+                        mdp->replica_cnt = replication_factor;
+                        mdp->replicas    = rd_tmpabuf_alloc(
+                            &tbuf, replication_factor * sizeof(*mdp->replicas));
+                        for (k = 0; k < replication_factor; k++)
+                                mdp->replicas[k] = (j + k) % num_brokers;
                 }
         }
 
@@ -1439,6 +1496,25 @@ rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
 }
 
 
+/**
+ * @brief Create mock Metadata (for testing) based on the provided topics.
+ *
+ * @param topics elements are checked for .topic and .partition_cnt
+ * @param topic_cnt is the number of topic elements in \p topics.
+ *
+ * @returns a newly allocated metadata object that must be freed with
+ *          rd_kafka_metadata_destroy().
+ *
+ * @sa rd_kafka_metadata_copy()
+ */
+rd_kafka_metadata_t *
+rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
+                                 size_t topic_cnt) {
+        return rd_kafka_metadata_new_topic_with_partition_replicas_mock(
+            topics, topic_cnt, 0, 0);
+}
+
+
 /**
  * @brief Create mock Metadata (for testing) based on the
  *        var-arg tuples of (const char *topic, int partition_cnt).
@@ -99,6 +99,11 @@ rd_kafka_metadata_t *
 rd_kafka_metadata_new_topic_mock(const rd_kafka_metadata_topic_t *topics,
                                  size_t topic_cnt);
 rd_kafka_metadata_t *rd_kafka_metadata_new_topic_mockv(size_t topic_cnt, ...);
+rd_kafka_metadata_t *rd_kafka_metadata_new_topic_with_partition_replicas_mock(
+    const rd_kafka_metadata_topic_t *topics,
+    size_t topic_cnt,
+    int replication_factor,
+    int num_brokers);
 
 
 /**
@@ -115,6 +120,7 @@ struct rd_kafka_metadata_cache_entry {
         /** Last known leader epochs array (same size as the partition count),
          *  or NULL if not known. */
         rd_kafka_metadata_topic_t rkmce_mtopic; /* Cached topic metadata */
+        rd_kafka_Uuid_t rkmce_topic_id; /* Topic id, or zero if unknown. */
         /* rkmce_topics.partitions memory points here. */
 };
 
@@ -159,6 +165,7 @@ void rd_kafka_metadata_cache_expiry_start(rd_kafka_t *rk);
 int rd_kafka_metadata_cache_evict_by_age(rd_kafka_t *rk, rd_ts_t ts);
 void rd_kafka_metadata_cache_topic_update(rd_kafka_t *rk,
                                           const rd_kafka_metadata_topic_t *mdt,
+                                          rd_kafka_Uuid_t topic_id,
                                           rd_bool_t propagate);
 void rd_kafka_metadata_cache_update(rd_kafka_t *rk,
                                     const rd_kafka_metadata_t *md,
@@ -166,6 +173,10 @@ void rd_kafka_metadata_cache_update(rd_kafka_t *rk,
 void rd_kafka_metadata_cache_propagate_changes(rd_kafka_t *rk);
 struct rd_kafka_metadata_cache_entry *
 rd_kafka_metadata_cache_find(rd_kafka_t *rk, const char *topic, int valid);
+struct rd_kafka_metadata_cache_entry *
+rd_kafka_metadata_cache_find_by_id(rd_kafka_t *rk,
+                                   rd_kafka_Uuid_t topic_id,
+                                   int valid);
 void rd_kafka_metadata_cache_purge_hints(rd_kafka_t *rk,
                                          const rd_list_t *topics);
 int rd_kafka_metadata_cache_hint(rd_kafka_t *rk,
@@ -222,6 +222,35 @@ rd_kafka_metadata_cache_find(rd_kafka_t *rk, const char *topic, int valid) {
 }
 
 
+/**
+ * @brief Find cache entry by topic id.
+ *
+ * This is a linear scan of the cache, which is fine for the
+ * consumer group protocol's use of resolving assigned topic ids.
+ *
+ * @param valid: entry must be valid (not hint)
+ *
+ * @locks rd_kafka_*lock()
+ */
+struct rd_kafka_metadata_cache_entry *
+rd_kafka_metadata_cache_find_by_id(rd_kafka_t *rk,
+                                   rd_kafka_Uuid_t topic_id,
+                                   int valid) {
+        struct rd_kafka_metadata_cache_entry *rkmce;
+
+        if (RD_KAFKA_UUID_IS_ZERO(topic_id))
+                return NULL;
+
+        TAILQ_FOREACH(rkmce, &rk->rk_metadata_cache.rkmc_expiry, rkmce_link) {
+                if (!rd_kafka_Uuid_cmp(rkmce->rkmce_topic_id, topic_id) &&
+                    (!valid || RD_KAFKA_METADATA_CACHE_VALID(rkmce)))
+                        return rkmce;
+        }
+
+        return NULL;
+}
+
+
 /**
  * @brief Partition (id) comparator
  */
@@ -241,6 +270,7 @@ int rd_kafka_metadata_partition_id_cmp(const void *_a, const void *_b) {
 static struct rd_kafka_metadata_cache_entry *
 rd_kafka_metadata_cache_insert(rd_kafka_t *rk,
                                const rd_kafka_metadata_topic_t *mtopic,
+                               rd_kafka_Uuid_t topic_id,
                                rd_ts_t now,
                                rd_ts_t ts_expires) {
         struct rd_kafka_metadata_cache_entry *rkmce, *old;
@@ -264,7 +294,8 @@ rd_kafka_metadata_cache_insert(rd_kafka_t *rk,
 
         rkmce = rd_tmpabuf_alloc(&tbuf, sizeof(*rkmce));
 
-        rkmce->rkmce_mtopic = *mtopic;
+        rkmce->rkmce_mtopic   = *mtopic;
+        rkmce->rkmce_topic_id = topic_id;
 
         /* Copy topic name and update pointer */
         rkmce->rkmce_mtopic.topic = rd_tmpabuf_write_str(&tbuf, mtopic->topic);
@@ -296,8 +327,12 @@ rd_kafka_metadata_cache_insert(rd_kafka_t *rk,
         /* Insert (and replace existing) entry. */
         old = RD_AVL_INSERT(&rk->rk_metadata_cache.rkmc_avl, rkmce,
                             rkmce_avlnode);
-        if (old)
+        if (old) {
+                /* Hints and id-less updates retain the known topic id. */
+                if (RD_KAFKA_UUID_IS_ZERO(rkmce->rkmce_topic_id))
+                        rkmce->rkmce_topic_id = old->rkmce_topic_id;
                 rd_kafka_metadata_cache_delete(rk, old, 0);
+        }
 
         /* Explicitly not freeing the tmpabuf since rkmce points to its
          * memory. */
@@ -360,6 +395,8 @@ void rd_kafka_metadata_cache_expiry_start(rd_kafka_t *rk) {
  * For permanent errors (authorization failures), we keep
  * the entry cached for metadata.max.age.ms.
  *
+ * @param topic_id The topic id, if known (Metadata v10+), else zero.
+ *
  * @remark The cache expiry timer will not be updated/started,
  *         call rd_kafka_metadata_cache_expiry_start() instead.
  *
@@ -367,6 +404,7 @@ void rd_kafka_metadata_cache_expiry_start(rd_kafka_t *rk) {
  */
 void rd_kafka_metadata_cache_topic_update(rd_kafka_t *rk,
                                           const rd_kafka_metadata_topic_t *mdt,
+                                          rd_kafka_Uuid_t topic_id,
                                           rd_bool_t propagate) {
         rd_ts_t now        = rd_clock();
         rd_ts_t ts_expires = now + (rk->rk_conf.metadata_max_age_ms * 1000);
@@ -380,7 +418,8 @@ void rd_kafka_metadata_cache_topic_update(rd_kafka_t *rk,
         if (!mdt->err ||
             mdt->err == RD_KAFKA_RESP_ERR_TOPIC_AUTHORIZATION_FAILED ||
             mdt->err == RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART)
-                rd_kafka_metadata_cache_insert(rk, mdt, now, ts_expires);
+                rd_kafka_metadata_cache_insert(rk, mdt, topic_id, now,
+                                               ts_expires);
         else
                 changed =
                     rd_kafka_metadata_cache_delete_by_name(rk, mdt->topic);
@@ -413,9 +452,11 @@ void rd_kafka_metadata_cache_update(rd_kafka_t *rk,
                 rd_kafka_metadata_cache_purge(rk, rd_false /*not observers*/);
 
 
-        for (i = 0; i < md->topic_cnt; i++)
-                rd_kafka_metadata_cache_insert(rk, &md->topics[i], now,
-                                               ts_expires);
+        for (i = 0; i < md->topic_cnt; i++) {
+                rd_kafka_Uuid_t zero_uuid = RD_KAFKA_UUID_ZERO;
+                rd_kafka_metadata_cache_insert(rk, &md->topics[i], zero_uuid,
+                                               now, ts_expires);
+        }
 
         /* Update expiry timer */
         if ((rkmce = TAILQ_FIRST(&rk->rk_metadata_cache.rkmc_expiry)))
@@ -493,6 +534,7 @@ int rd_kafka_metadata_cache_hint(rd_kafka_t *rk,
         const char *topic;
         rd_ts_t now        = rd_clock();
         rd_ts_t ts_expires = now + (rk->rk_conf.socket_timeout_ms * 1000);
+        rd_kafka_Uuid_t zero_uuid = RD_KAFKA_UUID_ZERO;
         int i;
         int cnt = 0;
 
@@ -512,7 +554,8 @@ int rd_kafka_metadata_cache_hint(rd_kafka_t *rk,
                         /* FALLTHRU */
                 }
 
-                rd_kafka_metadata_cache_insert(rk, &mtopic, now, ts_expires);
+                rd_kafka_metadata_cache_insert(rk, &mtopic, zero_uuid, now,
+                                               ts_expires);
                 cnt++;
 
                 if (dst)
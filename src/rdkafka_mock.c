@@ -601,6 +601,13 @@ rd_kafka_mock_topic_new(rd_kafka_mock_cluster_t *mcluster,
         mtopic          = rd_calloc(1, sizeof(*mtopic));
         mtopic->name    = rd_strdup(topic);
         mtopic->cluster = mcluster;
+        /* Random non-zero topic id */
+        mtopic->id.most_significant_bits =
+            ((int64_t)rd_jitter(1, INT32_MAX) << 32) |
+            (int64_t)rd_jitter(0, INT32_MAX);
+        mtopic->id.least_significant_bits =
+            ((int64_t)rd_jitter(0, INT32_MAX) << 32) |
+            (int64_t)(mcluster->topic_cnt + 1);
 
         mtopic->partition_cnt = partition_cnt;
         mtopic->partitions =
@@ -652,6 +659,20 @@ rd_kafka_mock_topic_find_by_kstr(const rd_kafka_mock_cluster_t *mcluster,
 }
 
 
+rd_kafka_mock_topic_t *
+rd_kafka_mock_topic_find_by_id(const rd_kafka_mock_cluster_t *mcluster,
+                               rd_kafka_Uuid_t id) {
+        const rd_kafka_mock_topic_t *mtopic;
+
+        TAILQ_FOREACH(mtopic, &mcluster->topics, link) {
+                if (!rd_kafka_Uuid_cmp(mtopic->id, id))
+                        return (rd_kafka_mock_topic_t *)mtopic;
+        }
+
+        return NULL;
+}
+
+
 /**
  * @brief Create a topic using default settings.
  *        The topic must not already exist.
@@ -1453,8 +1474,108 @@ rd_kafka_mock_error_stack_destroy(rd_kafka_mock_error_stack_t *errstack) {
 }
 
 
+/**
+ * @brief Create a new fetch session partition for \p topic and
+ *        \p partition.
+ */
+rd_kafka_mock_fetch_session_part_t *
+rd_kafka_mock_fetch_session_part_new(const rd_kafkap_str_t *topic,
+                                     int32_t partition) {
+        rd_kafka_mock_fetch_session_part_t *part;
+
+        part            = rd_calloc(1, sizeof(*part));
+        part->topic     = RD_KAFKAP_STR_DUP(topic);
+        part->partition = partition;
+        part->hwm       = -1;
+        part->lso       = -1;
+        part->log_start = -1;
+
+        return part;
+}
+
+/**
+ * @returns a copy of fetch session partition \p src.
+ */
+rd_kafka_mock_fetch_session_part_t *rd_kafka_mock_fetch_session_part_copy(
+    const rd_kafka_mock_fetch_session_part_t *src) {
+        rd_kafka_mock_fetch_session_part_t *part;
+
+        part        = rd_malloc(sizeof(*part));
+        *part       = *src;
+        part->topic = rd_strdup(src->topic);
+
+        return part;
+}
+
+void rd_kafka_mock_fetch_session_part_destroy(void *ptr) {
+        rd_kafka_mock_fetch_session_part_t *part = ptr;
+        rd_free(part->topic);
+        rd_free(part);
+}
+
+/**
+ * @returns the index of the partition \p topic \p partition in fetch
+ *          session \p msess, or -1 if not found.
+ */
+int rd_kafka_mock_fetch_session_part_find(
+    const rd_kafka_mock_fetch_session_t *msess,
+    const char *topic,
+    int32_t partition) {
+        const rd_kafka_mock_fetch_session_part_t *part;
+        int i;
+
+        RD_LIST_FOREACH(part, &msess->parts, i) {
+                if (part->partition == partition && !strcmp(part->topic, topic))
+                        return i;
+        }
+
+        return -1;
+}
+
+/**
+ * @brief Create a new fetch session on broker \p mrkb.
+ */
+rd_kafka_mock_fetch_session_t *
+rd_kafka_mock_fetch_session_new(rd_kafka_mock_broker_t *mrkb) {
+        rd_kafka_mock_fetch_session_t *msess;
+
+        msess        = rd_calloc(1, sizeof(*msess));
+        msess->id    = ++mrkb->fetch_session_id_next;
+        msess->epoch = 1;
+        rd_list_init(&msess->parts, 0,
+                     rd_kafka_mock_fetch_session_part_destroy);
+
+        TAILQ_INSERT_TAIL(&mrkb->fetch_sessions, msess, link);
+
+        return msess;
+}
+
+/**
+ * @returns the fetch session with SessionId \p id, or NULL if not found.
+ */
+rd_kafka_mock_fetch_session_t *
+rd_kafka_mock_fetch_session_find(rd_kafka_mock_broker_t *mrkb, int32_t id) {
+        rd_kafka_mock_fetch_session_t *msess;
+
+        TAILQ_FOREACH(msess, &mrkb->fetch_sessions, link) {
+                if (msess->id == id)
+                        return msess;
+        }
+
+        return NULL;
+}
+
+void rd_kafka_mock_fetch_session_destroy(rd_kafka_mock_broker_t *mrkb,
+                                         rd_kafka_mock_fetch_session_t *msess) {
+        TAILQ_REMOVE(&mrkb->fetch_sessions, msess, link);
+        rd_list_destroy(&msess->parts);
+        rd_free(msess);
+}
+
+
 static void rd_kafka_mock_broker_destroy(rd_kafka_mock_broker_t *mrkb) {
         rd_kafka_mock_error_stack_t *errstack;
+        rd_kafka_mock_fetch_session_t *msess;
 
         rd_kafka_mock_broker_close_all(mrkb, "Destroying broker");
 
@@ -1470,6 +1591,9 @@ static void rd_kafka_mock_broker_destroy(rd_kafka_mock_broker_t *mrkb) {
                 rd_kafka_mock_error_stack_destroy(errstack);
         }
 
+        while ((msess = TAILQ_FIRST(&mrkb->fetch_sessions)))
+                rd_kafka_mock_fetch_session_destroy(mrkb, msess);
+
         TAILQ_REMOVE(&mrkb->cluster->brokers, mrkb, link);
         mrkb->cluster->broker_cnt--;
 
@@ -1598,6 +1722,7 @@ rd_kafka_mock_broker_new(rd_kafka_mock_cluster_t *mcluster, int32_t broker_id) {
 
         TAILQ_INIT(&mrkb->connections);
         TAILQ_INIT(&mrkb->errstacks);
+        TAILQ_INIT(&mrkb->fetch_sessions);
 
         TAILQ_INSERT_TAIL(&mcluster->brokers, mrkb, link);
         mcluster->broker_cnt++;
@@ -2126,6 +2251,32 @@ rd_kafka_mock_set_apiversion(rd_kafka_mock_cluster_t *mcluster,
             rd_kafka_op_req(mcluster->ops, rko, RD_POLL_INFINITE));
 }
 
+rd_kafka_resp_err_t
+rd_kafka_mock_set_group_consumer_session_timeout_ms(
+    rd_kafka_mock_cluster_t *mcluster,
+    int session_timeout_ms) {
+        rd_kafka_op_t *rko = rd_kafka_op_new(RD_KAFKA_OP_MOCK);
+
+        rko->rko_u.mock.lo  = session_timeout_ms;
+        rko->rko_u.mock.cmd = RD_KAFKA_MOCK_CMD_CGRP_SESSION_TMOUT_SET;
+
+        return rd_kafka_op_err_destroy(
+            rd_kafka_op_req(mcluster->ops, rko, RD_POLL_INFINITE));
+}
+
+rd_kafka_resp_err_t
+rd_kafka_mock_set_group_consumer_heartbeat_interval_ms(
+    rd_kafka_mock_cluster_t *mcluster,
+    int heartbeat_interval_ms) {
+        rd_kafka_op_t *rko = rd_kafka_op_new(RD_KAFKA_OP_MOCK);
+
+        rko->rko_u.mock.lo  = heartbeat_interval_ms;
+        rko->rko_u.mock.cmd = RD_KAFKA_MOCK_CMD_CGRP_HB_INTVL_SET;
+
+        return rd_kafka_op_err_destroy(
+            rd_kafka_op_req(mcluster->ops, rko, RD_POLL_INFINITE));
+}
+
 
 /**
  * @brief Apply command to specific broker.
@@ -2348,6 +2499,16 @@ rd_kafka_mock_cluster_cmd(rd_kafka_mock_cluster_t *mcluster,
                     .MaxVersion = (int16_t)rko->rko_u.mock.hi;
                 break;
 
+        case RD_KAFKA_MOCK_CMD_CGRP_SESSION_TMOUT_SET:
+                mcluster->defaults.group_consumer_session_timeout_ms =
+                    (int)rko->rko_u.mock.lo;
+                break;
+
+        case RD_KAFKA_MOCK_CMD_CGRP_HB_INTVL_SET:
+                mcluster->defaults.group_consumer_heartbeat_interval_ms =
+                    (int)rko->rko_u.mock.lo;
+                break;
+
         default:
                 rd_assert(!*"unknown mock cmd");
                 break;
@@ -2393,6 +2554,7 @@ static void rd_kafka_mock_cluster_destroy0(rd_kafka_mock_cluster_t *mcluster) {
         rd_kafka_mock_topic_t *mtopic;
         rd_kafka_mock_broker_t *mrkb;
         rd_kafka_mock_cgrp_t *mcgrp;
+        rd_kafka_mock_cgrp_consumer_t *mcgrp_consumer;
         rd_kafka_mock_coord_t *mcoord;
         rd_kafka_mock_error_stack_t *errstack;
         thrd_t dummy_rkb_thread;
@@ -2407,6 +2569,9 @@ static void rd_kafka_mock_cluster_destroy0(rd_kafka_mock_cluster_t *mcluster) {
         while ((mcgrp = TAILQ_FIRST(&mcluster->cgrps)))
                 rd_kafka_mock_cgrp_destroy(mcgrp);
 
+        while ((mcgrp_consumer = TAILQ_FIRST(&mcluster->cgrps_consumer)))
+                rd_kafka_mock_cgrp_consumer_destroy(mcgrp_consumer);
+
         while ((mcoord = TAILQ_FIRST(&mcluster->coords)))
                 rd_kafka_mock_coord_destroy(mcluster, mcoord);
 
@@ -2507,8 +2672,13 @@ rd_kafka_mock_cluster_t *rd_kafka_mock_cluster_new(rd_kafka_t *rk,
         mcluster->defaults.partition_cnt      = 4;
         mcluster->defaults.replication_factor = RD_MIN(3, broker_cnt);
 
+        mcluster->defaults.group_consumer_session_timeout_ms    = 45000;
+        mcluster->defaults.group_consumer_heartbeat_interval_ms = 3000;
+
         TAILQ_INIT(&mcluster->cgrps);
 
+        TAILQ_INIT(&mcluster->cgrps_consumer);
+
         TAILQ_INIT(&mcluster->coords);
 
         rd_list_init(&mcluster->pids, 16, rd_free);
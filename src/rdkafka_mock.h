@@ -365,6 +365,30 @@ rd_kafka_mock_set_apiversion(rd_kafka_mock_cluster_t *mcluster,
                              int16_t MaxVersion);
 
 
+/**
+ * @brief Set the session timeout for consumer groups using the
+ *        consumer group protocol (KIP-848, `group.protocol=consumer`).
+ *
+ *        Members that do not heartbeat within this time are removed
+ *        from the group. The default is 45000 ms.
+ */
+RD_EXPORT rd_kafka_resp_err_t
+rd_kafka_mock_set_group_consumer_session_timeout_ms(
+    rd_kafka_mock_cluster_t *mcluster,
+    int session_timeout_ms);
+
+
+/**
+ * @brief Set the heartbeat interval returned to members of consumer groups
+ *        using the consumer group protocol (KIP-848,
+ *        `group.protocol=consumer`). The default is 3000 ms.
+ */
+RD_EXPORT rd_kafka_resp_err_t
+rd_kafka_mock_set_group_consumer_heartbeat_interval_ms(
+    rd_kafka_mock_cluster_t *mcluster,
+    int heartbeat_interval_ms);
+
+
 /**@}*/
 
 #ifdef __cplusplus
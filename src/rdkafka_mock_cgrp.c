@@ -685,3 +685,434 @@ void rd_kafka_mock_cgrps_connection_closed(rd_kafka_mock_cluster_t *mcluster,
                 }
         }
 }
+
+
+
+/**
+ * @name Consumer group protocol (KIP-848)
+ * @{
+ *
+ * A simplified server side implementation of the consumer group protocol:
+ * any change to the group membership or subscriptions bumps the group
+ * epoch and recomputes the target assignment of all members with the
+ * group's server side assignor ("uniform" or "range").
+ * Each member is handed the partitions of its target assignment that are
+ * not owned, or about to be owned, by another member, and its member epoch
+ * advances to the target assignment epoch once it no longer owns any
+ * partitions outside of its target assignment.
+ */
+
+
+static void rd_kafka_mock_cgrp_consumer_member_destroy(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member) {
+        rd_assert(mcgrp->member_cnt > 0);
+        TAILQ_REMOVE(&mcgrp->members, member, link);
+        mcgrp->member_cnt--;
+
+        rd_free(member->id);
+        if (member->instance_id)
+                rd_free(member->instance_id);
+        rd_list_destroy(&member->subscription);
+        if (member->target)
+                rd_kafka_topic_partition_list_destroy(member->target);
+        if (member->assigned)
+                rd_kafka_topic_partition_list_destroy(member->assigned);
+        rd_kafka_topic_partition_list_destroy(member->owned);
+        rd_free(member);
+}
+
+
+static int rd_kafka_mock_cgrp_consumer_member_cmp(const void *_a,
+                                                  const void *_b) {
+        const rd_kafka_mock_cgrp_consumer_member_t *a =
+            *(const rd_kafka_mock_cgrp_consumer_member_t **)_a;
+        const rd_kafka_mock_cgrp_consumer_member_t *b =
+            *(const rd_kafka_mock_cgrp_consumer_member_t **)_b;
+        return strcmp(a->id, b->id);
+}
+
+
+/**
+ * @brief Compute the target assignment of all members with the group's
+ *        server side assignor.
+ */
+static void rd_kafka_mock_cgrp_consumer_target_assign(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp) {
+        rd_kafka_mock_cgrp_consumer_member_t **members, **eligible, *member;
+        rd_bool_t range = mcgrp->assignor && !strcmp(mcgrp->assignor, "range");
+        rd_list_t topics;
+        const char *topic;
+        int i, j;
+
+        rd_list_init(&topics, 0, NULL);
+        members = rd_malloc(sizeof(*members) * RD_MAX(mcgrp->member_cnt, 1));
+        eligible = rd_malloc(sizeof(*eligible) * RD_MAX(mcgrp->member_cnt, 1));
+
+        i = 0;
+        TAILQ_FOREACH(member, &mcgrp->members, link) {
+                members[i++] = member;
+
+                if (member->target)
+                        rd_kafka_topic_partition_list_destroy(member->target);
+                member->target = rd_kafka_topic_partition_list_new(0);
+
+                RD_LIST_FOREACH(topic, &member->subscription, j) {
+                        if (!rd_list_find(&topics, topic, rd_list_cmp_str))
+                                rd_list_add(&topics, (void *)topic);
+                }
+        }
+
+        qsort(members, mcgrp->member_cnt, sizeof(*members),
+              rd_kafka_mock_cgrp_consumer_member_cmp);
+        rd_list_sort(&topics, rd_list_cmp_str);
+
+        RD_LIST_FOREACH(topic, &topics, i) {
+                const rd_kafka_mock_topic_t *mtopic =
+                    rd_kafka_mock_topic_find(mcgrp->cluster, topic);
+                int eligible_cnt = 0;
+                int partition;
+
+                if (!mtopic)
+                        continue;
+
+                for (j = 0; j < mcgrp->member_cnt; j++)
+                        if (rd_list_find(&members[j]->subscription, topic,
+                                         rd_list_cmp_str))
+                                eligible[eligible_cnt++] = members[j];
+
+                if (!eligible_cnt)
+                        continue;
+
+                for (partition = 0; partition < mtopic->partition_cnt;
+                     partition++) {
+                        int m = 0;
+
+                        if (range) {
+                                /* Contiguous ranges, the first members
+                                 * get one extra partition each. */
+                                int per   = mtopic->partition_cnt /
+                                          eligible_cnt;
+                                int extra = mtopic->partition_cnt %
+                                            eligible_cnt;
+                                if (partition < extra * (per + 1))
+                                        m = partition / (per + 1);
+                                else
+                                        m = extra + (partition -
+                                                     extra * (per + 1)) /
+                                                        per;
+                        } else {
+                                /* Uniform: the eligible member with the
+                                 * fewest assigned partitions. */
+                                for (j = 1; j < eligible_cnt; j++)
+                                        if (eligible[j]->target->cnt <
+                                            eligible[m]->target->cnt)
+                                                m = j;
+                        }
+
+                        rd_kafka_topic_partition_list_add(eligible[m]->target,
+                                                          topic, partition);
+                }
+        }
+
+        rd_free(eligible);
+        rd_free(members);
+        rd_list_destroy(&topics);
+
+        mcgrp->assignment_epoch = mcgrp->group_epoch;
+
+        rd_kafka_dbg(mcgrp->cluster->rk, MOCK, "MOCK",
+                     "Mock consumer group %s: computed %s target assignment "
+                     "for %d member(s) at epoch %" PRId32,
+                     mcgrp->id, range ? "range" : "uniform", mcgrp->member_cnt,
+                     mcgrp->assignment_epoch);
+}
+
+
+/**
+ * @brief Update the partitions handed out to \p member and its member epoch.
+ */
+static void rd_kafka_mock_cgrp_consumer_member_assigned_update(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member) {
+        rd_kafka_topic_partition_list_t *assigned;
+        const rd_kafka_mock_cgrp_consumer_member_t *other;
+        int i;
+
+        assigned = rd_kafka_topic_partition_list_new(member->target->cnt);
+
+        for (i = 0; i < member->target->cnt; i++) {
+                const rd_kafka_topic_partition_t *rktpar =
+                    &member->target->elems[i];
+                rd_bool_t released = rd_true;
+
+                /* Don't hand out partitions that another member still
+                 * owns, or has been handed out. */
+                TAILQ_FOREACH(other, &mcgrp->members, link) {
+                        if (other == member)
+                                continue;
+                        if (rd_kafka_topic_partition_list_find(
+                                other->owned, rktpar->topic,
+                                rktpar->partition) ||
+                            (other->assigned &&
+                             rd_kafka_topic_partition_list_find(
+                                 other->assigned, rktpar->topic,
+                                 rktpar->partition))) {
+                                released = rd_false;
+                                break;
+                        }
+                }
+
+                if (released)
+                        rd_kafka_topic_partition_list_add(
+                            assigned, rktpar->topic, rktpar->partition);
+        }
+
+        if (!member->assigned ||
+            rd_kafka_topic_partition_list_cmp(member->assigned, assigned,
+                                              rd_kafka_topic_partition_cmp)) {
+                if (member->assigned)
+                        rd_kafka_topic_partition_list_destroy(
+                            member->assigned);
+                member->assigned         = assigned;
+                member->assigned_changed = rd_true;
+        } else {
+                rd_kafka_topic_partition_list_destroy(assigned);
+        }
+
+        /* The member epoch advances once the member no longer owns any
+         * partitions outside of its target assignment. */
+        for (i = 0; i < member->owned->cnt; i++)
+                if (!rd_kafka_topic_partition_list_find(
+                        member->target, member->owned->elems[i].topic,
+                        member->owned->elems[i].partition))
+                        return;
+
+        member->member_epoch = mcgrp->assignment_epoch;
+}
+
+
+/**
+ * @brief Handle a heartbeat from \p member with its current subscription
+ *        and owned partitions.
+ *
+ * @param subscription Subscribed topic names (char *), or NULL if unchanged.
+ * @param assignor Server side assignor name, or NULL if unchanged.
+ * @param owned Owned partitions, or NULL if unchanged.
+ *
+ * @returns RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR on unknown assignor.
+ */
+rd_kafka_resp_err_t rd_kafka_mock_cgrp_consumer_member_heartbeat(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member,
+    const rd_list_t *subscription,
+    const char *assignor,
+    rd_kafka_topic_partition_list_t *owned) {
+        rd_bool_t changed = rd_false;
+
+        if (assignor && strcmp(assignor, "uniform") &&
+            strcmp(assignor, "range"))
+                return RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR;
+
+        if (assignor &&
+            (!mcgrp->assignor || strcmp(mcgrp->assignor, assignor))) {
+                if (mcgrp->assignor)
+                        rd_free(mcgrp->assignor);
+                mcgrp->assignor = rd_strdup(assignor);
+                changed         = rd_true;
+        }
+
+        if (subscription &&
+            rd_list_cmp(&member->subscription, subscription, rd_list_cmp_str)) {
+                rd_list_clear(&member->subscription);
+                rd_list_copy_to(&member->subscription, subscription,
+                                rd_list_string_copy, NULL);
+                rd_list_sort(&member->subscription, rd_list_cmp_str);
+                changed = rd_true;
+        }
+
+        if (owned) {
+                rd_kafka_topic_partition_list_destroy(member->owned);
+                member->owned = rd_kafka_topic_partition_list_copy(owned);
+        }
+
+        member->ts_last_activity = rd_clock();
+
+        if (changed)
+                mcgrp->group_epoch++;
+
+        if (mcgrp->assignment_epoch != mcgrp->group_epoch)
+                rd_kafka_mock_cgrp_consumer_target_assign(mcgrp);
+
+        rd_kafka_mock_cgrp_consumer_member_assigned_update(mcgrp, member);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
+/**
+ * @brief Find member in consumer protocol group.
+ */
+rd_kafka_mock_cgrp_consumer_member_t *
+rd_kafka_mock_cgrp_consumer_member_find(
+    const rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    const rd_kafkap_str_t *MemberId) {
+        const rd_kafka_mock_cgrp_consumer_member_t *member;
+        TAILQ_FOREACH(member, &mcgrp->members, link) {
+                if (!rd_kafkap_str_cmp_str(MemberId, member->id))
+                        return (rd_kafka_mock_cgrp_consumer_member_t *)member;
+        }
+
+        return NULL;
+}
+
+
+/**
+ * @brief Add a new member, or reset an existing member rejoining
+ *        with member epoch 0, to the consumer protocol group.
+ *
+ * A static member replaces any previous member with the same instance id.
+ */
+rd_kafka_mock_cgrp_consumer_member_t *
+rd_kafka_mock_cgrp_consumer_member_add(rd_kafka_mock_cgrp_consumer_t *mcgrp,
+                                       const rd_kafkap_str_t *MemberId,
+                                       const rd_kafkap_str_t *InstanceId) {
+        rd_kafka_mock_cgrp_consumer_member_t *member, *tmp;
+
+        TAILQ_FOREACH_SAFE(member, &mcgrp->members, link, tmp) {
+                if (!rd_kafkap_str_cmp_str(MemberId, member->id) ||
+                    (!RD_KAFKAP_STR_IS_NULL(InstanceId) &&
+                     member->instance_id &&
+                     !rd_kafkap_str_cmp_str(InstanceId, member->instance_id)))
+                        rd_kafka_mock_cgrp_consumer_member_destroy(mcgrp,
+                                                                   member);
+        }
+
+        member = rd_calloc(1, sizeof(*member));
+
+        if (!RD_KAFKAP_STR_LEN(MemberId)) {
+                /* Generate a member id */
+                char memberid[32];
+                rd_snprintf(memberid, sizeof(memberid), "%p", member);
+                member->id = rd_strdup(memberid);
+        } else
+                member->id = RD_KAFKAP_STR_DUP(MemberId);
+
+        if (!RD_KAFKAP_STR_IS_NULL(InstanceId))
+                member->instance_id = RD_KAFKAP_STR_DUP(InstanceId);
+
+        rd_list_init(&member->subscription, 0, rd_free);
+        member->owned            = rd_kafka_topic_partition_list_new(0);
+        member->assigned_changed = rd_true;
+
+        TAILQ_INSERT_TAIL(&mcgrp->members, member, link);
+        mcgrp->member_cnt++;
+        mcgrp->group_epoch++;
+
+        rd_kafka_dbg(mcgrp->cluster->rk, MOCK, "MOCK",
+                     "Member %s joined consumer group %s at group epoch "
+                     "%" PRId32,
+                     member->id, mcgrp->id, mcgrp->group_epoch);
+
+        return member;
+}
+
+
+/**
+ * @brief Remove \p member from the consumer protocol group.
+ */
+void rd_kafka_mock_cgrp_consumer_member_leave(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member) {
+        rd_kafka_dbg(mcgrp->cluster->rk, MOCK, "MOCK",
+                     "Member %s is leaving consumer group %s", member->id,
+                     mcgrp->id);
+
+        rd_kafka_mock_cgrp_consumer_member_destroy(mcgrp, member);
+        mcgrp->group_epoch++;
+}
+
+
+/**
+ * @brief Check if any consumer protocol members have exceeded the
+ *        session timeout.
+ */
+static void rd_kafka_mock_cgrp_consumer_session_tmr_cb(rd_kafka_timers_t *rkts,
+                                                       void *arg) {
+        rd_kafka_mock_cgrp_consumer_t *mcgrp = arg;
+        rd_kafka_mock_cgrp_consumer_member_t *member, *tmp;
+        rd_ts_t now = rd_clock();
+
+        TAILQ_FOREACH_SAFE(member, &mcgrp->members, link, tmp) {
+                if (member->ts_last_activity +
+                        (mcgrp->cluster->defaults
+                             .group_consumer_session_timeout_ms *
+                         1000) >
+                    now)
+                        continue;
+
+                rd_kafka_dbg(mcgrp->cluster->rk, MOCK, "MOCK",
+                             "Member %s session timed out for consumer "
+                             "group %s",
+                             member->id, mcgrp->id);
+
+                rd_kafka_mock_cgrp_consumer_member_leave(mcgrp, member);
+        }
+}
+
+
+void rd_kafka_mock_cgrp_consumer_destroy(rd_kafka_mock_cgrp_consumer_t *mcgrp) {
+        rd_kafka_mock_cgrp_consumer_member_t *member;
+
+        TAILQ_REMOVE(&mcgrp->cluster->cgrps_consumer, mcgrp, link);
+
+        rd_kafka_timer_stop(&mcgrp->cluster->timers, &mcgrp->session_tmr,
+                            rd_true);
+        rd_free(mcgrp->id);
+        if (mcgrp->assignor)
+                rd_free(mcgrp->assignor);
+        while ((member = TAILQ_FIRST(&mcgrp->members)))
+                rd_kafka_mock_cgrp_consumer_member_destroy(mcgrp, member);
+        rd_free(mcgrp);
+}
+
+
+rd_kafka_mock_cgrp_consumer_t *
+rd_kafka_mock_cgrp_consumer_find(rd_kafka_mock_cluster_t *mcluster,
+                                 const rd_kafkap_str_t *GroupId) {
+        rd_kafka_mock_cgrp_consumer_t *mcgrp;
+        TAILQ_FOREACH(mcgrp, &mcluster->cgrps_consumer, link) {
+                if (!rd_kafkap_str_cmp_str(GroupId, mcgrp->id))
+                        return mcgrp;
+        }
+
+        return NULL;
+}
+
+
+/**
+ * @brief Find or create a consumer protocol group
+ */
+rd_kafka_mock_cgrp_consumer_t *
+rd_kafka_mock_cgrp_consumer_get(rd_kafka_mock_cluster_t *mcluster,
+                                const rd_kafkap_str_t *GroupId) {
+        rd_kafka_mock_cgrp_consumer_t *mcgrp;
+
+        mcgrp = rd_kafka_mock_cgrp_consumer_find(mcluster, GroupId);
+        if (mcgrp)
+                return mcgrp;
+
+        mcgrp          = rd_calloc(1, sizeof(*mcgrp));
+        mcgrp->cluster = mcluster;
+        mcgrp->id      = RD_KAFKAP_STR_DUP(GroupId);
+        TAILQ_INIT(&mcgrp->members);
+        rd_kafka_timer_start(&mcluster->timers, &mcgrp->session_tmr,
+                             1000 * 1000 /*1s*/,
+                             rd_kafka_mock_cgrp_consumer_session_tmr_cb, mcgrp);
+
+        TAILQ_INSERT_TAIL(&mcluster->cgrps_consumer, mcgrp, link);
+
+        return mcgrp;
+}
+
+/**@}*/
@@ -174,9 +174,22 @@ static int rd_kafka_mock_handle_Fetch(rd_kafka_mock_connection_t *mconn,
         rd_kafka_buf_t *resp = rd_kafka_mock_buf_new_response(rkbuf);
         rd_kafka_resp_err_t all_err;
         int32_t ReplicaId, MaxWait, MinBytes, MaxBytes = -1, SessionId = -1,
-                                              Epoch, TopicsCnt;
+                                              Epoch = -1, TopicsCnt;
+        int32_t RespSessionId;
         int8_t IsolationLevel;
         size_t totsize = 0;
+        rd_list_t reqparts, forgotten;
+        const rd_list_t *parts;
+        rd_kafka_mock_fetch_session_t *msess = NULL;
+        rd_kafka_mock_fetch_session_part_t *part;
+        rd_bool_t incremental = rd_false;
+        const char *topic_last = NULL;
+        size_t of_TopicsCnt, of_PartitionCnt = 0;
+        int RespTopicsCnt = 0, RespPartitionCnt = 0;
+        int i;
+
+        rd_list_init(&reqparts, 0, rd_kafka_mock_fetch_session_part_destroy);
+        rd_list_init(&forgotten, 0, rd_kafka_mock_fetch_session_part_destroy);
 
         rd_kafka_buf_read_i32(rkbuf, &ReplicaId);
         rd_kafka_buf_read_i32(rkbuf, &MaxWait);
@@ -190,203 +203,326 @@ static int rd_kafka_mock_handle_Fetch(rd_kafka_mock_connection_t *mconn,
                 rd_kafka_buf_read_i32(rkbuf, &Epoch);
         }
 
-        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 1) {
-                /* Response: ThrottleTime */
-                rd_kafka_buf_write_i32(resp, 0);
-        }
-
-
-        /* Inject error, if any */
-        all_err = rd_kafka_mock_next_request_error(mconn, resp);
-
-        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 7) {
-                /* Response: ErrorCode */
-                rd_kafka_buf_write_i16(resp, all_err);
-
-                /* Response: SessionId */
-                rd_kafka_buf_write_i32(resp, SessionId);
-        }
-
         rd_kafka_buf_read_i32(rkbuf, &TopicsCnt);
 
-        /* Response: #Topics */
-        rd_kafka_buf_write_i32(resp, TopicsCnt);
-
         while (TopicsCnt-- > 0) {
                 rd_kafkap_str_t Topic;
                 int32_t PartitionCnt;
-                rd_kafka_mock_topic_t *mtopic;
 
                 rd_kafka_buf_read_str(rkbuf, &Topic);
                 rd_kafka_buf_read_i32(rkbuf, &PartitionCnt);
 
-                mtopic = rd_kafka_mock_topic_find_by_kstr(mcluster, &Topic);
-
-                /* Response: Topic */
-                rd_kafka_buf_write_kstr(resp, &Topic);
-                /* Response: #Partitions */
-                rd_kafka_buf_write_i32(resp, PartitionCnt);
-
                 while (PartitionCnt-- > 0) {
-                        int32_t Partition, CurrentLeaderEpoch = -1,
-                                           PartMaxBytes;
-                        int64_t FetchOffset, LogStartOffset;
-                        rd_kafka_mock_partition_t *mpart = NULL;
-                        rd_kafka_resp_err_t err          = all_err;
-                        rd_bool_t on_follower;
-                        size_t partsize                    = 0;
-                        const rd_kafka_mock_msgset_t *mset = NULL;
+                        int32_t Partition;
+                        int64_t LogStartOffset;
 
                         rd_kafka_buf_read_i32(rkbuf, &Partition);
 
+                        part = rd_kafka_mock_fetch_session_part_new(&Topic,
+                                                                    Partition);
+                        rd_list_add(&reqparts, part);
+
+                        part->leader_epoch = -1;
                         if (rkbuf->rkbuf_reqhdr.ApiVersion >= 9)
                                 rd_kafka_buf_read_i32(rkbuf,
-                                                      &CurrentLeaderEpoch);
+                                                      &part->leader_epoch);
 
-                        rd_kafka_buf_read_i64(rkbuf, &FetchOffset);
+                        rd_kafka_buf_read_i64(rkbuf, &part->fetch_offset);
 
                         if (rkbuf->rkbuf_reqhdr.ApiVersion >= 5)
                                 rd_kafka_buf_read_i64(rkbuf, &LogStartOffset);
 
-                        rd_kafka_buf_read_i32(rkbuf, &PartMaxBytes);
+                        rd_kafka_buf_read_i32(rkbuf, &part->max_bytes);
+                }
+        }
 
-                        if (mtopic)
-                                mpart = rd_kafka_mock_partition_find(mtopic,
-                                                                     Partition);
+        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 7) {
+                int32_t ForgottenTopicCnt;
+                rd_kafka_buf_read_i32(rkbuf, &ForgottenTopicCnt);
+                while (ForgottenTopicCnt-- > 0) {
+                        rd_kafkap_str_t Topic;
+                        int32_t ForgPartCnt;
+                        rd_kafka_buf_read_str(rkbuf, &Topic);
+                        rd_kafka_buf_read_i32(rkbuf, &ForgPartCnt);
+                        while (ForgPartCnt-- > 0) {
+                                int32_t Partition;
+                                rd_kafka_buf_read_i32(rkbuf, &Partition);
+                                rd_list_add(
+                                    &forgotten,
+                                    rd_kafka_mock_fetch_session_part_new(
+                                        &Topic, Partition));
+                        }
+                }
+        }
 
-                        /* Response: Partition */
-                        rd_kafka_buf_write_i32(resp, Partition);
+        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 11) {
+                rd_kafkap_str_t RackId;
+                char *rack;
+                rd_kafka_buf_read_str(rkbuf, &RackId);
+                RD_KAFKAP_STR_DUPA(&rack, &RackId);
+                /* Matt might do something sensible with this */
+        }
 
-                        /* Fetch is directed at follower and this is
-                         * the follower broker. */
-                        on_follower =
-                            mpart && mpart->follower_id == mconn->broker->id;
+        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 1) {
+                /* Response: ThrottleTime */
+                rd_kafka_buf_write_i32(resp, 0);
+        }
 
-                        if (!all_err && !mpart)
-                                err = RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART;
-                        else if (!all_err && mpart->leader != mconn->broker &&
-                                 !on_follower)
-                                err =
-                                    RD_KAFKA_RESP_ERR_NOT_LEADER_FOR_PARTITION;
 
-                        if (!err && mpart)
-                                err =
-                                    rd_kafka_mock_partition_leader_epoch_check(
-                                        mpart, CurrentLeaderEpoch);
+        /* Inject error, if any */
+        all_err = rd_kafka_mock_next_request_error(mconn, resp);
 
-                        /* Find MessageSet for FetchOffset */
-                        if (!err && FetchOffset != mpart->end_offset) {
-                                /* Kafka currently only returns
-                                 * OFFSET_NOT_AVAILABLE
-                                 * in ListOffsets calls */
-                                if (!(mset = rd_kafka_mock_msgset_find(
-                                          mpart, FetchOffset, on_follower)))
-                                        err =
-                                            RD_KAFKA_RESP_ERR_OFFSET_OUT_OF_RANGE;
-                                rd_kafka_dbg(
-                                    mcluster->rk, MOCK, "MOCK",
-                                    "Topic %.*s [%" PRId32
-                                    "] fetch err %s for offset %" PRId64
-                                    " mset %p, on_follower %d, "
-                                    "start %" PRId64 ", end_offset %" PRId64
-                                    ", current epoch %" PRId32,
-                                    RD_KAFKAP_STR_PR(&Topic), Partition,
-                                    rd_kafka_err2name(err), FetchOffset, mset,
-                                    on_follower, mpart->start_offset,
-                                    mpart->end_offset, mpart->leader_epoch);
+        /* Fetch sessions (KIP-227) */
+        parts         = &reqparts;
+        RespSessionId = SessionId;
+        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 7 && !all_err) {
+                RespSessionId = 0;
+
+                if (Epoch <= 0) {
+                        /* Full fetch: close the existing session, if any,
+                         * and create a new one unless Epoch is -1. */
+                        if (SessionId &&
+                            (msess = rd_kafka_mock_fetch_session_find(
+                                 mconn->broker, SessionId)))
+                                rd_kafka_mock_fetch_session_destroy(
+                                    mconn->broker, msess);
+
+                        if (Epoch == 0) {
+                                msess = rd_kafka_mock_fetch_session_new(
+                                    mconn->broker);
+                                RD_LIST_FOREACH(part, &reqparts, i)
+                                rd_list_add(
+                                    &msess->parts,
+                                    rd_kafka_mock_fetch_session_part_copy(
+                                        part));
+                                parts = &msess->parts;
+                                RespSessionId       = msess->id;
                         }
 
+                } else if (!(msess = rd_kafka_mock_fetch_session_find(
+                                 mconn->broker, SessionId))) {
+                        all_err = RD_KAFKA_RESP_ERR_FETCH_SESSION_ID_NOT_FOUND;
 
-                        /* Response: ErrorCode */
-                        rd_kafka_buf_write_i16(resp, err);
+                } else if (Epoch != msess->epoch) {
+                        all_err =
+                            RD_KAFKA_RESP_ERR_INVALID_FETCH_SESSION_EPOCH;
 
-                        /* Response: Highwatermark */
-                        rd_kafka_buf_write_i64(
-                            resp,
-                            mpart ? (on_follower ? mpart->follower_end_offset
-                                                 : mpart->end_offset)
-                                  : -1);
+                } else {
+                        /* Incremental fetch: update the session */
+                        RD_LIST_FOREACH(part, &reqparts, i) {
+                                rd_kafka_mock_fetch_session_part_t *spart;
+                                int idx = rd_kafka_mock_fetch_session_part_find(
+                                    msess, part->topic, part->partition);
+
+                                if (idx == -1) {
+                                        rd_list_add(
+                                            &msess->parts,
+                                            rd_kafka_mock_fetch_session_part_copy(
+                                                part));
+                                        continue;
+                                }
 
-                        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 4) {
-                                /* Response: LastStableOffset */
-                                rd_kafka_buf_write_i64(
-                                    resp, mpart ? mpart->end_offset : -1);
+                                spart = rd_list_elem(&msess->parts, idx);
+                                spart->leader_epoch = part->leader_epoch;
+                                spart->fetch_offset = part->fetch_offset;
+                                spart->max_bytes    = part->max_bytes;
                         }
 
-                        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 5) {
-                                /* Response: LogStartOffset */
-                                rd_kafka_buf_write_i64(
-                                    resp,
-                                    !mpart ? -1
-                                           : (on_follower
-                                                  ? mpart->follower_start_offset
-                                                  : mpart->start_offset));
-                        }
+                        RD_LIST_FOREACH(part, &forgotten, i) {
+                                int idx = rd_kafka_mock_fetch_session_part_find(
+                                    msess, part->topic, part->partition);
 
-                        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 4) {
-                                /* Response: #Aborted */
-                                rd_kafka_buf_write_i32(resp, 0);
+                                if (idx != -1) {
+                                        rd_kafka_mock_fetch_session_part_destroy(
+                                            rd_list_elem(&msess->parts, idx));
+                                        rd_list_remove_elem(&msess->parts,
+                                                            idx);
+                                }
                         }
 
+                        msess->epoch =
+                            msess->epoch == INT32_MAX ? 1 : msess->epoch + 1;
+                        parts         = &msess->parts;
+                        RespSessionId = msess->id;
+                        incremental   = rd_true;
+                }
 
-                        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 11) {
-                                int32_t PreferredReadReplica =
-                                    mpart && mpart->leader == mconn->broker &&
-                                            mpart->follower_id != -1
-                                        ? mpart->follower_id
-                                        : -1;
+                if (all_err) {
+                        rd_kafka_dbg(mcluster->rk, MOCK, "MOCK",
+                                     "Broker %" PRId32
+                                     ": Fetch session %" PRId32
+                                     " epoch %" PRId32 ": %s",
+                                     mconn->broker->id, SessionId, Epoch,
+                                     rd_kafka_err2name(all_err));
+                        /* No partitions in the response */
+                        rd_list_clear(&reqparts);
+                }
+        }
 
-                                /* Response: PreferredReplica */
-                                rd_kafka_buf_write_i32(resp,
-                                                       PreferredReadReplica);
+        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 7) {
+                /* Response: ErrorCode */
+                rd_kafka_buf_write_i16(resp, all_err);
 
-                                if (PreferredReadReplica != -1) {
-                                        /* Don't return any data when
-                                         * PreferredReadReplica is set */
-                                        mset    = NULL;
-                                        MaxWait = 0;
-                                }
-                        }
+                /* Response: SessionId */
+                rd_kafka_buf_write_i32(resp, RespSessionId);
+        }
 
+        /* Response: #Topics */
+        of_TopicsCnt = rd_kafka_buf_write_i32(resp, 0);
 
-                        if (mset && partsize < (size_t)PartMaxBytes &&
-                            totsize < (size_t)MaxBytes) {
-                                /* Response: Records */
-                                rd_kafka_buf_write_kbytes(resp, &mset->bytes);
-                                partsize += RD_KAFKAP_BYTES_SIZE(&mset->bytes);
-                                totsize += RD_KAFKAP_BYTES_SIZE(&mset->bytes);
+        RD_LIST_FOREACH(part, parts, i) {
+                rd_kafka_mock_topic_t *mtopic;
+                rd_kafka_mock_partition_t *mpart = NULL;
+                rd_kafka_resp_err_t err          = all_err;
+                rd_bool_t on_follower;
+                size_t partsize                    = 0;
+                const rd_kafka_mock_msgset_t *mset = NULL;
+                int64_t HighwaterMark, LastStableOffset, LogStartOffset;
+                int32_t PreferredReadReplica = -1;
+
+                mtopic = rd_kafka_mock_topic_find(mcluster, part->topic);
+                if (mtopic)
+                        mpart = rd_kafka_mock_partition_find(mtopic,
+                                                             part->partition);
+
+                /* Fetch is directed at follower and this is
+                 * the follower broker. */
+                on_follower = mpart && mpart->follower_id == mconn->broker->id;
+
+                if (!all_err && !mpart)
+                        err = RD_KAFKA_RESP_ERR_UNKNOWN_TOPIC_OR_PART;
+                else if (!all_err && mpart->leader != mconn->broker &&
+                         !on_follower)
+                        err = RD_KAFKA_RESP_ERR_NOT_LEADER_FOR_PARTITION;
+
+                if (!err && mpart)
+                        err = rd_kafka_mock_partition_leader_epoch_check(
+                            mpart, part->leader_epoch);
+
+                /* Find MessageSet for FetchOffset */
+                if (!err && part->fetch_offset != mpart->end_offset) {
+                        /* Kafka currently only returns
+                         * OFFSET_NOT_AVAILABLE
+                         * in ListOffsets calls */
+                        if (!(mset = rd_kafka_mock_msgset_find(
+                                  mpart, part->fetch_offset, on_follower)))
+                                err = RD_KAFKA_RESP_ERR_OFFSET_OUT_OF_RANGE;
+                        rd_kafka_dbg(
+                            mcluster->rk, MOCK, "MOCK",
+                            "Topic %s [%" PRId32
+                            "] fetch err %s for offset %" PRId64
+                            " mset %p, on_follower %d, "
+                            "start %" PRId64 ", end_offset %" PRId64
+                            ", current epoch %" PRId32,
+                            part->topic, part->partition,
+                            rd_kafka_err2name(err), part->fetch_offset, mset,
+                            on_follower, mpart->start_offset,
+                            mpart->end_offset, mpart->leader_epoch);
+                }
 
-                                /* FIXME: Multiple messageSets ? */
-                        } else {
-                                /* Empty Response: Records: Null */
-                                rd_kafka_buf_write_i32(resp, 0);
-                        }
+                HighwaterMark    = mpart ? (on_follower
+                                                ? mpart->follower_end_offset
+                                                : mpart->end_offset)
+                                         : -1;
+                LastStableOffset = mpart ? mpart->end_offset : -1;
+                LogStartOffset =
+                    !mpart ? -1
+                           : (on_follower ? mpart->follower_start_offset
+                                          : mpart->start_offset);
+
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 11 && mpart &&
+                    mpart->leader == mconn->broker &&
+                    mpart->follower_id != -1) {
+                        PreferredReadReplica = mpart->follower_id;
+                        /* Don't return any data when
+                         * PreferredReadReplica is set */
+                        mset    = NULL;
+                        MaxWait = 0;
                 }
-        }
 
-        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 7) {
-                int32_t ForgottenTopicCnt;
-                rd_kafka_buf_read_i32(rkbuf, &ForgottenTopicCnt);
-                while (ForgottenTopicCnt-- > 0) {
-                        rd_kafkap_str_t Topic;
-                        int32_t ForgPartCnt;
-                        rd_kafka_buf_read_str(rkbuf, &Topic);
-                        rd_kafka_buf_read_i32(rkbuf, &ForgPartCnt);
-                        while (ForgPartCnt-- > 0) {
-                                int32_t Partition;
-                                rd_kafka_buf_read_i32(rkbuf, &Partition);
-                        }
+                if (!(mset && partsize < (size_t)part->max_bytes &&
+                      totsize < (size_t)MaxBytes))
+                        mset = NULL;
+
+                /* An incremental fetch response only includes the
+                 * partitions with new data, changed offsets or errors. */
+                if (incremental && !err && !mset &&
+                    PreferredReadReplica == -1 &&
+                    HighwaterMark == part->hwm &&
+                    LastStableOffset == part->lso &&
+                    LogStartOffset == part->log_start)
+                        continue;
+
+                part->hwm       = HighwaterMark;
+                part->lso       = LastStableOffset;
+                part->log_start = LogStartOffset;
+
+                if (!topic_last || strcmp(topic_last, part->topic)) {
+                        if (topic_last)
+                                rd_kafka_buf_update_i32(resp, of_PartitionCnt,
+                                                        RespPartitionCnt);
+                        /* Response: Topic */
+                        rd_kafka_buf_write_str(resp, part->topic, -1);
+                        /* Response: #Partitions */
+                        of_PartitionCnt  = rd_kafka_buf_write_i32(resp, 0);
+                        RespPartitionCnt = 0;
+                        RespTopicsCnt++;
+                        topic_last = part->topic;
                 }
-        }
+                RespPartitionCnt++;
 
-        if (rkbuf->rkbuf_reqhdr.ApiVersion >= 11) {
-                rd_kafkap_str_t RackId;
-                char *rack;
-                rd_kafka_buf_read_str(rkbuf, &RackId);
-                RD_KAFKAP_STR_DUPA(&rack, &RackId);
-                /* Matt might do something sensible with this */
+                /* Response: Partition */
+                rd_kafka_buf_write_i32(resp, part->partition);
+
+                /* Response: ErrorCode */
+                rd_kafka_buf_write_i16(resp, err);
+
+                /* Response: Highwatermark */
+                rd_kafka_buf_write_i64(resp, HighwaterMark);
+
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 4) {
+                        /* Response: LastStableOffset */
+                        rd_kafka_buf_write_i64(resp, LastStableOffset);
+                }
+
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 5) {
+                        /* Response: LogStartOffset */
+                        rd_kafka_buf_write_i64(resp, LogStartOffset);
+                }
+
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 4) {
+                        /* Response: #Aborted */
+                        rd_kafka_buf_write_i32(resp, 0);
+                }
+
+
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 11) {
+                        /* Response: PreferredReplica */
+                        rd_kafka_buf_write_i32(resp, PreferredReadReplica);
+                }
+
+
+                if (mset) {
+                        /* Response: Records */
+                        rd_kafka_buf_write_kbytes(resp, &mset->bytes);
+                        partsize += RD_KAFKAP_BYTES_SIZE(&mset->bytes);
+                        totsize += RD_KAFKAP_BYTES_SIZE(&mset->bytes);
+
+                        /* FIXME: Multiple messageSets ? */
+                } else {
+                        /* Empty Response: Records: Null */
+                        rd_kafka_buf_write_i32(resp, 0);
+                }
         }
 
+        if (topic_last)
+                rd_kafka_buf_update_i32(resp, of_PartitionCnt,
+                                        RespPartitionCnt);
+        rd_kafka_buf_update_i32(resp, of_TopicsCnt, RespTopicsCnt);
+
+        rd_list_destroy(&reqparts);
+        rd_list_destroy(&forgotten);
+
         /* If there was no data, delay up to MaxWait.
          * This isn't strictly correct since we should cut the wait short
          * and feed newly produced data if a producer writes to the
@@ -400,6 +536,8 @@ static int rd_kafka_mock_handle_Fetch(rd_kafka_mock_connection_t *mconn,
         return 0;
 
 err_parse:
+        rd_list_destroy(&reqparts);
+        rd_list_destroy(&forgotten);
         rd_kafka_buf_destroy(resp);
         return -1;
 }
@@ -726,6 +864,7 @@ static int rd_kafka_mock_handle_OffsetCommit(rd_kafka_mock_connection_t *mconn,
 
         if (!all_err) {
                 rd_kafka_mock_cgrp_t *mcgrp;
+                rd_kafka_mock_cgrp_consumer_t *mcgrp_consumer;
 
                 mcgrp = rd_kafka_mock_cgrp_find(mcluster, &GroupId);
                 if (mcgrp) {
@@ -740,15 +879,34 @@ static int rd_kafka_mock_handle_OffsetCommit(rd_kafka_mock_connection_t *mconn,
                         else
                                 all_err = rd_kafka_mock_cgrp_check_state(
                                     mcgrp, member, rkbuf, GenerationId);
+                } else if ((mcgrp_consumer =
+                                rd_kafka_mock_cgrp_consumer_find(mcluster,
+                                                                 &GroupId))) {
+                        /* Consumer group protocol (KIP-848) group:
+                         * v9 is required and the GenerationId is the
+                         * member epoch. */
+                        rd_kafka_mock_cgrp_consumer_member_t *member;
+
+                        member = rd_kafka_mock_cgrp_consumer_member_find(
+                            mcgrp_consumer, &MemberId);
+
+                        if (rkbuf->rkbuf_reqhdr.ApiVersion < 9)
+                                all_err = RD_KAFKA_RESP_ERR_UNSUPPORTED_VERSION;
+                        else if (!member)
+                                all_err = RD_KAFKA_RESP_ERR_UNKNOWN_MEMBER_ID;
+                        else if (GenerationId < member->member_epoch)
+                                all_err = RD_KAFKA_RESP_ERR_STALE_MEMBER_EPOCH;
+                        else if (GenerationId > member->member_epoch)
+                                all_err = RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH;
                 }
 
                 /* FIXME: also check that partitions are assigned to member */
         }
 
-        rd_kafka_buf_read_i32(rkbuf, &TopicsCnt);
+        rd_kafka_buf_read_arraycnt(rkbuf, &TopicsCnt, RD_KAFKAP_TOPICS_MAX);
 
         /* Response: #Topics */
-        rd_kafka_buf_write_i32(resp, TopicsCnt);
+        rd_kafka_buf_write_arraycnt(resp, TopicsCnt);
 
         while (TopicsCnt-- > 0) {
                 rd_kafkap_str_t Topic;
@@ -756,14 +914,15 @@ static int rd_kafka_mock_handle_OffsetCommit(rd_kafka_mock_connection_t *mconn,
                 rd_kafka_mock_topic_t *mtopic;
 
                 rd_kafka_buf_read_str(rkbuf, &Topic);
-                rd_kafka_buf_read_i32(rkbuf, &PartitionCnt);
+                rd_kafka_buf_read_arraycnt(rkbuf, &PartitionCnt,
+                                           RD_KAFKAP_PARTITIONS_MAX);
 
                 mtopic = rd_kafka_mock_topic_find_by_kstr(mcluster, &Topic);
 
                 /* Response: Topic */
                 rd_kafka_buf_write_kstr(resp, &Topic);
                 /* Response: #Partitions */
-                rd_kafka_buf_write_i32(resp, PartitionCnt);
+                rd_kafka_buf_write_arraycnt(resp, PartitionCnt);
 
                 while (PartitionCnt-- > 0) {
                         int32_t Partition;
@@ -803,6 +962,7 @@ static int rd_kafka_mock_handle_OffsetCommit(rd_kafka_mock_connection_t *mconn,
                         }
 
                         rd_kafka_buf_read_str(rkbuf, &Metadata);
+                        rd_kafka_buf_skip_tags(rkbuf);
 
                         if (!err)
                                 rd_kafka_mock_commit_offset(mpart, &GroupId,
@@ -811,9 +971,16 @@ static int rd_kafka_mock_handle_OffsetCommit(rd_kafka_mock_connection_t *mconn,
 
                         /* Response: ErrorCode */
                         rd_kafka_buf_write_i16(resp, err);
+                        rd_kafka_buf_write_tags(resp);
                 }
+
+                rd_kafka_buf_skip_tags(rkbuf);
+                rd_kafka_buf_write_tags(resp);
         }
 
+        rd_kafka_buf_skip_tags(rkbuf);
+        rd_kafka_buf_write_tags(resp);
+
         rd_kafka_mock_connection_send_response(mconn, resp);
 
         return 0;
@@ -853,6 +1020,11 @@ rd_kafka_mock_buf_write_Metadata_Topic(rd_kafka_buf_t *resp,
         rd_kafka_buf_write_i16(resp, err);
         /* Response: Topics.Name */
         rd_kafka_buf_write_str(resp, topic, -1);
+        if (ApiVersion >= 10) {
+                /* Response: Topics.TopicId */
+                rd_kafka_Uuid_t zero_uuid = RD_KAFKA_UUID_ZERO;
+                rd_kafka_buf_write_uuid(resp, mtopic ? mtopic->id : zero_uuid);
+        }
         if (ApiVersion >= 1) {
                 /* Response: Topics.IsInternal */
                 rd_kafka_buf_write_bool(resp, rd_false);
@@ -964,6 +1136,12 @@ static int rd_kafka_mock_handle_Metadata(rd_kafka_mock_connection_t *mconn,
                 rd_kafkap_str_t Topic;
                 char *topic;
 
+                if (rkbuf->rkbuf_reqhdr.ApiVersion >= 10) {
+                        rd_kafka_Uuid_t TopicId;
+                        /* TopicId */
+                        rd_kafka_buf_read_uuid(rkbuf, &TopicId);
+                }
+
                 rd_kafka_buf_read_str(rkbuf, &Topic);
                 RD_KAFKAP_STR_DUPA(&topic, &Topic);
 
@@ -2104,6 +2282,210 @@ err_parse:
 }
 
 
+/**
+ * @brief Handle ConsumerGroupHeartbeatRequest (KIP-848)
+ */
+static int
+rd_kafka_mock_handle_ConsumerGroupHeartbeat(rd_kafka_mock_connection_t *mconn,
+                                            rd_kafka_buf_t *rkbuf) {
+        rd_kafka_mock_cluster_t *mcluster = mconn->broker->cluster;
+        rd_kafka_mock_broker_t *mrkb;
+        const rd_bool_t log_decode_errors = rd_true;
+        rd_kafka_buf_t *resp = rd_kafka_mock_buf_new_response(rkbuf);
+        rd_kafkap_str_t GroupId, MemberId, InstanceId, RackId, ServerAssignor;
+        int32_t MemberEpoch, RebalanceTimeoutMs, TopicCnt;
+        rd_list_t *subscription                      = NULL;
+        rd_kafka_topic_partition_list_t *owned       = NULL;
+        rd_kafka_mock_cgrp_consumer_t *mcgrp         = NULL;
+        rd_kafka_mock_cgrp_consumer_member_t *member = NULL;
+        char *assignor                               = NULL;
+        rd_kafka_resp_err_t err;
+        int32_t i;
+
+        rd_kafka_buf_read_str(rkbuf, &GroupId);
+        rd_kafka_buf_read_str(rkbuf, &MemberId);
+        rd_kafka_buf_read_i32(rkbuf, &MemberEpoch);
+        rd_kafka_buf_read_str(rkbuf, &InstanceId);
+        rd_kafka_buf_read_str(rkbuf, &RackId);
+        rd_kafka_buf_read_i32(rkbuf, &RebalanceTimeoutMs);
+
+        /* SubscribedTopicNames: null if unchanged */
+        rd_kafka_buf_read_arraycnt(rkbuf, &TopicCnt, RD_KAFKAP_TOPICS_MAX);
+        if (TopicCnt >= 0) {
+                subscription = rd_list_new(TopicCnt, rd_free);
+                for (i = 0; i < TopicCnt; i++) {
+                        rd_kafkap_str_t Topic;
+                        rd_kafka_buf_read_str(rkbuf, &Topic);
+                        rd_list_add(subscription, RD_KAFKAP_STR_DUP(&Topic));
+                }
+        }
+
+        rd_kafka_buf_read_str(rkbuf, &ServerAssignor);
+        if (!RD_KAFKAP_STR_IS_NULL(&ServerAssignor))
+                RD_KAFKAP_STR_DUPA(&assignor, &ServerAssignor);
+
+        /* TopicPartitions: null if unchanged */
+        rd_kafka_buf_read_arraycnt(rkbuf, &TopicCnt, RD_KAFKAP_TOPICS_MAX);
+        if (TopicCnt >= 0) {
+                owned = rd_kafka_topic_partition_list_new(0);
+                for (i = 0; i < TopicCnt; i++) {
+                        rd_kafka_Uuid_t TopicId;
+                        int32_t PartitionCnt;
+                        const rd_kafka_mock_topic_t *mtopic;
+
+                        rd_kafka_buf_read_uuid(rkbuf, &TopicId);
+                        rd_kafka_buf_read_arraycnt(rkbuf, &PartitionCnt,
+                                                   RD_KAFKAP_PARTITIONS_MAX);
+
+                        mtopic =
+                            rd_kafka_mock_topic_find_by_id(mcluster, TopicId);
+
+                        while (PartitionCnt-- > 0) {
+                                int32_t Partition;
+                                rd_kafka_buf_read_i32(rkbuf, &Partition);
+                                if (mtopic)
+                                        rd_kafka_topic_partition_list_add(
+                                            owned, mtopic->name, Partition);
+                        }
+
+                        rd_kafka_buf_skip_tags(rkbuf);
+                }
+        }
+
+        /*
+         * Construct response
+         */
+
+        /* Response: Throttle */
+        rd_kafka_buf_write_i32(resp, 0);
+
+        /* Inject error, if any */
+        err = rd_kafka_mock_next_request_error(mconn, resp);
+        if (!err) {
+                mrkb = rd_kafka_mock_cluster_get_coord(
+                    mcluster, RD_KAFKA_COORD_GROUP, &GroupId);
+
+                if (!mrkb)
+                        err = RD_KAFKA_RESP_ERR_COORDINATOR_NOT_AVAILABLE;
+                else if (mrkb != mconn->broker)
+                        err = RD_KAFKA_RESP_ERR_NOT_COORDINATOR;
+        }
+
+        if (!err && MemberEpoch == 0) {
+                /* Join */
+                mcgrp = rd_kafka_mock_cgrp_consumer_get(mcluster, &GroupId);
+                member = rd_kafka_mock_cgrp_consumer_member_add(
+                    mcgrp, &MemberId, &InstanceId);
+
+        } else if (!err) {
+                mcgrp = rd_kafka_mock_cgrp_consumer_find(mcluster, &GroupId);
+                if (mcgrp)
+                        member = rd_kafka_mock_cgrp_consumer_member_find(
+                            mcgrp, &MemberId);
+
+                if (!member)
+                        err = RD_KAFKA_RESP_ERR_UNKNOWN_MEMBER_ID;
+                else if (MemberEpoch < 0) {
+                        /* Leave */
+                        rd_kafka_mock_cgrp_consumer_member_leave(mcgrp,
+                                                                 member);
+                        member = NULL;
+                } else if (MemberEpoch > member->member_epoch)
+                        err = RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH;
+        }
+
+        if (!err && member) {
+                err = rd_kafka_mock_cgrp_consumer_member_heartbeat(
+                    mcgrp, member, subscription, assignor, owned);
+                if (err && MemberEpoch == 0) {
+                        /* Failed join */
+                        rd_kafka_mock_cgrp_consumer_member_leave(mcgrp,
+                                                                 member);
+                        member = NULL;
+                }
+        }
+
+        /* Response: ErrorCode */
+        rd_kafka_buf_write_i16(resp, err);
+        /* Response: ErrorMessage */
+        rd_kafka_buf_write_str(resp, err ? rd_kafka_err2str(err) : NULL, -1);
+        /* Response: MemberId */
+        rd_kafka_buf_write_str(resp, !err && member ? member->id : NULL, -1);
+        /* Response: MemberEpoch */
+        rd_kafka_buf_write_i32(resp, !err && member ? member->member_epoch
+                                                    : MemberEpoch);
+        /* Response: HeartbeatIntervalMs */
+        rd_kafka_buf_write_i32(
+            resp, mcluster->defaults.group_consumer_heartbeat_interval_ms);
+
+        /* Response: Assignment: nullable struct */
+        if (!err && member && member->assigned_changed) {
+                const rd_kafka_topic_partition_list_t *assigned =
+                    member->assigned;
+                int topic_cnt = 0;
+                int j;
+
+                /* .assigned is ordered by topic */
+                for (i = 0; i < assigned->cnt; i++)
+                        if (i == 0 || strcmp(assigned->elems[i].topic,
+                                             assigned->elems[i - 1].topic))
+                                topic_cnt++;
+
+                rd_kafka_buf_write_i8(resp, 1);
+                /* Response: TopicPartitions */
+                rd_kafka_buf_write_arraycnt(resp, topic_cnt);
+                for (i = 0; i < assigned->cnt;) {
+                        const char *topic = assigned->elems[i].topic;
+                        const rd_kafka_mock_topic_t *mtopic =
+                            rd_kafka_mock_topic_find(mcluster, topic);
+                        rd_kafka_Uuid_t TopicId = RD_KAFKA_UUID_ZERO;
+
+                        for (j = i; j < assigned->cnt &&
+                                    !strcmp(assigned->elems[j].topic, topic);
+                             j++)
+                                ;
+
+                        if (mtopic)
+                                TopicId = mtopic->id;
+
+                        /* Response: TopicId */
+                        rd_kafka_buf_write_uuid(resp, TopicId);
+                        /* Response: Partitions */
+                        rd_kafka_buf_write_arraycnt(resp, j - i);
+                        for (; i < j; i++)
+                                rd_kafka_buf_write_i32(
+                                    resp, assigned->elems[i].partition);
+                        rd_kafka_buf_write_tags(resp);
+                }
+                rd_kafka_buf_write_tags(resp);
+
+                member->assigned_changed = rd_false;
+        } else {
+                rd_kafka_buf_write_i8(resp, -1);
+        }
+
+        rd_kafka_buf_write_tags(resp);
+
+        rd_kafka_mock_connection_send_response(mconn, resp);
+
+        if (subscription)
+                rd_list_destroy(subscription);
+        if (owned)
+                rd_kafka_topic_partition_list_destroy(owned);
+
+        return 0;
+
+err_parse:
+        if (subscription)
+                rd_list_destroy(subscription);
+        if (owned)
+                rd_kafka_topic_partition_list_destroy(owned);
+        rd_kafka_buf_destroy(resp);
+        return -1;
+}
+
+
+
 /**
  * @brief Default request handlers
  */
@@ -2114,9 +2496,9 @@ const struct rd_kafka_mock_api_handler
         [RD_KAFKAP_Fetch]        = {0, 11, -1, rd_kafka_mock_handle_Fetch},
         [RD_KAFKAP_ListOffsets]  = {0, 5, -1, rd_kafka_mock_handle_ListOffsets},
         [RD_KAFKAP_OffsetFetch]  = {0, 6, 6, rd_kafka_mock_handle_OffsetFetch},
-        [RD_KAFKAP_OffsetCommit] = {0, 8, 8, rd_kafka_mock_handle_OffsetCommit},
+        [RD_KAFKAP_OffsetCommit] = {0, 9, 8, rd_kafka_mock_handle_OffsetCommit},
         [RD_KAFKAP_ApiVersion]   = {0, 2, 3, rd_kafka_mock_handle_ApiVersion},
-        [RD_KAFKAP_Metadata]     = {0, 9, 9, rd_kafka_mock_handle_Metadata},
+        [RD_KAFKAP_Metadata]     = {0, 10, 9, rd_kafka_mock_handle_Metadata},
         [RD_KAFKAP_FindCoordinator] = {0, 3, 3,
                                        rd_kafka_mock_handle_FindCoordinator},
         [RD_KAFKAP_InitProducerId]  = {0, 4, 2,
@@ -2134,6 +2516,8 @@ const struct rd_kafka_mock_api_handler
         [RD_KAFKAP_EndTxn]          = {0, 1, -1, rd_kafka_mock_handle_EndTxn},
         [RD_KAFKAP_OffsetForLeaderEpoch] =
             {2, 2, -1, rd_kafka_mock_handle_OffsetForLeaderEpoch},
+        [RD_KAFKAP_ConsumerGroupHeartbeat] =
+            {0, 0, 0, rd_kafka_mock_handle_ConsumerGroupHeartbeat},
 };
 
 
@@ -114,6 +114,46 @@ typedef struct rd_kafka_mock_cgrp_s {
 } rd_kafka_mock_cgrp_t;
 
 
+/**
+ * @struct Consumer group protocol (KIP-848) member.
+ */
+typedef struct rd_kafka_mock_cgrp_consumer_member_s {
+        TAILQ_ENTRY(rd_kafka_mock_cgrp_consumer_member_s) link;
+        char *id;                 /**< MemberId */
+        char *instance_id;        /**< Group instance id, or NULL */
+        int32_t member_epoch;     /**< Current member epoch */
+        rd_ts_t ts_last_activity; /**< Last heartbeat */
+        rd_list_t subscription;   /**< Subscribed topic names (char *) */
+        /** Target assignment computed by the server side assignor. */
+        rd_kafka_topic_partition_list_t *target;
+        /** Partitions handed out to the member: the target assignment
+         *  minus partitions not yet released by other members. */
+        rd_kafka_topic_partition_list_t *assigned;
+        /** Partitions the member reported owning in its last heartbeat. */
+        rd_kafka_topic_partition_list_t *owned;
+        /** True if .assigned changed since the last heartbeat response. */
+        rd_bool_t assigned_changed;
+} rd_kafka_mock_cgrp_consumer_member_t;
+
+/**
+ * @struct Consumer group protocol (KIP-848) group.
+ */
+typedef struct rd_kafka_mock_cgrp_consumer_s {
+        TAILQ_ENTRY(rd_kafka_mock_cgrp_consumer_s) link;
+        struct rd_kafka_mock_cluster_s *cluster; /**< Cluster */
+        char *id;                                /**< Group Id */
+        char *assignor;            /**< Server side assignor name */
+        int32_t group_epoch;       /**< Bumped on membership or
+                                    *   subscription changes. */
+        int32_t assignment_epoch;  /**< Group epoch of the current
+                                    *   target assignment. */
+        rd_kafka_timer_t session_tmr; /**< Session timeout timer */
+        TAILQ_HEAD(, rd_kafka_mock_cgrp_consumer_member_s)
+        members;        /**< Group members */
+        int member_cnt; /**< Number of group members */
+} rd_kafka_mock_cgrp_consumer_t;
+
+
 /**
  * @struct TransactionalId + PID (+ optional sequence state)
  */
@@ -188,6 +228,33 @@ typedef struct rd_kafka_mock_connection_s {
 /**
  * @struct Mock broker
  */
+/**
+ * @struct Fetch session (KIP-227) partition.
+ */
+typedef struct rd_kafka_mock_fetch_session_part_s {
+        char *topic;
+        int32_t partition;
+        int32_t leader_epoch; /**< CurrentLeaderEpoch */
+        int64_t fetch_offset;
+        int32_t max_bytes;
+        /**< Last returned HighwaterMark, LastStableOffset and
+         *   LogStartOffset, used to decide whether to include the partition
+         *   in incremental fetch responses, or -1 if not yet returned. */
+        int64_t hwm, lso, log_start;
+} rd_kafka_mock_fetch_session_part_t;
+
+
+/**
+ * @struct Fetch session (KIP-227).
+ */
+typedef struct rd_kafka_mock_fetch_session_s {
+        TAILQ_ENTRY(rd_kafka_mock_fetch_session_s) link;
+        int32_t id;
+        int32_t epoch;   /**< Next expected epoch */
+        rd_list_t parts; /**< rd_kafka_mock_fetch_session_part_t * */
+} rd_kafka_mock_fetch_session_t;
+
+
 typedef struct rd_kafka_mock_broker_s {
         TAILQ_ENTRY(rd_kafka_mock_broker_s) link;
         int32_t id;
@@ -206,6 +273,10 @@ typedef struct rd_kafka_mock_broker_s {
          *   @locks mcluster->lock */
         rd_kafka_mock_error_stack_head_t errstacks;
 
+        /**< Fetch sessions (KIP-227) */
+        TAILQ_HEAD(, rd_kafka_mock_fetch_session_s) fetch_sessions;
+        int32_t fetch_session_id_next; /**< Last assigned SessionId */
+
         struct rd_kafka_mock_cluster_s *cluster;
 } rd_kafka_mock_broker_t;
 
@@ -284,6 +355,7 @@ typedef struct rd_kafka_mock_partition_s {
 typedef struct rd_kafka_mock_topic_s {
         TAILQ_ENTRY(rd_kafka_mock_topic_s) link;
         char *name;
+        rd_kafka_Uuid_t id; /**< Topic id (random) */
 
         rd_kafka_mock_partition_t *partitions;
         int partition_cnt;
@@ -346,6 +418,9 @@ struct rd_kafka_mock_cluster_s {
 
         TAILQ_HEAD(, rd_kafka_mock_cgrp_s) cgrps;
 
+        /** Consumer group protocol (KIP-848) groups */
+        TAILQ_HEAD(, rd_kafka_mock_cgrp_consumer_s) cgrps_consumer;
+
         /** Explicit coordinators (set with mock_set_coordinator()) */
         TAILQ_HEAD(, rd_kafka_mock_coord_s) coords;
 
@@ -378,6 +453,10 @@ struct rd_kafka_mock_cluster_s {
         struct {
                 int partition_cnt;      /**< Auto topic create part cnt */
                 int replication_factor; /**< Auto topic create repl factor */
+                /** Consumer group protocol session timeout */
+                int group_consumer_session_timeout_ms;
+                /** Consumer group protocol heartbeat interval */
+                int group_consumer_heartbeat_interval_ms;
         } defaults;
 
         /**< Dynamic array of IO handlers for corresponding fd in .fds */
@@ -423,6 +502,9 @@ rd_kafka_mock_topic_find(const rd_kafka_mock_cluster_t *mcluster,
 rd_kafka_mock_topic_t *
 rd_kafka_mock_topic_find_by_kstr(const rd_kafka_mock_cluster_t *mcluster,
                                  const rd_kafkap_str_t *kname);
+rd_kafka_mock_topic_t *
+rd_kafka_mock_topic_find_by_id(const rd_kafka_mock_cluster_t *mcluster,
+                               rd_kafka_Uuid_t id);
 rd_kafka_mock_broker_t *
 rd_kafka_mock_cluster_get_coord(rd_kafka_mock_cluster_t *mcluster,
                                 rd_kafka_coordtype_t KeyType,
@@ -452,6 +534,23 @@ rd_kafka_mock_partition_log_append(rd_kafka_mock_partition_t *mpart,
                                    const rd_kafkap_str_t *TransactionalId,
                                    int64_t *BaseOffset);
 
+rd_kafka_mock_fetch_session_part_t *
+rd_kafka_mock_fetch_session_part_new(const rd_kafkap_str_t *topic,
+                                     int32_t partition);
+rd_kafka_mock_fetch_session_part_t *rd_kafka_mock_fetch_session_part_copy(
+    const rd_kafka_mock_fetch_session_part_t *src);
+void rd_kafka_mock_fetch_session_part_destroy(void *ptr);
+int rd_kafka_mock_fetch_session_part_find(
+    const rd_kafka_mock_fetch_session_t *msess,
+    const char *topic,
+    int32_t partition);
+rd_kafka_mock_fetch_session_t *
+rd_kafka_mock_fetch_session_new(rd_kafka_mock_broker_t *mrkb);
+rd_kafka_mock_fetch_session_t *
+rd_kafka_mock_fetch_session_find(rd_kafka_mock_broker_t *mrkb, int32_t id);
+void rd_kafka_mock_fetch_session_destroy(rd_kafka_mock_broker_t *mrkb,
+                                         rd_kafka_mock_fetch_session_t *msess);
+
 rd_kafka_resp_err_t rd_kafka_mock_partition_leader_epoch_check(
     const rd_kafka_mock_partition_t *mpart,
     int32_t leader_epoch);
@@ -527,6 +626,31 @@ rd_kafka_mock_cgrp_get(rd_kafka_mock_cluster_t *mcluster,
 void rd_kafka_mock_cgrps_connection_closed(rd_kafka_mock_cluster_t *mcluster,
                                            rd_kafka_mock_connection_t *mconn);
 
+rd_kafka_mock_cgrp_consumer_t *
+rd_kafka_mock_cgrp_consumer_find(rd_kafka_mock_cluster_t *mcluster,
+                                 const rd_kafkap_str_t *GroupId);
+rd_kafka_mock_cgrp_consumer_t *
+rd_kafka_mock_cgrp_consumer_get(rd_kafka_mock_cluster_t *mcluster,
+                                const rd_kafkap_str_t *GroupId);
+void rd_kafka_mock_cgrp_consumer_destroy(rd_kafka_mock_cgrp_consumer_t *mcgrp);
+rd_kafka_mock_cgrp_consumer_member_t *
+rd_kafka_mock_cgrp_consumer_member_find(
+    const rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    const rd_kafkap_str_t *MemberId);
+rd_kafka_mock_cgrp_consumer_member_t *
+rd_kafka_mock_cgrp_consumer_member_add(rd_kafka_mock_cgrp_consumer_t *mcgrp,
+                                       const rd_kafkap_str_t *MemberId,
+                                       const rd_kafkap_str_t *InstanceId);
+void rd_kafka_mock_cgrp_consumer_member_leave(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member);
+rd_kafka_resp_err_t rd_kafka_mock_cgrp_consumer_member_heartbeat(
+    rd_kafka_mock_cgrp_consumer_t *mcgrp,
+    rd_kafka_mock_cgrp_consumer_member_t *member,
+    const rd_list_t *subscription,
+    const char *assignor,
+    rd_kafka_topic_partition_list_t *owned);
+
 
 /**
  *@}
@@ -110,7 +110,8 @@ void rd_kafka_msg_destroy(rd_kafka_t *rk, rd_kafka_msg_t *rkm) {
         if (rkm->rkm_flags & RD_KAFKA_MSG_F_ACCOUNT) {
                 rd_dassert(rk || rkm->rkm_rkmessage.rkt);
                 rd_kafka_curr_msgs_sub(rk ? rk : rkm->rkm_rkmessage.rkt->rkt_rk,
-                                       1, rkm->rkm_len);
+                                       1, rkm->rkm_len,
+                                       rkm->rkm_u.producer.mem_size);
         }
 
         if (rkm->rkm_headers)
@@ -222,13 +223,21 @@ static rd_kafka_msg_t *rd_kafka_msg_new0(rd_kafka_topic_t *rkt,
                                          rd_ts_t now) {
         rd_kafka_msg_t *rkm;
         size_t hdrs_size = 0;
+        size_t mem_size;
 
         if (unlikely(!payload))
                 len = 0;
         if (!key)
                 keylen = 0;
-        if (hdrs)
+
+        /* The memory footprint of the message: the message struct,
+         * the payload (copied or not) and key, and the headers. */
+        mem_size = sizeof(*rkm) + len + keylen;
+
+        if (hdrs) {
                 hdrs_size = rd_kafka_headers_serialized_size(hdrs);
+                mem_size += rd_kafka_headers_mem_size(hdrs);
+        }
 
         if (unlikely(len > INT32_MAX || keylen > INT32_MAX ||
                      rd_kafka_msg_max_wire_size(keylen, len, hdrs_size) >
@@ -241,11 +250,12 @@ static rd_kafka_msg_t *rd_kafka_msg_new0(rd_kafka_topic_t *rkt,
 
         if (msgflags & RD_KAFKA_MSG_F_BLOCK)
                 *errp = rd_kafka_curr_msgs_add(
-                    rkt->rkt_rk, 1, len, 1 /*block*/,
+                    rkt->rkt_rk, 1, len, mem_size, 1 /*block*/,
                     (msgflags & RD_KAFKA_MSG_F_RKT_RDLOCKED) ? &rkt->rkt_lock
                                                              : NULL);
         else
-                *errp = rd_kafka_curr_msgs_add(rkt->rkt_rk, 1, len, 0, NULL);
+                *errp = rd_kafka_curr_msgs_add(rkt->rkt_rk, 1, len, mem_size,
+                                               0, NULL);
 
         if (unlikely(*errp)) {
                 if (errnop)
@@ -260,6 +270,7 @@ static rd_kafka_msg_t *rd_kafka_msg_new0(rd_kafka_topic_t *rkt,
             len, key, keylen, msg_opaque);
 
         memset(&rkm->rkm_u.producer, 0, sizeof(rkm->rkm_u.producer));
+        rkm->rkm_u.producer.mem_size = (uint32_t)mem_size;
 
         if (timestamp)
                 rkm->rkm_timestamp = timestamp;
@@ -1517,6 +1528,157 @@ rd_kafka_message_headers(const rd_kafka_message_t *rkmessage,
 }
 
 
+/**
+ * @brief Read the raw protocol header at byte offset \p *ofp of the
+ *        consumed message's unparsed headers \p binhdrs, without copying,
+ *        and advance \p *ofp to the next header.
+ *        An offset of 0 is the start of the headers.
+ *
+ * @returns RD_KAFKA_RESP_ERR_NO_ERROR if a header was read,
+ *          RD_KAFKA_RESP_ERR__NOENT at the end of the headers, or
+ *          RD_KAFKA_RESP_ERR__BAD_MSG if the headers are malformed.
+ */
+static rd_kafka_resp_err_t
+rd_kafka_msg_binhdrs_next(const rd_kafkap_bytes_t *binhdrs,
+                          size_t *ofp,
+                          const char **namep,
+                          size_t *name_sizep,
+                          const void **valuep,
+                          size_t *sizep) {
+        const char *buf = binhdrs->data;
+        size_t len      = (size_t)RD_KAFKAP_BYTES_LEN(binhdrs);
+        size_t of       = *ofp;
+        int64_t KeyLen, ValueLen;
+        size_t r;
+
+        if (of == 0) {
+                int64_t HeaderCount;
+
+                if (len == 0)
+                        return RD_KAFKA_RESP_ERR__NOENT;
+
+                r = rd_varint_dec_i64(buf, len, &HeaderCount);
+                if (RD_UVARINT_DEC_FAILED(r))
+                        return RD_KAFKA_RESP_ERR__BAD_MSG;
+                else if (HeaderCount <= 0)
+                        return RD_KAFKA_RESP_ERR__NOENT;
+
+                of = r;
+        }
+
+        if (of >= len)
+                return RD_KAFKA_RESP_ERR__NOENT;
+
+        r = rd_varint_dec_i64(buf + of, len - of, &KeyLen);
+        if (RD_UVARINT_DEC_FAILED(r) || KeyLen < 0 ||
+            (size_t)KeyLen > len - of - r)
+                return RD_KAFKA_RESP_ERR__BAD_MSG;
+        of += r;
+
+        *namep      = buf + of;
+        *name_sizep = (size_t)KeyLen;
+        of += (size_t)KeyLen;
+
+        r = rd_varint_dec_i64(buf + of, len - of, &ValueLen);
+        if (RD_UVARINT_DEC_FAILED(r) || ValueLen < -1 ||
+            (ValueLen > 0 && (size_t)ValueLen > len - of - r))
+                return RD_KAFKA_RESP_ERR__BAD_MSG;
+        of += r;
+
+        if (ValueLen == -1) {
+                *valuep = NULL;
+                *sizep  = 0;
+        } else {
+                *valuep = buf + of;
+                *sizep  = (size_t)ValueLen;
+                of += (size_t)ValueLen;
+        }
+
+        *ofp = of;
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
+rd_kafka_resp_err_t
+rd_kafka_message_header_peek_all(const rd_kafka_message_t *rkmessage,
+                                 size_t *iterp,
+                                 const char **namep,
+                                 size_t *name_sizep,
+                                 const void **valuep,
+                                 size_t *sizep) {
+        const rd_kafka_msg_t *rkm =
+            rd_kafka_message2msg((rd_kafka_message_t *)rkmessage);
+
+        /* Materialized header list: the iterator is a list index */
+        if (rkm->rkm_headers) {
+                const rd_kafka_header_t *hdr;
+
+                rd_kafka_headers_parse(rkm->rkm_headers);
+
+                if (!(hdr = rd_list_elem(&rkm->rkm_headers->rkhdrs_list,
+                                         (int)*iterp)))
+                        return RD_KAFKA_RESP_ERR__NOENT;
+
+                *namep      = hdr->rkhdr_name;
+                *name_sizep = hdr->rkhdr_name_size;
+                *valuep     = hdr->rkhdr_value;
+                *sizep      = hdr->rkhdr_value_size;
+                (*iterp)++;
+                return RD_KAFKA_RESP_ERR_NO_ERROR;
+        }
+
+        if (rkm->rkm_flags & RD_KAFKA_MSG_F_PRODUCER)
+                return RD_KAFKA_RESP_ERR__NOENT;
+
+        /* Raw protocol headers: the iterator is a byte offset */
+        return rd_kafka_msg_binhdrs_next(&rkm->rkm_u.consumer.binhdrs, iterp,
+                                         namep, name_sizep, valuep, sizep);
+}
+
+
+rd_kafka_resp_err_t
+rd_kafka_message_header_peek(const rd_kafka_message_t *rkmessage,
+                             const char *name,
+                             const void **valuep,
+                             size_t *sizep) {
+        const rd_kafka_msg_t *rkm =
+            rd_kafka_message2msg((rd_kafka_message_t *)rkmessage);
+        size_t name_size = strlen(name);
+        rd_kafka_resp_err_t err;
+        rd_bool_t found = rd_false;
+        size_t of       = 0;
+        const char *hname;
+        size_t hname_size;
+        const void *value;
+        size_t size;
+
+        if (rkm->rkm_headers)
+                return rd_kafka_header_get_last(rkm->rkm_headers, name, valuep,
+                                                sizep);
+
+        if (rkm->rkm_flags & RD_KAFKA_MSG_F_PRODUCER)
+                return RD_KAFKA_RESP_ERR__NOENT;
+
+        /* Scan all raw headers for the last match */
+        while (!(err = rd_kafka_msg_binhdrs_next(&rkm->rkm_u.consumer.binhdrs,
+                                                 &of, &hname, &hname_size,
+                                                 &value, &size))) {
+                if (hname_size == name_size &&
+                    !memcmp(hname, name, name_size)) {
+                        *valuep = value;
+                        *sizep  = size;
+                        found   = rd_true;
+                }
+        }
+
+        if (err != RD_KAFKA_RESP_ERR__NOENT)
+                return err;
+
+        return found ? RD_KAFKA_RESP_ERR_NO_ERROR : RD_KAFKA_RESP_ERR__NOENT;
+}
+
+
 rd_kafka_resp_err_t
 rd_kafka_message_detach_headers(rd_kafka_message_t *rkmessage,
                                 rd_kafka_headers_t **hdrsp) {
@@ -1545,6 +1707,11 @@ void rd_kafka_message_set_headers(rd_kafka_message_t *rkmessage,
                 rd_kafka_headers_destroy(rkm->rkm_headers);
         }
 
+        /* The application may have modified the headers after they were
+         * serialized, make sure they're serialized anew. */
+        if (hdrs)
+                rd_kafka_headers_invalidate(hdrs);
+
         rkm->rkm_headers = hdrs;
 }
 
@@ -2445,12 +2612,122 @@ static int unittest_msgq_insert_sort(const char *what,
 }
 
 
+/**
+ * @brief Verify zero-copy header lookup on raw protocol headers.
+ */
+static int unittest_msg_header_peek(void) {
+        char buf[128];
+        size_t of = 0;
+        rd_kafka_msg_t rkm;
+        const struct {
+                const char *name;
+                const char *value; /* NULL for null value */
+        } hdrs[] = {{"trace", "t1"}, {"null", NULL}, {"empty", ""},
+                    {"trace", "t2"}};
+        const char *name;
+        const void *value;
+        size_t name_size, size, iter = 0;
+        rd_kafka_resp_err_t err;
+        int i;
+
+        /* Serialize raw headers as they appear in a fetched record */
+        of += rd_uvarint_enc_i64(buf + of, sizeof(buf) - of,
+                                 RD_ARRAYSIZE(hdrs));
+        for (i = 0; i < (int)RD_ARRAYSIZE(hdrs); i++) {
+                size_t nlen = strlen(hdrs[i].name);
+                of += rd_uvarint_enc_i64(buf + of, sizeof(buf) - of, nlen);
+                memcpy(buf + of, hdrs[i].name, nlen);
+                of += nlen;
+                if (!hdrs[i].value) {
+                        of += rd_uvarint_enc_i64(buf + of, sizeof(buf) - of,
+                                                 -1);
+                } else {
+                        size_t vlen = strlen(hdrs[i].value);
+                        of += rd_uvarint_enc_i64(buf + of, sizeof(buf) - of,
+                                                 vlen);
+                        memcpy(buf + of, hdrs[i].value, vlen);
+                        of += vlen;
+                }
+        }
+
+        memset(&rkm, 0, sizeof(rkm));
+        rkm.rkm_u.consumer.binhdrs.data = buf;
+        rkm.rkm_u.consumer.binhdrs.len  = (int32_t)of;
+
+        /* Iterate all headers */
+        for (i = 0; !(err = rd_kafka_message_header_peek_all(
+                          &rkm.rkm_rkmessage, &iter, &name, &name_size,
+                          &value, &size));
+             i++) {
+                RD_UT_ASSERT(i < (int)RD_ARRAYSIZE(hdrs),
+                             "too many headers returned");
+                RD_UT_ASSERT(name_size == strlen(hdrs[i].name) &&
+                                 !memcmp(name, hdrs[i].name, name_size),
+                             "header #%d: expected name %s", i,
+                             hdrs[i].name);
+                if (!hdrs[i].value)
+                        RD_UT_ASSERT(!value && size == 0,
+                                     "header #%d: expected null value", i);
+                else
+                        RD_UT_ASSERT(value && size == strlen(hdrs[i].value) &&
+                                         !memcmp(value, hdrs[i].value, size),
+                                     "header #%d: expected value %s", i,
+                                     hdrs[i].value);
+                /* Returned pointers must reference the raw buffer */
+                RD_UT_ASSERT(name >= buf && name < buf + of,
+                             "header #%d: name not in raw buffer", i);
+        }
+        RD_UT_ASSERT(err == RD_KAFKA_RESP_ERR__NOENT,
+                     "expected end of headers, not %s", rd_kafka_err2name(err));
+        RD_UT_ASSERT(i == (int)RD_ARRAYSIZE(hdrs),
+                     "expected %d headers, not %d", (int)RD_ARRAYSIZE(hdrs),
+                     i);
+
+        /* Lookup returns the last match */
+        err = rd_kafka_message_header_peek(&rkm.rkm_rkmessage, "trace", &value,
+                                           &size);
+        RD_UT_ASSERT(!err && size == 2 && !memcmp(value, "t2", 2),
+                     "expected trace=t2: %s", rd_kafka_err2name(err));
+
+        err = rd_kafka_message_header_peek(&rkm.rkm_rkmessage, "empty", &value,
+                                           &size);
+        RD_UT_ASSERT(!err && value && size == 0, "expected empty value: %s",
+                     rd_kafka_err2name(err));
+
+        err = rd_kafka_message_header_peek(&rkm.rkm_rkmessage, "trac", &value,
+                                           &size);
+        RD_UT_ASSERT(err == RD_KAFKA_RESP_ERR__NOENT,
+                     "expected no match for prefix, not %s",
+                     rd_kafka_err2name(err));
+
+        /* Truncated headers are reported as malformed */
+        rkm.rkm_u.consumer.binhdrs.len = (int32_t)of - 1;
+        err = rd_kafka_message_header_peek(&rkm.rkm_rkmessage, "nope", &value,
+                                           &size);
+        RD_UT_ASSERT(err == RD_KAFKA_RESP_ERR__BAD_MSG,
+                     "expected BAD_MSG for truncated headers, not %s",
+                     rd_kafka_err2name(err));
+
+        /* No headers */
+        rkm.rkm_u.consumer.binhdrs.len = 0;
+        iter                           = 0;
+        err = rd_kafka_message_header_peek_all(&rkm.rkm_rkmessage, &iter,
+                                               &name, &name_size, &value,
+                                               &size);
+        RD_UT_ASSERT(err == RD_KAFKA_RESP_ERR__NOENT,
+                     "expected NOENT without headers, not %s",
+                     rd_kafka_err2name(err));
+
+        RD_UT_PASS();
+}
+
 int unittest_msg(void) {
         int fails              = 0;
         double insert_baseline = 0.0;
 
         fails += unittest_msgq_order("FIFO", 1, rd_kafka_msg_cmp_msgid);
         fails += unittest_msg_seq_wrap();
+        fails += unittest_msg_header_peek();
 
         fails += unittest_msgq_insert_sort(
             "get baseline insert time", 100000.0, &insert_baseline,
@@ -122,6 +122,8 @@ typedef struct rd_kafka_msg_s {
                                               *   identically reconstructed.
                                               */
                         int retries;         /* Number of retries so far */
+                        uint32_t mem_size;   /**< Memory footprint accounted
+                                              *   for in rk_curr_msgs.mem */
                 } producer;
 #define rkm_ts_timeout rkm_u.producer.ts_timeout
 #define rkm_ts_enq     rkm_u.producer.ts_enq
@@ -77,6 +77,15 @@ rd_kafka_msgset_parse(rd_kafka_buf_t *rkbuf,
                       rd_kafka_aborted_txns_t *aborted_txns,
                       const struct rd_kafka_toppar_ver *tver);
 
+rd_kafka_resp_err_t
+rd_kafka_msgset_parse0(rd_kafka_buf_t *rkbuf,
+                       rd_kafka_toppar_t *rktp,
+                       rd_kafka_aborted_txns_t *aborted_txns,
+                       const struct rd_kafka_toppar_ver *tver,
+                       rd_kafka_q_t *par_rkq,
+                       rd_kafka_fetch_pos_t *fetch_pos,
+                       int32_t *fetch_msg_max_bytes);
+
 int unittest_aborted_txns(void);
 
 #endif /* _RDKAFKA_MSGSET_H_ */
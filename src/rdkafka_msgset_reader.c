@@ -171,6 +171,15 @@ typedef struct rd_kafka_msgset_reader_s {
         int32_t msetr_leader_epoch; /**< Current MessageSet's partition
                                      *   leader epoch (or -1). */
 
+        rd_kafka_fetch_pos_t *msetr_fetch_pos; /**< Fetch position to
+                                                *   check and update,
+                                                *   normally the partition's
+                                                *   rktp_offsets.fetch_pos */
+        int32_t *msetr_fetch_msg_max_bytes;    /**< Max fetch size to
+                                                *   increase on underflow,
+                                                *   normally the partition's
+                                                *   rktp_fetch_msg_max_bytes */
+
         int32_t msetr_broker_id;       /**< Broker id (of msetr_rkb) */
         rd_kafka_broker_t *msetr_rkb;  /* @warning Not a refcounted
                                         *          reference! */
@@ -200,6 +209,12 @@ typedef struct rd_kafka_msgset_reader_s {
         int msetr_aborted_cnt; /**< Number of aborted MessageSets
                                 *   encountered. */
 
+        int msetr_filtered_cnt; /**< Number of messages dropped by
+                                 *   the consume_filter_cb. */
+        int64_t msetr_filtered_offset; /**< Highest offset of messages
+                                        *   dropped by the
+                                        *   consume_filter_cb, or -1. */
+
         const char *msetr_srcname; /**< Optional message source string,
                                     *   used in debug logging to
                                     *   indicate messages were
@@ -241,6 +256,11 @@ static void rd_kafka_msgset_reader_init(rd_kafka_msgset_reader_t *msetr,
         msetr->msetr_rkbuf        = rkbuf;
         msetr->msetr_srcname      = "";
 
+        msetr->msetr_fetch_pos           = &rktp->rktp_offsets.fetch_pos;
+        msetr->msetr_fetch_msg_max_bytes = &rktp->rktp_fetch_msg_max_bytes;
+
+        msetr->msetr_filtered_offset = -1;
+
         rkbuf->rkbuf_uflow_mitigation = "truncated response from broker (ok)";
 
         /* All parsed messages are put on this temporary op
@@ -467,6 +487,10 @@ rd_kafka_msgset_reader_decompress(rd_kafka_msgset_reader_t *msetr,
 
                 inner_msetr.msetr_srcname = "compressed ";
 
+                inner_msetr.msetr_fetch_pos = msetr->msetr_fetch_pos;
+                inner_msetr.msetr_fetch_msg_max_bytes =
+                    msetr->msetr_fetch_msg_max_bytes;
+
                 if (MsgVersion == 1) {
                         /* postproc() will convert relative to
                          * absolute offsets */
@@ -652,7 +676,7 @@ rd_kafka_msgset_reader_msg_v0_1(rd_kafka_msgset_reader_t *msetr) {
          *       we cant perform this offset check here
          *       in that case. */
         if (!relative_offsets &&
-            hdr.Offset < rktp->rktp_offsets.fetch_pos.offset)
+            hdr.Offset < msetr->msetr_fetch_pos->offset)
                 return RD_KAFKA_RESP_ERR_NO_ERROR; /* Continue with next msg */
 
         /* Handle compressed MessageSet */
@@ -727,6 +751,8 @@ rd_kafka_msgset_reader_msg_v2(rd_kafka_msgset_reader_t *msetr) {
         } hdr;
         rd_kafka_op_t *rko;
         rd_kafka_msg_t *rkm;
+        rd_kafka_timestamp_type_t tstype;
+        int64_t timestamp;
         /* Only log decoding errors if protocol debugging enabled. */
         int log_decode_errors =
             (rkbuf->rkbuf_rkb->rkb_rk->rk_conf.debug & RD_KAFKA_DBG_PROTOCOL)
@@ -744,13 +770,13 @@ rd_kafka_msgset_reader_msg_v2(rd_kafka_msgset_reader_t *msetr) {
         hdr.Offset = msetr->msetr_v2_hdr->BaseOffset + hdr.OffsetDelta;
 
         /* Skip message if outdated */
-        if (hdr.Offset < rktp->rktp_offsets.fetch_pos.offset) {
+        if (hdr.Offset < msetr->msetr_fetch_pos->offset) {
                 rd_rkb_dbg(msetr->msetr_rkb, MSG, "MSG",
                            "%s [%" PRId32
                            "]: "
                            "Skip offset %" PRId64 " < fetch_offset %" PRId64,
                            rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition,
-                           hdr.Offset, rktp->rktp_offsets.fetch_pos.offset);
+                           hdr.Offset, msetr->msetr_fetch_pos->offset);
                 rd_kafka_buf_skip_to(rkbuf, message_end);
                 return RD_KAFKA_RESP_ERR_NO_ERROR; /* Continue with next msg */
         }
@@ -903,6 +929,59 @@ rd_kafka_msgset_reader_msg_v2(rd_kafka_msgset_reader_t *msetr) {
             (int32_t)(message_end - rd_slice_offset(&rkbuf->rkbuf_reader));
         rd_kafka_buf_read_ptr(rkbuf, &hdr.Headers.data, hdr.Headers.len);
 
+        /* Set timestamp.
+         *
+         * When broker assigns the timestamps (LOG_APPEND_TIME) it will
+         * assign the same timestamp for all messages in a MessageSet
+         * using MaxTimestamp.
+         */
+        if ((msetr->msetr_v2_hdr->Attributes &
+             RD_KAFKA_MSG_ATTR_LOG_APPEND_TIME) ||
+            (hdr.MsgAttributes & RD_KAFKA_MSG_ATTR_LOG_APPEND_TIME)) {
+                tstype    = RD_KAFKA_TIMESTAMP_LOG_APPEND_TIME;
+                timestamp = msetr->msetr_v2_hdr->MaxTimestamp;
+        } else {
+                tstype    = RD_KAFKA_TIMESTAMP_CREATE_TIME;
+                timestamp =
+                    msetr->msetr_v2_hdr->BaseTimestamp + hdr.TimestampDelta;
+        }
+
+        /* Let the application filter the message before any op
+         * is allocated for it. The message is set up on the stack
+         * with pointers into the fetch response buffer. */
+        if (rktp->rktp_rkt->rkt_rk->rk_conf.consume_filter_cb) {
+                rd_kafka_t *rk = rktp->rktp_rkt->rkt_rk;
+                rd_kafka_msg_t fltrkm;
+
+                memset(&fltrkm, 0, sizeof(fltrkm));
+                fltrkm.rkm_rkmessage.rkt = rktp->rktp_rkt;
+                fltrkm.rkm_partition     = rktp->rktp_partition;
+                fltrkm.rkm_offset        = hdr.Offset;
+                if (!RD_KAFKAP_BYTES_IS_NULL(&hdr.Key)) {
+                        fltrkm.rkm_key     = (void *)hdr.Key.data;
+                        fltrkm.rkm_key_len = (size_t)hdr.Key.len;
+                }
+                if (!RD_KAFKAP_BYTES_IS_NULL(&hdr.Value)) {
+                        fltrkm.rkm_payload = (void *)hdr.Value.data;
+                        fltrkm.rkm_len     = (size_t)hdr.Value.len;
+                }
+                fltrkm.rkm_tstype    = tstype;
+                fltrkm.rkm_timestamp = timestamp;
+                fltrkm.rkm_u.consumer.binhdrs.len  = hdr.Headers.len;
+                fltrkm.rkm_u.consumer.binhdrs.data = hdr.Headers.data;
+
+                if (!rk->rk_conf.consume_filter_cb(
+                        rk, &fltrkm.rkm_rkmessage, rk->rk_conf.opaque)) {
+                        /* Dropped: the next fetch offset and the
+                         * application position are still advanced
+                         * past it, see rd_kafka_msgset_reader_run(). */
+                        msetr->msetr_filtered_cnt++;
+                        if (hdr.Offset > msetr->msetr_filtered_offset)
+                                msetr->msetr_filtered_offset = hdr.Offset;
+                        return RD_KAFKA_RESP_ERR_NO_ERROR;
+                }
+        }
+
         /* Create op/message container for message. */
         rko = rd_kafka_op_new_fetch_msg(
             &rkm, rktp, msetr->msetr_tver->version, rkbuf, hdr.Offset,
@@ -921,22 +1000,8 @@ rd_kafka_msgset_reader_msg_v2(rd_kafka_msgset_reader_t *msetr) {
         rkm->rkm_u.consumer.binhdrs.len  = hdr.Headers.len;
         rkm->rkm_u.consumer.binhdrs.data = hdr.Headers.data;
 
-        /* Set timestamp.
-         *
-         * When broker assigns the timestamps (LOG_APPEND_TIME) it will
-         * assign the same timestamp for all messages in a MessageSet
-         * using MaxTimestamp.
-         */
-        if ((msetr->msetr_v2_hdr->Attributes &
-             RD_KAFKA_MSG_ATTR_LOG_APPEND_TIME) ||
-            (hdr.MsgAttributes & RD_KAFKA_MSG_ATTR_LOG_APPEND_TIME)) {
-                rkm->rkm_tstype    = RD_KAFKA_TIMESTAMP_LOG_APPEND_TIME;
-                rkm->rkm_timestamp = msetr->msetr_v2_hdr->MaxTimestamp;
-        } else {
-                rkm->rkm_tstype = RD_KAFKA_TIMESTAMP_CREATE_TIME;
-                rkm->rkm_timestamp =
-                    msetr->msetr_v2_hdr->BaseTimestamp + hdr.TimestampDelta;
-        }
+        rkm->rkm_tstype    = tstype;
+        rkm->rkm_timestamp = timestamp;
 
 
         /* Enqueue message on temporary queue */
@@ -954,51 +1019,54 @@ err_parse:
 
 
 /**
- * @brief Read v2 messages from current buffer position.
+ * @brief Check if the v2 MessageSet with header \p hdr is part of an
+ *        aborted transaction, in which case its records are to be skipped.
+ *
+ * Only the MessageSet header is used, allowing aborted MessageSets to be
+ * skipped without decompressing or parsing their records.
  */
-static rd_kafka_resp_err_t
-rd_kafka_msgset_reader_msgs_v2(rd_kafka_msgset_reader_t *msetr) {
-        rd_kafka_buf_t *rkbuf   = msetr->msetr_rkbuf;
+static rd_bool_t
+rd_kafka_msgset_reader_v2_is_aborted(rd_kafka_msgset_reader_t *msetr,
+                                     const struct msgset_v2_hdr *hdr) {
         rd_kafka_toppar_t *rktp = msetr->msetr_rktp;
-        /* Only log decoding errors if protocol debugging enabled. */
-        int log_decode_errors =
-            (rkbuf->rkbuf_rkb->rkb_rk->rk_conf.debug & RD_KAFKA_DBG_PROTOCOL)
-                ? LOG_DEBUG
-                : 0;
+        int64_t txn_start_offset;
+
+        if (!msetr->msetr_aborted_txns ||
+            (hdr->Attributes & (RD_KAFKA_MSGSET_V2_ATTR_TRANSACTIONAL |
+                                RD_KAFKA_MSGSET_V2_ATTR_CONTROL)) !=
+                RD_KAFKA_MSGSET_V2_ATTR_TRANSACTIONAL)
+                return rd_false;
+
+        /* Transactional non-control MessageSet:
+         * check if it is part of an aborted transaction. */
+        txn_start_offset = rd_kafka_aborted_txns_get_offset(
+            msetr->msetr_aborted_txns, hdr->PID);
+
+        if (txn_start_offset == -1 || hdr->BaseOffset < txn_start_offset)
+                return rd_false;
+
+        /* MessageSet is part of aborted transaction */
+        rd_rkb_dbg(msetr->msetr_rkb, MSG, "MSG",
+                   "%s [%" PRId32
+                   "]: "
+                   "Skipping %" PRId32
+                   " message(s) "
+                   "in aborted transaction "
+                   "at offset %" PRId64 " for PID %" PRId64,
+                   rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition,
+                   hdr->RecordCount, txn_start_offset, hdr->PID);
+
+        msetr->msetr_aborted_cnt++;
+
+        return rd_true;
+}
 
-        if (msetr->msetr_aborted_txns != NULL &&
-            (msetr->msetr_v2_hdr->Attributes &
-             (RD_KAFKA_MSGSET_V2_ATTR_TRANSACTIONAL |
-              RD_KAFKA_MSGSET_V2_ATTR_CONTROL)) ==
-                RD_KAFKA_MSGSET_V2_ATTR_TRANSACTIONAL) {
-                /* Transactional non-control MessageSet:
-                 * check if it is part of an aborted transaction. */
-                int64_t txn_start_offset = rd_kafka_aborted_txns_get_offset(
-                    msetr->msetr_aborted_txns, msetr->msetr_v2_hdr->PID);
-
-                if (txn_start_offset != -1 &&
-                    msetr->msetr_v2_hdr->BaseOffset >= txn_start_offset) {
-                        /* MessageSet is part of aborted transaction */
-                        rd_rkb_dbg(msetr->msetr_rkb, MSG, "MSG",
-                                   "%s [%" PRId32
-                                   "]: "
-                                   "Skipping %" PRId32
-                                   " message(s) "
-                                   "in aborted transaction "
-                                   "at offset %" PRId64 " for PID %" PRId64,
-                                   rktp->rktp_rkt->rkt_topic->str,
-                                   rktp->rktp_partition,
-                                   msetr->msetr_v2_hdr->RecordCount,
-                                   txn_start_offset, msetr->msetr_v2_hdr->PID);
-                        rd_kafka_buf_skip(
-                            msetr->msetr_rkbuf,
-                            rd_slice_remains(
-                                &msetr->msetr_rkbuf->rkbuf_reader));
-                        msetr->msetr_aborted_cnt++;
-                        return RD_KAFKA_RESP_ERR_NO_ERROR;
-                }
-        }
 
+/**
+ * @brief Read v2 messages from current buffer position.
+ */
+static rd_kafka_resp_err_t
+rd_kafka_msgset_reader_msgs_v2(rd_kafka_msgset_reader_t *msetr) {
         while (rd_kafka_buf_read_remain(msetr->msetr_rkbuf)) {
                 rd_kafka_resp_err_t err;
                 err = rd_kafka_msgset_reader_msg_v2(msetr);
@@ -1007,12 +1075,6 @@ rd_kafka_msgset_reader_msgs_v2(rd_kafka_msgset_reader_t *msetr) {
         }
 
         return RD_KAFKA_RESP_ERR_NO_ERROR;
-
-err_parse:
-        /* Count all parse errors as partial message errors. */
-        rd_atomic64_add(&msetr->msetr_rkb->rkb_c.rx_partial, 1);
-        msetr->msetr_v2_hdr = NULL;
-        return rkbuf->rkbuf_err;
 }
 
 
@@ -1114,8 +1176,19 @@ rd_kafka_msgset_reader_v2(rd_kafka_msgset_reader_t *msetr) {
                     hdr.BaseOffset, payload_size);
 
         /* If entire MessageSet contains old outdated offsets, skip it. */
-        if (LastOffset < rktp->rktp_offsets.fetch_pos.offset) {
+        if (LastOffset < msetr->msetr_fetch_pos->offset) {
+                rd_kafka_buf_skip(rkbuf, payload_size);
+                goto done;
+        }
+
+        /* Skip MessageSets of aborted transactions prior to
+         * decompressing or parsing their records. */
+        if (rd_kafka_msgset_reader_v2_is_aborted(msetr, &hdr)) {
                 rd_kafka_buf_skip(rkbuf, payload_size);
+                rd_atomic64_add(&rktp->rktp_c.rx_aborted_msgs,
+                                hdr.RecordCount);
+                rd_atomic64_add(&rktp->rktp_c.rx_aborted_bytes,
+                                8 + 4 + hdr.Length);
                 goto done;
         }
 
@@ -1224,8 +1297,7 @@ rd_kafka_msgset_reader_peek_msg_version(rd_kafka_msgset_reader_t *msetr,
                            (int)*MagicBytep, Offset, read_offset,
                            rd_slice_size(&rkbuf->rkbuf_reader));
 
-                if (Offset >=
-                    msetr->msetr_rktp->rktp_offsets.fetch_pos.offset) {
+                if (Offset >= msetr->msetr_fetch_pos->offset) {
                         rd_kafka_consumer_err(
                             &msetr->msetr_rkq, msetr->msetr_broker_id,
                             RD_KAFKA_RESP_ERR__NOT_IMPLEMENTED,
@@ -1234,7 +1306,7 @@ rd_kafka_msgset_reader_peek_msg_version(rd_kafka_msgset_reader_t *msetr,
                             "at offset %" PRId64,
                             (int)*MagicBytep, Offset);
                         /* Skip message(set) */
-                        msetr->msetr_rktp->rktp_offsets.fetch_pos.offset =
+                        msetr->msetr_fetch_pos->offset =
                             Offset + 1;
                 }
 
@@ -1320,8 +1392,7 @@ static void rd_kafka_msgset_reader_postproc(rd_kafka_msgset_reader_t *msetr,
                          * and purge any messages older than the current
                          * fetch offset. */
                         rd_kafka_q_fix_offsets(
-                            &msetr->msetr_rkq,
-                            msetr->msetr_rktp->rktp_offsets.fetch_pos.offset,
+                            &msetr->msetr_rkq, msetr->msetr_fetch_pos->offset,
                             msetr->msetr_outer.offset - *last_offsetp);
                 }
         }
@@ -1349,6 +1420,29 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
         /* Parse MessageSets and messages */
         err = rd_kafka_msgset_reader(msetr);
 
+        if (msetr->msetr_filtered_cnt > 0) {
+                rd_kafka_op_t *rko;
+
+                rd_atomic64_add(&rktp->rktp_c.rx_filtered_msgs,
+                                msetr->msetr_filtered_cnt);
+
+                /* If the last message(s) were dropped by the
+                 * consume_filter_cb there is no later message whose
+                 * consumption advances the application position past
+                 * them: enqueue a control message op for the last
+                 * dropped offset, which is not exposed to the application
+                 * but stores its offset. */
+                rko = rd_kafka_q_last(&msetr->msetr_rkq, RD_KAFKA_OP_FETCH,
+                                      0 /* no error ops */);
+                if (!rko || rko->rko_u.fetch.rkm.rkm_offset <
+                                msetr->msetr_filtered_offset)
+                        rd_kafka_q_enq(&msetr->msetr_rkq,
+                                       rd_kafka_op_new_ctrl_msg(
+                                           rktp, msetr->msetr_tver->version,
+                                           msetr->msetr_rkbuf,
+                                           msetr->msetr_filtered_offset));
+        }
+
         if (unlikely(rd_kafka_q_len(&msetr->msetr_rkq) == 0)) {
                 /* The message set didn't contain at least one full message
                  * or no error was posted on the response queue.
@@ -1368,15 +1462,15 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
                         if (err == RD_KAFKA_RESP_ERR__UNDERFLOW)
                                 err = RD_KAFKA_RESP_ERR_NO_ERROR;
 
-                } else if (rktp->rktp_fetch_msg_max_bytes < (1 << 30)) {
-                        rktp->rktp_fetch_msg_max_bytes *= 2;
+                } else if (*msetr->msetr_fetch_msg_max_bytes < (1 << 30)) {
+                        *msetr->msetr_fetch_msg_max_bytes *= 2;
                         rd_rkb_dbg(msetr->msetr_rkb, FETCH, "CONSUME",
                                    "Topic %s [%" PRId32
                                    "]: Increasing "
                                    "max fetch bytes to %" PRId32,
                                    rktp->rktp_rkt->rkt_topic->str,
                                    rktp->rktp_partition,
-                                   rktp->rktp_fetch_msg_max_bytes);
+                                   *msetr->msetr_fetch_msg_max_bytes);
 
                         if (err == RD_KAFKA_RESP_ERR__UNDERFLOW)
                                 err = RD_KAFKA_RESP_ERR_NO_ERROR;
@@ -1386,11 +1480,11 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
                             &msetr->msetr_rkq, msetr->msetr_broker_id,
                             RD_KAFKA_RESP_ERR_MSG_SIZE_TOO_LARGE,
                             msetr->msetr_tver->version, NULL, rktp,
-                            rktp->rktp_offsets.fetch_pos.offset,
+                            msetr->msetr_fetch_pos->offset,
                             "Message at offset %" PRId64
                             " might be too large to fetch, try increasing "
                             "receive.message.max.bytes",
-                            rktp->rktp_offsets.fetch_pos.offset);
+                            msetr->msetr_fetch_pos->offset);
 
                 } else if (msetr->msetr_aborted_cnt > 0) {
                         /* Noop */
@@ -1406,7 +1500,7 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
                  * good message since it probably indicates a
                  * partial response rather than an erroneous one. */
                 if (err == RD_KAFKA_RESP_ERR__UNDERFLOW &&
-                    msetr->msetr_msgcnt > 0)
+                    (msetr->msetr_msgcnt > 0 || msetr->msetr_filtered_cnt > 0))
                         err = RD_KAFKA_RESP_ERR_NO_ERROR;
         }
 
@@ -1414,14 +1508,15 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
                    "Enqueue %i %smessage(s) (%" PRId64
                    " bytes, %d ops) on %s [%" PRId32
                    "] fetch queue (qlen %d, v%d, last_offset %" PRId64
-                   ", %d ctrl msgs, %d aborted msgsets, %s)",
+                   ", %d ctrl msgs, %d aborted msgsets, %d filtered msgs, "
+                   "%s)",
                    msetr->msetr_msgcnt, msetr->msetr_srcname,
                    msetr->msetr_msg_bytes, rd_kafka_q_len(&msetr->msetr_rkq),
                    rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition,
                    rd_kafka_q_len(msetr->msetr_par_rkq),
                    msetr->msetr_tver->version, last_offset,
                    msetr->msetr_ctrl_cnt, msetr->msetr_aborted_cnt,
-                   msetr->msetr_compression
+                   msetr->msetr_filtered_cnt, msetr->msetr_compression
                        ? rd_kafka_compression2str(msetr->msetr_compression)
                        : "uncompressed");
 
@@ -1431,15 +1526,15 @@ rd_kafka_msgset_reader_run(rd_kafka_msgset_reader_t *msetr) {
                 /* Update partition's fetch offset based on
                  * last message's offest. */
                 if (likely(last_offset != -1))
-                        rktp->rktp_offsets.fetch_pos.offset = last_offset + 1;
+                        msetr->msetr_fetch_pos->offset = last_offset + 1;
         }
 
         /* Adjust next fetch offset if outlier code has indicated
          * an even later next offset. */
-        if (msetr->msetr_next_offset > rktp->rktp_offsets.fetch_pos.offset)
-                rktp->rktp_offsets.fetch_pos.offset = msetr->msetr_next_offset;
+        if (msetr->msetr_next_offset > msetr->msetr_fetch_pos->offset)
+                msetr->msetr_fetch_pos->offset = msetr->msetr_next_offset;
 
-        rktp->rktp_offsets.fetch_pos.leader_epoch = msetr->msetr_leader_epoch;
+        msetr->msetr_fetch_pos->leader_epoch = msetr->msetr_leader_epoch;
 
         rd_kafka_q_destroy_owner(&msetr->msetr_rkq);
 
@@ -1465,11 +1560,40 @@ rd_kafka_msgset_parse(rd_kafka_buf_t *rkbuf,
                       rd_kafka_toppar_t *rktp,
                       rd_kafka_aborted_txns_t *aborted_txns,
                       const struct rd_kafka_toppar_ver *tver) {
+        return rd_kafka_msgset_parse0(
+            rkbuf, rktp, aborted_txns, tver, rktp->rktp_fetchq,
+            &rktp->rktp_offsets.fetch_pos, &rktp->rktp_fetch_msg_max_bytes);
+}
+
+
+/**
+ * @brief Same as rd_kafka_msgset_parse() but enqueues the messages on
+ *        \p par_rkq and checks and updates the caller-provided
+ *        \p fetch_pos and \p fetch_msg_max_bytes rather than the
+ *        partition's own fetch state.
+ *
+ * This allows a MessageSet to be parsed outside the broker thread,
+ * with the result being applied to the partition by the broker thread
+ * afterwards.
+ *
+ * @locality any thread, as long as the partition's fetch state is not
+ *           passed when called outside the broker thread.
+ */
+rd_kafka_resp_err_t
+rd_kafka_msgset_parse0(rd_kafka_buf_t *rkbuf,
+                       rd_kafka_toppar_t *rktp,
+                       rd_kafka_aborted_txns_t *aborted_txns,
+                       const struct rd_kafka_toppar_ver *tver,
+                       rd_kafka_q_t *par_rkq,
+                       rd_kafka_fetch_pos_t *fetch_pos,
+                       int32_t *fetch_msg_max_bytes) {
         rd_kafka_msgset_reader_t msetr;
         rd_kafka_resp_err_t err;
 
         rd_kafka_msgset_reader_init(&msetr, rkbuf, rktp, tver, aborted_txns,
-                                    rktp->rktp_fetchq);
+                                    par_rkq);
+        msetr.msetr_fetch_pos           = fetch_pos;
+        msetr.msetr_fetch_msg_max_bytes = fetch_msg_max_bytes;
 
         /* Parse and handle the message set */
         err = rd_kafka_msgset_reader_run(&msetr);
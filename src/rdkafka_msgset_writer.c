@@ -562,28 +562,13 @@ rd_kafka_msgset_writer_write_msg_payload(rd_kafka_msgset_writer_t *msetw,
  */
 static size_t
 rd_kafka_msgset_writer_write_msg_headers(rd_kafka_msgset_writer_t *msetw,
-                                         const rd_kafka_headers_t *hdrs) {
-        rd_kafka_buf_t *rkbuf = msetw->msetw_rkbuf;
-        const rd_kafka_header_t *hdr;
-        int i;
-        size_t start_pos = rd_buf_write_pos(&rkbuf->rkbuf_buf);
-        size_t written;
-
-        RD_LIST_FOREACH(hdr, &hdrs->rkhdrs_list, i) {
-                rd_kafka_buf_write_varint(rkbuf, hdr->rkhdr_name_size);
-                rd_kafka_buf_write(rkbuf, hdr->rkhdr_name,
-                                   hdr->rkhdr_name_size);
-                rd_kafka_buf_write_varint(
-                    rkbuf,
-                    hdr->rkhdr_value ? (int64_t)hdr->rkhdr_value_size : -1);
-                rd_kafka_buf_write(rkbuf, hdr->rkhdr_value,
-                                   hdr->rkhdr_value_size);
-        }
+                                         rd_kafka_headers_t *hdrs) {
+        /* The headers are only serialized on the first write, subsequent
+         * writes (e.g., retries) use the cached serialized headers. */
+        rd_kafka_buf_write(msetw->msetw_rkbuf, rd_kafka_headers_serialize(hdrs),
+                           hdrs->rkhdrs_ser_size);
 
-        written = rd_buf_write_pos(&rkbuf->rkbuf_buf) - start_pos;
-        rd_dassert(written == hdrs->rkhdrs_ser_size);
-
-        return written;
+        return hdrs->rkhdrs_ser_size;
 }
 
 
@@ -685,7 +670,7 @@ rd_kafka_msgset_writer_write_msg_v2(rd_kafka_msgset_writer_t *msetw,
         size_t HeaderSize = 0;
 
         if (rkm->rkm_headers) {
-                HeaderCount = rkm->rkm_headers->rkhdrs_list.rl_cnt;
+                HeaderCount = (int)rd_kafka_header_cnt(rkm->rkm_headers);
                 HeaderSize  = rkm->rkm_headers->rkhdrs_ser_size;
         }
 
@@ -1377,6 +1362,13 @@ rd_kafka_msgset_writer_finalize(rd_kafka_msgset_writer_t *msetw,
         /* Finalize MessageSet header fields */
         rd_kafka_msgset_writer_finalize_MessageSet(msetw);
 
+        /* Account for the request buffer's memory, which is held in
+         * addition to the messages' memory until the request is done. */
+        rkbuf->rkbuf_u.Produce.mem_size =
+            sizeof(*rkbuf) + rd_buf_mem_size(&rkbuf->rkbuf_buf);
+        rd_kafka_curr_msgs_mem_add(rktp->rktp_rkt->rkt_rk,
+                                   rkbuf->rkbuf_u.Produce.mem_size);
+
         /* Return final MessageSetSize */
         *MessageSetSizep = msetw->msetw_MessageSetSize;
 
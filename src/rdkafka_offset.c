@@ -262,7 +262,7 @@ rd_kafka_offset_file_commit(rd_kafka_toppar_t *rktp) {
         rd_kafka_topic_t *rkt = rktp->rktp_rkt;
         int attempt;
         rd_kafka_resp_err_t err = RD_KAFKA_RESP_ERR_NO_ERROR;
-        int64_t offset          = rktp->rktp_stored_pos.offset;
+        int64_t offset          = rd_kafka_toppar_stored_pos(rktp).offset;
 
         for (attempt = 0; attempt < 2; attempt++) {
                 char buf[22];
@@ -552,7 +552,7 @@ rd_kafka_offset_broker_commit(rd_kafka_toppar_t *rktp, const char *reason) {
         rd_kafka_assert(rktp->rktp_rkt->rkt_rk,
                         rktp->rktp_flags & RD_KAFKA_TOPPAR_F_OFFSET_STORE);
 
-        rktp->rktp_committing_pos = rktp->rktp_stored_pos;
+        rktp->rktp_committing_pos = rd_kafka_toppar_stored_pos(rktp);
 
         offsets = rd_kafka_topic_partition_list_new(1);
         rktpar  = rd_kafka_topic_partition_list_add(
@@ -585,20 +585,22 @@ rd_kafka_offset_broker_commit(rd_kafka_toppar_t *rktp, const char *reason) {
  */
 static rd_kafka_resp_err_t rd_kafka_offset_commit(rd_kafka_toppar_t *rktp,
                                                   const char *reason) {
+        rd_kafka_fetch_pos_t stored_pos = rd_kafka_toppar_stored_pos(rktp);
+
         rd_kafka_dbg(rktp->rktp_rkt->rkt_rk, TOPIC, "OFFSET",
                      "%s [%" PRId32 "]: commit: stored %s > committed %s?",
                      rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition,
-                     rd_kafka_fetch_pos2str(rktp->rktp_stored_pos),
+                     rd_kafka_fetch_pos2str(stored_pos),
                      rd_kafka_fetch_pos2str(rktp->rktp_committed_pos));
 
         /* Already committed */
-        if (rd_kafka_fetch_pos_cmp(&rktp->rktp_stored_pos,
-                                   &rktp->rktp_committed_pos) <= 0)
+        if (rd_kafka_fetch_pos_cmp(&stored_pos, &rktp->rktp_committed_pos) <=
+            0)
                 return RD_KAFKA_RESP_ERR_NO_ERROR;
 
         /* Already committing (for async ops) */
-        if (rd_kafka_fetch_pos_cmp(&rktp->rktp_stored_pos,
-                                   &rktp->rktp_committing_pos) <= 0)
+        if (rd_kafka_fetch_pos_cmp(&stored_pos, &rktp->rktp_committing_pos) <=
+            0)
                 return RD_KAFKA_RESP_ERR__PREV_IN_PROGRESS;
 
         switch (rktp->rktp_rkt->rkt_conf.offset_store_method) {
@@ -1321,8 +1323,10 @@ static void rd_kafka_offset_file_init(rd_kafka_toppar_t *rktp) {
 
         if (offset != RD_KAFKA_OFFSET_INVALID) {
                 /* Start fetching from offset */
+                rd_kafka_offset_store_close(rktp);
                 rktp->rktp_stored_pos.offset    = offset;
                 rktp->rktp_committed_pos.offset = offset;
+                rd_kafka_offset_store_open(rktp);
                 rd_kafka_toppar_next_offset_handle(rktp, rktp->rktp_stored_pos);
 
         } else {
@@ -1417,6 +1421,7 @@ void rd_kafka_offset_store_term(rd_kafka_toppar_t *rktp,
  */
 rd_kafka_resp_err_t rd_kafka_offset_store_stop(rd_kafka_toppar_t *rktp) {
         rd_kafka_resp_err_t err = RD_KAFKA_RESP_ERR_NO_ERROR;
+        rd_kafka_fetch_pos_t stored_pos;
 
         if (!(rktp->rktp_flags & RD_KAFKA_TOPPAR_F_OFFSET_STORE))
                 goto done;
@@ -1428,13 +1433,14 @@ rd_kafka_resp_err_t rd_kafka_offset_store_stop(rd_kafka_toppar_t *rktp) {
                      "]: stopping offset store "
                      "(stored %s, committed %s, EOF offset %" PRId64 ")",
                      rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition,
-                     rd_kafka_fetch_pos2str(rktp->rktp_stored_pos),
+                     rd_kafka_fetch_pos2str(rd_kafka_toppar_stored_pos(rktp)),
                      rd_kafka_fetch_pos2str(rktp->rktp_committed_pos),
                      rktp->rktp_offsets_fin.eof_offset);
 
         /* Store end offset for empty partitions */
         if (rktp->rktp_rkt->rkt_rk->rk_conf.enable_auto_offset_store &&
-            rktp->rktp_stored_pos.offset == RD_KAFKA_OFFSET_INVALID &&
+            rd_kafka_toppar_stored_pos(rktp).offset ==
+                RD_KAFKA_OFFSET_INVALID &&
             rktp->rktp_offsets_fin.eof_offset > 0)
                 rd_kafka_offset_store0(
                     rktp,
@@ -1444,9 +1450,9 @@ rd_kafka_resp_err_t rd_kafka_offset_store_stop(rd_kafka_toppar_t *rktp) {
 
         /* Commit offset to backing store.
          * This might be an async operation. */
+        stored_pos = rd_kafka_toppar_stored_pos(rktp);
         if (rd_kafka_is_simple_consumer(rktp->rktp_rkt->rkt_rk) &&
-            rd_kafka_fetch_pos_cmp(&rktp->rktp_stored_pos,
-                                   &rktp->rktp_committed_pos) > 0)
+            rd_kafka_fetch_pos_cmp(&stored_pos, &rktp->rktp_committed_pos) > 0)
                 err = rd_kafka_offset_commit(rktp, "offset store stop");
 
         /* If stop is in progress (async commit), return now. */
@@ -35,6 +35,109 @@
 const char *rd_kafka_offset2str(int64_t offset);
 
 
+/**
+ * @brief Closes the lock-free store path of \p rktp, folding any offset
+ *        stored through it into rktp_stored_pos.
+ *
+ * Once closed, rd_kafka_offset_store_fast() callers fall back to
+ * the locked path until rd_kafka_offset_store_open() is called.
+ *
+ * @locks_required toppar_lock(rktp)
+ */
+static RD_INLINE RD_UNUSED void
+rd_kafka_offset_store_close(rd_kafka_toppar_t *rktp) {
+        int64_t v = rd_atomic64_get(&rktp->rktp_stored_offset);
+        int64_t prev;
+
+        while (v >= 0) {
+                prev = rd_atomic64_cas(&rktp->rktp_stored_offset, v,
+                                       v | RD_KAFKA_STORED_OFFSET_CLOSED);
+                if (prev == v) {
+                        rktp->rktp_stored_pos.offset =
+                            v & RD_KAFKA_STORED_OFFSET_MASK;
+                        break;
+                }
+                v = prev;
+        }
+}
+
+
+/**
+ * @brief Re-opens the lock-free store path of \p rktp with a new
+ *        generation if stores to the partition would currently be
+ *        accepted and the stored offset is absolute.
+ *
+ * @locks_required toppar_lock(rktp)
+ */
+static RD_INLINE RD_UNUSED void
+rd_kafka_offset_store_open(rd_kafka_toppar_t *rktp) {
+        int64_t v = rd_atomic64_get(&rktp->rktp_stored_offset);
+        int64_t gen;
+
+        rd_dassert(v < 0);
+
+        if (rktp->rktp_stored_pos.offset < 0 ||
+            rktp->rktp_stored_pos.offset > RD_KAFKA_STORED_OFFSET_MASK ||
+            (!(rktp->rktp_flags & RD_KAFKA_TOPPAR_F_ASSIGNED) &&
+             !rd_kafka_is_simple_consumer(rktp->rktp_rkt->rkt_rk)))
+                return;
+
+        /* The epoch must be visible before the path is opened. */
+        rd_atomic32_set(&rktp->rktp_stored_epoch,
+                        rktp->rktp_stored_pos.leader_epoch);
+
+        gen = (RD_KAFKA_STORED_OFFSET_GEN(v) + 1) & 0x7fff;
+        rd_atomic64_set(&rktp->rktp_stored_offset,
+                        (gen << 48) | rktp->rktp_stored_pos.offset);
+}
+
+
+/**
+ * @brief Lock-free store of \p pos for the common case of an increasing
+ *        offset with an unchanged leader epoch on an assigned partition.
+ *
+ * The locked path of rd_kafka_offset_store0() closes the lock-free path
+ * while it modifies the stored position and re-opens it with a new
+ * generation, which makes a concurrent lock-free store that validated
+ * the old state fail its compare-and-swap and retry.
+ *
+ * @returns rd_true if the offset was stored, else the caller must use
+ *          the locked path.
+ *
+ * @locality any
+ * @locks none
+ */
+static RD_INLINE RD_UNUSED rd_bool_t
+rd_kafka_offset_store_fast(rd_kafka_toppar_t *rktp,
+                           const rd_kafka_fetch_pos_t pos) {
+        rd_kafka_t *rk = rktp->rktp_rkt->rkt_rk;
+        int64_t v, prev;
+
+        if (pos.offset < 0 || pos.offset > RD_KAFKA_STORED_OFFSET_MASK)
+                return rd_false;
+
+        v = rd_atomic64_get(&rktp->rktp_stored_offset);
+        while (1) {
+                if (v < 0 || pos.offset < (v & RD_KAFKA_STORED_OFFSET_MASK) ||
+                    pos.leader_epoch !=
+                        rd_atomic32_get(&rktp->rktp_stored_epoch))
+                        return rd_false;
+
+                prev = rd_atomic64_cas(
+                    &rktp->rktp_stored_offset, v,
+                    (v & ~RD_KAFKA_STORED_OFFSET_MASK) | pos.offset);
+                if (prev == v)
+                        break;
+                v = prev;
+        }
+
+        if (rk->rk_cgrp)
+                rd_kafka_cgrp_commit_dirty_add(rk->rk_cgrp, rktp);
+
+        return rd_true;
+}
+
+
 /**
  * @brief Stores the offset for the toppar 'rktp'.
  *        The actual commit of the offset to backing store is usually
@@ -50,6 +153,9 @@ const char *rd_kafka_offset2str(int64_t offset);
  * The \p force flag is useful for internal calls to offset_store0() which
  * do not need the protection described above.
  *
+ * Non-forced stores with \p do_lock set first try the lock-free
+ * rd_kafka_offset_store_fast() path.
+ *
  *
  * There is one situation where the \p force flag is troublesome:
  * If the application is using any of the consumer batching APIs,
@@ -88,17 +194,31 @@ rd_kafka_offset_store0(rd_kafka_toppar_t *rktp,
                        rd_dolock_t do_lock) {
         rd_kafka_resp_err_t err = RD_KAFKA_RESP_ERR_NO_ERROR;
 
+        /* Application stores of increasing offsets avoid the lock. */
+        if (do_lock && !force && rd_kafka_offset_store_fast(rktp, pos))
+                return RD_KAFKA_RESP_ERR_NO_ERROR;
+
         if (do_lock)
                 rd_kafka_toppar_lock(rktp);
 
+        rd_kafka_offset_store_close(rktp);
+
         if (unlikely(!force && !RD_KAFKA_OFFSET_IS_LOGICAL(pos.offset) &&
                      !(rktp->rktp_flags & RD_KAFKA_TOPPAR_F_ASSIGNED) &&
                      !rd_kafka_is_simple_consumer(rktp->rktp_rkt->rkt_rk))) {
                 err = RD_KAFKA_RESP_ERR__STATE;
         } else {
+                rd_kafka_t *rk        = rktp->rktp_rkt->rkt_rk;
                 rktp->rktp_stored_pos = pos;
+
+                /* Let the next commit of the assignment know this
+                 * partition's stored offset changed. */
+                if (!RD_KAFKA_OFFSET_IS_LOGICAL(pos.offset) && rk->rk_cgrp)
+                        rd_kafka_cgrp_commit_dirty_add(rk->rk_cgrp, rktp);
         }
 
+        rd_kafka_offset_store_open(rktp);
+
         if (do_lock)
                 rd_kafka_toppar_unlock(rktp);
 
@@ -288,6 +288,9 @@ void rd_kafka_op_destroy(rd_kafka_op_t *rko) {
 
         switch (rko->rko_type & ~RD_KAFKA_OP_FLAGMASK) {
         case RD_KAFKA_OP_FETCH:
+                if (rko->rko_flags & RD_KAFKA_OP_F_PREFETCH)
+                        rd_kafka_toppar_prefetch_release(rko->rko_rktp,
+                                                         rko->rko_len);
                 rd_kafka_msg_destroy(NULL, &rko->rko_u.fetch.rkm);
                 /* Decrease refcount on rkbuf to eventually rd_free shared buf*/
                 if (rko->rko_u.fetch.rkbuf)
@@ -306,6 +309,8 @@ void rd_kafka_op_destroy(rd_kafka_op_t *rko) {
                 RD_IF_FREE(rko->rko_u.offset_commit.partitions,
                            rd_kafka_topic_partition_list_destroy);
                 RD_IF_FREE(rko->rko_u.offset_commit.reason, rd_free);
+                RD_IF_FREE(rko->rko_u.offset_commit.coalesced,
+                           rd_list_destroy);
                 break;
 
         case RD_KAFKA_OP_SUBSCRIBE:
@@ -781,6 +786,13 @@ rd_kafka_op_t *rd_kafka_op_new_fetch_msg(rd_kafka_msg_t **rkmp,
         rkm->rkm_len     = val_len;
         rko->rko_len     = (int32_t)rkm->rkm_len;
 
+        if (rktp->rktp_rkt->rkt_rk->rk_conf.queued_max_total_bytes > 0) {
+                /* Account against the global prefetch budget until
+                 * the message is destroyed. */
+                rko->rko_flags |= RD_KAFKA_OP_F_PREFETCH;
+                rd_kafka_toppar_prefetch_add(rktp, rko->rko_len);
+        }
+
         rkm->rkm_partition = rktp->rktp_partition;
 
         /* Persistence status is always PERSISTED for consumed messages
@@ -925,4 +937,9 @@ void rd_kafka_fetch_op_app_prepare(rd_kafka_t *rk, rd_kafka_op_t *rko) {
         pos.leader_epoch = rko->rko_u.fetch.rkm.rkm_u.consumer.leader_epoch;
 
         rd_kafka_update_app_pos(rk, rktp, pos, RD_DO_LOCK);
+
+        if (unlikely(rk->rk_cgrp &&
+                     rd_atomic64_get(
+                         &rk->rk_cgrp->rkcg_rebalance_latency.ts_start)))
+                rd_kafka_cgrp_rebalance_latency_end(rk->rk_cgrp, rktp);
 }
@@ -78,6 +78,12 @@ typedef struct rd_kafka_replyq_s {
 #define RD_KAFKA_OP_F_FORCE_CB                                                 \
         0x100 /* rko: force callback even if                                   \
                *      op type is eventable. */
+#define RD_KAFKA_OP_F_POOLED                                                   \
+        0x200 /* rkbuf: allocated from a                                       \
+               *        broker buffer pool */
+#define RD_KAFKA_OP_F_PREFETCH                                                 \
+        0x400 /* rko: fetched message accounted                                \
+               *      against the prefetch budget */
 
 typedef enum {
         RD_KAFKA_OP_NONE,         /* No specific type, use OP_CB */
@@ -317,6 +323,10 @@ struct rd_kafka_op_s {
                                            *   offsets to commit. */
                         rd_ts_t ts_timeout;
                         char *reason;
+                        /** Commit ops coalesced into this commit that
+                         *  will be replied to with its result.
+                         *  (rd_kafka_op_t *), may be NULL. */
+                        rd_list_t *coalesced;
                 } offset_commit;
 
                 struct {
@@ -545,6 +555,8 @@ struct rd_kafka_op_s {
                                RD_KAFKA_MOCK_CMD_BROKER_SET_RACK,
                                RD_KAFKA_MOCK_CMD_COORD_SET,
                                RD_KAFKA_MOCK_CMD_APIVERSION_SET,
+                               RD_KAFKA_MOCK_CMD_CGRP_SESSION_TMOUT_SET,
+                               RD_KAFKA_MOCK_CMD_CGRP_HB_INTVL_SET,
                         } cmd;
 
                         rd_kafka_resp_err_t err; /**< Error for:
@@ -576,6 +588,8 @@ struct rd_kafka_op_s {
                                                   *    BROKER_SET_UPDOWN
                                                   *    APIVERSION_SET (minver)
                                                   *    BROKER_SET_RTT
+                                                  *    CGRP_SESSION_TMOUT_SET
+                                                  *    CGRP_HB_INTVL_SET
                                                   */
                         int64_t hi;              /**< High offset, for:
                                                   *    TOPIC_CREATE (repl fact)
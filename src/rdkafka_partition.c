@@ -71,20 +71,24 @@ rd_kafka_toppar_version_new_barrier0(rd_kafka_toppar_t *rktp,
 
 
 /**
- * Toppar based OffsetResponse handling.
- * This is used for updating the low water mark for consumer lag.
+ * @brief ListOffsetsResponse handler for consumer lag monitoring.
+ *        Updates the low water mark of each requested partition.
+ *
+ * @param opaque The requested partitions, with their rktp set.
+ *
+ * @locality main thread
  */
-static void rd_kafka_toppar_lag_handle_Offset(rd_kafka_t *rk,
-                                              rd_kafka_broker_t *rkb,
-                                              rd_kafka_resp_err_t err,
-                                              rd_kafka_buf_t *rkbuf,
-                                              rd_kafka_buf_t *request,
-                                              void *opaque) {
-        rd_kafka_toppar_t *rktp = opaque;
+static void rd_kafka_toppars_lag_handle_Offset(rd_kafka_t *rk,
+                                               rd_kafka_broker_t *rkb,
+                                               rd_kafka_resp_err_t err,
+                                               rd_kafka_buf_t *rkbuf,
+                                               rd_kafka_buf_t *request,
+                                               void *opaque) {
+        rd_kafka_topic_partition_list_t *partitions = opaque;
         rd_kafka_topic_partition_list_t *offsets;
-        rd_kafka_topic_partition_t *rktpar;
+        const rd_kafka_topic_partition_t *rktpar;
 
-        offsets = rd_kafka_topic_partition_list_new(1);
+        offsets = rd_kafka_topic_partition_list_new(partitions->cnt);
 
         /* Parse and return Offset */
         err = rd_kafka_handle_ListOffsets(rk, rkb, err, rkbuf, request, offsets,
@@ -95,34 +99,37 @@ static void rd_kafka_toppar_lag_handle_Offset(rd_kafka_t *rk,
                 return; /* Retrying */
         }
 
-        if (!err && !(rktpar = rd_kafka_topic_partition_list_find(
-                          offsets, rktp->rktp_rkt->rkt_topic->str,
-                          rktp->rktp_partition)))
-                err = RD_KAFKA_RESP_ERR__UNKNOWN_PARTITION;
+        /* A partition error is also returned as the request error,
+         * so update every partition that has an offset regardless. */
+        RD_KAFKA_TPLIST_FOREACH(rktpar, partitions) {
+                rd_kafka_toppar_t *rktp =
+                    rd_kafka_topic_partition_toppar(rk, rktpar);
+                const rd_kafka_topic_partition_t *result =
+                    rd_kafka_topic_partition_list_find(offsets, rktpar->topic,
+                                                       rktpar->partition);
 
-        if (!err && !rktpar->err) {
                 rd_kafka_toppar_lock(rktp);
-                rktp->rktp_lo_offset = rktpar->offset;
+                if (result && !result->err)
+                        rktp->rktp_lo_offset = result->offset;
+                rktp->rktp_wait_consumer_lag_resp = 0;
                 rd_kafka_toppar_unlock(rktp);
         }
 
         rd_kafka_topic_partition_list_destroy(offsets);
-
-        rktp->rktp_wait_consumer_lag_resp = 0;
-
-        rd_kafka_toppar_destroy(rktp); /* from request.opaque */
+        rd_kafka_topic_partition_list_destroy(partitions);
 }
 
 
-
 /**
- * Request information from broker to keep track of consumer lag.
+ * @brief Adds \p rktp to its leader's partitions in \p leaders if the
+ *        partition's low water mark needs to be requested for consumer lag.
  *
- * @locality toppar handle thread
- * @locks none
+ * @locality main thread
+ * @locks_required rd_kafka_topic_rdlock() on the partition's topic.
  */
-static void rd_kafka_toppar_consumer_lag_req(rd_kafka_toppar_t *rktp) {
-        rd_kafka_topic_partition_list_t *partitions;
+static void rd_kafka_toppar_consumer_lag_add(rd_kafka_toppar_t *rktp,
+                                             rd_list_t *leaders) {
+        struct rd_kafka_partition_leader *leader, leader_skel;
         rd_kafka_topic_partition_t *rktpar;
 
         if (rktp->rktp_wait_consumer_lag_resp)
@@ -131,12 +138,16 @@ static void rd_kafka_toppar_consumer_lag_req(rd_kafka_toppar_t *rktp) {
         rd_kafka_toppar_lock(rktp);
 
         /* Offset requests can only be sent to the leader replica.
+         * The leader id is compared since rktp_leader is not set when
+         * the partition was mapped to its leader broker after the
+         * broker's node information became known.
          *
          * Note: If rktp is delegated to a preferred replica, it is
          * certain that FETCH >= v5 and so rktp_lo_offset will be
          * updated via LogStartOffset in the FETCH response.
          */
-        if (!rktp->rktp_leader || (rktp->rktp_leader != rktp->rktp_broker)) {
+        if (!rktp->rktp_broker || rktp->rktp_leader_id == -1 ||
+            rktp->rktp_leader_id != rktp->rktp_broker_id) {
                 rd_kafka_toppar_unlock(rktp);
                 return;
         }
@@ -151,37 +162,68 @@ static void rd_kafka_toppar_consumer_lag_req(rd_kafka_toppar_t *rktp) {
                 return;
         }
 
+        leader_skel.rkb = rktp->rktp_broker;
+        if (!(leader = rd_list_find(leaders, &leader_skel,
+                                    rd_kafka_partition_leader_cmp))) {
+                leader = rd_kafka_partition_leader_new(rktp->rktp_broker);
+                rd_list_add(leaders, leader);
+        }
+
         rktp->rktp_wait_consumer_lag_resp = 1;
 
-        partitions = rd_kafka_topic_partition_list_new(1);
-        rktpar     = rd_kafka_topic_partition_list_add(
-            partitions, rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition);
+        rktpar = rd_kafka_topic_partition_list_add0(
+            __FUNCTION__, __LINE__, leader->partitions,
+            rktp->rktp_rkt->rkt_topic->str, rktp->rktp_partition, rktp, NULL);
         rktpar->offset = RD_KAFKA_OFFSET_BEGINNING;
         rd_kafka_topic_partition_set_current_leader_epoch(
             rktpar, rktp->rktp_leader_epoch);
 
-        /* Ask for oldest offset. The newest offset is automatically
-         * propagated in FetchResponse.HighwaterMark. */
-        rd_kafka_ListOffsetsRequest(
-            rktp->rktp_broker, partitions, RD_KAFKA_REPLYQ(rktp->rktp_ops, 0),
-            rd_kafka_toppar_lag_handle_Offset, rd_kafka_toppar_keep(rktp));
-
         rd_kafka_toppar_unlock(rktp);
-
-        rd_kafka_topic_partition_list_destroy(partitions);
 }
 
 
-
 /**
- * Request earliest offset for a partition
+ * @brief Request the low water mark of all known partitions from their
+ *        leaders to keep track of consumer lag.
  *
- * Locality: toppar handler thread
+ * One ListOffsetsRequest is sent per leader broker for all the partitions
+ * it leads, and the requests to the different leaders are all sent at once.
+ *
+ * @locality main thread
+ * @locks none
  */
-static void rd_kafka_toppar_consumer_lag_tmr_cb(rd_kafka_timers_t *rkts,
-                                                void *arg) {
-        rd_kafka_toppar_t *rktp = arg;
-        rd_kafka_toppar_consumer_lag_req(rktp);
+void rd_kafka_consumer_lag_tmr_cb(rd_kafka_timers_t *rkts, void *arg) {
+        rd_kafka_t *rk = rkts->rkts_rk;
+        rd_kafka_topic_t *rkt;
+        rd_list_t leaders;
+        struct rd_kafka_partition_leader *leader;
+        int i;
+
+        rd_list_init(&leaders, 0, NULL);
+
+        rd_kafka_rdlock(rk);
+        TAILQ_FOREACH(rkt, &rk->rk_topics, rkt_link) {
+                rd_kafka_topic_rdlock(rkt);
+                for (i = 0; i < rkt->rkt_partition_cnt; i++)
+                        rd_kafka_toppar_consumer_lag_add(rkt->rkt_p[i],
+                                                         &leaders);
+                rd_kafka_topic_rdunlock(rkt);
+        }
+        rd_kafka_rdunlock(rk);
+
+        /* Ask for oldest offset. The newest offset is automatically
+         * propagated in FetchResponse.HighwaterMark.
+         * The partition list is handed over to the response handler. */
+        RD_LIST_FOREACH(leader, &leaders, i) {
+                rd_kafka_ListOffsetsRequest(
+                    leader->rkb, leader->partitions,
+                    RD_KAFKA_REPLYQ(rk->rk_ops, 0),
+                    rd_kafka_toppars_lag_handle_Offset, leader->partitions);
+                rd_kafka_broker_destroy(leader->rkb);
+                rd_free(leader);
+        }
+
+        rd_list_destroy(&leaders);
 }
 
 /**
@@ -227,6 +269,7 @@ rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
         rd_interval_init(&rktp->rktp_new_lease_intvl);
         rd_interval_init(&rktp->rktp_new_lease_log_intvl);
         rd_interval_init(&rktp->rktp_metadata_intvl);
+        rd_interval_init(&rktp->rktp_replica_select_intvl);
         /* Mark partition as unknown (does not exist) until we see the
          * partition in topic metadata. */
         if (partition != RD_KAFKA_PARTITION_UA)
@@ -234,6 +277,7 @@ rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
         rktp->rktp_fetch_state = RD_KAFKA_TOPPAR_FETCH_NONE;
         rktp->rktp_fetch_msg_max_bytes =
             rkt->rkt_rk->rk_conf.fetch_msg_max_bytes;
+        rd_atomic32_init(&rktp->rktp_fetch_priority, 1);
         rktp->rktp_offset_fp = NULL;
         rd_kafka_offset_stats_reset(&rktp->rktp_offsets);
         rd_kafka_offset_stats_reset(&rktp->rktp_offsets_fin);
@@ -246,8 +290,15 @@ rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
         rd_kafka_fetch_pos_init(&rktp->rktp_offset_validation_pos);
         rd_kafka_fetch_pos_init(&rktp->rktp_app_pos);
         rd_kafka_fetch_pos_init(&rktp->rktp_stored_pos);
+        rd_atomic64_init(&rktp->rktp_stored_offset,
+                         RD_KAFKA_STORED_OFFSET_CLOSED);
+        rd_atomic32_init(&rktp->rktp_stored_epoch, -1);
+        rd_atomic32_init(&rktp->rktp_commit_dirty, 0);
+        rd_atomic32_init(&rktp->rktp_rebalance_epoch, 0);
         rd_kafka_fetch_pos_init(&rktp->rktp_committing_pos);
         rd_kafka_fetch_pos_init(&rktp->rktp_committed_pos);
+        rd_kafka_fetch_pos_init(&rktp->rktp_committed_cache.pos);
+        rktp->rktp_committed_cache.leader_epoch = -1;
         rd_kafka_msgq_init(&rktp->rktp_msgq);
         rd_kafka_msgq_init(&rktp->rktp_xmit_msgq);
         mtx_init(&rktp->rktp_lock, mtx_plain);
@@ -261,28 +312,10 @@ rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
         rktp->rktp_op_version = rd_atomic32_get(&rktp->rktp_version);
 
         rd_atomic32_init(&rktp->rktp_msgs_inflight, 0);
+        rd_atomic32_init(&rktp->rktp_fetch_inflight, 0);
+        rd_atomic64_init(&rktp->rktp_prefetch_bytes, 0);
         rd_kafka_pid_reset(&rktp->rktp_eos.pid);
 
-        /* Consumer: If statistics is available we query the log start offset
-         * of each partition.
-         * Since the oldest offset only moves on log retention, we cap this
-         * value on the low end to a reasonable value to avoid flooding
-         * the brokers with OffsetRequests when our statistics interval is low.
-         * FIXME: Use a global timer to collect offsets for all partitions
-         * FIXME: This timer is superfulous for FETCH >= v5 because the log
-         *        start offset is included in fetch responses.
-         * */
-        if (rktp->rktp_rkt->rkt_rk->rk_conf.stats_interval_ms > 0 &&
-            rkt->rkt_rk->rk_type == RD_KAFKA_CONSUMER &&
-            rktp->rktp_partition != RD_KAFKA_PARTITION_UA) {
-                int intvl = rkt->rkt_rk->rk_conf.stats_interval_ms;
-                if (intvl < 10 * 1000 /* 10s */)
-                        intvl = 10 * 1000;
-                rd_kafka_timer_start(
-                    &rkt->rkt_rk->rk_timers, &rktp->rktp_consumer_lag_tmr,
-                    intvl * 1000ll, rd_kafka_toppar_consumer_lag_tmr_cb, rktp);
-        }
-
         rktp->rktp_rkt = rd_kafka_topic_keep(rkt);
 
         rd_kafka_q_fwd_set(rktp->rktp_ops, rkt->rkt_rk->rk_ops);
@@ -311,8 +344,6 @@ static void rd_kafka_toppar_remove(rd_kafka_toppar_t *rktp) {
                             &rktp->rktp_validate_tmr, 1 /*lock*/);
         rd_kafka_timer_stop(&rktp->rktp_rkt->rkt_rk->rk_timers,
                             &rktp->rktp_offset_query_tmr, 1 /*lock*/);
-        rd_kafka_timer_stop(&rktp->rktp_rkt->rkt_rk->rk_timers,
-                            &rktp->rktp_consumer_lag_tmr, 1 /*lock*/);
 
         rd_kafka_q_fwd_set(rktp->rktp_ops, NULL);
 }
@@ -347,6 +378,9 @@ void rd_kafka_toppar_destroy_final(rd_kafka_toppar_t *rktp) {
         if (rktp->rktp_leader)
                 rd_kafka_broker_destroy(rktp->rktp_leader);
 
+        if (rktp->rktp_isrs)
+                rd_free(rktp->rktp_isrs);
+
         rd_refcnt_destroy(&rktp->rktp_refcnt);
 
         rd_free(rktp);
@@ -370,6 +404,12 @@ void rd_kafka_toppar_set_fetch_state(rd_kafka_toppar_t *rktp, int fetch_state) {
             rd_kafka_fetch_states[rktp->rktp_fetch_state],
             rd_kafka_fetch_states[fetch_state]);
 
+        if (RD_KAFKA_TOPPAR_FETCH_IS_STARTED(fetch_state) !=
+            RD_KAFKA_TOPPAR_FETCH_IS_STARTED(rktp->rktp_fetch_state))
+                rd_atomic32_add(
+                    &rktp->rktp_rkt->rkt_rk->rk_consumer.prefetch.toppar_cnt,
+                    RD_KAFKA_TOPPAR_FETCH_IS_STARTED(fetch_state) ? 1 : -1);
+
         rktp->rktp_fetch_state = fetch_state;
 
         if (fetch_state == RD_KAFKA_TOPPAR_FETCH_ACTIVE)
@@ -2019,6 +2059,16 @@ static rd_kafka_op_res_t rd_kafka_toppar_op_serve(rd_kafka_t *rk,
                 rd_kafka_toppar_pause_resume(rktp, rko);
                 break;
 
+        case RD_KAFKA_OP_WAKEUP:
+                /* Partition is back below its share of the prefetch
+                 * budget, see rd_kafka_toppar_prefetch_release(). */
+                rd_kafka_toppar_lock(rktp);
+                if (rktp->rktp_broker)
+                        rd_kafka_broker_wakeup(rktp->rktp_broker,
+                                               "prefetch budget available");
+                rd_kafka_toppar_unlock(rktp);
+                break;
+
         case RD_KAFKA_OP_OFFSET_COMMIT | RD_KAFKA_OP_REPLY:
                 rd_kafka_assert(NULL, rko->rko_u.offset_commit.cb);
                 rko->rko_u.offset_commit.cb(rk, rko->rko_err,
@@ -2285,6 +2335,63 @@ rd_kafka_resp_err_t rd_kafka_toppar_op_pause_resume(rd_kafka_toppar_t *rktp,
 }
 
 
+/**
+ * @returns the partition's fair share of the consumer's global prefetch
+ *          budget (queued.max.messages.total.kbytes), which is evenly
+ *          divided between all partitions being consumed.
+ *
+ * @remark The budget must be enabled.
+ *
+ * @locality any
+ */
+int64_t rd_kafka_toppar_prefetch_share(rd_kafka_toppar_t *rktp) {
+        rd_kafka_t *rk = rktp->rktp_rkt->rkt_rk;
+        int32_t cnt = rd_atomic32_get(&rk->rk_consumer.prefetch.toppar_cnt);
+
+        return rk->rk_conf.queued_max_total_bytes / RD_MAX(cnt, 1);
+}
+
+
+/**
+ * @brief Account \p size bytes of a fetched message against the global
+ *        prefetch budget.
+ *
+ * @locality broker thread
+ */
+void rd_kafka_toppar_prefetch_add(rd_kafka_toppar_t *rktp, int64_t size) {
+        rd_atomic64_add(&rktp->rktp_prefetch_bytes, size);
+        rd_atomic64_add(&rktp->rktp_rkt->rkt_rk->rk_consumer.prefetch.bytes,
+                        size);
+}
+
+
+/**
+ * @brief Release \p size bytes of a destroyed fetched message from the
+ *        global prefetch budget.
+ *
+ * If this brings the partition back below its share of the budget the
+ * partition's broker thread is woken up, through the partition's op queue,
+ * to resume fetching without waiting for its next periodic fetch decision.
+ *
+ * @locality any
+ * @locks any: the toppar lock may be held since messages may be purged
+ *             from the fetch queue with the lock held, which is why the
+ *             broker is not woken up directly.
+ */
+void rd_kafka_toppar_prefetch_release(rd_kafka_toppar_t *rktp, int64_t size) {
+        int64_t share = rd_kafka_toppar_prefetch_share(rktp);
+        int64_t remains;
+
+        remains = rd_atomic64_sub(&rktp->rktp_prefetch_bytes, size);
+        rd_atomic64_sub(&rktp->rktp_rkt->rkt_rk->rk_consumer.prefetch.bytes,
+                        size);
+
+        if (remains < share && remains + size >= share)
+                rd_kafka_toppar_op0(rktp, rd_kafka_op_new(RD_KAFKA_OP_WAKEUP),
+                                    RD_KAFKA_NO_REPLYQ);
+}
+
+
 /**
  * @brief Pause a toppar (asynchronous).
  *
@@ -3195,23 +3302,26 @@ int rd_kafka_topic_partition_list_set_offsets(
                         rd_kafka_toppar_t *rktp =
                             rd_kafka_topic_partition_ensure_toppar(rk, rktpar,
                                                                    rd_true);
+                        rd_kafka_fetch_pos_t stored_pos;
+
                         rd_kafka_toppar_lock(rktp);
 
+                        stored_pos = rd_kafka_toppar_stored_pos(rktp);
+
                         if (rk->rk_conf.debug &
                             (RD_KAFKA_DBG_CGRP | RD_KAFKA_DBG_TOPIC))
                                 rd_snprintf(preamble, sizeof(preamble),
                                             "stored %s, committed %s: ",
-                                            rd_kafka_fetch_pos2str(
-                                                rktp->rktp_stored_pos),
+                                            rd_kafka_fetch_pos2str(stored_pos),
                                             rd_kafka_fetch_pos2str(
                                                 rktp->rktp_committed_pos));
 
-                        if (rd_kafka_fetch_pos_cmp(&rktp->rktp_stored_pos,
+                        if (rd_kafka_fetch_pos_cmp(&stored_pos,
                                                    &rktp->rktp_committed_pos) >
                             0) {
                                 verb = "setting stored";
                                 rd_kafka_topic_partition_set_from_fetch_pos(
-                                    rktpar, rktp->rktp_stored_pos);
+                                    rktpar, stored_pos);
                         } else {
                                 rktpar->offset = RD_KAFKA_OFFSET_INVALID;
                         }
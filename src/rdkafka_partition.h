@@ -181,6 +181,11 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
                                            *   messages in-flight to/from
                                            *   the broker. */
 
+        rd_atomic64_t rktp_prefetch_bytes; /**< Payload bytes of fetched
+                                            *   messages not yet destroyed,
+                                            *   accounted against the
+                                            *   global prefetch budget. */
+
         uint64_t rktp_msgid; /**< Current/last message id.
                               *   Each message enqueued on a
                               *   non-UA partition will get a
@@ -305,11 +310,23 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
                                            * Locality: broker thread
                                            */
 
+        /** Application-assigned fetch priority used by
+         *  fetch.scheduling=priority and lag,
+         *  see rd_kafka_fetch_priority_set(). */
+        rd_atomic32_t rktp_fetch_priority;
+
         rd_ts_t rktp_ts_fetch_backoff; /* Back off fetcher for
                                         * this partition until this
                                         * absolute timestamp
                                         * expires. */
 
+        /** Number of pipelined FetchRequests (fetch.pipeline.depth > 1)
+         *  currently in flight for this partition. The partition is not
+         *  added to another FetchRequest until this drops to zero.
+         *  Atomic since the partition may migrate to another broker
+         *  thread while a request is outstanding. */
+        rd_atomic32_t rktp_fetch_inflight;
+
         /** Offset to query broker for. */
         rd_kafka_fetch_pos_t rktp_query_pos;
 
@@ -335,15 +352,49 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
          *  unassigned/stopped/seeked. */
         rd_kafka_fetch_pos_t rktp_app_pos;
 
-        /** Last stored offset, but maybe not yet committed. */
+        /** Last stored offset, but maybe not yet committed.
+         *  While the lock-free store path is open the offset is
+         *  superseded by rktp_stored_offset, use
+         *  rd_kafka_toppar_stored_pos() to read it.
+         *  @locks toppar_lock */
         rd_kafka_fetch_pos_t rktp_stored_pos;
 
+        /** Lock-free stored offset, see rd_kafka_offset_store_fast().
+         *  Bit 63 is set when the lock-free path is closed,
+         *  bits 48..62 hold a generation that is bumped each time the
+         *  path is re-opened and bits 0..47 hold the stored offset. */
+        rd_atomic64_t rktp_stored_offset;
+
+        /** Leader epoch of rktp_stored_pos, only updated while the
+         *  lock-free store path is closed. */
+        rd_atomic32_t rktp_stored_epoch;
+
+        /** Stored offset changed since the last commit of the
+         *  assignment: the partition is on rkcg_commit_dirty. */
+        rd_atomic32_t rktp_commit_dirty;
+
+        /** Rebalance latency measurement (rkcg_rebalance_latency.epoch)
+         *  this partition was added or resumed by, or 0. */
+        rd_atomic32_t rktp_rebalance_epoch;
+
         /** Offset currently being committed */
         rd_kafka_fetch_pos_t rktp_committing_pos;
 
         /** Last (known) committed offset */
         rd_kafka_fetch_pos_t rktp_committed_pos;
 
+        /** Last known committed offset of the partition in the consumer
+         *  group, from our own commits and from OffsetFetch responses.
+         *  Unlike rktp_committed_pos it is retained across assignments
+         *  so that fetching may start at it when the partition is
+         *  assigned again, see rd_kafka_assignment_serve_pending().
+         *  @locks toppar_lock */
+        struct {
+                rd_kafka_fetch_pos_t pos;
+                int32_t leader_epoch; /**< rktp_leader_epoch at the time
+                                       *   pos was cached. */
+        } rktp_committed_cache;
+
         rd_ts_t rktp_ts_committed_offset; /**< Timestamp of last commit */
 
         struct offset_stats rktp_offsets;     /* Current offsets.
@@ -428,8 +479,6 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
         rd_kafka_timer_t rktp_offset_query_tmr;  /* Offset query timer */
         rd_kafka_timer_t rktp_offset_commit_tmr; /* Offset commit timer */
         rd_kafka_timer_t rktp_offset_sync_tmr;   /* Offset file sync timer */
-        rd_kafka_timer_t rktp_consumer_lag_tmr;  /* Consumer lag monitoring
-                                                  * timer */
         rd_kafka_timer_t rktp_validate_tmr;      /**< Offset and epoch
                                                   *   validation retry timer */
 
@@ -447,6 +496,15 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
                                                  *   in preferred replica
                                                  *   handler.
                                                  */
+        rd_interval_t rktp_replica_select_intvl; /**< Controls max frequency
+                                                  *   of client-side replica
+                                                  *   selection while
+                                                  *   fetching from the
+                                                  *   leader. */
+        int32_t *rktp_isrs; /**< In-sync replicas from the last Metadata
+                             *   response, used by client-side replica
+                             *   selection. May be NULL. */
+        int rktp_isr_cnt;   /**< Number of rktp_isrs */
 
         int rktp_wait_consumer_lag_resp; /* Waiting for consumer lag
                                           * response. */
@@ -462,6 +520,13 @@ struct rd_kafka_toppar_s {                           /* rd_kafka_toppar_t */
                 rd_atomic64_t producer_enq_msgs; /**< Producer: enqueued msgs */
                 rd_atomic64_t rx_ver_drops;      /**< Consumer: outdated message
                                                   *             drops. */
+                rd_atomic64_t rx_aborted_msgs;   /**< Consumer: messages in
+                                                  *   aborted transactions
+                                                  *   skipped. */
+                rd_atomic64_t rx_aborted_bytes;  /**<  .. MessageSet bytes */
+                rd_atomic64_t rx_filtered_msgs;  /**< Consumer: messages
+                                                  *   dropped by the
+                                                  *   consume_filter_cb. */
         } rktp_c;
 };
 
@@ -536,6 +601,64 @@ static const char *rd_kafka_toppar_name(const rd_kafka_toppar_t *rktp) {
 
         return ret;
 }
+
+
+/**
+ * rktp_stored_offset layout, see rd_kafka_offset_store_fast().
+ */
+#define RD_KAFKA_STORED_OFFSET_CLOSED INT64_MIN
+#define RD_KAFKA_STORED_OFFSET_MASK   (((int64_t)1 << 48) - 1)
+#define RD_KAFKA_STORED_OFFSET_GEN(V) (((V) >> 48) & 0x7fff)
+
+/**
+ * @returns the partition's stored offset and leader epoch, taking
+ *          offsets stored through the lock-free path into account.
+ *
+ * @locks_required toppar_lock(rktp)
+ */
+static RD_INLINE RD_UNUSED rd_kafka_fetch_pos_t
+rd_kafka_toppar_stored_pos(rd_kafka_toppar_t *rktp) {
+        rd_kafka_fetch_pos_t pos = rktp->rktp_stored_pos;
+        int64_t v                = rd_atomic64_get(&rktp->rktp_stored_offset);
+
+        /* The leader epoch can't change while the path is open. */
+        if (v >= 0)
+                pos.offset = v & RD_KAFKA_STORED_OFFSET_MASK;
+
+        return pos;
+}
+
+
+/**
+ * @brief Cache \p pos as the partition's last known committed offset.
+ *
+ * @locks_required toppar_lock(rktp)
+ */
+static RD_INLINE RD_UNUSED void
+rd_kafka_toppar_committed_cache_set(rd_kafka_toppar_t *rktp,
+                                    rd_kafka_fetch_pos_t pos) {
+        rktp->rktp_committed_cache.pos          = pos;
+        rktp->rktp_committed_cache.leader_epoch = rktp->rktp_leader_epoch;
+}
+
+/**
+ * @returns the cached committed offset if fetching may start at it,
+ *          else a position with offset RD_KAFKA_OFFSET_INVALID.
+ *
+ * The cached offset is not used if the partition leadership changed
+ * since it was cached, since the log may have been truncated.
+ *
+ * @locks_required toppar_lock(rktp)
+ */
+static RD_INLINE RD_UNUSED rd_kafka_fetch_pos_t
+rd_kafka_toppar_committed_cache_get(rd_kafka_toppar_t *rktp) {
+        if (rktp->rktp_committed_cache.pos.offset < 0 ||
+            rktp->rktp_committed_cache.leader_epoch != rktp->rktp_leader_epoch)
+                return RD_KAFKA_FETCH_POS(RD_KAFKA_OFFSET_INVALID, -1);
+
+        return rktp->rktp_committed_cache.pos;
+}
+
 rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
                                         int32_t partition,
                                         const char *func,
@@ -544,6 +667,9 @@ rd_kafka_toppar_t *rd_kafka_toppar_new0(rd_kafka_topic_t *rkt,
         rd_kafka_toppar_new0(rkt, partition, __FUNCTION__, __LINE__)
 void rd_kafka_toppar_purge_and_disable_queues(rd_kafka_toppar_t *rktp);
 void rd_kafka_toppar_set_fetch_state(rd_kafka_toppar_t *rktp, int fetch_state);
+int64_t rd_kafka_toppar_prefetch_share(rd_kafka_toppar_t *rktp);
+void rd_kafka_toppar_prefetch_add(rd_kafka_toppar_t *rktp, int64_t size);
+void rd_kafka_toppar_prefetch_release(rd_kafka_toppar_t *rktp, int64_t size);
 void rd_kafka_toppar_insert_msg(rd_kafka_toppar_t *rktp, rd_kafka_msg_t *rkm);
 void rd_kafka_toppar_enq_msg(rd_kafka_toppar_t *rktp,
                              rd_kafka_msg_t *rkm,
@@ -944,6 +1070,8 @@ void *rd_kafka_topic_partition_list_copy_opaque(const void *src, void *opaque);
 struct rd_kafka_toppar_ver {
         rd_kafka_toppar_t *rktp;
         int32_t version;
+        rd_bool_t in_response; /**< Partition was included in the
+                                *   FetchResponse. */
 };
 
 
@@ -998,6 +1126,8 @@ void rd_kafka_toppar_offset_commit_result(
 
 void rd_kafka_toppar_broker_leave_for_remove(rd_kafka_toppar_t *rktp);
 
+void rd_kafka_consumer_lag_tmr_cb(rd_kafka_timers_t *rkts, void *arg);
+
 
 /**
  * @brief Represents a leader and the partitions it is leader for.
@@ -167,6 +167,7 @@ static RD_UNUSED const char *rd_kafka_ApiKey2str(int16_t ApiKey) {
             [RD_KAFKAP_DescribeTransactions] = "DescribeTransactions",
             [RD_KAFKAP_ListTransactions]     = "ListTransactions",
             [RD_KAFKAP_AllocateProducerIds]  = "AllocateProducerIds",
+            [RD_KAFKAP_ConsumerGroupHeartbeat] = "ConsumerGroupHeartbeat",
         };
         static RD_TLS char ret[64];
 
@@ -651,5 +652,64 @@ rd_kafka_pid_bump(const rd_kafka_pid_t old) {
 
 /**@}*/
 
+/**
+ * @name Topic Id (Uuid)
+ * @{
+ *
+ */
+
+/**
+ * @brief Kafka Uuid, as used for topic ids (KIP-516).
+ *
+ * Serialized as two big endian int64s, most significant bits first.
+ */
+typedef struct rd_kafka_Uuid_s {
+        int64_t most_significant_bits;
+        int64_t least_significant_bits;
+} rd_kafka_Uuid_t;
+
+#define RD_KAFKA_UUID_ZERO                                                     \
+        { 0, 0 }
+
+/**
+ * @returns true if \p UUID is the all-zero (unset) Uuid.
+ */
+#define RD_KAFKA_UUID_IS_ZERO(UUID)                                            \
+        ((UUID).most_significant_bits == 0 &&                                  \
+         (UUID).least_significant_bits == 0)
+
+/**
+ * @brief Uuid comparator
+ */
+static RD_UNUSED RD_INLINE int rd_kafka_Uuid_cmp(const rd_kafka_Uuid_t a,
+                                                 const rd_kafka_Uuid_t b) {
+        if (a.most_significant_bits != b.most_significant_bits)
+                return a.most_significant_bits < b.most_significant_bits ? -1
+                                                                         : 1;
+        if (a.least_significant_bits != b.least_significant_bits)
+                return a.least_significant_bits < b.least_significant_bits ? -1
+                                                                           : 1;
+        return 0;
+}
+
+/**
+ * @returns the hex string representation of a Uuid in a thread-safe
+ *          static buffer.
+ */
+static RD_UNUSED const char *rd_kafka_Uuid2str(const rd_kafka_Uuid_t uuid) {
+        static RD_TLS char buf[2][40];
+        static RD_TLS int i;
+
+        i = (i + 1) % 2;
+
+        rd_snprintf(buf[i], sizeof(buf[i]), "%016" PRIx64 "%016" PRIx64,
+                    (uint64_t)uuid.most_significant_bits,
+                    (uint64_t)uuid.least_significant_bits);
+
+        return buf[i];
+}
+
+/**@}*/
+
 
 #endif /* _RDKAFKA_PROTO_H_ */
@@ -571,6 +571,29 @@ int rd_kafka_q_serve(rd_kafka_q_t *rkq,
         return cnt;
 }
 
+/**
+ * @brief Filter out and destroy outdated control messages.
+ *
+ * @locality Any thread.
+ */
+static void
+rd_kafka_purge_outdated_ctrl_msgs(rd_kafka_toppar_t *rktp,
+                                  int32_t version,
+                                  struct rd_kafka_op_tailq *ctrl_msg_q) {
+        rd_kafka_op_t *rko, *next;
+
+        next = TAILQ_FIRST(ctrl_msg_q);
+        while (next) {
+                rko  = next;
+                next = TAILQ_NEXT(rko, rko_link);
+                if (rko->rko_rktp == rktp &&
+                    rd_kafka_op_version_outdated(rko, version)) {
+                        TAILQ_REMOVE(ctrl_msg_q, rko, rko_link);
+                        rd_kafka_op_destroy(rko);
+                }
+        }
+}
+
 /**
  * @brief Filter out and destroy outdated messages.
  *
@@ -586,7 +609,7 @@ rd_kafka_purge_outdated_messages(rd_kafka_toppar_t *rktp,
                                  struct rd_kafka_op_tailq *ctrl_msg_q) {
         size_t valid_count = 0;
         size_t i;
-        rd_kafka_op_t *rko, *next;
+        rd_kafka_op_t *rko;
 
         for (i = 0; i < cnt; i++) {
                 rko = rkmessages[i]->_private;
@@ -602,21 +625,70 @@ rd_kafka_purge_outdated_messages(rd_kafka_toppar_t *rktp,
         }
 
         /* Discard outdated control msgs ops */
-        next = TAILQ_FIRST(ctrl_msg_q);
-        while (next) {
-                rko  = next;
-                next = TAILQ_NEXT(rko, rko_link);
-                if (rko->rko_rktp == rktp &&
-                    rd_kafka_op_version_outdated(rko, version)) {
-                        TAILQ_REMOVE(ctrl_msg_q, rko, rko_link);
-                        rd_kafka_op_destroy(rko);
-                }
+        rd_kafka_purge_outdated_ctrl_msgs(rktp, version, ctrl_msg_q);
+
+        return valid_count;
+}
+
+
+/**
+ * @brief Filter out and destroy outdated ops, as
+ *        rd_kafka_purge_outdated_messages() but for an array of ops.
+ *
+ * @returns Returns the number of valid ops.
+ *
+ * @locality Any thread.
+ */
+static size_t
+rd_kafka_purge_outdated_ops(rd_kafka_toppar_t *rktp,
+                            int32_t version,
+                            rd_kafka_op_t **rkos,
+                            size_t cnt,
+                            struct rd_kafka_op_tailq *ctrl_msg_q) {
+        size_t valid_count = 0;
+        size_t i;
+
+        for (i = 0; i < cnt; i++) {
+                if (rkos[i]->rko_rktp == rktp &&
+                    rd_kafka_op_version_outdated(rkos[i], version))
+                        rd_kafka_op_destroy(rkos[i]);
+                else
+                        rkos[valid_count++] = rkos[i];
         }
 
+        rd_kafka_purge_outdated_ctrl_msgs(rktp, version, ctrl_msg_q);
+
         return valid_count;
 }
 
 
+/**
+ * @brief Update the application position past the consumed control
+ *        messages in \p ctrl_msg_q and destroy them.
+ */
+static void rd_kafka_q_ctrl_msgs_done(rd_kafka_t *rk,
+                                      struct rd_kafka_op_tailq *ctrl_msg_q) {
+        rd_kafka_op_t *rko, *next;
+
+        next = TAILQ_FIRST(ctrl_msg_q);
+        while (next) {
+                rko                     = next;
+                next                    = TAILQ_NEXT(next, rko_link);
+                rd_kafka_toppar_t *rktp = rko->rko_rktp;
+                int64_t offset = rko->rko_u.fetch.rkm.rkm_rkmessage.offset + 1;
+                if (rktp->rktp_app_pos.offset < offset)
+                        rd_kafka_update_app_pos(
+                            rk, rktp,
+                            RD_KAFKA_FETCH_POS(
+                                offset,
+                                rd_kafka_message_leader_epoch(
+                                    &rko->rko_u.fetch.rkm.rkm_rkmessage)),
+                            RD_DO_LOCK);
+                rd_kafka_op_destroy(rko);
+        }
+}
+
+
 /**
  * Populate 'rkmessages' array with messages from 'rkq'.
  * If 'auto_commit' is set, each message's offset will be committed
@@ -742,26 +814,203 @@ int rd_kafka_q_serve_rkmessages(rd_kafka_q_t *rkq,
         }
 
         /* Discard ctrl msgs */
-        next = TAILQ_FIRST(&ctrl_msg_q);
+        rd_kafka_q_ctrl_msgs_done(rk, &ctrl_msg_q);
+
+        rd_kafka_app_polled(rk);
+
+        return cnt;
+}
+
+
+/**
+ * @brief Project the op \p rko onto row \p i of \p cols.
+ *
+ * Plain fetched messages are read straight from the op without setting up
+ * the op's embedded rd_kafka_message_t, which is only done for errors
+ * and when there are on_consume interceptors that need it.
+ */
+static RD_INLINE void
+rd_kafka_message_columns_set(rd_kafka_message_columns_t *cols,
+                             size_t i,
+                             rd_kafka_op_t *rko,
+                             rd_bool_t on_consume) {
+        const rd_kafka_msg_t *rkm = &rko->rko_u.fetch.rkm;
+        const rd_kafka_message_t *rkmessage;
+
+        cols->rko[i] = rko;
+
+        if (likely(rko->rko_type == RD_KAFKA_OP_FETCH && !rko->rko_err &&
+                   !rkm->rkm_err && !on_consume)) {
+                cols->err[i]       = RD_KAFKA_RESP_ERR_NO_ERROR;
+                cols->rkt[i]       = rko->rko_rktp->rktp_rkt;
+                cols->partition[i] = rko->rko_rktp->rktp_partition;
+                cols->offset[i]    = rkm->rkm_offset;
+                cols->timestamp[i] = rkm->rkm_timestamp;
+                cols->key[i]       = rkm->rkm_key;
+                cols->key_len[i]   = rkm->rkm_key_len;
+                cols->payload[i]   = rkm->rkm_payload;
+                cols->len[i]       = rkm->rkm_len;
+                return;
+        }
+
+        rkmessage = rd_kafka_message_get(rko);
+
+        cols->err[i]       = rkmessage->err;
+        cols->rkt[i]       = rkmessage->rkt;
+        cols->partition[i] = rkmessage->partition;
+        cols->offset[i]    = rkmessage->offset;
+        cols->timestamp[i] = rd_kafka_message_timestamp(rkmessage, NULL);
+        cols->key[i]       = rkmessage->key;
+        cols->key_len[i]   = rkmessage->key_len;
+        cols->payload[i]   = rkmessage->payload;
+        cols->len[i]       = rkmessage->len;
+}
+
+
+/**
+ * @brief Populate the columns of \p cols with messages from \p rkq,
+ *        with the same semantics as rd_kafka_q_serve_rkmessages().
+ *
+ * The columns are filled directly from the fetch ops, which are kept on
+ * \p cols to back the referenced message data until the columns are
+ * cleared.
+ *
+ * @returns the number of rows populated.
+ */
+int rd_kafka_q_serve_columns(rd_kafka_q_t *rkq,
+                             int timeout_ms,
+                             rd_kafka_message_columns_t *cols) {
+        size_t cnt = 0;
+        TAILQ_HEAD(, rd_kafka_op_s) tmpq = TAILQ_HEAD_INITIALIZER(tmpq);
+        struct rd_kafka_op_tailq ctrl_msg_q =
+            TAILQ_HEAD_INITIALIZER(ctrl_msg_q);
+        rd_kafka_op_t *rko, *next;
+        rd_kafka_t *rk = rkq->rkq_rk;
+        rd_kafka_q_t *fwdq;
+        struct timespec timeout_tspec;
+        rd_bool_t on_consume;
+        size_t i;
+
+        mtx_lock(&rkq->rkq_lock);
+        if ((fwdq = rd_kafka_q_fwd_get(rkq, 0))) {
+                /* Since the q_pop may block we need to release the parent
+                 * queue's lock. */
+                mtx_unlock(&rkq->rkq_lock);
+                cnt = (size_t)rd_kafka_q_serve_columns(fwdq, timeout_ms, cols);
+                rd_kafka_q_destroy(fwdq);
+                return (int)cnt;
+        }
+
+        mtx_unlock(&rkq->rkq_lock);
+
+        if (timeout_ms)
+                rd_kafka_app_poll_blocking(rk);
+
+        rd_timeout_init_timespec(&timeout_tspec, timeout_ms);
+
+        rd_kafka_yield_thread = 0;
+        while (cnt < cols->size) {
+                rd_kafka_op_res_t res;
+
+                mtx_lock(&rkq->rkq_lock);
+
+                while (!(rko = TAILQ_FIRST(&rkq->rkq_q)) &&
+                       !rd_kafka_q_check_yield(rkq) &&
+                       cnd_timedwait_abs(&rkq->rkq_cond, &rkq->rkq_lock,
+                                         &timeout_tspec) == thrd_success)
+                        ;
+
+                rd_kafka_q_mark_served(rkq);
+
+                if (!rko) {
+                        mtx_unlock(&rkq->rkq_lock);
+                        break; /* Timed out */
+                }
+
+                rd_kafka_q_deq0(rkq, rko);
+
+                mtx_unlock(&rkq->rkq_lock);
+
+                if (unlikely(rko->rko_type == RD_KAFKA_OP_BARRIER)) {
+                        cnt = rd_kafka_purge_outdated_ops(
+                            rko->rko_rktp, rko->rko_version, cols->rko, cnt,
+                            &ctrl_msg_q);
+                        rd_kafka_op_destroy(rko);
+                        continue;
+                }
+
+                if (rd_kafka_op_version_outdated(rko, 0)) {
+                        /* Outdated op, put on discard queue */
+                        TAILQ_INSERT_TAIL(&tmpq, rko, rko_link);
+                        continue;
+                }
+
+                /* Serve non-FETCH callbacks */
+                res =
+                    rd_kafka_poll_cb(rk, rkq, rko, RD_KAFKA_Q_CB_RETURN, NULL);
+                if (res == RD_KAFKA_OP_RES_KEEP ||
+                    res == RD_KAFKA_OP_RES_HANDLED) {
+                        /* Callback served, rko is destroyed (if HANDLED). */
+                        continue;
+                } else if (unlikely(res == RD_KAFKA_OP_RES_YIELD ||
+                                    rd_kafka_yield_thread)) {
+                        /* Yield. */
+                        break;
+                }
+                rd_dassert(res == RD_KAFKA_OP_RES_PASS);
+
+                /* Control messages are not returned to the application */
+                if (unlikely(rd_kafka_op_is_ctrl_msg(rko))) {
+                        TAILQ_INSERT_TAIL(&ctrl_msg_q, rko, rko_link);
+                        continue;
+                }
+
+                cols->rko[cnt++] = rko;
+        }
+
+        /* Fill the columns from the remaining ops, in order. */
+        on_consume = rd_list_cnt(&rk->rk_conf.interceptors.on_consume) > 0;
+        for (i = 0; i < cnt; i++)
+                rd_kafka_message_columns_set(cols, i, cols->rko[i],
+                                             on_consume);
+
+        cols->cnt = cnt;
+
+        for (i = cnt; i-- > 0;) {
+                rd_kafka_toppar_t *rktp = cols->rko[i]->rko_rktp;
+                int64_t offset          = cols->offset[i] + 1;
+                int32_t leader_epoch;
+
+                if (!rktp || rktp->rktp_app_pos.offset >= offset)
+                        continue;
+
+                if (cols->rko[i]->rko_type == RD_KAFKA_OP_FETCH)
+                        leader_epoch = cols->rko[i]
+                                           ->rko_u.fetch.rkm.rkm_u.consumer
+                                           .leader_epoch;
+                else
+                        leader_epoch = rd_kafka_message_leader_epoch(
+                            &cols->rko[i]->rko_u.err.rkm.rkm_rkmessage);
+
+                rd_kafka_update_app_pos(
+                    rk, rktp, RD_KAFKA_FETCH_POS(offset, leader_epoch),
+                    RD_DO_LOCK);
+        }
+
+        /* Discard non-desired and already handled ops */
+        next = TAILQ_FIRST(&tmpq);
         while (next) {
-                rko                     = next;
-                next                    = TAILQ_NEXT(next, rko_link);
-                rd_kafka_toppar_t *rktp = rko->rko_rktp;
-                int64_t offset = rko->rko_u.fetch.rkm.rkm_rkmessage.offset + 1;
-                if (rktp->rktp_app_pos.offset < offset)
-                        rd_kafka_update_app_pos(
-                            rk, rktp,
-                            RD_KAFKA_FETCH_POS(
-                                offset,
-                                rd_kafka_message_leader_epoch(
-                                    &rko->rko_u.fetch.rkm.rkm_rkmessage)),
-                            RD_DO_LOCK);
+                rko  = next;
+                next = TAILQ_NEXT(next, rko_link);
                 rd_kafka_op_destroy(rko);
         }
 
+        /* Discard ctrl msgs */
+        rd_kafka_q_ctrl_msgs_done(rk, &ctrl_msg_q);
+
         rd_kafka_app_polled(rk);
 
-        return cnt;
+        return (int)cnt;
 }
 
 
@@ -858,6 +858,9 @@ int rd_kafka_q_serve_rkmessages(rd_kafka_q_t *rkq,
                                 int timeout_ms,
                                 rd_kafka_message_t **rkmessages,
                                 size_t rkmessages_size);
+int rd_kafka_q_serve_columns(rd_kafka_q_t *rkq,
+                             int timeout_ms,
+                             rd_kafka_message_columns_t *cols);
 rd_kafka_resp_err_t rd_kafka_q_wait_result(rd_kafka_q_t *rkq, int timeout_ms);
 
 int rd_kafka_q_apply(rd_kafka_q_t *rkq,
@@ -900,6 +903,34 @@ struct rd_kafka_queue_s {
 };
 
 
+/**
+ * @brief Column-oriented batch of consumed messages,
+ *        see rd_kafka_consume_columns_queue().
+ *
+ * Filled by rd_kafka_q_serve_columns().
+ */
+struct rd_kafka_message_columns_s {
+        size_t size; /**< Number of rows the columns can hold */
+        size_t cnt;  /**< Number of rows currently populated */
+
+        /* Columns, see the accessors in rdkafka.h */
+        rd_kafka_resp_err_t *err;
+        rd_kafka_topic_t **rkt;
+        int32_t *partition;
+        int64_t *offset;
+        int64_t *timestamp;
+        const void **key;
+        size_t *key_len;
+        const void **payload;
+        size_t *len;
+
+        rd_kafka_op_t **rko; /**< The ops the rows were filled from,
+                              *   which back the key and payload
+                              *   pointers until the columns are
+                              *   cleared. */
+};
+
+
 rd_kafka_queue_t *rd_kafka_queue_new0(rd_kafka_t *rk, rd_kafka_q_t *rkq);
 
 void rd_kafka_q_dump(FILE *fp, rd_kafka_q_t *rkq);
@@ -27,6 +27,7 @@
  */
 #include "rdkafka_int.h"
 #include "rdkafka_assignor.h"
+#include "rdunittest.h"
 
 
 
@@ -48,7 +49,110 @@
  * The assignment will be:
  * C0: [t0p0, t0p1, t1p0, t1p1]
  * C1: [t0p2, t1p2]
+ *
+ * If the consumers and the partition replicas have racks configured
+ * (KIP-881), and the partitions are not all replicated to the same racks,
+ * each consumer is first assigned up to its share of partitions that have
+ * a replica in the consumer's rack, in numeric order, and the remaining
+ * partitions are then assigned to the consumers without considering racks.
+ */
+
+
+/**
+ * @brief Rack-aware (KIP-881) assignment of \p eligible_topic's partitions.
+ *
+ * Each member is assigned at most the same number of partitions as with
+ * the non-rack-aware range assignment, preferring partitions with a replica
+ * in the member's rack.
  */
+static void rd_kafka_range_assignor_assign_topic_rack_aware(
+    rd_kafka_t *rk,
+    rd_kafka_assignor_topic_t *eligible_topic,
+    int numPartitionsPerConsumer,
+    int consumersWithExtraPartition) {
+        int partition_cnt = eligible_topic->metadata->partition_cnt;
+        int member_cnt    = rd_list_cnt(&eligible_topic->members);
+        rd_bool_t *assigned;
+        int *member_assigned_cnt;
+        int unassigned_cnt = partition_cnt;
+        int pass;
+        int i;
+
+        assigned = rd_calloc(partition_cnt, sizeof(*assigned));
+        member_assigned_cnt =
+            rd_calloc(member_cnt, sizeof(*member_assigned_cnt));
+
+        /* First pass: assign partitions with a replica in the member's rack.
+         * Second pass: assign the remaining partitions. */
+        for (pass = 0; pass < 2 && unassigned_cnt > 0; pass++) {
+                for (i = 0; i < member_cnt && unassigned_cnt > 0; i++) {
+                        rd_kafka_group_member_t *rkgm =
+                            rd_list_elem(&eligible_topic->members, i);
+                        const char *rack = NULL;
+                        rd_bool_t had_extra;
+                        int maxAssignable;
+                        int p;
+
+                        if (pass == 0) {
+                                if (!rkgm->rkgm_rack_id)
+                                        continue;
+                                rack = rkgm->rkgm_rack_id->str;
+                        }
+
+                        had_extra = member_assigned_cnt[i] >
+                                    numPartitionsPerConsumer;
+                        maxAssignable =
+                            numPartitionsPerConsumer +
+                            (consumersWithExtraPartition > 0 ? 1 : 0) -
+                            member_assigned_cnt[i];
+
+                        for (p = 0; p < partition_cnt && maxAssignable > 0;
+                             p++) {
+                                if (assigned[p])
+                                        continue;
+
+                                if (rack &&
+                                    !rd_kafka_assignor_topic_partition_has_rack(
+                                        eligible_topic, p, rack))
+                                        continue;
+
+                                rd_kafka_topic_partition_list_add(
+                                    rkgm->rkgm_assignment,
+                                    eligible_topic->metadata->topic, p);
+                                assigned[p] = rd_true;
+                                member_assigned_cnt[i]++;
+                                maxAssignable--;
+                                unassigned_cnt--;
+                        }
+
+                        if (!had_extra && member_assigned_cnt[i] >
+                                              numPartitionsPerConsumer)
+                                consumersWithExtraPartition--;
+                }
+        }
+
+        rd_assert(unassigned_cnt == 0);
+
+        for (i = 0; i < member_cnt; i++) {
+                rd_kafka_group_member_t *rkgm =
+                    rd_list_elem(&eligible_topic->members, i);
+
+                if (member_assigned_cnt[i] == 0)
+                        continue;
+
+                rd_kafka_dbg(rk, CGRP, "ASSIGN",
+                             "range: Member \"%s\"%s%s: "
+                             "assigned %d partition(s) of topic %s",
+                             rkgm->rkgm_member_id->str,
+                             rkgm->rkgm_rack_id ? " in rack " : "",
+                             rkgm->rkgm_rack_id ? rkgm->rkgm_rack_id->str : "",
+                             member_assigned_cnt[i],
+                             eligible_topic->metadata->topic);
+        }
+
+        rd_free(member_assigned_cnt);
+        rd_free(assigned);
+}
 
 rd_kafka_resp_err_t
 rd_kafka_range_assignor_assign_cb(rd_kafka_t *rk,
@@ -96,6 +200,13 @@ rd_kafka_range_assignor_assign_cb(rd_kafka_t *rk,
                              eligible_topic->metadata->partition_cnt,
                              rd_list_cnt(&eligible_topic->members));
 
+                if (rd_kafka_assignor_topic_use_rack_aware(eligible_topic)) {
+                        rd_kafka_range_assignor_assign_topic_rack_aware(
+                            rk, eligible_topic, numPartitionsPerConsumer,
+                            consumersWithExtraPartition);
+                        continue;
+                }
+
                 for (i = 0; i < rd_list_cnt(&eligible_topic->members); i++) {
                         rd_kafka_group_member_t *rkgm =
                             rd_list_elem(&eligible_topic->members, i);
@@ -126,6 +237,168 @@ rd_kafka_range_assignor_assign_cb(rd_kafka_t *rk,
 
 
 
+/**
+ * @brief Initialize group member struct for testing, with the given
+ *        \p rack (may be NULL) and a subscription to \p topic.
+ *
+ * Use rd_kafka_group_member_clear() to free fields.
+ */
+static void ut_init_member(rd_kafka_group_member_t *rkgm,
+                           const char *member_id,
+                           const char *rack,
+                           const char *topic) {
+        memset(rkgm, 0, sizeof(*rkgm));
+
+        rkgm->rkgm_member_id         = rd_kafkap_str_new(member_id, -1);
+        rkgm->rkgm_group_instance_id = rd_kafkap_str_new(member_id, -1);
+        if (rack)
+                rkgm->rkgm_rack_id = rd_kafkap_str_new(rack, -1);
+        rd_list_init(&rkgm->rkgm_eligible, 0, NULL);
+
+        rkgm->rkgm_subscription = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(rkgm->rkgm_subscription, topic,
+                                          RD_KAFKA_PARTITION_UA);
+
+        rkgm->rkgm_assignment = rd_kafka_topic_partition_list_new(1);
+}
+
+
+/**
+ * @brief Verify that \p rkgm is assigned exactly the partitions of
+ *        "topic1" in the -1-terminated var-arg list.
+ */
+static int ut_verify_assignment(rd_kafka_group_member_t *rkgm, ...) {
+        va_list ap;
+        int partition;
+        int cnt = 0;
+
+        rd_kafka_topic_partition_list_sort(rkgm->rkgm_assignment, NULL, NULL);
+
+        va_start(ap, rkgm);
+        while ((partition = va_arg(ap, int)) != -1) {
+                RD_UT_ASSERT(cnt < rkgm->rkgm_assignment->cnt &&
+                                 rkgm->rkgm_assignment->elems[cnt].partition ==
+                                     partition,
+                             "Member %s: expected partition %d at "
+                             "assignment index %d",
+                             rkgm->rkgm_member_id->str, partition, cnt);
+                cnt++;
+        }
+        va_end(ap);
+
+        RD_UT_ASSERT(cnt == rkgm->rkgm_assignment->cnt,
+                     "Member %s: expected %d assigned partition(s), not %d",
+                     rkgm->rkgm_member_id->str, cnt,
+                     rkgm->rkgm_assignment->cnt);
+
+        return 0;
+}
+
+
+/**
+ * @brief Rack-aware range assignment (KIP-881).
+ *
+ * Brokers 0, 1 and 2 are in racks a, b and c, and partition p of topic1
+ * has its replicas on brokers p, p+1, .. (modulo 3).
+ */
+static int ut_testRackAwareAssignment(rd_kafka_t *rk,
+                                      const rd_kafka_assignor_t *rkas) {
+        static const char *broker_racks[] = {"a", "b", "c"};
+        static const struct {
+                int partition_cnt;
+                int replication_factor;
+                const char *member_racks[3];
+                int expected[3][4]; /* -1-terminated */
+        } tests[] = {
+            /* Each member is assigned the partitions in its rack. */
+            {6, 1, {"a", "b", "c"}, {{0, 3, -1}, {1, 4, -1}, {2, 5, -1}}},
+            /* Uneven partition count. */
+            {7, 1, {"a", "b", "c"}, {{0, 3, 6, -1}, {1, 4, -1}, {2, 5, -1}}},
+            /* Members with racks matching no replica, or no rack at all,
+             * are assigned the remaining partitions. */
+            {6, 1, {"a", "d", NULL}, {{0, 3, -1}, {1, 2, -1}, {4, 5, -1}}},
+            /* Partitions replicated to all racks: range assignment. */
+            {6, 3, {"a", "b", "c"}, {{0, 1, -1}, {2, 3, -1}, {4, 5, -1}}},
+            /* No member racks: range assignment. */
+            {6, 1, {NULL, NULL, NULL}, {{0, 1, -1}, {2, 3, -1}, {4, 5, -1}}},
+        };
+        size_t i;
+
+        for (i = 0; i < RD_ARRAYSIZE(tests); i++) {
+                rd_kafka_metadata_topic_t mt = {.topic = "topic1"};
+                rd_kafka_metadata_t *metadata;
+                rd_kafka_group_member_t members[3];
+                rd_kafka_resp_err_t err;
+                char errstr[512];
+                int m;
+
+                RD_UT_SAY("Rack-aware range test case #%d", (int)i);
+
+                mt.partition_cnt = tests[i].partition_cnt;
+                metadata =
+                    rd_kafka_metadata_new_topic_with_partition_replicas_mock(
+                        &mt, 1, tests[i].replication_factor,
+                        RD_ARRAYSIZE(broker_racks));
+
+                ut_init_member(&members[0], "consumer1",
+                               tests[i].member_racks[0], "topic1");
+                ut_init_member(&members[1], "consumer2",
+                               tests[i].member_racks[1], "topic1");
+                ut_init_member(&members[2], "consumer3",
+                               tests[i].member_racks[2], "topic1");
+
+                err = rd_kafka_assignor_run_with_racks(
+                    rk->rk_cgrp, rkas, metadata, broker_racks, members,
+                    RD_ARRAYSIZE(members), errstr, sizeof(errstr));
+                RD_UT_ASSERT(!err, "assignor run failed: %s", errstr);
+
+                for (m = 0; m < (int)RD_ARRAYSIZE(members); m++) {
+                        const int *exp = tests[i].expected[m];
+                        if (ut_verify_assignment(&members[m], exp[0], exp[1],
+                                                 exp[2], exp[3], -1))
+                                return 1;
+                        rd_kafka_group_member_clear(&members[m]);
+                }
+
+                rd_kafka_metadata_destroy(metadata);
+        }
+
+        RD_UT_PASS();
+}
+
+
+static int rd_kafka_range_assignor_unittest(void) {
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *rk;
+        int fails = 0;
+        char errstr[256];
+        rd_kafka_assignor_t *rkas;
+
+        conf = rd_kafka_conf_new();
+        if (rd_kafka_conf_set(conf, "group.id", "test", errstr,
+                              sizeof(errstr)) ||
+            rd_kafka_conf_set(conf, "partition.assignment.strategy", "range",
+                              errstr, sizeof(errstr)))
+                RD_UT_FAIL("range assignor conf failed: %s", errstr);
+
+        rd_kafka_conf_set(conf, "debug", rd_getenv("TEST_DEBUG", NULL), NULL,
+                          0);
+
+        rk = rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr, sizeof(errstr));
+        RD_UT_ASSERT(rk, "range assignor client instantiation failed: %s",
+                     errstr);
+
+        rkas = rd_kafka_assignor_find(rk, "range");
+        RD_UT_ASSERT(rkas, "range assignor not found");
+
+        fails += ut_testRackAwareAssignment(rk, rkas);
+
+        rd_kafka_destroy(rk);
+
+        return fails;
+}
+
+
 /**
  * @brief Initialzie and add range assignor.
  */
@@ -134,5 +407,5 @@ rd_kafka_resp_err_t rd_kafka_range_assignor_init(rd_kafka_t *rk) {
             rk, "consumer", "range", RD_KAFKA_REBALANCE_PROTOCOL_EAGER,
             rd_kafka_range_assignor_assign_cb,
             rd_kafka_assignor_get_metadata_with_empty_userdata, NULL, NULL,
-            NULL, NULL);
+            rd_kafka_range_assignor_unittest, NULL);
 }
@@ -980,6 +980,8 @@ rd_kafka_handle_OffsetFetch(rd_kafka_t *rk,
                                 rktp->rktp_committed_pos =
                                     rd_kafka_topic_partition_get_fetch_pos(
                                         rktpar);
+                                rd_kafka_toppar_committed_cache_set(
+                                    rktp, rktp->rktp_committed_pos);
                                 rd_kafka_toppar_unlock(rktp);
                         }
 
@@ -1295,6 +1297,12 @@ rd_kafka_handle_OffsetCommit_error(rd_kafka_broker_t *rkb,
 
             RD_KAFKA_ERR_ACTION_PERMANENT, RD_KAFKA_RESP_ERR_ILLEGAL_GENERATION,
 
+            /* KIP-848: the member epoch used as generation is outdated */
+            RD_KAFKA_ERR_ACTION_PERMANENT, RD_KAFKA_RESP_ERR_STALE_MEMBER_EPOCH,
+
+            RD_KAFKA_ERR_ACTION_PERMANENT,
+            RD_KAFKA_RESP_ERR_FENCED_MEMBER_EPOCH,
+
             RD_KAFKA_ERR_ACTION_END);
 }
 
@@ -1330,7 +1338,7 @@ rd_kafka_handle_OffsetCommit(rd_kafka_t *rk,
         if (rd_kafka_buf_ApiVersion(rkbuf) >= 3)
                 rd_kafka_buf_read_throttle_time(rkbuf);
 
-        rd_kafka_buf_read_i32(rkbuf, &TopicArrayCnt);
+        rd_kafka_buf_read_arraycnt(rkbuf, &TopicArrayCnt, RD_KAFKAP_TOPICS_MAX);
         for (i = 0; i < TopicArrayCnt; i++) {
                 rd_kafkap_str_t topic;
                 char *topic_str;
@@ -1338,7 +1346,8 @@ rd_kafka_handle_OffsetCommit(rd_kafka_t *rk,
                 int j;
 
                 rd_kafka_buf_read_str(rkbuf, &topic);
-                rd_kafka_buf_read_i32(rkbuf, &PartArrayCnt);
+                rd_kafka_buf_read_arraycnt(rkbuf, &PartArrayCnt,
+                                           RD_KAFKAP_PARTITIONS_MAX);
 
                 RD_KAFKAP_STR_DUPA(&topic_str, &topic);
 
@@ -1349,6 +1358,7 @@ rd_kafka_handle_OffsetCommit(rd_kafka_t *rk,
 
                         rd_kafka_buf_read_i32(rkbuf, &partition);
                         rd_kafka_buf_read_i16(rkbuf, &ErrorCode);
+                        rd_kafka_buf_skip_tags(rkbuf);
 
                         rktpar = rd_kafka_topic_partition_list_find(
                             offsets, topic_str, partition);
@@ -1372,6 +1382,8 @@ rd_kafka_handle_OffsetCommit(rd_kafka_t *rk,
 
                         partcnt++;
                 }
+
+                rd_kafka_buf_skip_tags(rkbuf);
         }
 
         /* If all partitions failed use error code
@@ -1451,19 +1463,21 @@ int rd_kafka_OffsetCommitRequest(rd_kafka_broker_t *rkb,
         int features;
 
         ApiVersion = rd_kafka_broker_ApiVersion_supported(
-            rkb, RD_KAFKAP_OffsetCommit, 0, 7, &features);
+            rkb, RD_KAFKAP_OffsetCommit, 0, 9, &features);
 
         rd_kafka_assert(NULL, offsets != NULL);
 
-        rkbuf = rd_kafka_buf_new_request(rkb, RD_KAFKAP_OffsetCommit, 1,
-                                         100 + (offsets->cnt * 128));
+        rkbuf = rd_kafka_buf_new_flexver_request(rkb, RD_KAFKAP_OffsetCommit, 1,
+                                                 100 + (offsets->cnt * 128),
+                                                 ApiVersion >= 8);
 
         /* ConsumerGroup */
         rd_kafka_buf_write_str(rkbuf, cgmetadata->group_id, -1);
 
         /* v1,v2 */
         if (ApiVersion >= 1) {
-                /* ConsumerGroupGenerationId */
+                /* ConsumerGroupGenerationId, or v9: GenerationIdOrMemberEpoch
+                 * which is the member epoch for consumer protocol groups. */
                 rd_kafka_buf_write_i32(rkbuf, cgmetadata->generation_id);
                 /* ConsumerId */
                 rd_kafka_buf_write_str(rkbuf, cgmetadata->member_id, -1);
@@ -1482,7 +1496,7 @@ int rd_kafka_OffsetCommitRequest(rd_kafka_broker_t *rkb,
         rd_kafka_topic_partition_list_sort_by_topic(offsets);
 
         /* TopicArrayCnt: Will be updated when we know the number of topics. */
-        of_TopicCnt = rd_kafka_buf_write_i32(rkbuf, 0);
+        of_TopicCnt = rd_kafka_buf_write_arraycnt_pos(rkbuf);
 
         for (i = 0; i < offsets->cnt; i++) {
                 rd_kafka_topic_partition_t *rktpar = &offsets->elems[i];
@@ -1495,14 +1509,17 @@ int rd_kafka_OffsetCommitRequest(rd_kafka_broker_t *rkb,
                         /* New topic */
 
                         /* Finalize previous PartitionCnt */
-                        if (PartCnt > 0)
-                                rd_kafka_buf_update_u32(rkbuf, of_PartCnt,
-                                                        PartCnt);
+                        if (PartCnt > 0) {
+                                rd_kafka_buf_finalize_arraycnt(
+                                    rkbuf, of_PartCnt, PartCnt);
+                                /* Topic tags */
+                                rd_kafka_buf_write_tags(rkbuf);
+                        }
 
                         /* TopicName */
                         rd_kafka_buf_write_str(rkbuf, rktpar->topic, -1);
                         /* PartitionCnt, finalized later */
-                        of_PartCnt = rd_kafka_buf_write_i32(rkbuf, 0);
+                        of_PartCnt = rd_kafka_buf_write_arraycnt_pos(rkbuf);
                         PartCnt    = 0;
                         last_topic = rktpar->topic;
                         TopicCnt++;
@@ -1535,6 +1552,9 @@ int rd_kafka_OffsetCommitRequest(rd_kafka_broker_t *rkb,
                 else
                         rd_kafka_buf_write_str(rkbuf, rktpar->metadata,
                                                rktpar->metadata_size);
+
+                /* Partition tags */
+                rd_kafka_buf_write_tags(rkbuf);
         }
 
         if (tot_PartCnt == 0) {
@@ -1545,11 +1565,14 @@ int rd_kafka_OffsetCommitRequest(rd_kafka_broker_t *rkb,
         }
 
         /* Finalize previous PartitionCnt */
-        if (PartCnt > 0)
-                rd_kafka_buf_update_u32(rkbuf, of_PartCnt, PartCnt);
+        if (PartCnt > 0) {
+                rd_kafka_buf_finalize_arraycnt(rkbuf, of_PartCnt, PartCnt);
+                /* Topic tags */
+                rd_kafka_buf_write_tags(rkbuf);
+        }
 
         /* Finalize TopicCnt */
-        rd_kafka_buf_update_u32(rkbuf, of_TopicCnt, TopicCnt);
+        rd_kafka_buf_finalize_arraycnt(rkbuf, of_TopicCnt, TopicCnt);
 
         rd_kafka_buf_ApiVersion_set(rkbuf, ApiVersion, 0);
 
@@ -1765,7 +1788,8 @@ void rd_kafka_JoinGroupRequest(rd_kafka_broker_t *rkb,
                 rd_kafka_buf_write_kstr(rkbuf, rkas->rkas_protocol_name);
                 member_metadata = rkas->rkas_get_metadata_cb(
                     rkas, rk->rk_cgrp->rkcg_assignor_state, topics,
-                    rk->rk_cgrp->rkcg_group_assignment);
+                    rk->rk_cgrp->rkcg_group_assignment,
+                    rk->rk_conf.client_rack);
                 rd_kafka_buf_write_kbytes(rkbuf, member_metadata);
                 rd_kafkap_bytes_destroy(member_metadata);
         }
@@ -1950,6 +1974,154 @@ void rd_kafka_HeartbeatRequest(rd_kafka_broker_t *rkb,
 
 
 
+/**
+ * @brief Allocate a new topic id and partitions element with room
+ *        for \p partition_cnt partitions.
+ */
+rd_kafka_topic_id_partitions_t *
+rd_kafka_topic_id_partitions_new(rd_kafka_Uuid_t topic_id,
+                                 const char *topic,
+                                 int partition_cnt) {
+        rd_kafka_topic_id_partitions_t *tidp = rd_calloc(1, sizeof(*tidp));
+
+        tidp->topic_id = topic_id;
+        tidp->topic    = topic ? rd_strdup(topic) : NULL;
+        if (partition_cnt > 0)
+                tidp->partitions =
+                    rd_malloc(sizeof(*tidp->partitions) * partition_cnt);
+        tidp->partition_cnt = partition_cnt;
+
+        return tidp;
+}
+
+void rd_kafka_topic_id_partitions_destroy(void *ptr) {
+        rd_kafka_topic_id_partitions_t *tidp = ptr;
+
+        if (tidp->topic)
+                rd_free(tidp->topic);
+        if (tidp->partitions)
+                rd_free(tidp->partitions);
+        rd_free(tidp);
+}
+
+
+/**
+ * @brief Send ConsumerGroupHeartbeatRequest (KIP-848).
+ *
+ * The full member state is sent on every heartbeat, which is permitted
+ * by the protocol and keeps the client stateless with regards to what
+ * the coordinator has seen.
+ *
+ * @param member_epoch 0 to join, -1 to leave, else the current epoch.
+ * @param subscribed_topics (rd_kafka_topic_info_t *) or NULL when leaving.
+ * @param remote_assignor Server side assignor name, or NULL for the
+ *                        coordinator's default.
+ * @param owned (rd_kafka_topic_id_partitions_t *) currently owned partitions,
+ *              or NULL when leaving.
+ *
+ * @returns RD_KAFKA_RESP_ERR__UNSUPPORTED_FEATURE if the broker does
+ *          not support the consumer group protocol, else NO_ERROR.
+ */
+rd_kafka_resp_err_t
+rd_kafka_ConsumerGroupHeartbeatRequest(rd_kafka_broker_t *rkb,
+                                       const rd_kafkap_str_t *group_id,
+                                       const rd_kafkap_str_t *member_id,
+                                       int32_t member_epoch,
+                                       const rd_kafkap_str_t *group_instance_id,
+                                       const rd_kafkap_str_t *rack_id,
+                                       int32_t rebalance_timeout_ms,
+                                       const rd_list_t *subscribed_topics,
+                                       const char *remote_assignor,
+                                       const rd_list_t *owned,
+                                       rd_kafka_replyq_t replyq,
+                                       rd_kafka_resp_cb_t *resp_cb,
+                                       void *opaque) {
+        rd_kafka_buf_t *rkbuf;
+        int16_t ApiVersion = 0;
+        int features;
+        const rd_kafka_topic_info_t *tinfo;
+        const rd_kafka_topic_id_partitions_t *tidp;
+        int i, j;
+
+        ApiVersion = rd_kafka_broker_ApiVersion_supported(
+            rkb, RD_KAFKAP_ConsumerGroupHeartbeat, 0, 0, &features);
+        if (ApiVersion == -1) {
+                rd_kafka_replyq_destroy(&replyq);
+                return RD_KAFKA_RESP_ERR__UNSUPPORTED_FEATURE;
+        }
+
+        rd_rkb_dbg(rkb, CGRP, "HEARTBEAT",
+                   "ConsumerGroupHeartbeat for group \"%s\" "
+                   "member epoch %" PRId32 " with %d owned topic(s)",
+                   group_id->str, member_epoch, owned ? rd_list_cnt(owned) : 0);
+
+        rkbuf = rd_kafka_buf_new_flexver_request(
+            rkb, RD_KAFKAP_ConsumerGroupHeartbeat, 1,
+            RD_KAFKAP_STR_SIZE(group_id) + RD_KAFKAP_STR_SIZE(member_id) +
+                4 /* MemberEpoch */ + RD_KAFKAP_STR_SIZE(group_instance_id) +
+                4 /* RebalanceTimeoutMs */ +
+                (subscribed_topics ? rd_list_cnt(subscribed_topics) * 50 : 1) +
+                (owned ? rd_list_cnt(owned) * 64 : 1) + 64,
+            rd_true);
+
+        /* GroupId */
+        rd_kafka_buf_write_kstr(rkbuf, group_id);
+        /* MemberId */
+        rd_kafka_buf_write_kstr(rkbuf, member_id);
+        /* MemberEpoch */
+        rd_kafka_buf_write_i32(rkbuf, member_epoch);
+        /* InstanceId */
+        rd_kafka_buf_write_kstr(rkbuf, group_instance_id);
+        /* RackId */
+        rd_kafka_buf_write_kstr(rkbuf, rack_id);
+        /* RebalanceTimeoutMs */
+        rd_kafka_buf_write_i32(rkbuf, rebalance_timeout_ms);
+
+        /* SubscribedTopicNames */
+        if (subscribed_topics) {
+                rd_kafka_buf_write_arraycnt(rkbuf,
+                                            rd_list_cnt(subscribed_topics));
+                RD_LIST_FOREACH(tinfo, subscribed_topics, i)
+                rd_kafka_buf_write_str(rkbuf, tinfo->topic, -1);
+        } else {
+                /* Null array: unchanged */
+                rd_kafka_buf_write_uvarint(rkbuf, 0);
+        }
+
+        /* ServerAssignor */
+        rd_kafka_buf_write_str(rkbuf, remote_assignor, -1);
+
+        /* TopicPartitions */
+        if (owned) {
+                rd_kafka_buf_write_arraycnt(rkbuf, rd_list_cnt(owned));
+                RD_LIST_FOREACH(tidp, owned, i) {
+                        /* TopicId */
+                        rd_kafka_buf_write_uuid(rkbuf, tidp->topic_id);
+                        /* Partitions */
+                        rd_kafka_buf_write_arraycnt(rkbuf,
+                                                    tidp->partition_cnt);
+                        for (j = 0; j < tidp->partition_cnt; j++)
+                                rd_kafka_buf_write_i32(rkbuf,
+                                                       tidp->partitions[j]);
+                        rd_kafka_buf_write_tags(rkbuf);
+                }
+        } else {
+                /* Null array: unchanged */
+                rd_kafka_buf_write_uvarint(rkbuf, 0);
+        }
+
+        rd_kafka_buf_ApiVersion_set(rkbuf, ApiVersion, 0);
+
+        rd_kafka_buf_set_abs_timeout(
+            rkbuf, rkb->rkb_rk->rk_conf.group_session_timeout_ms, 0);
+
+        rd_kafka_broker_buf_enq_replyq(rkb, rkbuf, replyq, resp_cb, opaque);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
+
 /**
  * @brief Construct and send ListGroupsRequest to \p rkb
  *        with the states (const char *) in \p states.
@@ -2209,10 +2381,10 @@ rd_kafka_resp_err_t rd_kafka_MetadataRequest(rd_kafka_broker_t *rkb,
         int *full_incr = NULL;
 
         ApiVersion = rd_kafka_broker_ApiVersion_supported(
-            rkb, RD_KAFKAP_Metadata, 0, 9, &features);
+            rkb, RD_KAFKAP_Metadata, 0, 10, &features);
 
         rkbuf = rd_kafka_buf_new_flexver_request(rkb, RD_KAFKAP_Metadata, 1,
-                                                 4 + (50 * topic_cnt) + 1,
+                                                 4 + (66 * topic_cnt) + 1,
                                                  ApiVersion >= 9);
 
         if (!reason)
@@ -2304,6 +2476,11 @@ rd_kafka_resp_err_t rd_kafka_MetadataRequest(rd_kafka_broker_t *rkb,
                     rd_list_copy(topics, rd_list_string_copy, NULL);
 
                 RD_LIST_FOREACH(topic, topics, i) {
+                        if (ApiVersion >= 10) {
+                                /* TopicId: topics are requested by name */
+                                rd_kafka_Uuid_t zero_uuid = RD_KAFKA_UUID_ZERO;
+                                rd_kafka_buf_write_uuid(rkbuf, zero_uuid);
+                        }
                         rd_kafka_buf_write_str(rkbuf, topic, -1);
                         /* Tags for previous topic */
                         rd_kafka_buf_write_tags(rkbuf);
@@ -2329,7 +2506,7 @@ rd_kafka_resp_err_t rd_kafka_MetadataRequest(rd_kafka_broker_t *rkb,
                            "on broker auto.create.topics.enable configuration");
         }
 
-        if (ApiVersion >= 8 && ApiVersion < 10) {
+        if (ApiVersion >= 8 && ApiVersion <= 10) {
                 /* TODO: implement KIP-430 */
                 /* IncludeClusterAuthorizedOperations */
                 rd_kafka_buf_write_bool(rkbuf, rd_false);
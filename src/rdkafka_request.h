@@ -244,6 +244,38 @@ rd_kafka_error_t *rd_kafka_DescribeGroupsRequest(rd_kafka_broker_t *rkb,
                                                  void *opaque);
 
 
+/**
+ * @brief Topic id and partitions, as used in the ConsumerGroupHeartbeat
+ *        owned partitions and target assignment (KIP-848).
+ */
+typedef struct rd_kafka_topic_id_partitions_s {
+        rd_kafka_Uuid_t topic_id;
+        char *topic;         /**< Topic name, or NULL if not (yet) known. */
+        int32_t *partitions; /**< Partition ids, sorted */
+        int partition_cnt;
+} rd_kafka_topic_id_partitions_t;
+
+rd_kafka_topic_id_partitions_t *
+rd_kafka_topic_id_partitions_new(rd_kafka_Uuid_t topic_id,
+                                 const char *topic,
+                                 int partition_cnt);
+void rd_kafka_topic_id_partitions_destroy(void *ptr);
+
+rd_kafka_resp_err_t
+rd_kafka_ConsumerGroupHeartbeatRequest(rd_kafka_broker_t *rkb,
+                                       const rd_kafkap_str_t *group_id,
+                                       const rd_kafkap_str_t *member_id,
+                                       int32_t member_epoch,
+                                       const rd_kafkap_str_t *group_instance_id,
+                                       const rd_kafkap_str_t *rack_id,
+                                       int32_t rebalance_timeout_ms,
+                                       const rd_list_t *subscribed_topics,
+                                       const char *remote_assignor,
+                                       const rd_list_t *owned,
+                                       rd_kafka_replyq_t replyq,
+                                       rd_kafka_resp_cb_t *resp_cb,
+                                       void *opaque);
+
 void rd_kafka_HeartbeatRequest(rd_kafka_broker_t *rkb,
                                const rd_kafkap_str_t *group_id,
                                int32_t generation_id,
@@ -173,6 +173,23 @@ typedef RD_MAP_TYPE(const ConsumerPair_t *,
 typedef RD_MAP_TYPE(const char *,
                     map_cpair_toppar_list_t *) map_str_map_cpair_toppar_list_t;
 
+typedef RD_MAP_TYPE(const char *,
+                    const rd_kafka_assignor_topic_t *) map_str_atopic_t;
+
+typedef RD_MAP_TYPE(const char *, const char *) map_str_str_t;
+
+
+/**
+ * @struct Rack information for rack-aware assignment (KIP-881).
+ */
+typedef struct RackInfo_s {
+        /** Topics for which rack-aware assignment is used:
+         *  topic name -> eligible topic (with partition replica racks). */
+        map_str_atopic_t topics;
+        /** Consumer (member id) -> rack, for consumers with a rack. */
+        map_str_str_t consumerRacks;
+} RackInfo_t;
+
 
 
 /** Glue type helpers */
@@ -375,22 +392,321 @@ static rd_bool_t PartitionMovements_isSticky(rd_kafka_t *rk,
 
 
 /**
- * @brief Comparator to sort ascendingly by rd_map_elem_t object value as
- *        topic partition list count, or by member id if the list count is
- *        identical.
- *        Used to sort sortedCurrentSubscriptions list.
+ * @struct A consumer in a SortedConsumers_t set.
+ */
+typedef struct SortedConsumer_s {
+        /** The consumer's map element: the key is the consumer member id
+         *  and the value is its assigned partition list. */
+        const rd_map_elem_t *elem;
+        int rank; /**< Member id rank among all the set's consumers */
+        int cnt;  /**< Assigned partition count bucket the consumer is
+                   *   filed in, or -1 if the consumer is not in the set. */
+} SortedConsumer_t;
+
+typedef RD_MAP_TYPE(const char *, SortedConsumer_t *) map_str_sconsumer_t;
+
+/**
+ * @struct A set of consumers ordered ascendingly by their number of assigned
+ *         partitions, and by member id for the same number of partitions.
  *
- * elem.key is the consumer member id string,
- * elem.value is the partition list.
+ * Each consumer is filed in the bucket of its assigned partition count.
+ * A bucket is a bitset indexed by member id rank, so moving a consumer to
+ * another bucket after its partition count changed is O(1), and the least
+ * and most loaded consumers are those of the lowest and highest non-empty
+ * buckets.
  */
-static int sort_by_map_elem_val_toppar_list_cnt(const void *_a,
-                                                const void *_b) {
-        const rd_map_elem_t *a = _a, *b = _b;
-        const rd_kafka_topic_partition_list_t *al = a->value, *bl = b->value;
-        int r = al->cnt - bl->cnt;
-        if (r)
-                return r;
-        return strcmp((const char *)a->key, (const char *)b->key);
+typedef struct SortedConsumers_s {
+        SortedConsumer_t *consumers; /**< All consumers, by member id rank */
+        map_str_sconsumer_t consumerMap; /**< Member id -> consumer */
+        int size;                        /**< Number of consumers */
+        int words;                       /**< Bitset words per bucket */
+        uint64_t **buckets;   /**< Bucket bitsets by partition count,
+                               *   NULL for unused buckets. */
+        int *bucketCnts;      /**< Number of consumers per bucket */
+        int bucketSize;       /**< Allocated number of buckets */
+        uint64_t **freeBits;  /**< Zeroed bitsets of emptied buckets */
+        int freeCnt;          /**< Number of freeBits */
+        int cnt;              /**< Number of consumers in the set */
+        int min;              /**< Lowest non-empty bucket */
+        int max;              /**< Highest non-empty bucket */
+} SortedConsumers_t;
+
+/**
+ * @struct SortedConsumers_t iterator, see SortedConsumers_FOREACH().
+ */
+typedef struct SortedConsumers_iter_s {
+        int cnt;  /**< Current bucket */
+        int rank; /**< Current member id rank */
+} SortedConsumers_iter_t;
+
+
+static RD_INLINE int
+SortedConsumer_elem_cnt(const rd_map_elem_t *elem) {
+        return ((const rd_kafka_topic_partition_list_t *)elem->value)->cnt;
+}
+
+static int SortedConsumer_cmp_member_id(const void *_a, const void *_b) {
+        const SortedConsumer_t *a = _a, *b = _b;
+        return strcmp((const char *)a->elem->key, (const char *)b->elem->key);
+}
+
+
+/**
+ * @brief File \p sconsumer in the bucket of its current partition count.
+ */
+static void SortedConsumers_file(SortedConsumers_t *sc,
+                                 SortedConsumer_t *sconsumer) {
+        int cnt = SortedConsumer_elem_cnt(sconsumer->elem);
+
+        if (cnt >= sc->bucketSize) {
+                int newSize = RD_MAX(cnt + 1, sc->bucketSize * 2);
+
+                sc->buckets =
+                    rd_realloc(sc->buckets, sizeof(*sc->buckets) * newSize);
+                sc->bucketCnts = rd_realloc(
+                    sc->bucketCnts, sizeof(*sc->bucketCnts) * newSize);
+                memset(&sc->buckets[sc->bucketSize], 0,
+                       sizeof(*sc->buckets) * (newSize - sc->bucketSize));
+                memset(&sc->bucketCnts[sc->bucketSize], 0,
+                       sizeof(*sc->bucketCnts) * (newSize - sc->bucketSize));
+                sc->bucketSize = newSize;
+        }
+
+        if (!sc->buckets[cnt]) {
+                if (sc->freeCnt > 0)
+                        sc->buckets[cnt] = sc->freeBits[--sc->freeCnt];
+                else
+                        sc->buckets[cnt] = rd_calloc(
+                            sc->words, sizeof(*sc->buckets[cnt]));
+        }
+
+        sc->buckets[cnt][sconsumer->rank / 64] |=
+            (uint64_t)1 << (sconsumer->rank % 64);
+        sc->bucketCnts[cnt]++;
+        sconsumer->cnt = cnt;
+
+        if (sc->cnt++ == 0) {
+                sc->min = cnt;
+                sc->max = cnt;
+        } else if (cnt < sc->min)
+                sc->min = cnt;
+        else if (cnt > sc->max)
+                sc->max = cnt;
+}
+
+
+/**
+ * @brief Remove the consumer with member id rank \p rank from bucket \p cnt.
+ */
+static void
+SortedConsumers_unfile(SortedConsumers_t *sc, int rank, int cnt) {
+        sc->buckets[cnt][rank / 64] &= ~((uint64_t)1 << (rank % 64));
+        sc->cnt--;
+
+        if (--sc->bucketCnts[cnt] > 0)
+                return;
+
+        /* The bucket's bitset is all zeroes again: keep it for reuse */
+        sc->freeBits[sc->freeCnt++] = sc->buckets[cnt];
+        sc->buckets[cnt]            = NULL;
+
+        if (sc->cnt == 0)
+                return;
+
+        if (cnt == sc->min)
+                while (!sc->bucketCnts[sc->min])
+                        sc->min++;
+        else if (cnt == sc->max)
+                while (!sc->bucketCnts[sc->max])
+                        sc->max--;
+}
+
+
+/**
+ * @brief Initialize \p sc with all the consumers of \p rmap, whose keys
+ *        are consumer member ids and values their assigned partition
+ *        lists.
+ */
+static void SortedConsumers_init(SortedConsumers_t *sc, const rd_map_t *rmap) {
+        const rd_map_elem_t *elem;
+        int i = 0;
+
+        memset(sc, 0, sizeof(*sc));
+        sc->size      = (int)rd_map_cnt(rmap);
+        sc->words     = RD_MAX((sc->size + 63) / 64, 1);
+        sc->consumers = rd_calloc(RD_MAX(sc->size, 1), sizeof(*sc->consumers));
+        /* A consumer is transiently filed in two buckets when moved,
+         * so there are at most size + 1 bitsets. */
+        sc->freeBits = rd_malloc(sizeof(*sc->freeBits) * (sc->size + 1));
+        RD_MAP_INIT(&sc->consumerMap, sc->size, rd_map_str_cmp,
+                    rd_map_str_hash, NULL, NULL);
+
+        RD_MAP_FOREACH_ELEM(elem, rmap)
+        sc->consumers[i++].elem = elem;
+
+        qsort(sc->consumers, (size_t)sc->size, sizeof(*sc->consumers),
+              SortedConsumer_cmp_member_id);
+
+        for (i = 0; i < sc->size; i++) {
+                SortedConsumer_t *sconsumer = &sc->consumers[i];
+
+                sconsumer->rank = i;
+                RD_MAP_SET(&sc->consumerMap, sconsumer->elem->key, sconsumer);
+                SortedConsumers_file(sc, sconsumer);
+        }
+}
+
+
+static void SortedConsumers_destroy(SortedConsumers_t *sc) {
+        int i;
+
+        for (i = 0; i < sc->bucketSize; i++)
+                if (sc->buckets[i])
+                        rd_free(sc->buckets[i]);
+        for (i = 0; i < sc->freeCnt; i++)
+                rd_free(sc->freeBits[i]);
+
+        RD_IF_FREE(sc->buckets, rd_free);
+        RD_IF_FREE(sc->bucketCnts, rd_free);
+        rd_free(sc->freeBits);
+        rd_free(sc->consumers);
+        RD_MAP_DESTROY(&sc->consumerMap);
+}
+
+
+/**
+ * @brief Move \p consumer to its new position in \p sc after its
+ *        assigned partition count changed.
+ */
+static void SortedConsumers_update(SortedConsumers_t *sc,
+                                   const char *consumer) {
+        SortedConsumer_t *sconsumer = RD_MAP_GET(&sc->consumerMap, consumer);
+        int prevCnt;
+
+        rd_assert(sconsumer && sconsumer->cnt != -1);
+
+        prevCnt = sconsumer->cnt;
+        if (SortedConsumer_elem_cnt(sconsumer->elem) == prevCnt)
+                return;
+
+        /* File the consumer in its new bucket before removing it from the
+         * old one so that min or max is found right away when the old
+         * bucket is emptied. */
+        SortedConsumers_file(sc, sconsumer);
+        SortedConsumers_unfile(sc, sconsumer->rank, prevCnt);
+}
+
+
+/**
+ * @brief Remove \p consumer from \p sc.
+ */
+static void SortedConsumers_remove(SortedConsumers_t *sc,
+                                   const char *consumer) {
+        SortedConsumer_t *sconsumer = RD_MAP_GET(&sc->consumerMap, consumer);
+
+        rd_assert(sconsumer && sconsumer->cnt != -1);
+
+        SortedConsumers_unfile(sc, sconsumer->rank, sconsumer->cnt);
+        sconsumer->cnt = -1;
+}
+
+
+/**
+ * @returns the next consumer of \p sc after the iterator \p it position,
+ *          moving \p it to it, or NULL if there are no more consumers.
+ *
+ * The consumer at the current position may be removed from the set
+ * while iterating, but no other changes are allowed.
+ */
+static const rd_map_elem_t *SortedConsumers_next(const SortedConsumers_t *sc,
+                                                 SortedConsumers_iter_t *it) {
+        int cnt  = RD_MAX(it->cnt, sc->min);
+        int rank = cnt == it->cnt ? it->rank + 1 : 0;
+
+        if (sc->cnt == 0)
+                return NULL;
+
+        for (; cnt <= sc->max; cnt++, rank = 0) {
+                const uint64_t *bits = sc->buckets[cnt];
+                int w;
+                uint64_t word;
+
+                if (!bits || rank >= sc->size)
+                        continue;
+
+                w    = rank / 64;
+                word = bits[w] & (~(uint64_t)0 << (rank % 64));
+
+                while (!word && ++w < sc->words)
+                        word = bits[w];
+
+                if (!word)
+                        continue;
+
+                for (rank = w * 64; !(word & 0xff); word >>= 8)
+                        rank += 8;
+                for (; !(word & 1); word >>= 1)
+                        rank++;
+
+                it->cnt  = cnt;
+                it->rank = rank;
+                return sc->consumers[rank].elem;
+        }
+
+        return NULL;
+}
+
+/**
+ * @brief Iterate over the consumers of \p SC in ascending order,
+ *        setting \p ELEM to each consumer's map element.
+ */
+#define SortedConsumers_FOREACH(ELEM, SC, IT)                                  \
+        for ((IT).cnt = -1, (IT).rank = -1;                                    \
+             ((ELEM) = SortedConsumers_next(SC, &(IT)));)
+
+/**
+ * @returns the consumer with the least assigned partitions in \p sc,
+ *          which must not be empty.
+ */
+static RD_INLINE const rd_map_elem_t *
+SortedConsumers_first(const SortedConsumers_t *sc) {
+        SortedConsumers_iter_t it = {-1, -1};
+        return SortedConsumers_next(sc, &it);
+}
+
+/**
+ * @returns the consumer with the most assigned partitions in \p sc,
+ *          which must not be empty.
+ */
+static const rd_map_elem_t *SortedConsumers_last(const SortedConsumers_t *sc) {
+        const uint64_t *bits = sc->buckets[sc->max];
+        int w                = sc->words - 1;
+        int rank;
+        uint64_t word;
+
+        while (!bits[w])
+                w--;
+
+        word = bits[w];
+        for (rank = w * 64 + 63; !(word & ((uint64_t)0xff << 56)); word <<= 8)
+                rank -= 8;
+        for (; !(word & ((uint64_t)1 << 63)); word <<= 1)
+                rank--;
+
+        return sc->consumers[rank].elem;
+}
+
+
+/**
+ * @returns true if \p partition is in \p partitions, which must be sorted
+ *          by rd_kafka_topic_partition_cmp().
+ */
+static RD_INLINE rd_bool_t
+sortedPartitionsContain(const rd_kafka_topic_partition_list_t *partitions,
+                        const rd_kafka_topic_partition_t *partition) {
+        return bsearch(partition, partitions->elems, partitions->cnt,
+                       sizeof(*partitions->elems),
+                       rd_kafka_topic_partition_cmp) != NULL;
 }
 
 
@@ -399,40 +715,70 @@ static int sort_by_map_elem_val_toppar_list_cnt(const void *_a,
  *
  * The assignment should improve the overall balance of the partition
  * assignments to consumers.
+ *
+ * If \p rackInfo is set and the partition's topic is rack-aware, a consumer
+ * in one of the partition's replica racks is preferred among the eligible
+ * consumers with the least number of assigned partitions.
  */
 static void
 assignPartition(const rd_kafka_topic_partition_t *partition,
-                rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+                SortedConsumers_t *sortedCurrentSubscriptions,
                 map_str_toppar_list_t *currentAssignment,
                 map_str_toppar_list_t *consumer2AllPotentialPartitions,
-                map_toppar_str_t *currentPartitionConsumer) {
+                map_toppar_str_t *currentPartitionConsumer,
+                RackInfo_t *rackInfo) {
+        const rd_kafka_assignor_topic_t *atopic = NULL;
+        const char *consumer                    = NULL;
+        int consumer_cnt                        = 0;
+        rd_kafka_topic_partition_list_t *partitions;
         const rd_map_elem_t *elem;
-        int i;
+        SortedConsumers_iter_t it;
 
-        RD_LIST_FOREACH(elem, sortedCurrentSubscriptions, i) {
-                const char *consumer = (const char *)elem->key;
-                const rd_kafka_topic_partition_list_t *partitions;
+        if (rackInfo)
+                atopic = RD_MAP_GET(&rackInfo->topics, partition->topic);
 
-                partitions =
-                    RD_MAP_GET(consumer2AllPotentialPartitions, consumer);
-                if (!rd_kafka_topic_partition_list_find(
-                        partitions, partition->topic, partition->partition))
+        SortedConsumers_FOREACH(elem, sortedCurrentSubscriptions, it) {
+                const char *candidate = (const char *)elem->key;
+                int cnt =
+                    ((const rd_kafka_topic_partition_list_t *)elem->value)->cnt;
+
+                /* Only consider the least loaded eligible consumers. */
+                if (consumer && cnt > consumer_cnt)
+                        break;
+
+                if (!sortedPartitionsContain(
+                        RD_MAP_GET(consumer2AllPotentialPartitions, candidate),
+                        partition))
                         continue;
 
-                rd_kafka_topic_partition_list_add(
-                    RD_MAP_GET(currentAssignment, consumer), partition->topic,
-                    partition->partition);
+                if (!consumer) {
+                        consumer     = candidate;
+                        consumer_cnt = cnt;
+                        if (!atopic)
+                                break;
+                }
 
-                RD_MAP_SET(currentPartitionConsumer,
-                           rd_kafka_topic_partition_copy(partition), consumer);
+                if (rd_kafka_assignor_topic_partition_has_rack(
+                        atopic, partition->partition,
+                        RD_MAP_GET(&rackInfo->consumerRacks, candidate))) {
+                        consumer = candidate;
+                        break;
+                }
+        }
 
-                /* Re-sort sortedCurrentSubscriptions since this consumer's
-                 * assignment count has increased.
-                 * This is an O(N) operation since it is a single shuffle. */
-                rd_list_sort(sortedCurrentSubscriptions,
-                             sort_by_map_elem_val_toppar_list_cnt);
+        if (!consumer)
                 return;
-        }
+
+        partitions = RD_MAP_GET(currentAssignment, consumer);
+        rd_kafka_topic_partition_list_add(partitions, partition->topic,
+                                          partition->partition);
+
+        RD_MAP_SET(currentPartitionConsumer,
+                   rd_kafka_topic_partition_copy(partition), consumer);
+
+        /* Reposition the consumer in sortedCurrentSubscriptions
+         * since its assignment count has increased. */
+        SortedConsumers_update(sortedCurrentSubscriptions, consumer);
 }
 
 /**
@@ -506,30 +852,31 @@ static void processPartitionMovement(
     const rd_kafka_topic_partition_t *partition,
     const char *newConsumer,
     map_str_toppar_list_t *currentAssignment,
-    rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+    SortedConsumers_t *sortedCurrentSubscriptions,
     map_toppar_str_t *currentPartitionConsumer) {
 
         const char *oldConsumer =
             RD_MAP_GET(currentPartitionConsumer, partition);
+        rd_kafka_topic_partition_list_t *partitions;
 
         PartitionMovements_movePartition(partitionMovements, partition,
                                          oldConsumer, newConsumer);
 
-        rd_kafka_topic_partition_list_add(
-            RD_MAP_GET(currentAssignment, newConsumer), partition->topic,
-            partition->partition);
+        /* Reposition each consumer in sortedCurrentSubscriptions after
+         * its assignment count has changed. */
+        partitions = RD_MAP_GET(currentAssignment, newConsumer);
+        rd_kafka_topic_partition_list_add(partitions, partition->topic,
+                                          partition->partition);
+        SortedConsumers_update(sortedCurrentSubscriptions, newConsumer);
 
-        rd_kafka_topic_partition_list_del(
-            RD_MAP_GET(currentAssignment, oldConsumer), partition->topic,
-            partition->partition);
+        partitions = RD_MAP_GET(currentAssignment, oldConsumer);
+        rd_kafka_topic_partition_list_del(partitions, partition->topic,
+                                          partition->partition);
+        SortedConsumers_update(sortedCurrentSubscriptions, oldConsumer);
 
         RD_MAP_SET(currentPartitionConsumer,
                    rd_kafka_topic_partition_copy(partition), newConsumer);
 
-        /* Re-sort after assignment count has changed. */
-        rd_list_sort(sortedCurrentSubscriptions,
-                     sort_by_map_elem_val_toppar_list_cnt);
-
         rd_kafka_dbg(rk, ASSIGNOR, "STICKY",
                      "%s [%" PRId32 "] %sassigned to %s (from %s)",
                      partition->topic, partition->partition,
@@ -546,7 +893,7 @@ static void reassignPartitionToConsumer(
     PartitionMovements_t *partitionMovements,
     const rd_kafka_topic_partition_t *partition,
     map_str_toppar_list_t *currentAssignment,
-    rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+    SortedConsumers_t *sortedCurrentSubscriptions,
     map_toppar_str_t *currentPartitionConsumer,
     const char *newConsumer) {
 
@@ -572,21 +919,21 @@ reassignPartition(rd_kafka_t *rk,
                   PartitionMovements_t *partitionMovements,
                   const rd_kafka_topic_partition_t *partition,
                   map_str_toppar_list_t *currentAssignment,
-                  rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+                  SortedConsumers_t *sortedCurrentSubscriptions,
                   map_toppar_str_t *currentPartitionConsumer,
                   map_str_toppar_list_t *consumer2AllPotentialPartitions) {
 
         const rd_map_elem_t *elem;
-        int i;
+        SortedConsumers_iter_t it;
 
         /* Find the new consumer */
-        RD_LIST_FOREACH(elem, sortedCurrentSubscriptions, i) {
+        SortedConsumers_FOREACH(elem, sortedCurrentSubscriptions, it) {
                 const char *newConsumer = (const char *)elem->key;
 
-                if (rd_kafka_topic_partition_list_find(
+                if (sortedPartitionsContain(
                         RD_MAP_GET(consumer2AllPotentialPartitions,
                                    newConsumer),
-                        partition->topic, partition->partition)) {
+                        partition)) {
                         reassignPartitionToConsumer(
                             rk, partitionMovements, partition,
                             currentAssignment, sortedCurrentSubscriptions,
@@ -624,33 +971,17 @@ reassignPartition(rd_kafka_t *rk,
 static rd_bool_t
 isBalanced(rd_kafka_t *rk,
            map_str_toppar_list_t *currentAssignment,
-           const rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+           const SortedConsumers_t *sortedCurrentSubscriptions,
            map_str_toppar_list_t *consumer2AllPotentialPartitions,
-           map_toppar_list_t *partition2AllPotentialConsumers) {
-
-        int minimum = ((const rd_kafka_topic_partition_list_t
-                            *)((const rd_map_elem_t *)rd_list_first(
-                                   sortedCurrentSubscriptions))
-                           ->value)
-                          ->cnt;
-        int maximum = ((const rd_kafka_topic_partition_list_t
-                            *)((const rd_map_elem_t *)rd_list_last(
-                                   sortedCurrentSubscriptions))
-                           ->value)
-                          ->cnt;
-
-        /* Mapping from partitions to the consumer assigned to them */
-        // FIXME: don't create prior to min/max check below */
-        map_toppar_str_t allPartitions = RD_MAP_INITIALIZER(
-            RD_MAP_CNT(partition2AllPotentialConsumers),
-            rd_kafka_topic_partition_cmp, rd_kafka_topic_partition_hash,
-            NULL /* references currentAssignment */,
-            NULL /* references currentAssignment */);
+           map_toppar_list_t *partition2AllPotentialConsumers,
+           map_toppar_str_t *currentPartitionConsumer) {
+
+        int minimum = sortedCurrentSubscriptions->min;
+        int maximum = sortedCurrentSubscriptions->max;
 
         /* Iterators */
-        const rd_kafka_topic_partition_list_t *partitions;
-        const char *consumer;
         const rd_map_elem_t *elem;
+        SortedConsumers_iter_t it;
         int i;
 
         /* The assignment is balanced if minimum and maximum numbers of
@@ -661,30 +992,13 @@ isBalanced(rd_kafka_t *rk,
                              "minimum %d and maximum %d partitions assigned "
                              "to each consumer",
                              minimum, maximum);
-                RD_MAP_DESTROY(&allPartitions);
                 return rd_true;
         }
 
-        /* Create a mapping from partitions to the consumer assigned to them */
-        RD_MAP_FOREACH(consumer, partitions, currentAssignment) {
-
-                for (i = 0; i < partitions->cnt; i++) {
-                        const rd_kafka_topic_partition_t *partition =
-                            &partitions->elems[i];
-                        const char *existing;
-                        if ((existing = RD_MAP_GET(&allPartitions, partition)))
-                                rd_kafka_log(rk, LOG_ERR, "STICKY",
-                                             "Sticky assignor: %s [%" PRId32
-                                             "] "
-                                             "is assigned to more than one "
-                                             "consumer (%s and %s)",
-                                             partition->topic,
-                                             partition->partition, existing,
-                                             consumer);
-
-                        RD_MAP_SET(&allPartitions, partition, consumer);
-                }
-        }
+        /* currentPartitionConsumer maps each assigned partition to its
+         * consumer and is kept in sync with currentAssignment, so there is
+         * no need to construct that mapping here on each call, which
+         * is done for each reassignable partition. */
 
 
         /* For each consumer that does not have all the topic partitions it
@@ -694,7 +1008,7 @@ isBalanced(rd_kafka_t *rk,
          * Note: Since sortedCurrentSubscriptions elements are pointers to
          *       currentAssignment's element we get both the consumer
          *       and partition list in elem here. */
-        RD_LIST_FOREACH(elem, sortedCurrentSubscriptions, i) {
+        SortedConsumers_FOREACH(elem, sortedCurrentSubscriptions, it) {
                 const char *consumer = (const char *)elem->key;
                 const rd_kafka_topic_partition_list_t *potentialTopicPartitions;
                 const rd_kafka_topic_partition_list_t *consumerPartitions;
@@ -716,16 +1030,25 @@ isBalanced(rd_kafka_t *rk,
                         const rd_kafka_topic_partition_t *partition =
                             &potentialTopicPartitions->elems[i];
                         const char *otherConsumer;
+                        const rd_kafka_topic_partition_list_t
+                            *otherConsumerPartitions;
                         int otherConsumerPartitionCount;
 
-                        if (rd_kafka_topic_partition_list_find(
-                                consumerPartitions, partition->topic,
-                                partition->partition))
+                        otherConsumer =
+                            RD_MAP_GET(currentPartitionConsumer, partition);
+
+                        /* Skip partitions already assigned to this consumer,
+                         * or not assigned at all. */
+                        if (!otherConsumer ||
+                            !strcmp(otherConsumer, consumer))
                                 continue;
 
-                        otherConsumer = RD_MAP_GET(&allPartitions, partition);
+                        otherConsumerPartitions =
+                            RD_MAP_GET(currentAssignment, otherConsumer);
+                        if (!otherConsumerPartitions)
+                                continue;
                         otherConsumerPartitionCount =
-                            RD_MAP_GET(currentAssignment, otherConsumer)->cnt;
+                            otherConsumerPartitions->cnt;
 
                         if (consumerPartitions->cnt <
                             otherConsumerPartitionCount) {
@@ -739,13 +1062,11 @@ isBalanced(rd_kafka_t *rk,
                                     partition->topic, partition->partition,
                                     otherConsumer, otherConsumerPartitionCount,
                                     consumer, consumerPartitions->cnt);
-                                RD_MAP_DESTROY(&allPartitions);
                                 return rd_false;
                         }
                 }
         }
 
-        RD_MAP_DESTROY(&allPartitions);
         return rd_true;
 }
 
@@ -761,7 +1082,7 @@ performReassignments(rd_kafka_t *rk,
                      rd_kafka_topic_partition_list_t *reassignablePartitions,
                      map_str_toppar_list_t *currentAssignment,
                      map_toppar_cgpair_t *prevAssignment,
-                     rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+                     SortedConsumers_t *sortedCurrentSubscriptions,
                      map_str_toppar_list_t *consumer2AllPotentialPartitions,
                      map_toppar_list_t *partition2AllPotentialConsumers,
                      map_toppar_str_t *currentPartitionConsumer) {
@@ -786,7 +1107,8 @@ performReassignments(rd_kafka_t *rk,
                             !isBalanced(rk, currentAssignment,
                                         sortedCurrentSubscriptions,
                                         consumer2AllPotentialPartitions,
-                                        partition2AllPotentialConsumers);
+                                        partition2AllPotentialConsumers,
+                                        currentPartitionConsumer);
                      i++) {
                         const rd_kafka_topic_partition_t *partition =
                             &reassignablePartitions->elems[i];
@@ -872,6 +1194,11 @@ performReassignments(rd_kafka_t *rk,
 }
 
 
+static int getBalanceScore_cmp_size(const void *_a, const void *_b) {
+        int a = *(const int *)_a, b = *(const int *)_b;
+        return RD_CMP(a, b);
+}
+
 /**
  * @returns the balance score of the given assignment, as the sum of assigned
  *           partitions size difference of all consumer pairs.
@@ -882,13 +1209,13 @@ performReassignments(rd_kafka_t *rk,
  * Lower balance score indicates a more balanced assignment.
  * FIXME: should be called imbalance score then?
  */
-static int getBalanceScore(map_str_toppar_list_t *assignment) {
+static int64_t getBalanceScore(map_str_toppar_list_t *assignment) {
         const char *consumer;
         const rd_kafka_topic_partition_list_t *partitions;
         int *sizes;
-        int cnt   = 0;
-        int score = 0;
-        int i, next;
+        int cnt       = 0;
+        int64_t score = 0;
+        int i;
 
         /* If there is just a single consumer the assignment will be balanced */
         if (RD_MAP_CNT(assignment) < 2)
@@ -899,9 +1226,14 @@ static int getBalanceScore(map_str_toppar_list_t *assignment) {
         RD_MAP_FOREACH(consumer, partitions, assignment)
         sizes[cnt++] = partitions->cnt;
 
-        for (next = 0; next < cnt; next++)
-                for (i = next + 1; i < cnt; i++)
-                        score += abs(sizes[next] - sizes[i]);
+        /* With the sizes sorted in ascending order the sum of the
+         * differences of all pairs is the sum of each size multiplied by
+         * the number of smaller sizes minus the number of larger sizes,
+         * which avoids iterating over all consumer pairs. */
+        qsort(sizes, (size_t)cnt, sizeof(*sizes), getBalanceScore_cmp_size);
+
+        for (i = 0; i < cnt; i++)
+                score += (int64_t)sizes[i] * (2 * i - (cnt - 1));
 
         rd_free(sizes);
 
@@ -913,6 +1245,35 @@ static int getBalanceScore(map_str_toppar_list_t *assignment) {
 
 
 
+/**
+ * @brief Remove the partitions that can't participate in reassignment
+ *        from \p partitions, retaining the order of the remaining ones.
+ */
+static void retainReassignablePartitions(
+    rd_kafka_topic_partition_list_t *partitions,
+    map_toppar_list_t *partition2AllPotentialConsumers) {
+        rd_kafka_topic_partition_list_t *all =
+            rd_kafka_topic_partition_list_copy(partitions);
+        int i;
+
+        rd_kafka_topic_partition_list_clear(partitions);
+
+        for (i = 0; i < all->cnt; i++) {
+                const rd_kafka_topic_partition_t *partition = &all->elems[i];
+                const rd_list_t *consumers =
+                    RD_MAP_GET(partition2AllPotentialConsumers, partition);
+
+                if (consumers && rd_list_cnt(consumers) < 2)
+                        continue;
+
+                rd_kafka_topic_partition_list_add(partitions, partition->topic,
+                                                  partition->partition);
+        }
+
+        rd_kafka_topic_partition_list_destroy(all);
+}
+
+
 /**
  * @brief Balance the current assignment using the data structures
  *        created in assign_cb(). */
@@ -922,22 +1283,19 @@ static void balance(rd_kafka_t *rk,
                     map_toppar_cgpair_t *prevAssignment,
                     rd_kafka_topic_partition_list_t *sortedPartitions,
                     rd_kafka_topic_partition_list_t *unassignedPartitions,
-                    rd_list_t *sortedCurrentSubscriptions /*rd_map_elem_t*/,
+                    SortedConsumers_t *sortedCurrentSubscriptions,
                     map_str_toppar_list_t *consumer2AllPotentialPartitions,
                     map_toppar_list_t *partition2AllPotentialConsumers,
                     map_toppar_str_t *currentPartitionConsumer,
+                    RackInfo_t *rackInfo,
                     rd_bool_t revocationRequired) {
 
-        /* If the consumer with most assignments (thus the last element
-         * in the ascendingly ordered sortedCurrentSubscriptions list) has
+        /* If the consumer with most assignments (thus the last consumer
+         * in the ascendingly ordered sortedCurrentSubscriptions set) has
          * zero partitions assigned it means there is no current assignment
          * for any consumer and the group is thus initializing for the first
          * time. */
-        rd_bool_t initializing = ((const rd_kafka_topic_partition_list_t
-                                       *)((const rd_map_elem_t *)rd_list_last(
-                                              sortedCurrentSubscriptions))
-                                      ->value)
-                                     ->cnt == 0;
+        rd_bool_t initializing = sortedCurrentSubscriptions->max == 0;
         rd_bool_t reassignmentPerformed = rd_false;
 
         map_str_toppar_list_t fixedAssignments =
@@ -958,11 +1316,11 @@ static void balance(rd_kafka_t *rk,
             rd_kafka_topic_partition_cmp, rd_kafka_topic_partition_hash,
             rd_kafka_topic_partition_destroy_free,
             NULL /* refs currentPartitionConsumer */);
-        int newScore, oldScore;
+        int64_t newScore, oldScore;
         /* Iterator variables */
         const rd_kafka_topic_partition_t *partition;
-        const void *ignore;
         const rd_map_elem_t *elem;
+        SortedConsumers_iter_t it;
         int i;
 
         /* Assign all unassigned partitions */
@@ -977,33 +1335,24 @@ static void balance(rd_kafka_t *rk,
                         continue;
                 }
 
-                assignPartition(
-                    partition, sortedCurrentSubscriptions, currentAssignment,
-                    consumer2AllPotentialPartitions, currentPartitionConsumer);
+                assignPartition(partition, sortedCurrentSubscriptions,
+                                currentAssignment,
+                                consumer2AllPotentialPartitions,
+                                currentPartitionConsumer, rackInfo);
         }
 
 
         /* Narrow down the reassignment scope to only those partitions that can
          * actually be reassigned. */
-        RD_MAP_FOREACH(partition, ignore, partition2AllPotentialConsumers) {
-                if (partitionCanParticipateInReassignment(
-                        partition, partition2AllPotentialConsumers))
-                        continue;
-
-                rd_kafka_topic_partition_list_del(
-                    sortedPartitions, partition->topic, partition->partition);
-                rd_kafka_topic_partition_list_del(unassignedPartitions,
-                                                  partition->topic,
-                                                  partition->partition);
-        }
-
-        if (ignore)
-                ; /* Avoid unused warning */
+        retainReassignablePartitions(sortedPartitions,
+                                     partition2AllPotentialConsumers);
+        retainReassignablePartitions(unassignedPartitions,
+                                     partition2AllPotentialConsumers);
 
 
         /* Narrow down the reassignment scope to only those consumers that are
          * subject to reassignment. */
-        RD_LIST_FOREACH(elem, sortedCurrentSubscriptions, i) {
+        SortedConsumers_FOREACH(elem, sortedCurrentSubscriptions, it) {
                 const char *consumer = (const char *)elem->key;
                 rd_kafka_topic_partition_list_t *partitions;
 
@@ -1013,9 +1362,8 @@ static void balance(rd_kafka_t *rk,
                         partition2AllPotentialConsumers))
                         continue;
 
-                rd_list_remove_elem(sortedCurrentSubscriptions, i);
-                i--; /* Since the current element is removed we need
-                      * to rewind the iterator. */
+                /* Removing the current consumer while iterating is safe. */
+                SortedConsumers_remove(sortedCurrentSubscriptions, consumer);
 
                 partitions = rd_kafka_topic_partition_list_copy(
                     RD_MAP_GET(currentAssignment, consumer));
@@ -1073,8 +1421,10 @@ static void balance(rd_kafka_t *rk,
                 rd_kafka_dbg(rk, ASSIGNOR, "STICKY",
                              "Reassignment performed but keeping previous "
                              "assignment since balance score did not improve: "
-                             "new score %d (%d consumers) vs "
-                             "old score %d (%d consumers): "
+                             "new score %" PRId64
+                             " (%d consumers) vs "
+                             "old score %" PRId64
+                             " (%d consumers): "
                              "lower score is better",
                              newScore, (int)RD_MAP_CNT(currentAssignment),
                              oldScore, (int)RD_MAP_CNT(&preBalanceAssignment));
@@ -1104,13 +1454,7 @@ static void balance(rd_kafka_t *rk,
                             (rd_kafka_topic_partition_list_t *)elem->value;
 
                         RD_MAP_SET(currentAssignment, consumer, partitions);
-
-                        rd_list_add(sortedCurrentSubscriptions, (void *)elem);
                 }
-
-                /* Re-sort */
-                rd_list_sort(sortedCurrentSubscriptions,
-                             sort_by_map_elem_val_toppar_list_cnt);
         }
 
         RD_MAP_DESTROY(&fixedAssignments);
@@ -1165,10 +1509,13 @@ static void prepopulateCurrentAssignments(
                 RD_MAP_SET(currentAssignment, consumer->rkgm_member_id->str,
                            rd_kafka_topic_partition_list_new(10));
 
+                /* Grown by populatePotentialMaps() as needed:
+                 * preallocating estimated_partition_cnt for each member
+                 * would not scale with large groups. */
                 RD_MAP_SET(consumer2AllPotentialPartitions,
                            consumer->rkgm_member_id->str,
                            rd_kafka_topic_partition_list_new(
-                               (int)estimated_partition_cnt));
+                               (int)RD_MIN(estimated_partition_cnt, 32)));
 
                 if (!consumer->rkgm_owned)
                         continue;
@@ -1202,10 +1549,6 @@ static void prepopulateCurrentAssignments(
                                     ConsumerGenerationPair_new(
                                         consumer->rkgm_member_id->str,
                                         consumer->rkgm_generation));
-
-                        RD_MAP_SET(currentPartitionConsumer,
-                                   rd_kafka_topic_partition_copy(partition),
-                                   consumer->rkgm_member_id->str);
                 }
         }
 
@@ -1229,6 +1572,10 @@ static void prepopulateCurrentAssignments(
                 rd_kafka_topic_partition_list_add(partitions, partition->topic,
                                                   partition->partition);
 
+                RD_MAP_SET(currentPartitionConsumer,
+                           rd_kafka_topic_partition_copy(partition),
+                           current->consumer);
+
                 /* Add previous (next highest generation) consumer, if any,
                  * to prevAssignment. */
                 previous = rd_list_elem(consumers, 1);
@@ -1285,7 +1632,7 @@ populatePotentialMaps(const rd_kafka_assignor_topic_t *atopic,
                                   RD_MAP_GET(partition2AllPotentialConsumers,
                                              partition))) {
                                 consumers = rd_list_new(
-                                    RD_MAX(2, (int)estimated_partition_cnt / 2),
+                                    RD_MAX(2, rd_list_cnt(&atopic->members)),
                                     NULL);
                                 RD_MAP_SET(
                                     partition2AllPotentialConsumers,
@@ -1306,6 +1653,8 @@ populatePotentialMaps(const rd_kafka_assignor_topic_t *atopic,
  *         and consumer2AllPotentialPartitions but since these maps
  *         are symmetrical we only check one of them.
  *         ^ FIXME, but we do.
+ *
+ * @remark The consumer2AllPotentialPartitions lists must be sorted.
  */
 static rd_bool_t areSubscriptionsIdentical(
     map_toppar_list_t *partition2AllPotentialConsumers,
@@ -1321,10 +1670,24 @@ static rd_bool_t areSubscriptionsIdentical(
         }
 
         RD_MAP_FOREACH(ignore, pcurr, consumer2AllPotentialPartitions) {
-                if (pprev && rd_kafka_topic_partition_list_cmp(
-                                 pcurr, pprev, rd_kafka_topic_partition_cmp))
+                int i;
+
+                if (!pprev) {
+                        pprev = pcurr;
+                        continue;
+                }
+
+                /* Since the lists are sorted they can be compared
+                 * element by element, rather than with
+                 * rd_kafka_topic_partition_list_cmp() which scans
+                 * all of one list for each element of the other. */
+                if (pcurr->cnt != pprev->cnt)
                         return rd_false;
-                pprev = pcurr;
+
+                for (i = 0; i < pcurr->cnt; i++)
+                        if (rd_kafka_topic_partition_cmp(&pcurr->elems[i],
+                                                         &pprev->elems[i]))
+                                return rd_false;
         }
 
         if (ignore) /* Avoid unused warning */
@@ -1374,9 +1737,9 @@ sortPartitions(rd_kafka_t *rk,
         const rd_kafka_topic_partition_t *partition;
         const rd_list_t *consumers;
         const char *consumer;
-        rd_list_t sortedConsumers; /* element is the (rd_map_elem_t *) from
-                                    * assignments. */
-        const rd_map_elem_t *elem;
+        SortedConsumers_t sortedConsumers; /* element is the
+                                            * (rd_map_elem_t *) from
+                                            * assignments. */
         rd_bool_t wasEmpty;
         int i;
 
@@ -1415,13 +1778,6 @@ sortPartitions(rd_kafka_t *rk,
          * (from consumers with most assigned partitions to those
          * with least assigned partitions). */
 
-        /* Create an ascending sorted list of consumers by valid
-         * partition count. The list element is the `rd_map_elem_t *`
-         * of the assignments map. This allows us to get a sorted list
-         * of consumers without too much data duplication. */
-        rd_list_init(&sortedConsumers, (int)RD_MAP_CNT(currentAssignment),
-                     NULL);
-
         RD_MAP_FOREACH(consumer, partitions, currentAssignment) {
                 rd_kafka_topic_partition_list_t *partitions2;
 
@@ -1443,60 +1799,52 @@ sortPartitions(rd_kafka_t *rk,
                                     partition->partition);
                 }
 
-                if (partitions2->cnt > 0) {
-                        elem = RD_MAP_SET(&assignments, consumer, partitions2);
-                        rd_list_add(&sortedConsumers, (void *)elem);
-                } else
+                if (partitions2->cnt > 0)
+                        RD_MAP_SET(&assignments, consumer, partitions2);
+                else
                         rd_kafka_topic_partition_list_destroy(partitions2);
         }
 
-        /* Sort consumers */
-        rd_list_sort(&sortedConsumers, sort_by_map_elem_val_toppar_list_cnt);
+        /* Create an ascending sorted set of consumers by valid
+         * partition count. The set element is the `rd_map_elem_t *`
+         * of the assignments map. This allows us to get a sorted set
+         * of consumers without too much data duplication. */
+        SortedConsumers_init(&sortedConsumers, &assignments.rmap);
 
         /* At this point sortedConsumers contains an ascending-sorted list
          * of consumers based on how many valid partitions are currently
          * assigned to them. */
 
-        while (!rd_list_empty(&sortedConsumers)) {
+        while (sortedConsumers.cnt > 0) {
                 /* Take consumer with most partitions */
-                const rd_map_elem_t *elem = rd_list_last(&sortedConsumers);
+                const rd_map_elem_t *elem =
+                    SortedConsumers_last(&sortedConsumers);
                 const char *consumer      = (const char *)elem->key;
                 /* Currently assigned partitions to this consumer */
                 rd_kafka_topic_partition_list_t *remainingPartitions =
                     RD_MAP_GET(&assignments, consumer);
-                /* Partitions that were assigned to a different consumer
-                 * last time */
-                rd_kafka_topic_partition_list_t *prevPartitions =
-                    rd_kafka_topic_partition_list_new(
-                        (int)RD_MAP_CNT(prevAssignment));
                 rd_bool_t reSort = rd_true;
 
-                /* From the partitions that had a different consumer before,
-                 * keep only those that are assigned to this consumer now. */
+                /* Find the first of this consumer's partitions that had
+                 * a different consumer before. */
                 for (i = 0; i < remainingPartitions->cnt; i++) {
                         partition = &remainingPartitions->elems[i];
                         if (RD_MAP_GET(prevAssignment, partition))
-                                rd_kafka_topic_partition_list_add(
-                                    prevPartitions, partition->topic,
-                                    partition->partition);
+                                break;
                 }
 
-                if (prevPartitions->cnt > 0) {
+                if (i < remainingPartitions->cnt) {
                         /* If there is a partition of this consumer that was
                          * assigned to another consumer before, then mark
                          * it as a good option for reassignment. */
-                        partition = &prevPartitions->elems[0];
-
-                        rd_kafka_topic_partition_list_del(remainingPartitions,
-                                                          partition->topic,
-                                                          partition->partition);
+                        partition = &remainingPartitions->elems[i];
 
                         rd_kafka_topic_partition_list_add(sortedPartitions,
                                                           partition->topic,
                                                           partition->partition);
 
-                        rd_kafka_topic_partition_list_del_by_idx(prevPartitions,
-                                                                 0);
+                        rd_kafka_topic_partition_list_del_by_idx(
+                            remainingPartitions, i);
 
                 } else if (remainingPartitions->cnt > 0) {
                         /* Otherwise mark any other one of the current
@@ -1510,30 +1858,57 @@ sortPartitions(rd_kafka_t *rk,
                         rd_kafka_topic_partition_list_del_by_idx(
                             remainingPartitions, 0);
                 } else {
-                        rd_list_remove_elem(&sortedConsumers,
-                                            rd_list_cnt(&sortedConsumers) - 1);
-                        /* No need to re-sort the list (below) */
+                        SortedConsumers_remove(&sortedConsumers, consumer);
+                        /* No need to reposition the consumer (below) */
                         reSort = rd_false;
                 }
 
-                rd_kafka_topic_partition_list_destroy(prevPartitions);
-
                 if (reSort) {
-                        /* Re-sort the list to keep the consumer with the most
-                         * partitions at the end of the list.
-                         * This should be an O(N) operation given it is at most
-                         * a single shuffle. */
-                        rd_list_sort(&sortedConsumers,
-                                     sort_by_map_elem_val_toppar_list_cnt);
+                        /* Reposition the consumer to keep the consumer with
+                         * the most partitions last. */
+                        SortedConsumers_update(&sortedConsumers, consumer);
                 }
         }
 
 
         wasEmpty = !sortedPartitions->cnt;
 
-        RD_MAP_FOREACH(partition, consumers, partition2AllPotentialConsumers)
-        rd_kafka_topic_partition_list_upsert(sortedPartitions, partition->topic,
-                                             partition->partition);
+        if (wasEmpty) {
+                RD_MAP_FOREACH(partition, consumers,
+                               partition2AllPotentialConsumers)
+                rd_kafka_topic_partition_list_add(
+                    sortedPartitions, partition->topic, partition->partition);
+        } else {
+                /* Add the remaining partitions, in map order, without
+                 * a linear search of sortedPartitions for each partition. */
+                rd_kafka_topic_partition_list_t *missingPartitions =
+                    rd_kafka_topic_partition_list_new(
+                        (int)RD_MAP_CNT(partition2AllPotentialConsumers));
+                RD_MAP_LOCAL_INITIALIZER(
+                    sortedPartitionsMap, sortedPartitions->cnt,
+                    const rd_kafka_topic_partition_t *, void *,
+                    rd_kafka_topic_partition_cmp,
+                    rd_kafka_topic_partition_hash, NULL, NULL);
+
+                for (i = 0; i < sortedPartitions->cnt; i++)
+                        RD_MAP_SET(&sortedPartitionsMap,
+                                   &sortedPartitions->elems[i],
+                                   (void *)&sortedPartitions->elems[i]);
+
+                RD_MAP_FOREACH(partition, consumers,
+                               partition2AllPotentialConsumers) {
+                        if (!RD_MAP_GET(&sortedPartitionsMap, partition))
+                                rd_kafka_topic_partition_list_add(
+                                    missingPartitions, partition->topic,
+                                    partition->partition);
+                }
+
+                RD_MAP_DESTROY(&sortedPartitionsMap);
+
+                rd_kafka_topic_partition_list_add_list(sortedPartitions,
+                                                       missingPartitions);
+                rd_kafka_topic_partition_list_destroy(missingPartitions);
+        }
 
         /* If all partitions were added in the foreach loop just above
          * it means there is no order to retain from the sorderConsumer loop
@@ -1543,7 +1918,7 @@ sortPartitions(rd_kafka_t *rk,
                 rd_kafka_topic_partition_list_sort(sortedPartitions, NULL,
                                                    NULL);
 
-        rd_list_destroy(&sortedConsumers);
+        SortedConsumers_destroy(&sortedConsumers);
         RD_MAP_DESTROY(&assignments);
 
         return sortedPartitions;
@@ -1571,6 +1946,23 @@ static void assignToMembers(map_str_toppar_list_t *currentAssignment,
 }
 
 
+/**
+ * @returns the total number of partitions of the eligible topics.
+ */
+static size_t
+eligiblePartitionCount(rd_kafka_assignor_topic_t **eligible_topics,
+                       size_t eligible_topic_cnt) {
+        size_t partition_cnt = 0;
+        size_t i;
+
+        for (i = 0; i < eligible_topic_cnt; i++)
+                partition_cnt +=
+                    (size_t)eligible_topics[i]->metadata->partition_cnt;
+
+        return partition_cnt;
+}
+
+
 /**
  * @brief KIP-54 and KIP-341/FIXME sticky assignor.
  *
@@ -1588,8 +1980,8 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
                                    char *errstr,
                                    size_t errstr_size,
                                    void *opaque) {
-        /* FIXME: Let the cgrp pass the actual eligible partition count */
-        size_t partition_cnt = member_cnt * 10; /* FIXME */
+        size_t partition_cnt =
+            eligiblePartitionCount(eligible_topics, eligible_topic_cnt);
 
         /* Map of subscriptions. This is \p member turned into a map. */
         map_str_toppar_list_t subscriptions =
@@ -1640,14 +2032,36 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
 
         rd_kafka_topic_partition_list_t *sortedPartitions;
         rd_kafka_topic_partition_list_t *unassignedPartitions;
-        rd_list_t sortedCurrentSubscriptions;
+        SortedConsumers_t sortedCurrentSubscriptions;
+
+        /* Mapping of partition to its unassignedPartitions element, and
+         * a flag for each element marking its assignment as preserved. */
+        RD_MAP_LOCAL_INITIALIZER(unassignedPartitionsMap, partition_cnt,
+                                 const rd_kafka_topic_partition_t *,
+                                 rd_bool_t *, rd_kafka_topic_partition_cmp,
+                                 rd_kafka_topic_partition_hash,
+                                 NULL /* refs unassignedPartitions */,
+                                 NULL /* refs preserved */);
+        rd_bool_t *preserved;
+
+        /* Rack information, used for the rack-aware topics, if any. */
+        RackInfo_t rackInfo = {
+            .topics        = RD_MAP_INITIALIZER(eligible_topic_cnt,
+                                         rd_map_str_cmp,
+                                         rd_map_str_hash,
+                                         NULL /* refs eligible_topics */,
+                                         NULL /* refs eligible_topics */),
+            .consumerRacks = RD_MAP_INITIALIZER(member_cnt,
+                                                rd_map_str_cmp,
+                                                rd_map_str_hash,
+                                                NULL /* refs members */,
+                                                NULL /* refs members */)};
 
         rd_bool_t revocationRequired = rd_false;
 
         /* Iteration variables */
         const char *consumer;
         rd_kafka_topic_partition_list_t *partitions;
-        const rd_map_elem_t *elem;
         int i;
 
         /* Initialize PartitionMovements */
@@ -1668,6 +2082,29 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
                     eligible_topics[i], &partition2AllPotentialConsumers,
                     &consumer2AllPotentialPartitions, partition_cnt);
 
+        /* Collect the topics for which rack-aware assignment is used,
+         * and the consumer racks. */
+        for (i = 0; i < (int)eligible_topic_cnt; i++) {
+                if (rd_kafka_assignor_topic_use_rack_aware(eligible_topics[i]))
+                        RD_MAP_SET(&rackInfo.topics,
+                                   eligible_topics[i]->metadata->topic,
+                                   eligible_topics[i]);
+        }
+
+        if (!RD_MAP_IS_EMPTY(&rackInfo.topics)) {
+                for (i = 0; i < (int)member_cnt; i++) {
+                        if (members[i].rkgm_rack_id)
+                                RD_MAP_SET(&rackInfo.consumerRacks,
+                                           members[i].rkgm_member_id->str,
+                                           members[i].rkgm_rack_id->str);
+                }
+        }
+
+        /* Sort each consumer's potential partitions to allow
+         * binary searches by sortedPartitionsContain(). */
+        RD_MAP_FOREACH(consumer, partitions, &consumer2AllPotentialPartitions)
+        rd_kafka_topic_partition_list_sort(partitions, NULL, NULL);
+
 
         /* Sort valid partitions to minimize partition movements. */
         sortedPartitions = sortPartitions(
@@ -1680,6 +2117,15 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
         unassignedPartitions =
             rd_kafka_topic_partition_list_copy(sortedPartitions);
 
+        /* Preserved assignments are removed from unassignedPartitions
+         * after the loop below rather than with a linear search and
+         * removal for each partition. */
+        preserved = rd_calloc(RD_MAX(unassignedPartitions->cnt, 1),
+                              sizeof(*preserved));
+        for (i = 0; i < unassignedPartitions->cnt; i++)
+                RD_MAP_SET(&unassignedPartitionsMap,
+                           &unassignedPartitions->elems[i], &preserved[i]);
+
         RD_MAP_FOREACH(consumer, partitions, &currentAssignment) {
                 if (!RD_MAP_GET(&subscriptions, consumer)) {
                         /* If a consumer that existed before
@@ -1743,10 +2189,11 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
                                          * is already assigned and we would want
                                          * to preserve that assignment as much
                                          * as possible). */
-                                        rd_kafka_topic_partition_list_del(
-                                            unassignedPartitions,
-                                            partition->topic,
-                                            partition->partition);
+                                        rd_bool_t *is_preserved = RD_MAP_GET(
+                                            &unassignedPartitionsMap,
+                                            partition);
+                                        if (is_preserved)
+                                                *is_preserved = rd_true;
                                 }
 
                                 if (remove_part) {
@@ -1762,29 +2209,41 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
         }
 
 
+        RD_MAP_DESTROY(&unassignedPartitionsMap);
+
+        /* Remove the preserved assignments from unassignedPartitions,
+         * retaining the order of the remaining partitions. */
+        partitions = unassignedPartitions;
+        unassignedPartitions =
+            rd_kafka_topic_partition_list_new(partitions->cnt);
+        for (i = 0; i < partitions->cnt; i++) {
+                if (!preserved[i])
+                        rd_kafka_topic_partition_list_add(
+                            unassignedPartitions, partitions->elems[i].topic,
+                            partitions->elems[i].partition);
+        }
+        rd_kafka_topic_partition_list_destroy(partitions);
+        rd_free(preserved);
+
+
         /* At this point we have preserved all valid topic partition to consumer
          * assignments and removed all invalid topic partitions and invalid
          * consumers.
          * Now we need to assign unassignedPartitions to consumers so that the
          * topic partition assignments are as balanced as possible. */
 
-        /* An ascending sorted list of consumers based on how many topic
-         * partitions are already assigned to them. The list element is
+        /* An ascending sorted set of consumers based on how many topic
+         * partitions are already assigned to them. The set element is
          * referencing the rd_map_elem_t* from the currentAssignment map. */
-        rd_list_init(&sortedCurrentSubscriptions,
-                     (int)RD_MAP_CNT(&currentAssignment), NULL);
-
-        RD_MAP_FOREACH_ELEM(elem, &currentAssignment.rmap)
-        rd_list_add(&sortedCurrentSubscriptions, (void *)elem);
-
-        rd_list_sort(&sortedCurrentSubscriptions,
-                     sort_by_map_elem_val_toppar_list_cnt);
+        SortedConsumers_init(&sortedCurrentSubscriptions,
+                             &currentAssignment.rmap);
 
         /* Balance the available partitions across consumers */
         balance(rk, &partitionMovements, &currentAssignment, &prevAssignment,
                 sortedPartitions, unassignedPartitions,
                 &sortedCurrentSubscriptions, &consumer2AllPotentialPartitions,
                 &partition2AllPotentialConsumers, &currentPartitionConsumer,
+                !RD_MAP_IS_EMPTY(&rackInfo.topics) ? &rackInfo : NULL,
                 revocationRequired);
 
         /* Transfer currentAssignment (now updated) to each member's
@@ -1792,13 +2251,15 @@ rd_kafka_sticky_assignor_assign_cb(rd_kafka_t *rk,
         assignToMembers(&currentAssignment, members, member_cnt);
 
 
-        rd_list_destroy(&sortedCurrentSubscriptions);
+        SortedConsumers_destroy(&sortedCurrentSubscriptions);
 
         PartitionMovements_destroy(&partitionMovements);
 
         rd_kafka_topic_partition_list_destroy(unassignedPartitions);
         rd_kafka_topic_partition_list_destroy(sortedPartitions);
 
+        RD_MAP_DESTROY(&rackInfo.consumerRacks);
+        RD_MAP_DESTROY(&rackInfo.topics);
         RD_MAP_DESTROY(&currentPartitionConsumer);
         RD_MAP_DESTROY(&consumer2AllPotentialPartitions);
         RD_MAP_DESTROY(&partition2AllPotentialConsumers);
@@ -1837,7 +2298,8 @@ static rd_kafkap_bytes_t *rd_kafka_sticky_assignor_get_metadata(
     const rd_kafka_assignor_t *rkas,
     void *assignor_state,
     const rd_list_t *topics,
-    const rd_kafka_topic_partition_list_t *owned_partitions) {
+    const rd_kafka_topic_partition_list_t *owned_partitions,
+    const rd_kafkap_str_t *rack_id) {
         rd_kafka_sticky_assignor_state_t *state;
         rd_kafka_buf_t *rkbuf;
         rd_kafkap_bytes_t *metadata;
@@ -1857,7 +2319,8 @@ static rd_kafkap_bytes_t *rd_kafka_sticky_assignor_get_metadata(
 
         if (!assignor_state) {
                 return rd_kafka_consumer_protocol_member_metadata_new(
-                    topics, NULL, 0, owned_partitions);
+                    topics, NULL, 0, owned_partitions, -1 /* generation */,
+                    rack_id);
         }
 
         state = (rd_kafka_sticky_assignor_state_t *)assignor_state;
@@ -1880,7 +2343,8 @@ static rd_kafkap_bytes_t *rd_kafka_sticky_assignor_get_metadata(
         rd_kafka_buf_destroy(rkbuf);
 
         metadata = rd_kafka_consumer_protocol_member_metadata_new(
-            topics, kbytes->data, kbytes->len, owned_partitions);
+            topics, kbytes->data, kbytes->len, owned_partitions,
+            state->generation_id, rack_id);
 
         rd_kafkap_bytes_destroy(kbytes);
 
@@ -3338,6 +3802,244 @@ ut_testConflictingPreviousAssignments(rd_kafka_t *rk,
         RD_UT_PASS();
 }
 
+/**
+ * @brief Assign and rebalance groups of increasing size and verify that
+ *        the time spent per potential member-partition pair stays
+ *        roughly constant, i.e., that the assignor scales linearly
+ *        with the size of its input.
+ *
+ * Each scenario runs a fresh assignment followed by a rebalance where
+ * every tenth member has left. With mixed subscriptions every other
+ * member only subscribes to the first half of the topics.
+ */
+static int ut_testAssignmentScaling(rd_kafka_t *rk,
+                                    const rd_kafka_assignor_t *rkas) {
+        static const struct {
+                int member_cnt;
+                int topic_cnt;
+                int partition_cnt;     /**< Per topic */
+                rd_bool_t mixed;       /**< Mixed subscriptions */
+                uint32_t exp_checksum; /**< Checksum of the assignments
+                                        *   made by the assignor prior to
+                                        *   the scaling improvements. */
+        } scenarios[] = {
+            {50, 10, 20, rd_false, 0x1be1fa31},
+            {50, 10, 20, rd_true, 0x477cec4d},
+            {150, 20, 30, rd_false, 0xd0125d0c},
+            {150, 20, 30, rd_true, 0xe105b614},
+            {400, 40, 40, rd_false, 0xaea3927c},
+            {400, 40, 40, rd_true, 0xf054abec},
+        };
+        double ns_per_pair[RD_ARRAYSIZE(scenarios)];
+        int s;
+
+        for (s = 0; s < (int)RD_ARRAYSIZE(scenarios); s++) {
+                rd_kafka_resp_err_t err;
+                char errstr[512];
+                rd_kafka_metadata_t *metadata;
+                rd_kafka_metadata_topic_t *mt;
+                rd_kafka_group_member_t *members;
+                int member_cnt = scenarios[s].member_cnt;
+                int topic_cnt  = scenarios[s].topic_cnt;
+                int64_t pair_cnt = 0;
+                int *assigned_cnt;
+                uint32_t checksum = 0;
+                rd_ts_t ts_assign, ts_rebalance;
+                int i, j, run;
+
+                mt = rd_alloca(sizeof(*mt) * topic_cnt);
+                for (i = 0; i < topic_cnt; i++) {
+                        char topic[16];
+                        rd_snprintf(topic, sizeof(topic), "topic%03d", i);
+                        rd_strdupa(&mt[i].topic, topic);
+                        mt[i].partition_cnt = scenarios[s].partition_cnt;
+                }
+
+                metadata = rd_kafka_metadata_new_topic_mock(mt, topic_cnt);
+
+                members = rd_calloc(member_cnt, sizeof(*members));
+                for (i = 0; i < member_cnt; i++) {
+                        int sub_cnt = scenarios[s].mixed && (i % 2)
+                                          ? topic_cnt / 2
+                                          : topic_cnt;
+                        char name[32];
+
+                        rd_snprintf(name, sizeof(name), "consumer%05d", i);
+                        ut_init_member(&members[i], name, NULL);
+                        for (j = 0; j < sub_cnt; j++)
+                                rd_kafka_topic_partition_list_add(
+                                    members[i].rkgm_subscription, mt[j].topic,
+                                    RD_KAFKA_PARTITION_UA);
+                        pair_cnt +=
+                            (int64_t)sub_cnt * scenarios[s].partition_cnt;
+                }
+
+                assigned_cnt = rd_calloc(topic_cnt * scenarios[s].partition_cnt,
+                                         sizeof(*assigned_cnt));
+
+                for (run = 0; run < 2; run++) {
+                        rd_ts_t ts = rd_clock();
+
+                        err = rd_kafka_assignor_run(rk->rk_cgrp, rkas,
+                                                    metadata, members,
+                                                    member_cnt, errstr,
+                                                    sizeof(errstr));
+                        RD_UT_ASSERT(!err, "assignor run failed: %s", errstr);
+
+                        ts = rd_clock() - ts;
+                        if (run == 0)
+                                ts_assign = ts;
+                        else
+                                ts_rebalance = ts;
+
+                        /* Verify that each partition is assigned exactly
+                         * once, and checksum the assignment. */
+                        memset(assigned_cnt, 0,
+                               sizeof(*assigned_cnt) * topic_cnt *
+                                   scenarios[s].partition_cnt);
+                        for (i = 0; i < member_cnt; i++) {
+                                const rd_kafka_topic_partition_list_t *parts =
+                                    members[i].rkgm_assignment;
+
+                                checksum = checksum * 31 + (uint32_t)i;
+                                for (j = 0; j < parts->cnt; j++) {
+                                        int t = atoi(parts->elems[j].topic +
+                                                     strlen("topic"));
+                                        assigned_cnt
+                                            [t * scenarios[s].partition_cnt +
+                                             parts->elems[j].partition]++;
+                                        checksum =
+                                            checksum * 31 +
+                                            (uint32_t)(t * 100000 +
+                                                       parts->elems[j]
+                                                           .partition);
+                                }
+
+                                ut_set_owned(&members[i]);
+                        }
+
+                        for (i = 0; i < topic_cnt * scenarios[s].partition_cnt;
+                             i++)
+                                RD_UT_ASSERT(assigned_cnt[i] == 1,
+                                             "Scenario #%d run %d: partition "
+                                             "#%d assigned %d times",
+                                             s, run, i, assigned_cnt[i]);
+
+                        if (run == 1)
+                                break;
+
+                        /* Remove every tenth member */
+                        for (i = member_cnt - 1; i >= 0; i -= 10) {
+                                rd_kafka_group_member_clear(&members[i]);
+                                memmove(&members[i], &members[i + 1],
+                                        sizeof(*members) *
+                                            (member_cnt - (i + 1)));
+                                member_cnt--;
+                        }
+                }
+
+                ns_per_pair[s] = (double)(ts_assign + ts_rebalance) * 1000.0 /
+                                 (double)pair_cnt;
+
+                RD_UT_SAY("Scenario #%d: %d members, %d topics x %d "
+                          "partitions, %s subscriptions: "
+                          "assign %.3fms, rebalance %.3fms, "
+                          "%.1fns per member-partition pair "
+                          "(checksum %08x)",
+                          s, scenarios[s].member_cnt, topic_cnt,
+                          scenarios[s].partition_cnt,
+                          scenarios[s].mixed ? "mixed" : "identical",
+                          (double)ts_assign / 1000.0,
+                          (double)ts_rebalance / 1000.0, ns_per_pair[s],
+                          checksum);
+
+                /* The assignments must be identical to those of the
+                 * original, non-indexed, implementation. */
+                RD_UT_ASSERT(checksum == scenarios[s].exp_checksum,
+                             "Scenario #%d: assignment checksum %08x "
+                             "differs from expected %08x",
+                             s, checksum, scenarios[s].exp_checksum);
+
+                for (i = 0; i < member_cnt; i++)
+                        rd_kafka_group_member_clear(&members[i]);
+                rd_free(members);
+                rd_free(assigned_cnt);
+                rd_kafka_metadata_destroy(metadata);
+        }
+
+        /* The cost per member-partition pair of the largest scenarios
+         * should be in the same order as that of the smallest ones. */
+        for (s = (int)RD_ARRAYSIZE(scenarios) - 2;
+             s < (int)RD_ARRAYSIZE(scenarios); s++) {
+                double ratio = ns_per_pair[s] / ns_per_pair[s % 2];
+
+                if (!rd_unittest_slow)
+                        RD_UT_ASSERT(ratio < 5.0,
+                                     "Scenario #%d: %.1fns per "
+                                     "member-partition pair is %.1f times "
+                                     "that of scenario #%d: "
+                                     "expected near-linear scaling",
+                                     s, ns_per_pair[s], ratio, s % 2);
+                else if (ratio >= 5.0)
+                        RD_UT_WARN("Scenario #%d: %.1fns per "
+                                   "member-partition pair is %.1f times "
+                                   "that of scenario #%d",
+                                   s, ns_per_pair[s], ratio, s % 2);
+        }
+
+        RD_UT_PASS();
+}
+
+
+/**
+ * @brief Rack-aware assignment (KIP-881): each consumer is preferably
+ *        assigned partitions with a replica in its rack.
+ */
+static int ut_testRackAwareAssignment(rd_kafka_t *rk,
+                                      const rd_kafka_assignor_t *rkas) {
+        rd_kafka_resp_err_t err;
+        char errstr[512];
+        rd_kafka_metadata_t *metadata;
+        rd_kafka_group_member_t members[3];
+        static const char *broker_racks[] = {"a", "b", "c"};
+        static const char *member_racks[] = {"c", "b", "a"};
+        rd_kafka_metadata_topic_t mt      = {.topic         = "topic1",
+                                        .partition_cnt = 6};
+        int member_cnt                    = RD_ARRAYSIZE(members);
+        int i;
+
+        /* Partition p is replicated to broker (p % 3) only. */
+        metadata = rd_kafka_metadata_new_topic_with_partition_replicas_mock(
+            &mt, 1, 1, RD_ARRAYSIZE(broker_racks));
+
+        ut_init_member(&members[0], "consumer1", "topic1", NULL);
+        ut_init_member(&members[1], "consumer2", "topic1", NULL);
+        ut_init_member(&members[2], "consumer3", "topic1", NULL);
+        for (i = 0; i < member_cnt; i++)
+                members[i].rkgm_rack_id =
+                    rd_kafkap_str_new(member_racks[i], -1);
+
+        err = rd_kafka_assignor_run_with_racks(rk->rk_cgrp, rkas, metadata,
+                                               broker_racks, members,
+                                               member_cnt, errstr,
+                                               sizeof(errstr));
+        RD_UT_ASSERT(!err, "assignor run failed: %s", errstr);
+
+        verifyAssignment(&members[0], "topic1", 2, "topic1", 5, NULL);
+        verifyAssignment(&members[1], "topic1", 1, "topic1", 4, NULL);
+        verifyAssignment(&members[2], "topic1", 0, "topic1", 3, NULL);
+
+        verifyValidityAndBalance(members, member_cnt, metadata);
+        isFullyBalanced(members, member_cnt);
+
+        for (i = 0; i < member_cnt; i++)
+                rd_kafka_group_member_clear(&members[i]);
+        rd_kafka_metadata_destroy(metadata);
+
+        RD_UT_PASS();
+}
+
+
 /* testReassignmentWithRandomSubscriptionsAndChanges is not ported
  * from Java since random tests don't provide meaningful test coverage. */
 
@@ -3372,6 +4074,8 @@ static int rd_kafka_sticky_assignor_unittest(void) {
             ut_testAssignmentUpdatedForDeletedTopic,
             ut_testNoExceptionThrownWhenOnlySubscribedTopicDeleted,
             ut_testConflictingPreviousAssignments,
+            ut_testRackAwareAssignment,
+            ut_testAssignmentScaling,
             NULL,
         };
         int i;
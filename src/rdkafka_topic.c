@@ -618,6 +618,27 @@ int rd_kafka_toppar_broker_update(rd_kafka_toppar_t *rktp,
 }
 
 
+/**
+ * @returns true if \p broker_id is an in-sync replica of \p rktp according
+ *          to the last Metadata response, or if the ISRs are not known.
+ *
+ * @locks_required rd_kafka_toppar_lock(rktp)
+ */
+static rd_bool_t rd_kafka_toppar_is_isr(const rd_kafka_toppar_t *rktp,
+                                        int32_t broker_id) {
+        int i;
+
+        if (!rktp->rktp_isrs)
+                return rd_true;
+
+        for (i = 0; i < rktp->rktp_isr_cnt; i++)
+                if (rktp->rktp_isrs[i] == broker_id)
+                        return rd_true;
+
+        return rd_false;
+}
+
+
 /**
  * @brief Update a topic+partition for a new leader.
  *
@@ -629,6 +650,8 @@ int rd_kafka_toppar_broker_update(rd_kafka_toppar_t *rktp,
  * @param leader A reference to the leader broker or NULL if the
  *        toppar should be undelegated for any reason.
  * @param leader_epoch Partition leader's epoch (KIP-320), or -1 if not known.
+ * @param isrs In-sync replicas, or NULL if not known.
+ * @param isr_cnt Number of \p isrs.
  *
  * @returns 1 if the broker delegation was changed, -1 if the broker
  *        delegation was changed and is now undelegated, else 0.
@@ -641,7 +664,9 @@ static int rd_kafka_toppar_leader_update(rd_kafka_topic_t *rkt,
                                          int32_t partition,
                                          int32_t leader_id,
                                          rd_kafka_broker_t *leader,
-                                         int32_t leader_epoch) {
+                                         int32_t leader_epoch,
+                                         const int32_t *isrs,
+                                         int isr_cnt) {
         rd_kafka_toppar_t *rktp;
         rd_bool_t fetching_from_follower, need_epoch_validation = rd_false;
         int r = 0;
@@ -678,6 +703,15 @@ static int rd_kafka_toppar_leader_update(rd_kafka_topic_t *rkt,
                 }
         }
 
+        /* Keep the in-sync replicas for client-side replica selection,
+         * they are not available when updating from the metadata cache. */
+        if (isrs) {
+                rktp->rktp_isrs = rd_realloc(
+                    rktp->rktp_isrs, sizeof(*isrs) * RD_MAX(isr_cnt, 1));
+                memcpy(rktp->rktp_isrs, isrs, sizeof(*isrs) * isr_cnt);
+                rktp->rktp_isr_cnt = isr_cnt;
+        }
+
         if (rktp->rktp_fetch_state == RD_KAFKA_TOPPAR_FETCH_VALIDATE_EPOCH_WAIT)
                 need_epoch_validation = rd_true;
         else if (leader_epoch > rktp->rktp_leader_epoch) {
@@ -697,6 +731,23 @@ static int rd_kafka_toppar_leader_update(rd_kafka_topic_t *rkt,
             rktp->rktp_broker->rkb_source != RD_KAFKA_INTERNAL &&
             rktp->rktp_broker != leader;
 
+        /* With client-side replica selection: revert to the leader
+         * if the selected replica is no longer in sync. */
+        if (fetching_from_follower &&
+            rkt->rkt_rk->rk_conf.fetch_replica_selection ==
+                RD_KAFKA_FETCH_REPLICA_SELECTION_CLIENT &&
+            !rd_kafka_toppar_is_isr(rktp, rktp->rktp_broker_id)) {
+                rd_kafka_dbg(rktp->rktp_rkt->rkt_rk, TOPIC, "BROKER",
+                             "Topic %s [%" PRId32 "]: selected replica %" PRId32
+                             " is no longer in sync: "
+                             "reverting to leader %" PRId32,
+                             rktp->rktp_rkt->rkt_topic->str,
+                             rktp->rktp_partition, rktp->rktp_broker_id,
+                             leader_id);
+                fetching_from_follower = rd_false;
+                rd_interval_reset_to_now(&rktp->rktp_replica_select_intvl, 0);
+        }
+
         if (fetching_from_follower && rktp->rktp_leader_id == leader_id) {
                 rd_kafka_dbg(
                     rktp->rktp_rkt->rkt_rk, TOPIC, "BROKER",
@@ -784,6 +835,9 @@ int rd_kafka_toppar_delegate_to_leader(rd_kafka_toppar_t *rktp) {
         r = rd_kafka_toppar_broker_update(
             rktp, rktp->rktp_leader_id, leader,
             "reverting from preferred replica to leader");
+        /* Stay on the leader for a while before client-side replica
+         * selection may select a replica again. */
+        rd_interval_reset_to_now(&rktp->rktp_replica_select_intvl, 0);
         rd_kafka_toppar_unlock(rktp);
 
         if (leader)
@@ -1336,9 +1390,10 @@ static int rd_kafka_topic_metadata_update(
                 partbrokers[j] = NULL;
 
                 /* Update leader for partition */
-                r = rd_kafka_toppar_leader_update(rkt, mdt->partitions[j].id,
-                                                  mdt->partitions[j].leader,
-                                                  leader, leader_epoch);
+                r = rd_kafka_toppar_leader_update(
+                    rkt, mdt->partitions[j].id, mdt->partitions[j].leader,
+                    leader, leader_epoch, mdt->partitions[j].isrs,
+                    mdt->partitions[j].isr_cnt);
 
                 upd += (r != 0 ? 1 : 0);
 
@@ -1889,6 +1944,7 @@ void rd_ut_kafka_topic_set_topic_exists(rd_kafka_topic_t *rkt,
         struct rd_kafka_metadata_topic mdt = {.topic =
                                                   (char *)rkt->rkt_topic->str,
                                               .partition_cnt = partition_cnt};
+        rd_kafka_Uuid_t zero_uuid = RD_KAFKA_UUID_ZERO;
         int i;
 
         mdt.partitions = rd_alloca(sizeof(*mdt.partitions) * partition_cnt);
@@ -1900,7 +1956,8 @@ void rd_ut_kafka_topic_set_topic_exists(rd_kafka_topic_t *rkt,
         }
 
         rd_kafka_wrlock(rkt->rkt_rk);
-        rd_kafka_metadata_cache_topic_update(rkt->rkt_rk, &mdt, rd_true);
+        rd_kafka_metadata_cache_topic_update(rkt->rkt_rk, &mdt, zero_uuid,
+                                             rd_true);
         rd_kafka_topic_metadata_update(rkt, &mdt, NULL, rd_clock());
         rd_kafka_wrunlock(rkt->rkt_rk);
 }
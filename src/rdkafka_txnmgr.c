@@ -44,6 +44,7 @@
 
 
 static void rd_kafka_txn_coord_timer_start(rd_kafka_t *rk, int timeout_ms);
+static void rd_kafka_txn_register_partitions(rd_kafka_t *rk);
 
 #define rd_kafka_txn_curr_api_set_result(rk, actions, error)                   \
         rd_kafka_txn_curr_api_set_result0(__FUNCTION__, __LINE__, rk, actions, \
@@ -237,6 +238,7 @@ rd_kafka_txn_state_transition_is_valid(rd_kafka_txn_state_t curr,
 static void rd_kafka_txn_set_state(rd_kafka_t *rk,
                                    rd_kafka_txn_state_t new_state) {
         rd_bool_t ignore;
+        rd_ts_t now;
 
         if (rk->rk_eos.txn_state == new_state)
                 return;
@@ -269,7 +271,13 @@ static void rd_kafka_txn_set_state(rd_kafka_t *rk,
         else if (new_state == RD_KAFKA_TXN_STATE_IN_TRANSACTION)
                 rd_atomic32_set(&rk->rk_eos.txn_may_enq, 1);
 
-        rk->rk_eos.txn_state = new_state;
+        /* Account time spent in the previous state */
+        now = rd_clock();
+        rk->rk_eos.txn_state_time[rk->rk_eos.txn_state] +=
+            now - rk->rk_eos.ts_txn_state;
+
+        rk->rk_eos.txn_state    = new_state;
+        rk->rk_eos.ts_txn_state = now;
 }
 
 
@@ -820,6 +828,11 @@ static void rd_kafka_txn_handle_AddPartitionsToTxn(rd_kafka_t *rk,
         rd_kafka_resp_err_t reset_coord_err = RD_KAFKA_RESP_ERR_NO_ERROR;
         rd_bool_t require_bump              = rd_false;
 
+        if (err != RD_KAFKA_RESP_ERR__DESTROY) {
+                rk->rk_eos.txn_addparts_cnt++;
+                rk->rk_eos.txn_addparts_rtt += request->rkbuf_ts_sent;
+        }
+
         if (err)
                 goto done;
 
@@ -1077,12 +1090,17 @@ done:
                             rd_kafka_broker_name(rkb), rd_kafka_err2str(err),
                             (int)(request->rkbuf_ts_sent / 1000));
 
-        } else {
+        } else if (actions & RD_KAFKA_ERR_ACTION_RETRY) {
                 /* Schedule registration of any new or remaining partitions */
-                rd_kafka_txn_schedule_register_partitions(
-                    rk, (actions & RD_KAFKA_ERR_ACTION_RETRY)
-                            ? retry_backoff_ms
-                            : 1 /*immediate*/);
+                rd_kafka_txn_schedule_register_partitions(rk,
+                                                          retry_backoff_ms);
+        } else {
+                /* Partitions that were added to the transaction while
+                 * this request was in-flight have been accumulating on
+                 * the pending list: send them right away rather than
+                 * going through the timer, this avoids adding latency
+                 * to short-lived transactions. */
+                rd_kafka_txn_register_partitions(rk);
         }
 }
 
@@ -3172,7 +3190,7 @@ void rd_kafka_txn_coord_monitor_cb(rd_kafka_broker_t *rkb) {
                         /* PID is already valid, continue transactional
                          * operations by checking for partitions to register */
                         rd_kafka_txn_schedule_register_partitions(rk,
-                                                                  1 /*ASAP*/);
+                                                                  0 /*ASAP*/);
                 }
 
                 rd_kafka_wrunlock(rk);
@@ -133,7 +133,7 @@ rd_kafka_txn_add_partition(rd_kafka_toppar_t *rktp) {
 
         /* Schedule registration of partitions by the rdkafka main thread */
         if (unlikely(schedule))
-                rd_kafka_txn_schedule_register_partitions(rk, 1 /*immediate*/);
+                rd_kafka_txn_schedule_register_partitions(rk, 0 /*immediate*/);
 }
 
 
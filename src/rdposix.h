@@ -39,6 +39,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/mman.h>
 
 /**
  * Types
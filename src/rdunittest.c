@@ -420,6 +420,8 @@ extern int unittest_scram(void);
 #endif
 extern int unittest_assignors(void);
 extern int unittest_map(void);
+extern int unittest_headers(void);
+extern int unittest_buf(void);
 #if WITH_CURL
 extern int unittest_http(void);
 #endif
@@ -440,6 +442,8 @@ int rd_unittest(void) {
                 {"rdvarint", unittest_rdvarint},
                 {"crc32c", unittest_rd_crc32c},
                 {"msg", unittest_msg},
+                {"headers", unittest_headers},
+                {"buf", unittest_buf},
                 {"murmurhash", unittest_murmur2},
                 {"fnv1a", unittest_fnv1a},
 #if WITH_HDRHISTOGRAM
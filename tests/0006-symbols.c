@@ -61,6 +61,7 @@ int main_0006_symbols(int argc, char **argv) {
                 rd_kafka_conf_set_rebalance_cb(NULL, NULL);
                 rd_kafka_conf_set_offset_commit_cb(NULL, NULL);
                 rd_kafka_conf_set_throttle_cb(NULL, NULL);
+                rd_kafka_conf_set_consume_filter_cb(NULL, NULL);
                 rd_kafka_conf_set_default_topic_conf(NULL, NULL);
                 rd_kafka_conf_get(NULL, NULL, NULL, NULL);
 #ifndef _WIN32
@@ -124,12 +125,46 @@ int main_0006_symbols(int argc, char **argv) {
                 rd_kafka_consume_start_queue(NULL, 0, 0, NULL);
                 rd_kafka_consume_queue(NULL, 0);
                 rd_kafka_consume_batch_queue(NULL, 0, NULL, 0);
+                rd_kafka_consume_columns_queue(NULL, 0, NULL);
+                rd_kafka_message_columns_new(0);
+                rd_kafka_message_columns_clear(NULL);
+                rd_kafka_message_columns_destroy(NULL);
+                rd_kafka_message_columns_cnt(NULL);
+                rd_kafka_message_columns_err(NULL);
+                rd_kafka_message_columns_topic(NULL);
+                rd_kafka_message_columns_partition(NULL);
+                rd_kafka_message_columns_offset(NULL);
+                rd_kafka_message_columns_timestamp(NULL);
+                rd_kafka_message_columns_key(NULL);
+                rd_kafka_message_columns_key_len(NULL);
+                rd_kafka_message_columns_payload(NULL);
+                rd_kafka_message_columns_len(NULL);
+                rd_kafka_message_columns_headers(NULL, 0, NULL);
+                rd_kafka_message_header_peek(NULL, NULL, NULL, NULL);
+                rd_kafka_message_header_peek_all(NULL, NULL, NULL, NULL, NULL,
+                                                 NULL);
+                rd_kafka_headers_new_from_wire(NULL, 0);
                 rd_kafka_consume_callback_queue(NULL, 0, NULL, NULL);
                 rd_kafka_seek(NULL, 0, 0, 0);
+                rd_kafka_fetch_priority_set(NULL, NULL, 0, 0);
                 rd_kafka_yield(NULL);
                 rd_kafka_mem_free(NULL, NULL);
                 rd_kafka_list_groups(NULL, NULL, NULL, 0);
                 rd_kafka_group_list_destroy(NULL);
+                rd_kafka_conf_add_partition_assignor(NULL, NULL, NULL, NULL,
+                                                     NULL);
+                rd_kafka_assignor_ctx_member_cnt(NULL);
+                rd_kafka_assignor_ctx_member_id(NULL, 0);
+                rd_kafka_assignor_ctx_member_rack(NULL, 0);
+                rd_kafka_assignor_ctx_member_subscription(NULL, 0);
+                rd_kafka_assignor_ctx_member_owned(NULL, 0);
+                rd_kafka_assignor_ctx_topic_cnt(NULL);
+                rd_kafka_assignor_ctx_topic(NULL, 0);
+                rd_kafka_assignor_ctx_topic_member_cnt(NULL, 0);
+                rd_kafka_assignor_ctx_topic_member(NULL, 0, 0);
+                rd_kafka_assignor_ctx_partition_rack_cnt(NULL, 0, 0);
+                rd_kafka_assignor_ctx_partition_rack(NULL, 0, 0, 0);
+                rd_kafka_assignor_ctx_assign(NULL, 0, 0, 0);
 
                 /* KafkaConsumer API */
                 rd_kafka_subscribe(NULL, NULL);
@@ -91,6 +91,29 @@ void do_produce_batch(rd_kafka_t *rk,
 
 
 
+/**
+ * @brief Sum of the per-partition rx_aborted_msgs consumer statistics,
+ *        as of the last stats emission.
+ */
+static int64_t rx_aborted_msgs;
+
+static int
+aborted_stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+        const char *field = "\"rx_aborted_msgs\": ";
+        const char *s     = json;
+        int64_t sum       = 0;
+
+        while ((s = strstr(s, field))) {
+                s += strlen(field);
+                sum += strtoll(s, NULL, 10);
+        }
+
+        rx_aborted_msgs = sum;
+
+        return 0;
+}
+
+
 /**
  * @brief Basic producer transaction testing without consumed input
  *        (only consumed output for verification).
@@ -153,6 +176,12 @@ static void do_test_basic_producer_txn(rd_bool_t enable_compression) {
             "expected isolation.level=read_committed, not %s",
             test_conf_get(c_conf, "isolation.level"));
 
+        /* Aborted MessageSets are skipped without being decoded,
+         * which is reflected in the statistics. */
+        rx_aborted_msgs = 0;
+        test_conf_set(c_conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_stats_cb(c_conf, aborted_stats_cb);
+
         c = test_create_consumer(topic, NULL, c_conf, NULL);
 
         /* Wait for topic to propagate to avoid test flakyness */
@@ -242,6 +271,13 @@ static void do_test_basic_producer_txn(rd_bool_t enable_compression) {
                          i, txn[i].desc);
         }
 
+        TEST_SAY("%" PRId64 " aborted message(s) skipped by consumer\n",
+                 rx_aborted_msgs);
+        TEST_ASSERT(rx_aborted_msgs > 0,
+                    "Expected aborted messages to be skipped, "
+                    "rx_aborted_msgs is %" PRId64,
+                    rx_aborted_msgs);
+
         rd_kafka_destroy(p);
 
         test_consumer_close(c);
@@ -3821,6 +3821,106 @@ do_test_txn_offset_commit_doesnt_retry_too_quickly(rd_bool_t times_out) {
 }
 
 
+static mtx_t small_txns_stats_lock;
+static char *small_txns_stats;
+
+static int small_txns_stats_cb(rd_kafka_t *rk,
+                               char *json,
+                               size_t json_len,
+                               void *opaque) {
+        mtx_lock(&small_txns_stats_lock);
+        if (small_txns_stats)
+                rd_free(small_txns_stats);
+        small_txns_stats = rd_strdup(json);
+        mtx_unlock(&small_txns_stats_lock);
+        return 0;
+}
+
+/**
+ * @brief Run a large number of small (single message) transactions
+ *        back to back and verify that the per-state transaction timing
+ *        is exposed in the statistics.
+ *
+ * The throughput is reported to serve as a benchmark of the coordinator
+ * round-trips involved in each transaction.
+ */
+static void do_test_txn_small_txns(void) {
+        rd_kafka_t *rk;
+        rd_kafka_conf_t *conf;
+        rd_kafka_mock_cluster_t *mcluster;
+        const char *txnid = "txnid", *topic = "mytopic";
+        const int txn_cnt = 200;
+        int i;
+        rd_ts_t ts_start, duration;
+        char *stats;
+
+        SUB_TEST();
+
+        mtx_init(&small_txns_stats_lock, mtx_plain);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "transactional.id", txnid);
+        test_conf_set(conf, "test.mock.num.brokers", "3");
+        test_conf_set(conf, "linger.ms", "0");
+        test_conf_set(conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_dr_msg_cb(conf, test_dr_msg_cb);
+        rd_kafka_conf_set_stats_cb(conf, small_txns_stats_cb);
+
+        rk = test_create_handle(RD_KAFKA_PRODUCER, conf);
+
+        mcluster = rd_kafka_handle_mock_cluster(rk);
+        TEST_ASSERT(mcluster, "failed to create mock cluster");
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 3, 1));
+
+        TEST_CALL_ERROR__(rd_kafka_init_transactions(rk, 5000));
+
+        ts_start = test_clock();
+        for (i = 0; i < txn_cnt; i++) {
+                TEST_CALL_ERROR__(rd_kafka_begin_transaction(rk));
+                TEST_CALL_ERR__(rd_kafka_producev(
+                    rk, RD_KAFKA_V_TOPIC(topic), RD_KAFKA_V_PARTITION(i % 3),
+                    RD_KAFKA_V_VALUE("hi", 2), RD_KAFKA_V_END));
+                TEST_CALL_ERROR__(rd_kafka_commit_transaction(rk, 5000));
+        }
+        duration = test_clock() - ts_start;
+
+        TEST_SAY("%d transactions committed in %.3fs: %.1f txns/s\n", txn_cnt,
+                 (double)duration / 1000000.0,
+                 (double)txn_cnt * 1000000.0 / (double)RD_MAX(duration, 1));
+
+        /* Wait for stats to be emitted after the last transaction. */
+        mtx_lock(&small_txns_stats_lock);
+        if (small_txns_stats) {
+                rd_free(small_txns_stats);
+                small_txns_stats = NULL;
+        }
+        mtx_unlock(&small_txns_stats_lock);
+
+        do {
+                rd_kafka_poll(rk, 100);
+                mtx_lock(&small_txns_stats_lock);
+                stats            = small_txns_stats;
+                small_txns_stats = NULL;
+                mtx_unlock(&small_txns_stats_lock);
+        } while (!stats);
+
+        TEST_ASSERT(strstr(stats, "\"txn_state_time\": { \"Init\": "),
+                    "Expected txn_state_time in stats: %s", stats);
+        TEST_ASSERT(strstr(stats, "\"InTransaction\": "),
+                    "Expected InTransaction state time in stats: %s", stats);
+        TEST_ASSERT(!strstr(stats, "\"txn_addparts_cnt\": 0,"),
+                    "Expected txn_addparts_cnt > 0 in stats: %s", stats);
+
+        rd_free(stats);
+
+        rd_kafka_destroy(rk);
+
+        mtx_destroy(&small_txns_stats_lock);
+
+        SUB_TEST_PASS();
+}
+
+
 int main_0105_transactions_mock(int argc, char **argv) {
         if (test_needs_auth()) {
                 TEST_SKIP("Mock cluster does not support SSL/SASL\n");
@@ -3871,6 +3971,8 @@ int main_0105_transactions_mock(int argc, char **argv) {
 
         do_test_txn_addparts_req_multi();
 
+        do_test_txn_small_txns();
+
         do_test_txns_no_timeout_crash();
 
         do_test_txn_auth_failure(
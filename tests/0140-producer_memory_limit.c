@@ -0,0 +1,220 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test.h"
+
+
+/**
+ * @name Verify queue.buffering.max.memory.kbytes: the producer queue limit
+ *       that accounts for the full memory footprint of each message
+ *       (message struct, key, headers and payload) rather than just the
+ *       payload size.
+ */
+
+
+/**
+ * @brief Produce messages with a \p keylen byte key and \p valuelen byte
+ *        value until the queue is full.
+ *
+ * @returns the number of messages successfully enqueued.
+ */
+static int produce_until_full(rd_kafka_t *rk,
+                              const char *topic,
+                              size_t keylen,
+                              size_t valuelen,
+                              rd_bool_t with_headers,
+                              int max_msgs) {
+        static char buf[4096];
+        int cnt;
+
+        TEST_ASSERT(keylen <= sizeof(buf) && valuelen <= sizeof(buf));
+
+        for (cnt = 0; cnt < max_msgs; cnt++) {
+                rd_kafka_resp_err_t err;
+
+                if (with_headers)
+                        err = rd_kafka_producev(
+                            rk, RD_KAFKA_V_TOPIC(topic),
+                            RD_KAFKA_V_PARTITION(0),
+                            RD_KAFKA_V_KEY(keylen ? buf : NULL, keylen),
+                            RD_KAFKA_V_VALUE(valuelen ? buf : NULL, valuelen),
+                            RD_KAFKA_V_HEADER("hdr", buf, 512),
+                            RD_KAFKA_V_END);
+                else
+                        err = rd_kafka_producev(
+                            rk, RD_KAFKA_V_TOPIC(topic),
+                            RD_KAFKA_V_PARTITION(0),
+                            RD_KAFKA_V_KEY(keylen ? buf : NULL, keylen),
+                            RD_KAFKA_V_VALUE(valuelen ? buf : NULL, valuelen),
+                            RD_KAFKA_V_END);
+
+                if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL)
+                        break;
+
+                TEST_ASSERT(!err, "produce failed: %s", rd_kafka_err2str(err));
+        }
+
+        return cnt;
+}
+
+
+static void do_test_memory_limit(const char *what,
+                                 size_t keylen,
+                                 size_t valuelen,
+                                 rd_bool_t with_headers,
+                                 int exp_min,
+                                 int exp_max) {
+        rd_kafka_t *rk;
+        rd_kafka_conf_t *conf;
+        const char *topic = test_mk_topic_name("0140", 0);
+        int cnt;
+
+        SUB_TEST_QUICK("%s", what);
+
+        test_conf_init(&conf, NULL, 30);
+        test_conf_set(conf, "bootstrap.servers", NULL);
+        test_conf_set(conf, "queue.buffering.max.memory.kbytes", "100");
+        /* Make sure the count and payload size limits are not hit first */
+        test_conf_set(conf, "queue.buffering.max.messages", "1000000");
+        test_conf_set(conf, "queue.buffering.max.kbytes", "1000000");
+        rk = test_create_handle(RD_KAFKA_PRODUCER, conf);
+
+        cnt = produce_until_full(rk, topic, keylen, valuelen, with_headers,
+                                 100000);
+        TEST_SAY("%s: %d messages enqueued before QUEUE_FULL\n", what, cnt);
+        TEST_ASSERT(cnt >= exp_min && cnt <= exp_max,
+                    "%s: expected %d..%d messages to be enqueued, not %d",
+                    what, exp_min, exp_max, cnt);
+
+        /* Purging the queue must release the accounted memory. */
+        TEST_CALL_ERR__(rd_kafka_purge(rk, RD_KAFKA_PURGE_F_QUEUE));
+        rd_kafka_poll(rk, 0);
+
+        cnt = produce_until_full(rk, topic, keylen, valuelen, with_headers,
+                                 exp_min);
+        TEST_ASSERT(cnt == exp_min,
+                    "%s: expected %d messages to be enqueued after purge, "
+                    "not %d",
+                    what, exp_min, cnt);
+
+        TEST_CALL_ERR__(rd_kafka_purge(rk, RD_KAFKA_PURGE_F_QUEUE));
+        rd_kafka_destroy(rk);
+
+        SUB_TEST_PASS();
+}
+
+
+static int64_t stats_msg_mem = -1; /**< msg_mem from the last stats */
+
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+        const char *s;
+
+        if ((s = strstr(json, "\"msg_mem\":")))
+                stats_msg_mem = strtoll(s + strlen("\"msg_mem\":"), NULL, 10);
+        return 0;
+}
+
+/**
+ * @brief Verify that the memory accounted for by messages and in-flight
+ *        ProduceRequests is fully released once all messages have been
+ *        delivered.
+ */
+static void do_test_memory_released(void) {
+        rd_kafka_t *rk;
+        rd_kafka_conf_t *conf;
+        rd_kafka_mock_cluster_t *mcluster;
+        const char *bootstraps;
+        const char *topic = test_mk_topic_name("0140", 0);
+        const int msgcnt  = 2000;
+        static char payload[1000];
+        int64_t ts_end;
+        int i;
+
+        SUB_TEST_QUICK();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+
+        test_conf_init(&conf, NULL, 30);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "queue.buffering.max.memory.kbytes", "200");
+        test_conf_set(conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_stats_cb(conf, stats_cb);
+        rk = test_create_handle(RD_KAFKA_PRODUCER, conf);
+
+        /* Only a fraction of the messages fit in the queue at once,
+         * so this relies on memory being released as ProduceRequests
+         * complete. */
+        for (i = 0; i < msgcnt; i++) {
+                rd_kafka_resp_err_t err;
+
+                while ((err = rd_kafka_producev(
+                            rk, RD_KAFKA_V_TOPIC(topic),
+                            RD_KAFKA_V_PARTITION(0),
+                            RD_KAFKA_V_VALUE(payload, sizeof(payload)),
+                            RD_KAFKA_V_END)) ==
+                       RD_KAFKA_RESP_ERR__QUEUE_FULL)
+                        rd_kafka_poll(rk, 10);
+
+                TEST_ASSERT(!err, "produce failed: %s", rd_kafka_err2str(err));
+        }
+        TEST_CALL_ERR__(rd_kafka_flush(rk, tmout_multip(10 * 1000)));
+
+        stats_msg_mem = -1;
+        ts_end        = test_clock() + tmout_multip(10 * 1000) * 1000;
+        while (stats_msg_mem != 0) {
+                if (test_clock() > ts_end)
+                        TEST_FAIL("Expected msg_mem to drop to 0 after all "
+                                  "messages were delivered, last stats "
+                                  "msg_mem is %" PRId64,
+                                  stats_msg_mem);
+                rd_kafka_poll(rk, 100);
+        }
+
+        rd_kafka_destroy(rk);
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0140_producer_memory_limit(int argc, char **argv) {
+        /* Empty messages: only the per-message overhead is accounted for,
+         * which must still be limited. */
+        do_test_memory_limit("empty messages", 0, 0, rd_false, 100, 1000);
+        /* 1 KiB payloads */
+        do_test_memory_limit("value only", 0, 1024, rd_false, 80, 100);
+        /* Keys are accounted for */
+        do_test_memory_limit("key and value", 1024, 1024, rd_false, 40, 50);
+        /* Headers are accounted for */
+        do_test_memory_limit("headers", 0, 1024, rd_true, 50, 67);
+
+        if (!test_needs_auth())
+                do_test_memory_released();
+
+        return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify incremental fetch sessions (KIP-227) against the mock cluster.
+ *
+ * Idle partitions are omitted from incremental Fetch requests and
+ * responses, so this test makes sure the consumer still sees all messages
+ * and exactly one EOF per partition as data trickles in, that paused
+ * partitions are dropped from and re-added to the session, and that
+ * session errors from the broker are recovered from transparently.
+ */
+
+
+static void do_test_fetch_sessions(rd_bool_t enable_sessions) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        const char *topic       = "test";
+        const int partition_cnt = 16;
+        const int msgcnt        = 100;
+        int i;
+
+        SUB_TEST_QUICK("enable.fetch.sessions=%s",
+                       enable_sessions ? "true" : "false");
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        /* Seed every other partition with messages, leave the rest empty */
+        for (i = 0; i < partition_cnt; i += 2)
+                test_produce_msgs_easy_v(topic, 0, i, 0, msgcnt, 10,
+                                         "bootstrap.servers", bootstraps,
+                                         NULL);
+
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.partition.eof", "true");
+        test_conf_set(conf, "fetch.wait.max.ms", "100");
+        test_conf_set(conf, "enable.fetch.sessions",
+                      enable_sessions ? "true" : "false");
+
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        test_consumer_assign_topic("assign", c, topic, partition_cnt,
+                                   RD_KAFKA_OFFSET_BEGINNING);
+
+        test_consumer_poll_exact("initial", c, 0, partition_cnt, 0,
+                                 msgcnt * (partition_cnt / 2), rd_true, NULL);
+
+        /* New data on a single partition: the other partitions are idle
+         * and must not re-emit EOF when they are omitted from the
+         * incremental responses. */
+        test_produce_msgs_easy_v(topic, 0, 3, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+        test_consumer_poll_exact("single partition", c, 0, 1, 0, msgcnt,
+                                 rd_true, NULL);
+
+        /* A paused partition is removed from the session and must be
+         * re-added on resume. */
+        test_consumer_pause_resume_partition(c, topic, 5, rd_true);
+        test_produce_msgs_easy_v(topic, 0, 5, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+        test_consumer_poll_no_msgs("paused", c, 0, 2000);
+        test_consumer_pause_resume_partition(c, topic, 5, rd_false);
+        test_consumer_poll_exact("resumed", c, 0, 1, 0, msgcnt, rd_true,
+                                 NULL);
+
+        /* Session errors must be handled internally by re-establishing
+         * the session, without surfacing to the application or
+         * duplicating messages. */
+        if (enable_sessions)
+                rd_kafka_mock_push_request_errors(
+                    mcluster, 1 /*FetchRequest*/, 2,
+                    RD_KAFKA_RESP_ERR_FETCH_SESSION_ID_NOT_FOUND,
+                    RD_KAFKA_RESP_ERR_INVALID_FETCH_SESSION_EPOCH);
+        test_produce_msgs_easy_v(topic, 0, 1, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+        test_consumer_poll_exact("after session error", c, 0, 1, 0, msgcnt,
+                                 rd_true, NULL);
+
+        test_consumer_poll_no_msgs("idle", c, 0, 2000);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0141_fetch_sessions(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_fetch_sessions(rd_true);
+        do_test_fetch_sessions(rd_false);
+
+        return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify fetch.pipeline.depth: multiple FetchRequests in flight to
+ *       the same broker, each for a disjoint set of partitions.
+ */
+
+
+/**
+ * @brief Track the highest number of FetchRequests already in flight when
+ *        a new FetchRequest was sent, as reported by the fetch debug log.
+ */
+static void
+log_cb(const rd_kafka_t *rk, int level, const char *fac, const char *buf) {
+        rd_atomic32_t *max_inflightp = rd_kafka_opaque(rk);
+        const char *s;
+        int cnt, inflight;
+
+        if (!(s = strstr(buf, "Fetch ")) ||
+            sscanf(s, "Fetch %d/%*d/%*d toppar(s) (%d request(s) in flight)",
+                   &cnt, &inflight) != 2 ||
+            cnt == 0)
+                return;
+
+        if (inflight > rd_atomic32_get(max_inflightp))
+                rd_atomic32_set(max_inflightp, inflight);
+}
+
+
+static void do_test_fetch_pipelining(int depth) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        const char *topic       = "test";
+        const int partition_cnt = 8;
+        const int msgcnt        = 200;
+        uint64_t testid;
+        test_msgver_t mv;
+        rd_atomic32_t max_inflight;
+        char tmp[16];
+        int i;
+
+        SUB_TEST_QUICK("fetch.pipeline.depth=%d", depth);
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        for (i = 0; i < partition_cnt; i++)
+                test_produce_msgs_easy_v(topic, testid, i, i * msgcnt, msgcnt,
+                                         100, "bootstrap.servers", bootstraps,
+                                         "batch.num.messages", "10", NULL);
+
+        /* Make the round-trip long enough for requests to overlap */
+        rd_kafka_mock_broker_set_rtt(mcluster, 1, 50);
+
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.partition.eof", "true");
+        /* Only fetch a couple of batches per partition and request */
+        test_conf_set(conf, "fetch.message.max.bytes", "2000");
+        rd_snprintf(tmp, sizeof(tmp), "%d", depth);
+        test_conf_set(conf, "fetch.pipeline.depth", tmp);
+        test_conf_set(conf, "debug", "fetch");
+        rd_atomic32_init(&max_inflight, 0);
+        rd_kafka_conf_set_log_cb(conf, log_cb);
+        rd_kafka_conf_set_opaque(conf, &max_inflight);
+
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        test_consumer_assign_topic("assign", c, topic, partition_cnt,
+                                   RD_KAFKA_OFFSET_BEGINNING);
+
+        test_msgver_init(&mv, testid);
+        test_consumer_poll_exact("consume", c, testid, partition_cnt, 0,
+                                 msgcnt * partition_cnt, rd_true, &mv);
+
+        /* Every message must be seen exactly once and in order,
+         * regardless of which pipelined request fetched it. */
+        test_msgver_verify("consume", &mv, TEST_MSGVER_ORDER | TEST_MSGVER_DUP,
+                           0, msgcnt * partition_cnt);
+        test_msgver_clear(&mv);
+
+        TEST_SAY("Max FetchRequests in flight when sending: %d\n",
+                 rd_atomic32_get(&max_inflight));
+        if (depth > 1)
+                TEST_ASSERT(rd_atomic32_get(&max_inflight) > 0 &&
+                                rd_atomic32_get(&max_inflight) < depth,
+                            "Expected pipelined FetchRequests, up to %d "
+                            "in flight, not %d",
+                            depth, rd_atomic32_get(&max_inflight));
+        else
+                TEST_ASSERT(rd_atomic32_get(&max_inflight) == 0,
+                            "Expected a single FetchRequest in flight, "
+                            "not %d",
+                            rd_atomic32_get(&max_inflight) + 1);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0142_fetch_pipelining(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_fetch_pipelining(1);
+        do_test_fetch_pipelining(4);
+
+        return 0;
+}
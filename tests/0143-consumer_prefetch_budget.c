@@ -0,0 +1,152 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify queued.max.messages.total.kbytes: the consumer's global
+ *       prefetch budget shared by all partitions.
+ *
+ * The legacy consumer is used since each partition then has its own
+ * fetch queue, limited only by queued.max.messages.kbytes per partition
+ * unless the global budget is set.
+ */
+
+
+static int64_t max_prefetch_size = -1;
+
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+        const char *s;
+        int64_t size;
+
+        /* The first occurrence is the top-level (global) prefetch_size */
+        s = strstr(json, "\"prefetch_size\":");
+        TEST_ASSERT(s, "prefetch_size not found in stats");
+        size = strtoll(s + strlen("\"prefetch_size\":"), NULL, 10);
+
+        if (size > max_prefetch_size)
+                max_prefetch_size = size;
+
+        return 0;
+}
+
+
+int main_0143_consumer_prefetch_budget(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_topic_t *rkt;
+        const char *topic          = "test";
+        const int partition_cnt    = 20;
+        const int msgcnt           = 200;
+        const size_t msgsize       = 1000;
+        const int64_t budget       = 256 * 1024;
+        const int64_t batch_size   = 10 * (msgsize + 100);
+        const int64_t max_expected = budget + partition_cnt * batch_size;
+        test_timing_t t_prefetch;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        for (i = 0; i < partition_cnt; i++)
+                test_produce_msgs_easy_v(topic, 0, i, 0, msgcnt, msgsize,
+                                         "bootstrap.servers", bootstraps,
+                                         "batch.num.messages", "10", NULL);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "queued.max.messages.total.kbytes", "256");
+        test_conf_set(conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_stats_cb(conf, stats_cb);
+
+        c   = test_create_handle(RD_KAFKA_CONSUMER, conf);
+        rkt = test_create_consumer_topic(c, topic);
+
+        for (i = 0; i < partition_cnt; i++)
+                TEST_CALL_ERR__(rd_kafka_consume_start(
+                                    rkt, i, RD_KAFKA_OFFSET_BEGINNING) == -1
+                                    ? rd_kafka_last_error()
+                                    : RD_KAFKA_RESP_ERR_NO_ERROR);
+
+        /* Let the consumer pre-fetch without consuming any messages:
+         * the total amount pre-fetched must stay within the budget,
+         * give or take one batch per partition. */
+        TIMING_START(&t_prefetch, "PREFETCH");
+        while (TIMING_DURATION(&t_prefetch) < 3 * 1000 * 1000)
+                rd_kafka_poll(c, 100);
+        TIMING_STOP(&t_prefetch);
+
+        TEST_SAY("Max prefetch size %" PRId64 " bytes (budget %" PRId64
+                 ", max expected %" PRId64 ", total available %" PRId64
+                 ")\n",
+                 max_prefetch_size, budget, max_expected,
+                 (int64_t)(partition_cnt * msgcnt * msgsize));
+        TEST_ASSERT(max_prefetch_size > 0,
+                    "Expected messages to be pre-fetched");
+        TEST_ASSERT(max_prefetch_size <= max_expected,
+                    "Pre-fetched %" PRId64
+                    " bytes, expected at most %" PRId64,
+                    max_prefetch_size, max_expected);
+
+        /* Consuming and destroying the messages releases the budget
+         * and all messages must eventually be consumed. */
+        for (i = 0; i < partition_cnt; i++) {
+                int cnt = 0;
+
+                while (cnt < msgcnt) {
+                        rd_kafka_message_t *rkm;
+
+                        rkm = rd_kafka_consume(rkt, i, tmout_multip(5000));
+                        TEST_ASSERT(rkm, "Partition %d: timed out after %d/%d "
+                                    "messages", i, cnt, msgcnt);
+                        TEST_ASSERT(!rkm->err, "Partition %d: %s", i,
+                                    rd_kafka_message_errstr(rkm));
+                        cnt++;
+                        rd_kafka_message_destroy(rkm);
+                }
+
+                rd_kafka_consume_stop(rkt, i);
+        }
+
+        rd_kafka_topic_destroy(rkt);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
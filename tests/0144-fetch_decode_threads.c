@@ -0,0 +1,174 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify fetch.decode.threads: MessageSets decoded on the worker pool
+ *       are delivered complete and in per-partition order.
+ */
+
+
+/**
+ * @brief Count the MessageSets decoded on the worker pool,
+ *        as reported by the fetch debug log.
+ */
+static void
+log_cb(const rd_kafka_t *rk, int level, const char *fac, const char *buf) {
+        rd_atomic32_t *decodedp = rd_kafka_opaque(rk);
+        const char *s;
+        int cnt;
+
+        if (!(s = strstr(buf, "Decoded ")) ||
+            sscanf(s, "Decoded %d MessageSet(s) on decode worker pool",
+                   &cnt) != 1)
+                return;
+
+        rd_atomic32_add(decodedp, cnt);
+}
+
+
+static void do_test_fetch_decode_threads(const char *codec, int threads) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *p, *c;
+        const char *topic       = "test";
+        const int partition_cnt = 8;
+        const int msgcnt        = 8;
+        const size_t msgsize    = 100000;
+        char *payload;
+        uint64_t testid;
+        test_msgver_t mv;
+        rd_atomic32_t decoded;
+        char tmp[16];
+        int i;
+
+        SUB_TEST_QUICK("compression.codec=%s, fetch.decode.threads=%d", codec,
+                       threads);
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        /* Random (incompressible) payloads make for MessageSets that are
+         * large enough to be handed to the worker pool also when
+         * compressed. */
+        payload = malloc(msgsize);
+        for (i = 0; i < (int)msgsize; i++)
+                payload[i] = (char)jitter(0, 255);
+
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "compression.codec", codec);
+        test_conf_set(conf, "linger.ms", "100");
+        p = test_create_handle(RD_KAFKA_PRODUCER, conf);
+
+        for (i = 0; i < partition_cnt; i++) {
+                int j;
+                for (j = 0; j < msgcnt; j++) {
+                        rd_kafka_resp_err_t err;
+
+                        /* The message id prefixes the random payload */
+                        test_msg_fmt(payload, 64, testid, i, i * msgcnt + j);
+                        err = rd_kafka_producev(
+                            p, RD_KAFKA_V_TOPIC(topic), RD_KAFKA_V_PARTITION(i),
+                            RD_KAFKA_V_VALUE(payload, msgsize),
+                            RD_KAFKA_V_MSGFLAGS(RD_KAFKA_MSG_F_COPY),
+                            RD_KAFKA_V_END);
+                        TEST_ASSERT(!err, "producev() failed: %s",
+                                    rd_kafka_err2str(err));
+                }
+        }
+
+        TEST_CALL_ERR__(rd_kafka_flush(p, tmout_multip(10 * 1000)));
+        rd_kafka_destroy(p);
+        free(payload);
+
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.partition.eof", "true");
+        rd_snprintf(tmp, sizeof(tmp), "%d", threads);
+        test_conf_set(conf, "fetch.decode.threads", tmp);
+        test_conf_set(conf, "debug", "fetch");
+        rd_atomic32_init(&decoded, 0);
+        rd_kafka_conf_set_log_cb(conf, log_cb);
+        rd_kafka_conf_set_opaque(conf, &decoded);
+
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        test_consumer_assign_topic("assign", c, topic, partition_cnt,
+                                   RD_KAFKA_OFFSET_BEGINNING);
+
+        test_msgver_init(&mv, testid);
+        test_consumer_poll_exact("consume", c, testid, partition_cnt, 0,
+                                 msgcnt * partition_cnt, rd_true, &mv);
+
+        /* Every message must be seen exactly once and in order,
+         * regardless of which thread decoded it. */
+        test_msgver_verify("consume", &mv, TEST_MSGVER_ORDER | TEST_MSGVER_DUP,
+                           0, msgcnt * partition_cnt);
+        test_msgver_clear(&mv);
+
+        TEST_SAY("%d MessageSet(s) decoded on worker pool\n",
+                 rd_atomic32_get(&decoded));
+        if (threads > 0)
+                TEST_ASSERT(rd_atomic32_get(&decoded) > 0,
+                            "Expected MessageSets to be decoded on the "
+                            "worker pool");
+        else
+                TEST_ASSERT(rd_atomic32_get(&decoded) == 0,
+                            "Expected no worker pool, not %d decoded "
+                            "MessageSet(s)",
+                            rd_atomic32_get(&decoded));
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0144_fetch_decode_threads(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_fetch_decode_threads("none", 0);
+        do_test_fetch_decode_threads("none", 4);
+        do_test_fetch_decode_threads("lz4", 4);
+
+        return 0;
+}
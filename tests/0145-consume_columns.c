@@ -0,0 +1,192 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify rd_kafka_consume_columns_queue(): the column arrays must
+ *       hold the produced messages and all messages must be delivered
+ *       in order.
+ */
+
+
+int main_0145_consume_columns(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_queue_t *rkqu;
+        rd_kafka_message_columns_t *cols;
+        const char *topic       = "test";
+        const int partition_cnt = 3;
+        const int msgcnt        = 500;
+        const size_t col_size   = 64;
+        uint64_t testid;
+        test_msgver_t mv;
+        int consumed = 0, batches = 0;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        for (i = 0; i < partition_cnt; i++)
+                test_produce_msgs_easy_v(topic, testid, i, i * msgcnt, msgcnt,
+                                         100, "bootstrap.servers", bootstraps,
+                                         "batch.num.messages", "50", NULL);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        test_consumer_subscribe(c, topic);
+
+        rkqu = rd_kafka_queue_get_consumer(c);
+        cols = rd_kafka_message_columns_new(col_size);
+        TEST_ASSERT(rd_kafka_message_columns_cnt(cols) == 0,
+                    "Expected empty columns, not %" PRIusz " rows",
+                    rd_kafka_message_columns_cnt(cols));
+
+        test_msgver_init(&mv, testid);
+
+        while (consumed < partition_cnt * msgcnt) {
+                const rd_kafka_resp_err_t *err;
+                rd_kafka_topic_t *const *rkt;
+                const int32_t *partition;
+                const int64_t *offset, *timestamp;
+                const void *const *key, *const *payload;
+                const size_t *key_len, *len;
+                ssize_t cnt;
+                size_t r;
+
+                cnt = rd_kafka_consume_columns_queue(rkqu, 1000, cols);
+                TEST_ASSERT(cnt >= 0, "consume_columns failed: %s",
+                            rd_kafka_err2str(rd_kafka_last_error()));
+                TEST_ASSERT((size_t)cnt == rd_kafka_message_columns_cnt(cols) &&
+                                (size_t)cnt <= col_size,
+                            "Expected %" PRIdsz " rows, not %" PRIusz
+                            " (size %" PRIusz ")",
+                            cnt, rd_kafka_message_columns_cnt(cols), col_size);
+
+                if (cnt > 0)
+                        batches++;
+
+                err       = rd_kafka_message_columns_err(cols);
+                rkt       = rd_kafka_message_columns_topic(cols);
+                partition = rd_kafka_message_columns_partition(cols);
+                offset    = rd_kafka_message_columns_offset(cols);
+                timestamp = rd_kafka_message_columns_timestamp(cols);
+                key       = rd_kafka_message_columns_key(cols);
+                key_len   = rd_kafka_message_columns_key_len(cols);
+                payload   = rd_kafka_message_columns_payload(cols);
+                len       = rd_kafka_message_columns_len(cols);
+
+                for (r = 0; r < (size_t)cnt; r++) {
+                        rd_kafka_headers_t *hdrs;
+                        char buf[128];
+                        uint64_t in_testid;
+                        int in_part, in_msgnum;
+
+                        if (err[r]) {
+                                TEST_SAY("Consumer event: %.*s\n", (int)len[r],
+                                         (const char *)payload[r]);
+                                continue;
+                        }
+
+                        TEST_ASSERT(!strcmp(rd_kafka_topic_name(rkt[r]),
+                                            topic),
+                                    "Row %" PRIusz ": unexpected topic %s", r,
+                                    rd_kafka_topic_name(rkt[r]));
+                        TEST_ASSERT(timestamp[r] > 0,
+                                    "Row %" PRIusz
+                                    ": expected message timestamp, "
+                                    "not %" PRId64,
+                                    r, timestamp[r]);
+                        TEST_ASSERT(key[r] && key_len[r] > 0,
+                                    "Row %" PRIusz ": expected key", r);
+                        TEST_ASSERT(rd_kafka_message_columns_headers(
+                                        cols, r, &hdrs) ==
+                                        RD_KAFKA_RESP_ERR__NOENT,
+                                    "Row %" PRIusz ": expected no headers", r);
+
+                        rd_snprintf(buf, sizeof(buf), "%.*s", (int)len[r],
+                                    (const char *)payload[r]);
+                        TEST_ASSERT(sscanf(buf,
+                                           "testid=%" SCNu64
+                                           ", partition=%i, msg=%i\n",
+                                           &in_testid, &in_part,
+                                           &in_msgnum) == 3,
+                                    "Row %" PRIusz
+                                    ": incorrect payload at offset %" PRId64
+                                    ": %s",
+                                    r, offset[r], buf);
+                        TEST_ASSERT(in_part == (int)partition[r],
+                                    "Row %" PRIusz
+                                    ": expected partition %d, not %" PRId32,
+                                    r, in_part, partition[r]);
+
+                        test_msgver_add_msg00(
+                            __FUNCTION__, __LINE__, rd_kafka_name(c), &mv,
+                            in_testid, rd_kafka_topic_name(rkt[r]),
+                            partition[r], offset[r], timestamp[r], -1,
+                            err[r], in_msgnum);
+                        consumed++;
+                }
+        }
+
+        TEST_SAY("Consumed %d messages in %d column batch(es)\n", consumed,
+                 batches);
+
+        test_msgver_verify("consume", &mv, TEST_MSGVER_ORDER | TEST_MSGVER_DUP,
+                           0, partition_cnt * msgcnt);
+        test_msgver_clear(&mv);
+
+        rd_kafka_message_columns_clear(cols);
+        TEST_ASSERT(rd_kafka_message_columns_cnt(cols) == 0,
+                    "Expected no rows after clear");
+        rd_kafka_message_columns_destroy(cols);
+
+        rd_kafka_queue_destroy(rkqu);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
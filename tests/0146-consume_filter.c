@@ -0,0 +1,202 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify the consume filter callback: only messages accepted by the
+ *       filter are returned to the application, and the consumer position
+ *       and committed offset advance past the dropped messages, including
+ *       dropped messages at the end of the partition.
+ */
+
+
+static int filter_calls;
+
+static int filter_cb(rd_kafka_t *rk,
+                     const rd_kafka_message_t *rkmessage,
+                     void *opaque) {
+        const void *value;
+        size_t size;
+
+        filter_calls++;
+
+        TEST_ASSERT(rd_kafka_message_timestamp(rkmessage, NULL) > 0,
+                    "Expected message timestamp at offset %" PRId64,
+                    rkmessage->offset);
+        TEST_ASSERT(rkmessage->key && rkmessage->key_len > 0,
+                    "Expected message key at offset %" PRId64,
+                    rkmessage->offset);
+
+        return !rd_kafka_message_header_peek(rkmessage, "keep", &value, &size);
+}
+
+
+int main_0146_consume_filter(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *p, *c;
+        rd_kafka_topic_partition_list_t *offsets;
+        const char *topic  = "test";
+        const int msgcnt   = 100;
+        const int tail_cnt = 10;
+        int exp_cnt        = 0;
+        int consumed       = 0;
+        int64_t position   = -1;
+        test_timing_t t_position;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 1, 1));
+
+        /* Every third message, except for the last tail_cnt messages,
+         * has the "keep" header. */
+        test_conf_init(&conf, NULL, 30);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "batch.num.messages", "20");
+        p = test_create_handle(RD_KAFKA_PRODUCER, conf);
+
+        for (i = 0; i < msgcnt; i++) {
+                char key[16];
+                rd_kafka_headers_t *hdrs = rd_kafka_headers_new(1);
+                rd_kafka_resp_err_t err;
+
+                rd_snprintf(key, sizeof(key), "%d", i);
+                if (i % 3 == 0 && i < msgcnt - tail_cnt) {
+                        rd_kafka_header_add(hdrs, "keep", -1, "yes", -1);
+                        exp_cnt++;
+                }
+
+                err = rd_kafka_producev(
+                    p, RD_KAFKA_V_TOPIC(topic), RD_KAFKA_V_PARTITION(0),
+                    RD_KAFKA_V_KEY(key, strlen(key)),
+                    RD_KAFKA_V_VALUE("value", 5), RD_KAFKA_V_HEADERS(hdrs),
+                    RD_KAFKA_V_END);
+                TEST_ASSERT(!err, "producev() failed: %s",
+                            rd_kafka_err2str(err));
+        }
+
+        test_flush(p, 10 * 1000);
+        rd_kafka_destroy(p);
+
+        test_conf_init(&conf, NULL, 30);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit", "false");
+        rd_kafka_conf_set_consume_filter_cb(conf, filter_cb);
+
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        test_consumer_subscribe(c, topic);
+
+        while (consumed < exp_cnt) {
+                rd_kafka_message_t *rkmessage;
+                rd_kafka_headers_t *hdrs;
+                char key[16];
+                rd_bool_t exp_kept;
+                int msgid;
+
+                rkmessage = rd_kafka_consumer_poll(c, 1000);
+                if (!rkmessage)
+                        continue;
+
+                TEST_ASSERT(!rkmessage->err, "Unexpected consumer error: %s",
+                            rd_kafka_message_errstr(rkmessage));
+                TEST_ASSERT(!rd_kafka_message_headers(rkmessage, &hdrs) &&
+                                rd_kafka_header_cnt(hdrs) == 1,
+                            "Expected the keep header at offset %" PRId64,
+                            rkmessage->offset);
+
+                TEST_ASSERT(rkmessage->key_len < sizeof(key),
+                            "Unexpected key length %" PRIusz,
+                            rkmessage->key_len);
+                memcpy(key, rkmessage->key, rkmessage->key_len);
+                key[rkmessage->key_len] = '\0';
+                msgid                   = atoi(key);
+                exp_kept = msgid % 3 == 0 && msgid < msgcnt - tail_cnt &&
+                           rkmessage->offset == (int64_t)msgid;
+                TEST_ASSERT(exp_kept,
+                            "Unexpected message %d at offset %" PRId64
+                            " passed the filter",
+                            msgid, rkmessage->offset);
+
+                rd_kafka_message_destroy(rkmessage);
+                consumed++;
+        }
+
+        /* The position must advance past the filtered tail */
+        offsets = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(offsets, topic, 0);
+
+        TIMING_START(&t_position, "position");
+        while (position != msgcnt) {
+                rd_kafka_message_t *rkmessage;
+
+                TEST_ASSERT(TIMING_DURATION(&t_position) < 10 * 1000 * 1000,
+                            "Position did not reach %d, still at %" PRId64,
+                            msgcnt, position);
+
+                rkmessage = rd_kafka_consumer_poll(c, 100);
+                TEST_ASSERT(!rkmessage, "Unexpected message at offset %" PRId64,
+                            rkmessage->offset);
+
+                TEST_CALL_ERR__(rd_kafka_position(c, offsets));
+                position = offsets->elems[0].offset;
+        }
+        TIMING_STOP(&t_position);
+
+        TEST_SAY("Consumed %d messages, filter called %d times\n", consumed,
+                 filter_calls);
+        TEST_ASSERT(filter_calls >= msgcnt,
+                    "Expected filter to be called at least %d times, not %d",
+                    msgcnt, filter_calls);
+
+        TEST_CALL_ERR__(rd_kafka_commit(c, NULL, 0 /*sync*/));
+
+        offsets->elems[0].offset = -1;
+        TEST_CALL_ERR__(rd_kafka_committed(c, offsets, tmout_multip(5000)));
+        TEST_ASSERT(offsets->elems[0].offset == msgcnt,
+                    "Expected committed offset %d, not %" PRId64, msgcnt,
+                    offsets->elems[0].offset);
+
+        rd_kafka_topic_partition_list_destroy(offsets);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Client-side replica selection (fetch.replica.selection=client)
+ *       using the mock cluster.
+ *
+ * The mock cluster returns all replicas as in-sync replicas.
+ */
+
+
+static int64_t leader_fetch_cnt = -1; /**< Fetch requests sent to leader */
+static int32_t partition_broker = -1; /**< Broker partition 0 is fetched
+                                       *   from */
+
+/**
+ * @brief Extract the number of Fetch requests sent to broker 1 (the leader)
+ *        and the broker partition 0 is currently fetched from.
+ */
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+        const char *s;
+
+        if ((s = strstr(json, "\"nodeid\":1,")) &&
+            (s = strstr(s, "\"Fetch\": ")))
+                leader_fetch_cnt = strtoll(s + strlen("\"Fetch\": "), NULL, 10);
+
+        if ((s = strstr(json, "\"partition\":0, \"broker\":")))
+                partition_broker = (int32_t)strtol(
+                    s + strlen("\"partition\":0, \"broker\":"), NULL, 10);
+
+        return 0;
+}
+
+
+static rd_kafka_t *create_consumer(const char *bootstraps,
+                                   const char *topic,
+                                   const char *client_rack) {
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "client.rack", client_rack);
+        test_conf_set(conf, "fetch.replica.selection", "client");
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit", "false");
+        test_conf_set(conf, "topic.metadata.refresh.interval.ms", "60000");
+        test_conf_set(conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_stats_cb(conf, stats_cb);
+
+        c = test_create_consumer("mygroup", NULL, conf, NULL);
+        test_consumer_assign_partition("assign", c, topic, 0,
+                                       RD_KAFKA_OFFSET_INVALID);
+
+        return c;
+}
+
+
+/**
+ * @brief The replica in the client's rack must be selected without
+ *        fetching from the leader first.
+ */
+static void do_test_rack_replica(void) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        const char *topic = "test";
+        const int msgcnt  = 1000;
+
+        SUB_TEST_QUICK();
+
+        mcluster = test_mock_cluster_new(3, &bootstraps);
+        rd_kafka_mock_broker_set_rack(mcluster, 1, "rack1");
+        rd_kafka_mock_broker_set_rack(mcluster, 2, "rack2");
+        rd_kafka_mock_broker_set_rack(mcluster, 3, "rack3");
+
+        test_produce_msgs_easy_v(topic, 0, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps,
+                                 "batch.num.messages", "10", NULL);
+
+        /* Leader is broker 1, broker 3 accepts fetches as follower. */
+        rd_kafka_mock_partition_set_leader(mcluster, topic, 0, 1);
+        rd_kafka_mock_partition_set_follower(mcluster, topic, 0, 3);
+
+        leader_fetch_cnt = -1;
+        partition_broker = -1;
+
+        c = create_consumer(bootstraps, topic, "rack3");
+
+        test_consumer_poll("Consume", c, 0, 0, 0, msgcnt, NULL);
+
+        /* Wait for up-to-date statistics */
+        partition_broker = -1;
+        while (partition_broker == -1)
+                test_consumer_poll_no_msgs("Wait for stats", c, 0, 200);
+
+        TEST_ASSERT(partition_broker == 3,
+                    "Expected partition to be fetched from broker 3, "
+                    "not %" PRId32,
+                    partition_broker);
+        TEST_ASSERT(leader_fetch_cnt == 0,
+                    "Expected no Fetch requests to the leader, not %" PRId64,
+                    leader_fetch_cnt);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+/**
+ * @brief When the selected replica fails the consumer must revert to
+ *        the leader.
+ */
+static void do_test_revert_to_leader(void) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        const char *topic = "test";
+        const int msgcnt  = 1000;
+
+        SUB_TEST_QUICK();
+
+        mcluster = test_mock_cluster_new(3, &bootstraps);
+        rd_kafka_mock_broker_set_rack(mcluster, 1, "rack1");
+        rd_kafka_mock_broker_set_rack(mcluster, 2, "rack2");
+        rd_kafka_mock_broker_set_rack(mcluster, 3, "rack3");
+
+        test_produce_msgs_easy_v(topic, 0, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps,
+                                 "batch.num.messages", "10", NULL);
+
+        /* Leader is broker 1. Broker 3 is not set up as follower and
+         * fails all fetches with NOT_LEADER_OR_FOLLOWER. */
+        rd_kafka_mock_partition_set_leader(mcluster, topic, 0, 1);
+
+        leader_fetch_cnt = -1;
+        partition_broker = -1;
+
+        c = create_consumer(bootstraps, topic, "rack3");
+
+        test_consumer_poll("Consume", c, 0, 0, 0, msgcnt, NULL);
+
+        partition_broker = -1;
+        while (partition_broker == -1)
+                test_consumer_poll_no_msgs("Wait for stats", c, 0, 200);
+
+        TEST_ASSERT(partition_broker == 1,
+                    "Expected partition to be fetched from leader, "
+                    "not broker %" PRId32,
+                    partition_broker);
+        TEST_ASSERT(leader_fetch_cnt > 0,
+                    "Expected Fetch requests to the leader");
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0147_fetch_replica_selection(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_rack_replica();
+
+        do_test_revert_to_leader();
+
+        return 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test.h"
+
+
+/**
+ * @name Verify fetch.scheduling: fetch.max.bytes is divided between the
+ *       partitions in proportion to their consumer lag or fetch priority,
+ *       and the FetchRequest starts with the partition with the highest
+ *       weight.
+ */
+
+
+#define FETCH_MAX_BYTES     8192
+#define PARTITION_MAX_BYTES 1024
+#define MAX_REQUESTS        256
+
+/** A FetchRequest for partitions 0 and 1, as seen in the fetch debug log */
+typedef struct fetch_request_s {
+        int first;             /**< First partition in the request */
+        int64_t offset[2];     /**< FetchOffset per partition, or -1 */
+        int32_t max_bytes[2];  /**< MaxBytes per partition, or -1 */
+} fetch_request_t;
+
+static struct {
+        fetch_request_t cur;
+        fetch_request_t reqs[MAX_REQUESTS];
+        int cnt;
+} state;
+
+
+static void fetch_request_reset(fetch_request_t *req) {
+        req->first        = -1;
+        req->offset[0]    = req->offset[1]    = -1;
+        req->max_bytes[0] = req->max_bytes[1] = -1;
+}
+
+
+/**
+ * @brief Collect the partitions, offsets and MaxBytes of each FetchRequest
+ *        from the fetch debug log.
+ *
+ * The per-partition lines are logged while the request is built and are
+ * followed by a summary line.
+ */
+static void
+log_cb(const rd_kafka_t *rk, int level, const char *fac, const char *buf) {
+        const char *s;
+        int partition, cnt;
+        int64_t offset;
+        int32_t max_bytes;
+
+        if ((s = strstr(buf, "Fetch topic ")) &&
+            sscanf(s, "Fetch topic %*s [%d] at offset %" SCNd64, &partition,
+                   &offset) == 2 &&
+            (s = strstr(s, "MaxBytes ")) &&
+            sscanf(s, "MaxBytes %" SCNd32, &max_bytes) == 1) {
+                if (partition < 0 || partition > 1)
+                        return;
+                if (state.cur.first == -1)
+                        state.cur.first = partition;
+                state.cur.offset[partition]    = offset;
+                state.cur.max_bytes[partition] = max_bytes;
+
+        } else if ((s = strstr(buf, "Fetch ")) &&
+                   sscanf(s, "Fetch %d/%*d/%*d toppar(s)", &cnt) == 1) {
+                if (cnt > 0 && state.cur.first != -1 &&
+                    state.cnt < MAX_REQUESTS)
+                        state.reqs[state.cnt++] = state.cur;
+                fetch_request_reset(&state.cur);
+        }
+}
+
+
+static rd_kafka_t *create_consumer(const char *bootstraps,
+                                   const char *scheduling) {
+        rd_kafka_conf_t *conf;
+
+        memset(&state, 0, sizeof(state));
+        fetch_request_reset(&state.cur);
+
+        test_conf_init(&conf, NULL, 30);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "fetch.scheduling", scheduling);
+        test_conf_set(conf, "message.max.bytes", "1000");
+        test_conf_set(conf, "fetch.max.bytes", "8192" /*FETCH_MAX_BYTES*/);
+        test_conf_set(conf, "fetch.message.max.bytes",
+                      "1024" /*PARTITION_MAX_BYTES*/);
+        test_conf_set(conf, "fetch.wait.max.ms", "100");
+        /* Log every partition of every request */
+        test_conf_set(conf, "enable.fetch.sessions", "false");
+        test_conf_set(conf, "debug", "fetch");
+        rd_kafka_conf_set_log_cb(conf, log_cb);
+
+        return test_create_consumer("mygroup", NULL, conf, NULL);
+}
+
+
+static void assign_both(rd_kafka_t *c, const char *topic) {
+        rd_kafka_topic_partition_list_t *parts;
+
+        parts = rd_kafka_topic_partition_list_new(2);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset =
+            RD_KAFKA_OFFSET_BEGINNING;
+        rd_kafka_topic_partition_list_add(parts, topic, 1)->offset =
+            RD_KAFKA_OFFSET_BEGINNING;
+        TEST_CALL_ERR__(rd_kafka_assign(c, parts));
+        rd_kafka_topic_partition_list_destroy(parts);
+}
+
+
+/**
+ * @brief Partition 0 has a backlog while partition 1 is idle:
+ *        with fetch.scheduling=lag partition 0 must be fetched first and
+ *        be given the larger share of fetch.max.bytes while it catches up.
+ */
+static void do_test_lag(void) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        const char *topic = "test";
+        const int msgcnt  = 100;
+        uint64_t testid;
+        int i, checked = 0;
+
+        SUB_TEST_QUICK();
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 2, 1));
+
+        test_produce_msgs_easy_v(topic, testid, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps,
+                                 "batch.num.messages", "10", NULL);
+
+        c = create_consumer(bootstraps, "lag");
+        assign_both(c, topic);
+
+        test_consumer_poll("consume", c, testid, -1, 0, msgcnt, NULL);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        /* The weights are only known once a response has been received,
+         * check the requests where partition 0 lags by at least half of
+         * the messages, which gives it more than half of
+         * fetch.max.bytes. */
+        for (i = 0; i < state.cnt; i++) {
+                const fetch_request_t *req = &state.reqs[i];
+
+                if (req->offset[0] <= 0 || req->offset[0] > msgcnt / 2 ||
+                    req->max_bytes[1] == -1)
+                        continue;
+
+                TEST_SAY("Request #%d: first partition %d, MaxBytes %" PRId32
+                         " at offset %" PRId64 " and %" PRId32 "\n",
+                         i, req->first, req->max_bytes[0], req->offset[0],
+                         req->max_bytes[1]);
+                TEST_ASSERT(req->first == 0,
+                            "Expected request to start with the lagging "
+                            "partition 0, not %d",
+                            req->first);
+                TEST_ASSERT(req->max_bytes[0] == FETCH_MAX_BYTES / 2 &&
+                                req->max_bytes[1] == PARTITION_MAX_BYTES,
+                            "Expected MaxBytes %d for lagging partition 0 "
+                            "and %d for idle partition 1, not %" PRId32
+                            " and %" PRId32,
+                            FETCH_MAX_BYTES / 2, PARTITION_MAX_BYTES,
+                            req->max_bytes[0], req->max_bytes[1]);
+                checked++;
+        }
+
+        TEST_ASSERT(checked > 0,
+                    "No FetchRequest seen while partition 0 was lagging "
+                    "(%d requests)",
+                    state.cnt);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+/**
+ * @brief Partition 1 has a higher fetch priority than partition 0:
+ *        with fetch.scheduling=priority it must be fetched first and be
+ *        given the larger share of fetch.max.bytes, while the priority
+ *        has no effect with round-robin scheduling.
+ */
+static void do_test_priority(const char *scheduling) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        const char *topic = "test";
+        rd_bool_t weighted = !strcmp(scheduling, "priority");
+        int i, checked = 0;
+
+        SUB_TEST_QUICK("%s", scheduling);
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 2, 1));
+
+        c = create_consumer(bootstraps, scheduling);
+
+        TEST_ASSERT(rd_kafka_fetch_priority_set(c, topic, 1, 7) ==
+                        RD_KAFKA_RESP_ERR__UNKNOWN_PARTITION,
+                    "Expected unknown partition before assign");
+
+        assign_both(c, topic);
+
+        TEST_ASSERT(rd_kafka_fetch_priority_set(c, topic, 1, 0) ==
+                        RD_KAFKA_RESP_ERR__INVALID_ARG,
+                    "Expected priority 0 to be rejected");
+        TEST_ASSERT(rd_kafka_fetch_priority_set(c, topic, 1, 1001) ==
+                        RD_KAFKA_RESP_ERR__INVALID_ARG,
+                    "Expected priority 1001 to be rejected");
+        TEST_ASSERT(rd_kafka_fetch_priority_set(c, topic, 2, 7) ==
+                        RD_KAFKA_RESP_ERR__UNKNOWN_PARTITION,
+                    "Expected unknown partition");
+        TEST_CALL_ERR__(rd_kafka_fetch_priority_set(c, topic, 1, 7));
+
+        test_consumer_poll_no_msgs("idle", c, 0, 2000);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        for (i = 0; i < state.cnt; i++) {
+                const fetch_request_t *req = &state.reqs[i];
+
+                if (req->max_bytes[0] == -1 || req->max_bytes[1] == -1)
+                        continue;
+
+                if (weighted) {
+                        /* Priorities 1 and 7 give shares of 1/8 and 7/8
+                         * of fetch.max.bytes, rounded down to a
+                         * power-of-two multiple of
+                         * fetch.message.max.bytes. */
+                        TEST_ASSERT(req->first == 1,
+                                    "Expected request to start with the "
+                                    "prioritized partition 1, not %d",
+                                    req->first);
+                        TEST_ASSERT(
+                            req->max_bytes[0] == PARTITION_MAX_BYTES &&
+                                req->max_bytes[1] == FETCH_MAX_BYTES / 2,
+                            "Expected MaxBytes %d and %d, not %" PRId32
+                            " and %" PRId32,
+                            PARTITION_MAX_BYTES, FETCH_MAX_BYTES / 2,
+                            req->max_bytes[0], req->max_bytes[1]);
+                } else {
+                        TEST_ASSERT(
+                            req->max_bytes[0] == PARTITION_MAX_BYTES &&
+                                req->max_bytes[1] == PARTITION_MAX_BYTES,
+                            "Expected MaxBytes %d for both partitions, "
+                            "not %" PRId32 " and %" PRId32,
+                            PARTITION_MAX_BYTES, req->max_bytes[0],
+                            req->max_bytes[1]);
+                }
+                checked++;
+        }
+
+        TEST_SAY("Checked %d/%d FetchRequests\n", checked, state.cnt);
+        TEST_ASSERT(checked >= 3,
+                    "Expected at least 3 FetchRequests for both partitions, "
+                    "not %d",
+                    checked);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0148_fetch_scheduling(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_lag();
+        do_test_priority("priority");
+        do_test_priority("round-robin");
+
+        return 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+#include "../src/rdkafka_proto.h"
+
+
+/**
+ * @name Verify the consumer group protocol (KIP-848, group.protocol=consumer)
+ *       against the mock cluster: the coordinator's target assignment is
+ *       reconciled incrementally as members join and leave, and an unknown
+ *       server side assignor is reported to the application.
+ */
+
+
+static rd_kafka_t *create_consumer(const char *bootstraps,
+                                   const char *group_id,
+                                   const char *remote_assignor,
+                                   rd_bool_t auto_commit) {
+        rd_kafka_conf_t *conf;
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "group.protocol", "consumer");
+        if (remote_assignor)
+                test_conf_set(conf, "group.remote.assignor", remote_assignor);
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit",
+                      auto_commit ? "true" : "false");
+
+        return test_create_consumer(group_id, NULL, conf, NULL);
+}
+
+
+static rd_kafka_topic_partition_list_t *assignment_get(rd_kafka_t *c) {
+        rd_kafka_topic_partition_list_t *parts;
+
+        TEST_CALL_ERR__(rd_kafka_assignment(c, &parts));
+        return parts;
+}
+
+
+/**
+ * @brief Poll the consumers in \p c until their assignments have
+ *        \p exp_cnt partitions each, counting consumed messages
+ *        in \p msgcntp.
+ */
+static void wait_assignment(rd_kafka_t **c,
+                            int c_cnt,
+                            const int *exp_cnt,
+                            int *msgcntp) {
+        int64_t abs_timeout = test_clock() + tmout_multip(30 * 1000) * 1000;
+
+        while (1) {
+                rd_bool_t done = rd_true;
+                int i;
+
+                for (i = 0; i < c_cnt; i++) {
+                        rd_kafka_message_t *rkm;
+                        rd_kafka_topic_partition_list_t *parts;
+
+                        if ((rkm = rd_kafka_consumer_poll(c[i], 100))) {
+                                TEST_ASSERT(!rkm->err,
+                                            "%s: unexpected consumer error: "
+                                            "%s",
+                                            rd_kafka_name(c[i]),
+                                            rd_kafka_message_errstr(rkm));
+                                (*msgcntp)++;
+                                rd_kafka_message_destroy(rkm);
+                        }
+
+                        parts = assignment_get(c[i]);
+                        if (parts->cnt != exp_cnt[i])
+                                done = rd_false;
+                        rd_kafka_topic_partition_list_destroy(parts);
+                }
+
+                if (done)
+                        break;
+
+                TEST_ASSERT(test_clock() < abs_timeout,
+                            "Timed out waiting for expected assignment");
+        }
+}
+
+
+/**
+ * @brief Two members share the partitions without overlap, and the
+ *        remaining member takes over all partitions once the other
+ *        member leaves.
+ */
+static void do_test_join_leave(const char *remote_assignor) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c[2];
+        rd_kafka_topic_partition_list_t *parts[2];
+        const char *topic = "test";
+        const int msgcnt  = 100;
+        int consumed      = 0;
+        uint64_t testid;
+        int i;
+
+        SUB_TEST_QUICK("remote assignor %s",
+                       remote_assignor ? remote_assignor : "(default)");
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(3, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 4, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_set_group_consumer_heartbeat_interval_ms(mcluster,
+                                                                   500));
+
+        test_produce_msgs_easy_v(topic, testid, RD_KAFKA_PARTITION_UA, 0,
+                                 msgcnt, 10, "bootstrap.servers", bootstraps,
+                                 NULL);
+
+        c[0] = create_consumer(bootstraps, topic, remote_assignor, rd_true);
+        test_consumer_subscribe(c[0], topic);
+        wait_assignment(c, 1, (const int[]) {4}, &consumed);
+        TEST_SAY("First member assigned all 4 partitions\n");
+
+        c[1] = create_consumer(bootstraps, topic, remote_assignor, rd_true);
+        test_consumer_subscribe(c[1], topic);
+        wait_assignment(c, 2, (const int[]) {2, 2}, &consumed);
+        TEST_SAY("Both members assigned 2 partitions\n");
+
+        parts[0] = assignment_get(c[0]);
+        parts[1] = assignment_get(c[1]);
+        for (i = 0; i < parts[0]->cnt; i++)
+                TEST_ASSERT(!rd_kafka_topic_partition_list_find(
+                                parts[1], parts[0]->elems[i].topic,
+                                parts[0]->elems[i].partition),
+                            "Partition %s [%" PRId32
+                            "] assigned to both members",
+                            parts[0]->elems[i].topic,
+                            parts[0]->elems[i].partition);
+        rd_kafka_topic_partition_list_destroy(parts[0]);
+        rd_kafka_topic_partition_list_destroy(parts[1]);
+
+        test_consumer_close(c[1]);
+        rd_kafka_destroy(c[1]);
+
+        wait_assignment(c, 1, (const int[]) {4}, &consumed);
+        TEST_SAY("Remaining member assigned all 4 partitions\n");
+
+        while (consumed < msgcnt)
+                wait_assignment(c, 1, (const int[]) {4}, &consumed);
+
+        test_consumer_close(c[0]);
+        rd_kafka_destroy(c[0]);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+/**
+ * @brief An unknown group.remote.assignor is reported to the application
+ *        as UNSUPPORTED_ASSIGNOR.
+ */
+static void do_test_unsupported_assignor(void) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        const char *topic  = "test";
+        rd_kafka_resp_err_t err = RD_KAFKA_RESP_ERR_NO_ERROR;
+        int64_t abs_timeout;
+
+        SUB_TEST_QUICK();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 2, 1));
+
+        c = create_consumer(bootstraps, topic, "doesnotexist", rd_true);
+        test_consumer_subscribe(c, topic);
+
+        abs_timeout = test_clock() + tmout_multip(10 * 1000) * 1000;
+        while (!err && test_clock() < abs_timeout) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c, 100);
+                if (!rkm)
+                        continue;
+                err = rkm->err;
+                TEST_SAY("Consumer error: %s\n", rd_kafka_message_errstr(rkm));
+                rd_kafka_message_destroy(rkm);
+        }
+
+        TEST_ASSERT(err == RD_KAFKA_RESP_ERR_UNSUPPORTED_ASSIGNOR,
+                    "Expected UNSUPPORTED_ASSIGNOR, not %s",
+                    rd_kafka_err2name(err));
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+/**
+ * @brief Offsets are committed with OffsetCommit v9 and the member epoch,
+ *        and commits are refused if the coordinator does not support v9.
+ */
+static void do_test_commit(rd_bool_t with_v9) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c;
+        rd_kafka_topic_partition_list_t *offsets;
+        const char *topic = "test";
+        const int msgcnt  = 20;
+        int consumed      = 0;
+        rd_kafka_resp_err_t err, exp_err;
+        uint64_t testid;
+
+        SUB_TEST_QUICK("%s OffsetCommit v9", with_v9 ? "with" : "without");
+
+        testid = test_id_generate();
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 1, 1));
+        if (!with_v9)
+                TEST_CALL_ERR__(rd_kafka_mock_set_apiversion(
+                    mcluster, RD_KAFKAP_OffsetCommit, 0, 8));
+
+        test_produce_msgs_easy_v(topic, testid, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+
+        c = create_consumer(bootstraps, topic, NULL, rd_false);
+        test_consumer_subscribe(c, topic);
+
+        while (consumed < msgcnt)
+                wait_assignment(&c, 1, (const int[]) {1}, &consumed);
+
+        exp_err = with_v9 ? RD_KAFKA_RESP_ERR_NO_ERROR
+                          : RD_KAFKA_RESP_ERR__UNSUPPORTED_FEATURE;
+        err     = rd_kafka_commit(c, NULL, rd_false /*sync*/);
+        TEST_ASSERT(err == exp_err, "Expected commit to return %s, not %s",
+                    rd_kafka_err2name(exp_err), rd_kafka_err2name(err));
+
+        if (with_v9) {
+                offsets = rd_kafka_topic_partition_list_new(1);
+                rd_kafka_topic_partition_list_add(offsets, topic, 0);
+                TEST_CALL_ERR__(rd_kafka_committed(c, offsets, 5000));
+                TEST_ASSERT(offsets->elems[0].offset == msgcnt,
+                            "Expected committed offset %d, not %" PRId64,
+                            msgcnt, offsets->elems[0].offset);
+                rd_kafka_topic_partition_list_destroy(offsets);
+        }
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0149_consumer_group_protocol(int argc, char **argv) {
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        do_test_join_leave(NULL);
+        do_test_join_leave("range");
+        do_test_unsupported_assignor();
+        do_test_commit(rd_true);
+        do_test_commit(rd_false);
+
+        return 0;
+}
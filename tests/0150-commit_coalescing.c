@@ -0,0 +1,251 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+#include "../src/rdkafka_proto.h"
+
+
+/**
+ * @name Verify that commits of the current assignment only include
+ *       partitions whose stored offset changed, and that such commits
+ *       requested while another one is in-flight are coalesced into
+ *       a single OffsetCommitRequest.
+ */
+
+
+static rd_atomic32_t commit_req_cnt;
+
+static rd_kafka_resp_err_t on_request_sent(rd_kafka_t *rk,
+                                           int sockfd,
+                                           const char *brokername,
+                                           int32_t brokerid,
+                                           int16_t ApiKey,
+                                           int16_t ApiVersion,
+                                           int32_t CorrId,
+                                           size_t size,
+                                           void *ic_opaque) {
+        if (ApiKey == RD_KAFKAP_OffsetCommit)
+                rd_atomic32_add(&commit_req_cnt, 1);
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+static rd_kafka_resp_err_t on_new_consumer(rd_kafka_t *rk,
+                                           const rd_kafka_conf_t *conf,
+                                           void *ic_opaque,
+                                           char *errstr,
+                                           size_t errstr_size) {
+        return rd_kafka_interceptor_add_on_request_sent(
+            rk, "commit_counter", on_request_sent, NULL);
+}
+
+
+/**
+ * @brief Wait for an offset commit result on \p rkqu.
+ *
+ * @returns the number of partitions in the result.
+ */
+static int wait_commit_result(rd_kafka_queue_t *rkqu, int exp_partition) {
+        rd_kafka_event_t *rkev;
+        const rd_kafka_topic_partition_list_t *offsets;
+        int cnt;
+
+        rkev = rd_kafka_queue_poll(rkqu, tmout_multip(10 * 1000));
+        TEST_ASSERT(rkev, "Timed out waiting for commit result");
+        TEST_ASSERT(rd_kafka_event_type(rkev) == RD_KAFKA_EVENT_OFFSET_COMMIT,
+                    "Expected OFFSET_COMMIT event, not %s",
+                    rd_kafka_event_name(rkev));
+        TEST_ASSERT(!rd_kafka_event_error(rkev), "Commit failed: %s",
+                    rd_kafka_event_error_string(rkev));
+
+        offsets = rd_kafka_event_topic_partition_list(rkev);
+        TEST_ASSERT(offsets, "Expected offsets in commit result");
+        cnt = offsets->cnt;
+
+        if (exp_partition != -1)
+                TEST_ASSERT(cnt == 1 &&
+                                offsets->elems[0].partition == exp_partition,
+                            "Expected only partition %d to be committed, "
+                            "got %d partition(s), first being [%" PRId32 "]",
+                            exp_partition, cnt,
+                            cnt > 0 ? offsets->elems[0].partition : -1);
+
+        rd_kafka_event_destroy(rkev);
+
+        return cnt;
+}
+
+
+static void store_offset(rd_kafka_message_t *rkm) {
+        rd_kafka_error_t *error = rd_kafka_offset_store_message(rkm);
+        TEST_ASSERT(!error, "offset_store_message() failed: %s",
+                    rd_kafka_error_string(error));
+}
+
+
+int main_0150_commit_coalescing(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_queue_t *rkqu;
+        rd_kafka_topic_partition_list_t *parts;
+        rd_kafka_message_t *first[4] = {NULL}, *last[4] = {NULL};
+        const char *topic       = "test";
+        const int partition_cnt = 4;
+        const int msgcnt        = 10 * partition_cnt;
+        int consumed            = 0;
+        int req_cnt;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(3, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_coordinator_set(mcluster, "group", topic, 1));
+
+        test_produce_msgs_easy_v(topic, 0, RD_KAFKA_PARTITION_UA, 0, msgcnt,
+                                 10, "bootstrap.servers", bootstraps, NULL);
+
+        rd_atomic32_init(&commit_req_cnt, 0);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.auto.commit", "false");
+        test_conf_set(conf, "enable.auto.offset.store", "false");
+        rd_kafka_conf_interceptor_add_on_new(conf, "on_new_consumer",
+                                             on_new_consumer, NULL);
+        c = test_create_consumer(topic, NULL, conf, NULL);
+        rkqu = rd_kafka_queue_new(c);
+
+        /* Start from the beginning to not depend on committed offsets. */
+        parts = rd_kafka_topic_partition_list_new(partition_cnt);
+        for (i = 0; i < partition_cnt; i++)
+                rd_kafka_topic_partition_list_add(parts, topic, i)->offset =
+                    RD_KAFKA_OFFSET_BEGINNING;
+        TEST_CALL_ERR__(rd_kafka_assign(c, parts));
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        /* Keep the first and last message of each partition for
+         * storing offsets below. */
+        while (consumed < msgcnt) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c, 1000);
+                if (!rkm)
+                        continue;
+                TEST_ASSERT(!rkm->err, "Consume error: %s",
+                            rd_kafka_message_errstr(rkm));
+                consumed++;
+
+                if (!first[rkm->partition])
+                        first[rkm->partition] = rkm;
+                else {
+                        if (last[rkm->partition])
+                                rd_kafka_message_destroy(last[rkm->partition]);
+                        last[rkm->partition] = rkm;
+                }
+        }
+
+
+        TEST_SAY("Committing after storing a single partition's offset\n");
+        store_offset(first[2]);
+        TEST_CALL_ERR__(rd_kafka_commit_queue(c, NULL, rkqu, NULL, NULL));
+        wait_commit_result(rkqu, 2);
+        TEST_ASSERT(rd_atomic32_get(&commit_req_cnt) == 1,
+                    "Expected 1 OffsetCommitRequest, not %d",
+                    rd_atomic32_get(&commit_req_cnt));
+
+
+        TEST_SAY("Committing while a commit is in-flight\n");
+        rd_kafka_mock_broker_set_rtt(mcluster, 1, 1000);
+
+        store_offset(first[0]);
+        store_offset(first[1]);
+        store_offset(first[3]);
+        for (i = 0; i < 5; i++)
+                TEST_CALL_ERR__(
+                    rd_kafka_commit_queue(c, NULL, rkqu, NULL, NULL));
+
+        /* Let the first commit be sent before storing a new offset. */
+        rd_usleep(300 * 1000, 0);
+
+        store_offset(last[1]);
+        for (i = 0; i < 2; i++)
+                TEST_CALL_ERR__(
+                    rd_kafka_commit_queue(c, NULL, rkqu, NULL, NULL));
+
+        /* The first commit and the ones coalesced with it */
+        for (i = 0; i < 5; i++)
+                TEST_ASSERT(wait_commit_result(rkqu, -1) == 3,
+                            "Expected 3 partitions in commit result");
+        /* The commits sent after the in-flight one */
+        for (i = 0; i < 2; i++)
+                wait_commit_result(rkqu, 1);
+
+        req_cnt = rd_atomic32_get(&commit_req_cnt);
+        TEST_ASSERT(req_cnt == 3,
+                    "Expected 3 OffsetCommitRequests in total, not %d",
+                    req_cnt);
+
+        rd_kafka_mock_broker_set_rtt(mcluster, 1, 0);
+
+
+        TEST_SAY("Verifying committed offsets\n");
+        parts = rd_kafka_topic_partition_list_new(partition_cnt);
+        for (i = 0; i < partition_cnt; i++)
+                rd_kafka_topic_partition_list_add(parts, topic, i);
+        TEST_CALL_ERR__(rd_kafka_committed(c, parts, tmout_multip(5000)));
+        for (i = 0; i < partition_cnt; i++) {
+                int64_t exp_offset =
+                    (i == 1 ? last[i] : first[i])->offset + 1;
+                TEST_ASSERT(parts->elems[i].offset == exp_offset,
+                            "Expected partition %d committed offset "
+                            "%" PRId64 ", not %" PRId64,
+                            i, exp_offset, parts->elems[i].offset);
+        }
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        for (i = 0; i < partition_cnt; i++) {
+                rd_kafka_message_destroy(first[i]);
+                if (last[i])
+                        rd_kafka_message_destroy(last[i]);
+        }
+
+        rd_kafka_queue_destroy(rkqu);
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify offset stores from multiple application threads, which
+ *       mostly take the lock-free store path, as well as stores of
+ *       decreasing offsets and stores after the partition was unassigned,
+ *       which take the locked path, and stores racing with the partition
+ *       being unassigned.
+ */
+
+
+#define STORE_THREAD_CNT 4
+
+struct store_args {
+        struct test *test;
+        rd_kafka_message_t **msgs;
+        int msgcnt;
+        int idx;
+};
+
+static void store_offset(rd_kafka_message_t *rkm) {
+        rd_kafka_error_t *error = rd_kafka_offset_store_message(rkm);
+        TEST_ASSERT(!error, "offset_store_message() failed: %s",
+                    rd_kafka_error_string(error));
+}
+
+
+static int store_thread(void *arg) {
+        struct store_args *args = arg;
+        int i;
+
+        test_curr = args->test;
+
+        /* Each thread stores every STORE_THREAD_CNT:th message's offset,
+         * in increasing order. */
+        for (i = args->idx; i < args->msgcnt; i += STORE_THREAD_CNT)
+                store_offset(args->msgs[i]);
+
+        return 0;
+}
+
+
+struct revoke_store_args {
+        struct test *test;
+        rd_kafka_message_t **msgs;
+        int msgcnt;
+        rd_atomic32_t store_cnt; /**< Number of successful stores */
+        int64_t last_offset;     /**< Last successfully stored offset */
+};
+
+/**
+ * @brief Store the messages' offsets, over and over, until the partition
+ *        is unassigned.
+ */
+static int revoke_store_thread(void *arg) {
+        struct revoke_store_args *args = arg;
+        int i                          = 0;
+
+        test_curr = args->test;
+
+        while (1) {
+                rd_kafka_message_t *rkm = args->msgs[i];
+                rd_kafka_error_t *error = rd_kafka_offset_store_message(rkm);
+
+                if (error) {
+                        TEST_ASSERT(rd_kafka_error_code(error) ==
+                                        RD_KAFKA_RESP_ERR__STATE,
+                                    "Expected offset_store_message() to "
+                                    "fail with __STATE, not %s",
+                                    rd_kafka_error_string(error));
+                        rd_kafka_error_destroy(error);
+                        break;
+                }
+
+                args->last_offset = rkm->offset;
+                rd_atomic32_add(&args->store_cnt, 1);
+                i = (i + 1) % args->msgcnt;
+        }
+
+        return 0;
+}
+
+
+static rd_atomic32_t revoke_commit_cnt;
+
+static void revoke_offset_commit_cb(rd_kafka_t *rk,
+                                    rd_kafka_resp_err_t err,
+                                    rd_kafka_topic_partition_list_t *offsets,
+                                    void *opaque) {
+        TEST_ASSERT(!err, "Commit failed: %s", rd_kafka_err2str(err));
+        rd_atomic32_add(&revoke_commit_cnt, 1);
+}
+
+
+static int64_t get_committed(rd_kafka_t *c, const char *topic) {
+        rd_kafka_topic_partition_list_t *parts;
+        int64_t offset;
+
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0);
+        TEST_CALL_ERR__(rd_kafka_committed(c, parts, tmout_multip(5000)));
+        offset = parts->elems[0].offset;
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        return offset;
+}
+
+
+static void store_and_verify(rd_kafka_t *c,
+                             const char *topic,
+                             rd_kafka_message_t *rkm) {
+        int64_t committed;
+
+        store_offset(rkm);
+        TEST_CALL_ERR__(rd_kafka_commit(c, NULL, rd_false /*sync*/));
+
+        committed = get_committed(c, topic);
+        TEST_ASSERT(committed == rkm->offset + 1,
+                    "Expected committed offset %" PRId64 ", not %" PRId64,
+                    rkm->offset + 1, committed);
+}
+
+
+/**
+ * @brief The offset committed when the partition is unassigned, with
+ *        enable.auto.commit=true, is the last offset that was successfully
+ *        stored by a thread storing offsets during the unassign.
+ */
+static void do_test_store_during_revoke(const char *bootstraps,
+                                        const char *topic,
+                                        int msgcnt) {
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_topic_partition_list_t *parts;
+        rd_kafka_message_t **msgs;
+        struct revoke_store_args args;
+        thrd_t thrd;
+        int consumed = 0;
+        int64_t committed, abs_timeout;
+        int i;
+
+        SUB_TEST_QUICK();
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.auto.commit", "true");
+        test_conf_set(conf, "auto.commit.interval.ms", "3600000");
+        test_conf_set(conf, "enable.auto.offset.store", "false");
+        rd_kafka_conf_set_offset_commit_cb(conf, revoke_offset_commit_cb);
+        c = test_create_consumer("revoke", NULL, conf, NULL);
+
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset =
+            RD_KAFKA_OFFSET_BEGINNING;
+        test_consumer_assign("assign", c, parts);
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        msgs = calloc(msgcnt, sizeof(*msgs));
+        while (consumed < msgcnt) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c, 1000);
+                if (!rkm)
+                        continue;
+                TEST_ASSERT(!rkm->err, "Consume error: %s",
+                            rd_kafka_message_errstr(rkm));
+                msgs[consumed++] = rkm;
+        }
+
+        args.test        = test_curr;
+        args.msgs        = msgs;
+        args.msgcnt      = msgcnt;
+        args.last_offset = -1;
+        rd_atomic32_init(&args.store_cnt, 0);
+        rd_atomic32_init(&revoke_commit_cnt, 0);
+
+        if (thrd_create(&thrd, revoke_store_thread, &args) != thrd_success)
+                TEST_FAIL("Failed to create store thread");
+
+        /* Unassign while the thread is storing offsets */
+        while (rd_atomic32_get(&args.store_cnt) < msgcnt)
+                rd_usleep(1000, NULL);
+        test_consumer_unassign("unassign", c);
+
+        thrd_join(thrd, NULL);
+
+        TEST_SAY("Last stored offset %" PRId64 " after %" PRId32
+                 " stores, waiting for the unassign commit\n",
+                 args.last_offset, rd_atomic32_get(&args.store_cnt));
+
+        abs_timeout = test_clock() + tmout_multip(10 * 1000) * 1000;
+        while (!rd_atomic32_get(&revoke_commit_cnt)) {
+                TEST_ASSERT(test_clock() < abs_timeout,
+                            "Timed out waiting for the unassign commit");
+                test_consumer_poll_no_msgs("commit", c, 0, 100);
+        }
+
+        committed = get_committed(c, topic);
+        TEST_ASSERT(committed == args.last_offset + 1,
+                    "Expected committed offset %" PRId64 ", not %" PRId64,
+                    args.last_offset + 1, committed);
+
+        for (i = 0; i < msgcnt; i++)
+                rd_kafka_message_destroy(msgs[i]);
+        free(msgs);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        SUB_TEST_PASS();
+}
+
+
+int main_0151_offset_store_mt(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_topic_partition_list_t *parts;
+        rd_kafka_message_t **msgs;
+        rd_kafka_error_t *error;
+        thrd_t thrds[STORE_THREAD_CNT];
+        struct store_args args[STORE_THREAD_CNT];
+        const char *topic = "test";
+        const int msgcnt  = 1000;
+        int consumed      = 0;
+        int64_t committed;
+        rd_bool_t found = rd_false;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 1, 1));
+
+        test_produce_msgs_easy_v(topic, 0, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "enable.auto.commit", "false");
+        test_conf_set(conf, "enable.auto.offset.store", "false");
+        c = test_create_consumer(topic, NULL, conf, NULL);
+
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset =
+            RD_KAFKA_OFFSET_BEGINNING;
+        test_consumer_assign("assign", c, parts);
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        msgs = calloc(msgcnt, sizeof(*msgs));
+        while (consumed < msgcnt) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c, 1000);
+                if (!rkm)
+                        continue;
+                TEST_ASSERT(!rkm->err, "Consume error: %s",
+                            rd_kafka_message_errstr(rkm));
+                msgs[consumed++] = rkm;
+        }
+
+
+        TEST_SAY("Storing increasing offsets\n");
+        store_and_verify(c, topic, msgs[10]);
+        store_and_verify(c, topic, msgs[20]);
+
+        TEST_SAY("Storing a lower offset followed by a higher one\n");
+        store_offset(msgs[5]);
+        store_and_verify(c, topic, msgs[30]);
+
+
+        TEST_SAY("Storing offsets from %d threads\n", STORE_THREAD_CNT);
+        for (i = 0; i < STORE_THREAD_CNT; i++) {
+                args[i].test   = test_curr;
+                args[i].msgs   = msgs;
+                args[i].msgcnt = msgcnt;
+                args[i].idx    = i;
+                if (thrd_create(&thrds[i], store_thread, &args[i]) !=
+                    thrd_success)
+                        TEST_FAIL("Failed to create store thread");
+        }
+        for (i = 0; i < STORE_THREAD_CNT; i++)
+                thrd_join(thrds[i], NULL);
+
+        TEST_CALL_ERR__(rd_kafka_commit(c, NULL, rd_false /*sync*/));
+
+        /* The last store wins, which is one of the threads' last ones. */
+        committed = get_committed(c, topic);
+        for (i = msgcnt - STORE_THREAD_CNT; i < msgcnt; i++)
+                found = found || committed == msgs[i]->offset + 1;
+        TEST_ASSERT(found,
+                    "Committed offset %" PRId64
+                    " is not one of the threads' last stored offsets",
+                    committed);
+
+
+        TEST_SAY("Storing an offset after unassign\n");
+        test_consumer_unassign("unassign", c);
+        error = rd_kafka_offset_store_message(msgs[msgcnt - 1]);
+        TEST_ASSERT(error && rd_kafka_error_code(error) ==
+                                 RD_KAFKA_RESP_ERR__STATE,
+                    "Expected offset_store_message() to fail with "
+                    "__STATE, not %s",
+                    error ? rd_kafka_error_string(error) : "success");
+        rd_kafka_error_destroy(error);
+
+        for (i = 0; i < msgcnt; i++)
+                rd_kafka_message_destroy(msgs[i]);
+        free(msgs);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        do_test_store_during_revoke(bootstraps, topic, msgcnt);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify that partitions retained by a consumer across an incremental
+ *       (cooperative) rebalance keep their prefetched messages rather than
+ *       having them discarded and refetched, and that the rebalance latency
+ *       is reported in the statistics.
+ */
+
+
+static int64_t c1_rxmsgs         = -1; /**< Total messages fetched */
+static int rebalance_latency_cnt = 0;  /**< Measured rebalances */
+
+static int stats_cb(rd_kafka_t *rk, char *json, size_t json_len, void *opaque) {
+        const char *s;
+
+        /* The client-wide totals are emitted last, after txmsg_bytes. */
+        if ((s = strstr(json, "\"txmsg_bytes\":")) &&
+            (s = strstr(s, "\"rxmsgs\":")))
+                c1_rxmsgs = strtoll(s + strlen("\"rxmsgs\":"), NULL, 10);
+
+        if ((s = strstr(json, "\"rebalance_latency\": {")) &&
+            (s = strstr(s, "\"cnt\":")))
+                rebalance_latency_cnt +=
+                    (int)strtol(s + strlen("\"cnt\":"), NULL, 10);
+
+        return 0;
+}
+
+
+static rd_kafka_t *create_consumer(const char *bootstraps,
+                                   const char *topic,
+                                   rd_bool_t with_stats) {
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "partition.assignment.strategy",
+                      "cooperative-sticky");
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit", "false");
+        if (with_stats) {
+                test_conf_set(conf, "statistics.interval.ms", "100");
+                rd_kafka_conf_set_stats_cb(conf, stats_cb);
+        }
+
+        c = test_create_consumer(topic, test_rebalance_cb, conf, NULL);
+        test_consumer_subscribe(c, topic);
+
+        return c;
+}
+
+
+int main_0152_cooperative_rebalance_retain(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_t *c1, *c2;
+        const char *topic            = "test";
+        const int partition_cnt      = 4;
+        const int msgs_per_partition = 500;
+        const int msgcnt             = partition_cnt * msgs_per_partition;
+        int consumed                 = 0;
+        rd_bool_t *seen;
+        int32_t partition;
+        test_timing_t t_consume;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(1, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+        for (partition = 0; partition < partition_cnt; partition++)
+                test_produce_msgs_easy_v(topic, 0, partition, 0,
+                                         msgs_per_partition, 10,
+                                         "bootstrap.servers", bootstraps,
+                                         NULL);
+
+        c1 = create_consumer(bootstraps, topic, rd_true);
+
+        /* Track which messages have been consumed, since messages of
+         * revoked partitions may be consumed by both consumers. */
+        seen = calloc(msgcnt, sizeof(*seen));
+
+        /* Consume a single message and then give the fetcher time to
+         * prefetch the remaining messages of all partitions. */
+        TEST_SAY("Consuming from the first consumer\n");
+        while (!consumed) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c1, 1000);
+                if (!rkm)
+                        continue;
+                TEST_ASSERT(!rkm->err, "Consume error: %s",
+                            rd_kafka_message_errstr(rkm));
+                seen[(int)(rkm->partition * msgs_per_partition +
+                           rkm->offset)] = rd_true;
+                consumed++;
+                rd_kafka_message_destroy(rkm);
+        }
+        rd_sleep(3);
+
+        /* Have a second consumer join the group, causing some of c1's
+         * partitions to be revoked while the others are retained. */
+        TEST_SAY("Joining second consumer\n");
+        c2 = create_consumer(bootstraps, topic, rd_false);
+
+        TIMING_START(&t_consume, "consume");
+        while (consumed < msgcnt) {
+                rd_kafka_t *cs[] = {c1, c2};
+                int i;
+
+                TIMING_ASSERT_LATER(&t_consume, 0, tmout_multip(60 * 1000));
+
+                for (i = 0; i < (int)RD_ARRAYSIZE(cs); i++) {
+                        rd_kafka_message_t *rkm =
+                            rd_kafka_consumer_poll(cs[i], 100);
+                        int idx;
+
+                        if (!rkm)
+                                continue;
+                        TEST_ASSERT(!rkm->err, "Consume error: %s",
+                                    rd_kafka_message_errstr(rkm));
+                        idx = (int)(rkm->partition * msgs_per_partition +
+                                    rkm->offset);
+                        if (!seen[idx]) {
+                                seen[idx] = rd_true;
+                                consumed++;
+                        }
+                        rd_kafka_message_destroy(rkm);
+                }
+        }
+        TIMING_STOP(&t_consume);
+        free(seen);
+
+        /* Wait for a final statistics update. */
+        test_consumer_poll_no_msgs("Wait for stats", c1, 0, 500);
+
+        TEST_SAY("c1 fetched %" PRId64 " messages, %d rebalance(s) measured\n",
+                 c1_rxmsgs, rebalance_latency_cnt);
+
+        /* Messages of revoked partitions that were prefetched are fetched
+         * again by c2, but c1 itself must not fetch any message twice. */
+        TEST_ASSERT(c1_rxmsgs > 0 && c1_rxmsgs <= msgcnt,
+                    "Expected c1 to fetch at most %d messages, not %" PRId64
+                    ": retained partitions were refetched",
+                    msgcnt, c1_rxmsgs);
+        /* Only the initial join is measured: the second rebalance merely
+         * revoked partitions from c1, so there is no message to wait for. */
+        TEST_ASSERT(rebalance_latency_cnt == 1,
+                    "Expected the rebalance latency to be measured once, "
+                    "not %d time(s)",
+                    rebalance_latency_cnt);
+
+        test_consumer_close(c1);
+        test_consumer_close(c2);
+        rd_kafka_destroy(c1);
+        rd_kafka_destroy(c2);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify that a partition assigned again starts fetching at its cached
+ *       committed offset while the committed offset is being queried, and
+ *       that messages are only delivered from the confirmed committed offset.
+ */
+
+
+static int64_t rxmsgs = -1; /**< partition 0 rxmsgs from the last stats */
+
+/**
+ * @brief Assign partition 0 of \p topic and verify that the first consumed
+ *        message is at \p exp_offset.
+ *
+ * @returns the number of messages fetched before the first message was
+ *          consumed.
+ */
+static int64_t assign_and_verify(rd_kafka_t *c,
+                                 const char *topic,
+                                 int64_t exp_offset) {
+        rd_kafka_topic_partition_list_t *parts;
+        rd_kafka_message_t *rkm;
+        int64_t rxmsgs_start, rxmsgs_before_msg = -1;
+
+        rxmsgs_start = rxmsgs;
+
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0);
+        test_consumer_assign("assign", c, parts);
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        do {
+                rxmsgs_before_msg = rxmsgs;
+                rkm               = rd_kafka_consumer_poll(c, 100);
+        } while (!rkm);
+
+        TEST_ASSERT(!rkm->err, "Consume error: %s",
+                    rd_kafka_message_errstr(rkm));
+        TEST_ASSERT(rkm->offset == exp_offset,
+                    "Expected first message at offset %" PRId64
+                    ", not %" PRId64,
+                    exp_offset, rkm->offset);
+        rd_kafka_message_destroy(rkm);
+
+        test_consumer_unassign("unassign", c);
+
+        /* Wait for the statistics to settle. */
+        test_consumer_poll_no_msgs("Wait for stats", c, 0, 500);
+
+        return rxmsgs_before_msg - rxmsgs_start;
+}
+
+
+int main_0153_committed_offset_cache(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c1, *c2;
+        rd_kafka_topic_partition_list_t *parts;
+        const char *topic = "test";
+        const int msgcnt  = 100;
+        int64_t prefetched;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(2, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 1, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_partition_set_leader(mcluster, topic, 0, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_coordinator_set(mcluster, "group", topic, 2));
+
+        test_produce_msgs_easy_v(topic, 0, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit", "false");
+        test_conf_set_partition0_rxmsgs(conf, &rxmsgs);
+        c1 = test_create_consumer(topic, NULL, conf, NULL);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        c2 = test_create_consumer(topic, NULL, conf, NULL);
+
+        /* Nothing committed yet, consume the first message and commit. */
+        assign_and_verify(c1, topic, 0);
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset = 10;
+        TEST_CALL_ERR__(rd_kafka_commit(c1, parts, rd_false /*sync*/));
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        /* Delay the OffsetFetch responses so that fetching at the cached
+         * committed offset has time to start. */
+        rd_kafka_mock_broker_set_rtt(mcluster, 2, 2000);
+
+        TEST_SAY("Assigning with our own committed offset cached\n");
+        prefetched = assign_and_verify(c1, topic, 10);
+        TEST_SAY("%" PRId64 " message(s) fetched before first message\n",
+                 prefetched);
+        TEST_ASSERT(prefetched > 0,
+                    "Expected fetching to start at the cached committed "
+                    "offset before the committed offset was fetched");
+
+        TEST_SAY("Assigning with an outdated committed offset cached\n");
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset = 50;
+        TEST_CALL_ERR__(rd_kafka_commit(c2, parts, rd_false /*sync*/));
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        assign_and_verify(c1, topic, 50);
+
+        rd_kafka_mock_broker_set_rtt(mcluster, 2, 0);
+
+        test_consumer_close(c1);
+        test_consumer_close(c2);
+        rd_kafka_destroy(c1);
+        rd_kafka_destroy(c2);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify custom partition assignors added with
+ *       rd_kafka_conf_add_partition_assignor(), and the assignor context
+ *       accessors.
+ */
+
+
+static const char *topic;
+static rd_atomic32_t assign_cnt; /**< Number of assign_cb calls */
+
+/**
+ * @brief Assigns partition i of each topic to the topic's
+ *        i % subscribed member count:th member, after verifying the context.
+ */
+static rd_kafka_resp_err_t assign_cb(rd_kafka_t *rk,
+                                     rd_kafka_assignor_ctx_t *ctx,
+                                     char *errstr,
+                                     size_t errstr_size,
+                                     void *opaque) {
+        const rd_kafka_metadata_topic_t *mdt;
+        int member_cnt = rd_kafka_assignor_ctx_member_cnt(ctx);
+        int i, ti;
+
+        TEST_ASSERT(opaque == (void *)&assign_cnt, "Wrong opaque %p", opaque);
+        TEST_ASSERT(member_cnt == 2, "Expected 2 members, not %d", member_cnt);
+        TEST_ASSERT(rd_kafka_assignor_ctx_topic_cnt(ctx) == 1,
+                    "Expected 1 eligible topic, not %d",
+                    rd_kafka_assignor_ctx_topic_cnt(ctx));
+
+        for (i = 0; i < member_cnt; i++) {
+                const rd_kafka_topic_partition_list_t *subscription =
+                    rd_kafka_assignor_ctx_member_subscription(ctx, i);
+                const char *rack = rd_kafka_assignor_ctx_member_rack(ctx, i);
+
+                TEST_ASSERT(rd_kafka_assignor_ctx_member_id(ctx, i),
+                            "Expected member id");
+                TEST_ASSERT(rack && !strcmp(rack, "rack1"),
+                            "Expected member rack \"rack1\", not %s",
+                            rack ? rack : "(null)");
+                TEST_ASSERT(subscription && subscription->cnt == 1 &&
+                                !strcmp(subscription->elems[0].topic, topic),
+                            "Expected subscription to %s", topic);
+        }
+        TEST_ASSERT(!rd_kafka_assignor_ctx_member_id(ctx, member_cnt),
+                    "Expected NULL member id for out of range index");
+
+        for (ti = 0; ti < rd_kafka_assignor_ctx_topic_cnt(ctx); ti++) {
+                int topic_member_cnt =
+                    rd_kafka_assignor_ctx_topic_member_cnt(ctx, ti);
+
+                mdt = rd_kafka_assignor_ctx_topic(ctx, ti);
+                TEST_ASSERT(!strcmp(mdt->topic, topic),
+                            "Expected topic %s, not %s", topic, mdt->topic);
+                TEST_ASSERT(topic_member_cnt == 2,
+                            "Expected 2 subscribed members, not %d",
+                            topic_member_cnt);
+
+                for (i = 0; i < mdt->partition_cnt; i++) {
+                        const char *rack =
+                            rd_kafka_assignor_ctx_partition_rack(ctx, ti, i, 0);
+                        int member_idx = rd_kafka_assignor_ctx_topic_member(
+                            ctx, ti, i % topic_member_cnt);
+
+                        TEST_ASSERT(rd_kafka_assignor_ctx_partition_rack_cnt(
+                                        ctx, ti, i) == 1 &&
+                                        rack && !strcmp(rack, "rack1"),
+                                    "Expected partition %d replica rack "
+                                    "\"rack1\", not %s",
+                                    i, rack ? rack : "(null)");
+
+                        TEST_CALL_ERR__(rd_kafka_assignor_ctx_assign(
+                            ctx, member_idx, ti, i));
+                }
+
+                TEST_ASSERT(rd_kafka_assignor_ctx_assign(
+                                ctx, 0, ti, mdt->partition_cnt) ==
+                                RD_KAFKA_RESP_ERR__INVALID_ARG,
+                            "Expected assign of unknown partition to fail");
+        }
+
+        rd_atomic32_add(&assign_cnt, 1);
+
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+
+static rd_kafka_conf_t *create_conf(const char *bootstraps) {
+        rd_kafka_conf_t *conf;
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "client.rack", "rack1");
+        test_conf_set(conf, "partition.assignment.strategy", "modulo");
+        TEST_CALL_ERR__(rd_kafka_conf_add_partition_assignor(
+            conf, "modulo", "EAGER", assign_cb, &assign_cnt));
+
+        return conf;
+}
+
+
+int main_0154_custom_assignor(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c[2];
+        char errstr[512];
+        const int partition_cnt = 4;
+        int assigned_cnt        = 0;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        topic = test_mk_topic_name(__FUNCTION__, 1);
+        rd_atomic32_init(&assign_cnt, 0);
+
+        mcluster = test_mock_cluster_new(3, &bootstraps);
+        for (i = 1; i <= 3; i++)
+                TEST_CALL_ERR__(
+                    rd_kafka_mock_broker_set_rack(mcluster, i, "rack1"));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+
+
+        TEST_SAY("Verifying invalid custom assignors\n");
+        conf = create_conf(bootstraps);
+        TEST_ASSERT(rd_kafka_conf_add_partition_assignor(
+                        conf, "modulo", "EAGER", assign_cb, NULL) ==
+                        RD_KAFKA_RESP_ERR__CONFLICT,
+                    "Expected duplicate assignor to fail");
+        TEST_ASSERT(rd_kafka_conf_add_partition_assignor(
+                        conf, "other", "SOMETIMES", assign_cb, NULL) ==
+                        RD_KAFKA_RESP_ERR__INVALID_ARG,
+                    "Expected unknown rebalance protocol to fail");
+        TEST_CALL_ERR__(rd_kafka_conf_add_partition_assignor(
+            conf, "range", "EAGER", assign_cb, NULL));
+        test_conf_set(conf, "group.id", topic);
+        TEST_ASSERT(!rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr,
+                                  sizeof(errstr)),
+                    "Expected rd_kafka_new() to fail for an assignor "
+                    "named as a builtin one");
+        TEST_SAY("rd_kafka_new() failed as expected: %s\n", errstr);
+        rd_kafka_conf_destroy(conf);
+
+
+        TEST_SAY("Running custom assignor\n");
+        conf = create_conf(bootstraps);
+        /* The second consumer's configuration is a copy. */
+        c[1] = test_create_consumer(topic, NULL, rd_kafka_conf_dup(conf),
+                                    NULL);
+        c[0] = test_create_consumer(topic, NULL, conf, NULL);
+
+        for (i = 0; i < 2; i++)
+                test_consumer_subscribe(c[i], topic);
+
+        while (assigned_cnt < partition_cnt) {
+                assigned_cnt = 0;
+                for (i = 0; i < 2; i++) {
+                        rd_kafka_topic_partition_list_t *parts;
+                        rd_kafka_message_t *rkm;
+
+                        /* The topic is empty: only serve the rebalance. */
+                        rkm = rd_kafka_consumer_poll(c[i], 100);
+                        TEST_ASSERT(!rkm, "Did not expect a message");
+                        TEST_CALL_ERR__(rd_kafka_assignment(c[i], &parts));
+                        /* Wait for both consumers to be assigned. */
+                        assigned_cnt += parts->cnt > 0 ? parts->cnt : -100;
+                        rd_kafka_topic_partition_list_destroy(parts);
+                }
+        }
+
+        TEST_ASSERT(assigned_cnt == partition_cnt,
+                    "Expected %d assigned partitions, not %d", partition_cnt,
+                    assigned_cnt);
+        TEST_ASSERT(rd_atomic32_get(&assign_cnt) > 0,
+                    "Expected custom assignor to be called");
+
+        for (i = 0; i < 2; i++) {
+                test_consumer_close(c[i]);
+                rd_kafka_destroy(c[i]);
+        }
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+#include "../src/rdkafka_proto.h"
+
+
+/**
+ * @name Verify that consumer lag monitoring requests the log start offsets
+ *       of all partitions with one ListOffsetsRequest per leader broker.
+ */
+
+
+#define BROKER_CNT 2
+
+static rd_atomic32_t list_offsets_cnt[BROKER_CNT + 1];
+
+static rd_kafka_resp_err_t on_request_sent(rd_kafka_t *rk,
+                                           int sockfd,
+                                           const char *brokername,
+                                           int32_t brokerid,
+                                           int16_t ApiKey,
+                                           int16_t ApiVersion,
+                                           int32_t CorrId,
+                                           size_t size,
+                                           void *ic_opaque) {
+        if (ApiKey == RD_KAFKAP_ListOffsets && brokerid >= 1 &&
+            brokerid <= BROKER_CNT)
+                rd_atomic32_add(&list_offsets_cnt[brokerid], 1);
+        return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+static rd_kafka_resp_err_t on_new_consumer(rd_kafka_t *rk,
+                                           const rd_kafka_conf_t *conf,
+                                           void *ic_opaque,
+                                           char *errstr,
+                                           size_t errstr_size) {
+        return rd_kafka_interceptor_add_on_request_sent(
+            rk, "list_offsets_counter", on_request_sent, NULL);
+}
+
+
+/**
+ * @returns the number of partitions with a known low watermark.
+ */
+static int known_lo_offset_cnt(rd_kafka_t *c,
+                               const char *topic,
+                               int partition_cnt) {
+        int i, cnt = 0;
+
+        for (i = 0; i < partition_cnt; i++) {
+                int64_t lo, hi;
+
+                TEST_CALL_ERR__(
+                    rd_kafka_get_watermark_offsets(c, topic, i, &lo, &hi));
+                if (lo == 0)
+                        cnt++;
+        }
+
+        return cnt;
+}
+
+
+int main_0155_consumer_lag_batch(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_topic_partition_list_t *parts;
+        const char *topic       = "test";
+        const int partition_cnt = 8;
+        test_timing_t t_lag;
+        int i;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        mcluster = test_mock_cluster_new(BROKER_CNT, &bootstraps);
+        TEST_CALL_ERR__(
+            rd_kafka_mock_topic_create(mcluster, topic, partition_cnt, 1));
+        for (i = 0; i < partition_cnt; i++)
+                TEST_CALL_ERR__(rd_kafka_mock_partition_set_leader(
+                    mcluster, topic, i, 1 + (i % BROKER_CNT)));
+
+        /* The log start offset is only requested separately from brokers
+         * that do not return it in FetchResponses (Fetch < v5). */
+        TEST_CALL_ERR__(rd_kafka_mock_set_apiversion(
+            mcluster, RD_KAFKAP_Fetch, 0, 4));
+
+        for (i = 1; i <= BROKER_CNT; i++)
+                rd_atomic32_init(&list_offsets_cnt[i], 0);
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "statistics.interval.ms", "1000");
+        rd_kafka_conf_interceptor_add_on_new(conf, "on_new_consumer",
+                                             on_new_consumer, NULL);
+        c = test_create_consumer(topic, NULL, conf, NULL);
+
+        /* Start at an absolute offset to not query offsets when
+         * starting to fetch. */
+        parts = rd_kafka_topic_partition_list_new(partition_cnt);
+        for (i = 0; i < partition_cnt; i++)
+                rd_kafka_topic_partition_list_add(parts, topic, i)->offset = 0;
+        TEST_CALL_ERR__(rd_kafka_assign(c, parts));
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        TEST_SAY("Waiting for the low watermarks of %d partitions\n",
+                 partition_cnt);
+        TIMING_START(&t_lag, "consumer lag");
+        while (known_lo_offset_cnt(c, topic, partition_cnt) < partition_cnt) {
+                rd_kafka_message_t *rkm = rd_kafka_consumer_poll(c, 500);
+                if (rkm)
+                        rd_kafka_message_destroy(rkm);
+                TEST_ASSERT(TIMING_DURATION(&t_lag) < 30 * 1000 * 1000,
+                            "Timed out waiting for low watermarks");
+        }
+        TIMING_STOP(&t_lag);
+
+        /* One request per leader and interval, rather than one per
+         * partition. */
+        for (i = 1; i <= BROKER_CNT; i++) {
+                int cnt = rd_atomic32_get(&list_offsets_cnt[i]);
+                TEST_SAY("Broker %d: %d ListOffsetsRequest(s)\n", i, cnt);
+                TEST_ASSERT(cnt >= 1 && cnt < partition_cnt / BROKER_CNT,
+                            "Expected fewer ListOffsetsRequests to broker %d "
+                            "than its %d partitions, not %d",
+                            i, partition_cnt / BROKER_CNT, cnt);
+        }
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        test_mock_cluster_destroy(mcluster);
+
+        return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * librdkafka - Apache Kafka C library
+ *
+ * Copyright (c) 2023, Confluent Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test.h"
+
+
+/**
+ * @name Verify that a static group member writes its assignment snapshot
+ *       on close, and that the next run prefetches the snapshot's
+ *       partitions while rejoining the group and delivers messages from
+ *       the committed offset.
+ */
+
+
+static int64_t rxmsgs = -1; /**< partition 0 rxmsgs from the last stats */
+
+static rd_kafka_t *create_consumer(const char *bootstraps,
+                                   const char *topic,
+                                   const char *path) {
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+
+        test_conf_init(&conf, NULL, 60);
+        test_conf_set(conf, "bootstrap.servers", bootstraps);
+        test_conf_set(conf, "group.instance.id", "instance1");
+        test_conf_set(conf, "group.assignment.snapshot.path", path);
+        test_conf_set(conf, "auto.offset.reset", "earliest");
+        test_conf_set(conf, "enable.auto.commit", "false");
+        test_conf_set(conf, "session.timeout.ms", "6000");
+        test_conf_set_partition0_rxmsgs(conf, &rxmsgs);
+        c = test_create_consumer(topic, NULL, conf, NULL);
+
+        test_consumer_subscribe(c, topic);
+
+        return c;
+}
+
+
+/**
+ * @brief Consume the first message and verify its offset.
+ *
+ * @returns the number of messages fetched before the first message was
+ *          consumed.
+ */
+static int64_t consume_first(rd_kafka_t *c, int64_t exp_offset) {
+        rd_kafka_message_t *rkm;
+        int64_t rxmsgs_before_msg;
+
+        do {
+                rxmsgs_before_msg = rxmsgs;
+                rkm               = rd_kafka_consumer_poll(c, 100);
+        } while (!rkm);
+
+        TEST_ASSERT(!rkm->err, "Consume error: %s",
+                    rd_kafka_message_errstr(rkm));
+        TEST_ASSERT(rkm->offset == exp_offset,
+                    "Expected first message at offset %" PRId64
+                    ", not %" PRId64,
+                    exp_offset, rkm->offset);
+        rd_kafka_message_destroy(rkm);
+
+        return rxmsgs_before_msg;
+}
+
+
+int main_0156_static_membership_snapshot(int argc, char **argv) {
+        const char *bootstraps;
+        rd_kafka_mock_cluster_t *mcluster;
+        rd_kafka_conf_t *conf;
+        rd_kafka_t *c;
+        rd_kafka_topic_partition_list_t *parts;
+        const char *topic = test_mk_topic_name(__FUNCTION__, 1);
+        const int msgcnt  = 100;
+        char path[256], exp_line[256], line[256], errstr[512];
+        char tmppath[sizeof(path) + 5];
+        int64_t prefetched;
+        rd_bool_t found = rd_false;
+        int linecnt     = 0;
+        FILE *fp;
+
+        if (test_needs_auth()) {
+                TEST_SKIP("Mock cluster does not support SSL/SASL\n");
+                return 0;
+        }
+
+        rd_snprintf(path, sizeof(path), "%s.snapshot", topic);
+        remove(path);
+
+        mcluster = test_mock_cluster_new(2, &bootstraps);
+        TEST_CALL_ERR__(rd_kafka_mock_topic_create(mcluster, topic, 1, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_partition_set_leader(mcluster, topic, 0, 1));
+        TEST_CALL_ERR__(
+            rd_kafka_mock_coordinator_set(mcluster, "group", topic, 2));
+
+        test_produce_msgs_easy_v(topic, 0, 0, 0, msgcnt, 10,
+                                 "bootstrap.servers", bootstraps, NULL);
+
+
+        TEST_SAY("First run: committing offset 10 and closing\n");
+        c = create_consumer(bootstraps, topic, path);
+        consume_first(c, 0);
+
+        parts = rd_kafka_topic_partition_list_new(1);
+        rd_kafka_topic_partition_list_add(parts, topic, 0)->offset = 10;
+        TEST_CALL_ERR__(rd_kafka_commit(c, parts, rd_false /*sync*/));
+        rd_kafka_topic_partition_list_destroy(parts);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        fp = fopen(path, "r");
+        TEST_ASSERT(fp, "Expected assignment snapshot %s to be written",
+                    path);
+        rd_snprintf(exp_line, sizeof(exp_line), "%s 0 10\n", topic);
+        while (fgets(line, sizeof(line), fp)) {
+                /* The partition count follows the three header lines. */
+                if (++linecnt == 4)
+                        TEST_ASSERT(!strcmp(line, "1\n"),
+                                    "Expected a partition count of 1 in "
+                                    "assignment snapshot %s, not \"%s\"",
+                                    path, line);
+                found = found || !strcmp(line, exp_line);
+        }
+        fclose(fp);
+        TEST_ASSERT(found, "Expected \"%s 0 10\" in assignment snapshot %s",
+                    topic, path);
+
+        /* The snapshot is written to a temporary file that is renamed
+         * over the previous snapshot. */
+        rd_snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+        fp = fopen(tmppath, "r");
+        TEST_ASSERT(!fp, "Expected temporary snapshot %s to be renamed",
+                    tmppath);
+
+
+        /* Delay the group coordinator's responses so that prefetching
+         * has time to start while rejoining. */
+        rd_kafka_mock_broker_set_rtt(mcluster, 2, 1000);
+
+        TEST_SAY("Second run: prefetching the snapshot while rejoining\n");
+        rxmsgs = -1;
+        c      = create_consumer(bootstraps, topic, path);
+        prefetched = consume_first(c, 10);
+        TEST_SAY("%" PRId64 " message(s) fetched before first message\n",
+                 prefetched);
+        TEST_ASSERT(prefetched > 0,
+                    "Expected the snapshot's partition to be fetched "
+                    "before the first message was delivered");
+
+        rd_kafka_mock_broker_set_rtt(mcluster, 2, 0);
+
+        test_consumer_close(c);
+        rd_kafka_destroy(c);
+
+        remove(path);
+
+        test_mock_cluster_destroy(mcluster);
+
+
+        TEST_SAY("Verifying that the snapshot requires group.instance.id\n");
+        test_conf_init(&conf, NULL, 0);
+        test_conf_set(conf, "group.id", topic);
+        test_conf_set(conf, "group.assignment.snapshot.path", path);
+        c = rd_kafka_new(RD_KAFKA_CONSUMER, conf, errstr, sizeof(errstr));
+        TEST_ASSERT(!c, "Expected rd_kafka_new() to fail");
+        TEST_ASSERT(strstr(errstr, "group.instance.id"),
+                    "Unexpected error: %s", errstr);
+        rd_kafka_conf_destroy(conf);
+
+        return 0;
+}
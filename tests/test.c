@@ -247,6 +247,23 @@ _TEST_DECL(0136_resolve_cb);
 _TEST_DECL(0137_barrier_batch_consume);
 _TEST_DECL(0138_admin_mock);
 _TEST_DECL(0139_offset_validation_mock);
+_TEST_DECL(0140_producer_memory_limit);
+_TEST_DECL(0141_fetch_sessions);
+_TEST_DECL(0142_fetch_pipelining);
+_TEST_DECL(0143_consumer_prefetch_budget);
+_TEST_DECL(0144_fetch_decode_threads);
+_TEST_DECL(0145_consume_columns);
+_TEST_DECL(0146_consume_filter);
+_TEST_DECL(0147_fetch_replica_selection);
+_TEST_DECL(0148_fetch_scheduling);
+_TEST_DECL(0149_consumer_group_protocol);
+_TEST_DECL(0150_commit_coalescing);
+_TEST_DECL(0151_offset_store_mt);
+_TEST_DECL(0152_cooperative_rebalance_retain);
+_TEST_DECL(0153_committed_offset_cache);
+_TEST_DECL(0154_custom_assignor);
+_TEST_DECL(0155_consumer_lag_batch);
+_TEST_DECL(0156_static_membership_snapshot);
 
 
 /* Manual tests */
@@ -494,6 +511,23 @@ struct test tests[] = {
     _TEST(0137_barrier_batch_consume, 0),
     _TEST(0138_admin_mock, TEST_F_LOCAL, TEST_BRKVER(2, 4, 0, 0)),
     _TEST(0139_offset_validation_mock, 0),
+    _TEST(0140_producer_memory_limit, TEST_F_LOCAL),
+    _TEST(0141_fetch_sessions, TEST_F_LOCAL),
+    _TEST(0142_fetch_pipelining, TEST_F_LOCAL),
+    _TEST(0143_consumer_prefetch_budget, TEST_F_LOCAL),
+    _TEST(0144_fetch_decode_threads, TEST_F_LOCAL),
+    _TEST(0145_consume_columns, TEST_F_LOCAL),
+    _TEST(0146_consume_filter, TEST_F_LOCAL),
+    _TEST(0147_fetch_replica_selection, TEST_F_LOCAL),
+    _TEST(0148_fetch_scheduling, TEST_F_LOCAL),
+    _TEST(0149_consumer_group_protocol, TEST_F_LOCAL),
+    _TEST(0150_commit_coalescing, TEST_F_LOCAL),
+    _TEST(0151_offset_store_mt, TEST_F_LOCAL),
+    _TEST(0152_cooperative_rebalance_retain, TEST_F_LOCAL),
+    _TEST(0153_committed_offset_cache, TEST_F_LOCAL),
+    _TEST(0154_custom_assignor, TEST_F_LOCAL),
+    _TEST(0155_consumer_lag_batch, TEST_F_LOCAL),
+    _TEST(0156_static_membership_snapshot, TEST_F_LOCAL),
 
     /* Manual tests */
     _TEST(8000_idle, TEST_F_MANUAL),
@@ -3033,6 +3067,29 @@ void test_consumer_assign_partition(const char *what,
 }
 
 
+/**
+ * @brief Assign partitions 0..\p partition_cnt-1 of \p topic, all with
+ *        the same starting offset.
+ */
+void test_consumer_assign_topic(const char *what,
+                                rd_kafka_t *rk,
+                                const char *topic,
+                                int partition_cnt,
+                                int64_t offset) {
+        rd_kafka_topic_partition_list_t *parts;
+        int i;
+
+        parts = rd_kafka_topic_partition_list_new(partition_cnt);
+        for (i = 0; i < partition_cnt; i++)
+                rd_kafka_topic_partition_list_add(parts, topic, i)->offset =
+                    offset;
+
+        test_consumer_assign(what, rk, parts);
+
+        rd_kafka_topic_partition_list_destroy(parts);
+}
+
+
 void test_consumer_pause_resume_partition(rd_kafka_t *rk,
                                           const char *topic,
                                           int32_t partition,
@@ -4396,6 +4453,33 @@ void test_conf_set(rd_kafka_conf_t *conf, const char *name, const char *val) {
                           errstr);
 }
 
+
+static int test_partition0_rxmsgs_stats_cb(rd_kafka_t *rk,
+                                           char *json,
+                                           size_t json_len,
+                                           void *opaque) {
+        int64_t *rxmsgsp = opaque;
+        const char *s;
+
+        if ((s = strstr(json, "\"partition\":0, \"broker\":")) &&
+            (s = strstr(s, "\"rxmsgs\":")))
+                *rxmsgsp = strtoll(s + strlen("\"rxmsgs\":"), NULL, 10);
+
+        return 0;
+}
+
+/**
+ * @brief Emit statistics every 100ms and keep \p *rxmsgsp updated with
+ *        the number of messages fetched for partition 0.
+ *
+ * @remark Sets the configuration's opaque.
+ */
+void test_conf_set_partition0_rxmsgs(rd_kafka_conf_t *conf, int64_t *rxmsgsp) {
+        test_conf_set(conf, "statistics.interval.ms", "100");
+        rd_kafka_conf_set_stats_cb(conf, test_partition0_rxmsgs_stats_cb);
+        rd_kafka_conf_set_opaque(conf, rxmsgsp);
+}
+
 /**
  * @brief Get configuration value for property \p name.
  *
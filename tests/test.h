@@ -674,6 +674,11 @@ void test_consumer_assign_partition(const char *what,
                                     const char *topic,
                                     int32_t partition,
                                     int64_t offset);
+void test_consumer_assign_topic(const char *what,
+                                rd_kafka_t *rk,
+                                const char *topic,
+                                int partition_cnt,
+                                int64_t offset);
 void test_consumer_pause_resume_partition(rd_kafka_t *rk,
                                           const char *topic,
                                           int32_t partition,
@@ -684,6 +689,7 @@ void test_consumer_close(rd_kafka_t *rk);
 void test_flush(rd_kafka_t *rk, int timeout_ms);
 
 void test_conf_set(rd_kafka_conf_t *conf, const char *name, const char *val);
+void test_conf_set_partition0_rxmsgs(rd_kafka_conf_t *conf, int64_t *rxmsgsp);
 char *test_topic_conf_get(const rd_kafka_topic_conf_t *tconf, const char *name);
 int test_conf_match(rd_kafka_conf_t *conf, const char *name, const char *val);
 void test_topic_conf_set(rd_kafka_topic_conf_t *tconf,